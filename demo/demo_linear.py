@@ -3,6 +3,7 @@ import requests
 import matplotlib.pyplot as plt
 import match
 import match.nn
+import match.optim
 import torch
 import torch.nn
 from match.tensorbase import TensorBase
@@ -16,48 +17,37 @@ from math import prod
 class MNISTClassifier(match.nn.Module):
     def __init__(self, num_input_features, num_output_features):
         super().__init__()
-        self.linear1 = match.nn.Linear(num_input_features, 128)
-        self.relu1 = match.nn.Sigmoid()
+        # The activations are fused into the layers' GEMMs.
+        self.linear1 = match.nn.Linear(num_input_features, 128, activation="sigmoid")
 
-        self.linear2 = match.nn.Linear(128, 64)
-        self.relu2 = match.nn.ReLU()
+        self.linear2 = match.nn.Linear(128, 64, activation="relu")
 
-        self.linear3 = match.nn.Linear(64, 32)
-        self.relu3 = match.nn.ReLU()
+        self.linear3 = match.nn.Linear(64, 32, activation="relu")
 
         self.output = match.nn.Linear(32, num_output_features)
-        self.softmax = match.nn.Softmax(1)
 
     def forward(self, x: match.Tensor) -> match.Tensor:
-        o1 = self.relu1(self.linear1(x))
+        o1 = self.linear1(x)
 
-        o2 = self.relu2(self.linear2(o1))
+        o2 = self.linear2(o1)
 
-        o3 = self.relu3(self.linear3(o2))
+        o3 = self.linear3(o2)
 
-        return self.softmax(self.output(o3))
+        # Logits; CrossEntropyLoss applies the (log) softmax itself.
+        return self.output(o3)
 
 
-def torch_to_match(
-    X: torch.Tensor, Y: torch.Tensor, p: float = 1, loading_msg: str | None = None
-):
+def torch_to_match(X: torch.Tensor, Y: torch.Tensor, p: float = 1):
     assert p > 0 and p <= 1
     num_total_instances, num_features = X.data.shape[0], prod(X.data.shape[1:])
     num_instances = int(num_total_instances * p)
 
-    X = X.data.reshape((num_total_instances, num_features))
-    Y = Y.data
-
-    X_match = TensorBase((num_instances, num_features))
-    Y_match = TensorBase((num_instances, 10))
-    Y_match.fill_(0)
+    X = X.data.reshape((num_total_instances, num_features))[:num_instances]
+    Y = Y.data[:num_instances]
 
-    load_sequence = list(range(num_instances))
-    random.shuffle(load_sequence)
-    for r in tqdm(load_sequence, desc=loading_msg, leave=True):
-        for c in range(num_features):
-            X_match[r, c] = X[r, c].item()
-        Y_match[r, Y[r].item()] = 1
+    # TensorBase copies (and converts) the elements of any buffer exporter in one pass.
+    X_match = TensorBase(X.numpy(), dtype="float64")
+    Y_match = TensorBase(Y.numpy(), dtype="int64")
 
     return match.Tensor(X_match), match.Tensor(Y_match)
 
@@ -82,7 +72,7 @@ def test_model(
     X_test: match.Tensor,
     Y_test: match.Tensor,
 ):
-    accuracy = {k: [0, 0] for k in range(Y_test.shape[1])}
+    accuracy = {k: [0, 0] for k in range(10)}
     num_instances = X_test.shape[0]
     total_correct = 0
     loss = 0
@@ -93,7 +83,7 @@ def test_model(
         loss += lossfn(prediction, target)
 
         prediction_arg_max = prediction.argmax().item()
-        target_arg_max = target.argmax().item()
+        target_arg_max = int(target.item())
 
         correct = int(prediction_arg_max == target_arg_max)
         total_correct += correct
@@ -112,22 +102,12 @@ if __name__ == "__main__":
         root="data", train=False, download=True, transform=ToTensor()
     )
     print("Transforming data into Match compatable format...")
-    X, Y = torch_to_match(
-        training_data.data,
-        training_data.targets,
-        p=0.1,
-        loading_msg="Loading training data...",
-    )
-    X_test, Y_test = torch_to_match(
-        testing_data.data,
-        testing_data.targets,
-        p=0.1,
-        loading_msg="Loading testing data...",
-    )
+    X, Y = torch_to_match(training_data.data, training_data.targets, p=0.1)
+    X_test, Y_test = torch_to_match(testing_data.data, testing_data.targets, p=0.1)
     num_instances, num_input_features, num_output_features = (
         X.shape[0],
         X.shape[1],
-        Y.shape[1],
+        10,
     )
     print(f"Number of instances: {num_instances}")
     print(f"Number of input features: {num_input_features}")
@@ -136,7 +116,8 @@ if __name__ == "__main__":
     model = MNISTClassifier(num_input_features, num_output_features)
     epochs = 10
     learning_rate = 0.04
-    lossfn = match.nn.MultiClassCrossEntropyLoss()
+    lossfn = match.nn.CrossEntropyLoss()
+    optimizer = match.optim.SGD(model.parameters(), lr=learning_rate)
     batch_size = 128
 
     train_losses = []
@@ -168,9 +149,8 @@ if __name__ == "__main__":
 
                 # Backpropagation
                 loss.backward()
-                for param in model.parameters():
-                    param.data -= learning_rate * param.grad
-                model.zero_grad()
+                optimizer.step()
+                optimizer.zero_grad()
 
                 # Update progress bar with current loss
                 progress_bar.set_postfix(loss=f"{loss.data.item():.4f}")
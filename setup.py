@@ -8,15 +8,24 @@ tensorbase_module = Extension(
         f"{DIR}/tensorbasemodule.c",
         f"{DIR}/tensorbase_aggregation.c",
         f"{DIR}/tensorbase_alloc.c",
+        f"{DIR}/tensorbase_attention.c",
         f"{DIR}/tensorbase_broadcasting.c",
+        f"{DIR}/tensorbase_convolution.c",
+        f"{DIR}/tensorbase_dispatch.c",
+        f"{DIR}/tensorbase_gemm.c",
         f"{DIR}/tensorbase_linalg.c",
+        f"{DIR}/tensorbase_linear.c",
+        f"{DIR}/tensorbase_normalization.c",
+        f"{DIR}/tensorbase_optim.c",
+        f"{DIR}/tensorbase_parallel.c",
+        f"{DIR}/tensorbase_softmax.c",
         f"{DIR}/tensorbase_string.c",
         f"{DIR}/tensorbase_transform.c",
         f"{DIR}/tensorbase_util.c",
         f"{DIR}/tensorbase_subscripting.c",
     ],
     include_dirs=[DIR],
-    extra_compile_args=["-fvisibility=default"],
+    extra_compile_args=["-fvisibility=default", "-fno-math-errno"],
     extra_link_args=["-undefined", "dynamic_lookup"]
 )
 
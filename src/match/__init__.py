@@ -4,29 +4,107 @@ from .tensor import Tensor
 from match.tensorbase import TensorBase
 
 
-def cat(tensors: list[Tensor], dim=0) -> Tensor:
-    """_summary_
+def cat(tensors: list[Tensor], dim: int = 0) -> Tensor:
+    """
+    Concatenate tensors along an existing dimension.
 
     Args:
-        tensors (list[Tensor]): _description_
-        dim (int, optional): _description_. Defaults to 0.
+        tensors (list[Tensor]): Tensors of the same dtype, whose shapes match except along dim.
+        dim (int, optional): The dimension to join along. Defaults to 0.
 
     Returns:
-        Tensor: _description_
+        Tensor: A new tensor whose size along dim is the sum of the inputs' sizes.
     """
-    # Store the underlying TensorBase objects.
-    TensorBase_objects = [tensor.data for tensor in tensors]
-    # Concatenate the TensorBase objects into a single object.
-    concatenated_TensorBase_objects = TensorBase.concatenate(
-        TensorBases=TensorBase_objects, dim=dim
+    tensors = list(tensors)
+    result = Tensor(
+        TensorBase.concatenate([tensor.data for tensor in tensors], dim),
+        children=tuple(tensors),
     )
-    return Tensor(data=concatenated_TensorBase_objects)
+
+    def _gradient() -> None:
+        # The gradient of each input is its own slice of the result's gradient.
+        pieces = result.grad.split([tensor.shape[dim] for tensor in tensors], dim)
+        for tensor, piece in zip(tensors, pieces):
+            tensor.grad += piece
+
+    result._gradient = _gradient
+    return result
+
+
+def stack(tensors: list[Tensor], dim: int = 0) -> Tensor:
+    """
+    Stack tensors of the same shape along a new dimension.
+
+    Args:
+        tensors (list[Tensor]): Tensors of the same dtype and shape.
+        dim (int, optional): The position of the new dimension. Defaults to 0.
+
+    Returns:
+        Tensor: A new tensor with a dimension of size len(tensors) at dim.
+    """
+    tensors = list(tensors)
+    result = Tensor(
+        TensorBase.stack([tensor.data for tensor in tensors], dim),
+        children=tuple(tensors),
+    )
+
+    def _gradient() -> None:
+        pieces = result.grad.split(1, dim)
+        for tensor, piece in zip(tensors, pieces):
+            tensor.grad += piece.reshape(tensor.shape)
+
+    result._gradient = _gradient
+    return result
+
+
+def scaled_dot_product_attention(
+    query: Tensor,
+    key: Tensor,
+    value: Tensor,
+    attn_mask: Tensor | None = None,
+    is_causal: bool = False,
+    scale: float | None = None,
+) -> Tensor:
+    """
+    softmax(query @ key^T * scale + attn_mask) @ value, computed tile by tile with an online softmax, so the
+    (..., Sq, Sk) score matrix is never stored and memory is linear in the sequence length.
+
+    Args:
+        query (Tensor): (..., Sq, D) queries.
+        key (Tensor): (..., Sk, D) keys, with the leading (batch and head) dimensions of the queries.
+        value (Tensor): (..., Sk, Dv) values.
+        attn_mask (Tensor, optional): (Sq, Sk) or (..., Sq, Sk) mask added to the scores (e.g., -inf to mask a key
+            out). Masks are not differentiated.
+        is_causal (bool, optional): If True, query i only attends to keys j <= i, and the key tiles after a query
+            tile are skipped. Defaults to False.
+        scale (float, optional): Defaults to 1 / sqrt(D).
+
+    Returns:
+        Tensor: The (..., Sq, Dv) output.
+    """
+    mask = None if attn_mask is None else attn_mask.data
+    out, lse = query.data.scaled_dot_product_attention(
+        key.data, value.data, mask=mask, causal=is_causal, scale=scale
+    )
+    result = Tensor(out, children=(query, key, value))
+
+    def _gradient() -> None:
+        # The probabilities are recomputed from the saved log-sum-exps, tile by tile.
+        grad_query, grad_key, grad_value = query.data.scaled_dot_product_attention_backward(
+            key.data, value.data, out, lse, result.grad, mask=mask, causal=is_causal, scale=scale
+        )
+        query.grad += grad_query
+        key.grad += grad_key
+        value.grad += grad_value
+
+    result._gradient = _gradient
+    return result
 
 
-def randn(*shape, generator=lambda: gauss(0, 1)) -> Tensor:
+def randn(*shape, generator=lambda: gauss(0, 1), dtype: str = "float64") -> Tensor:
     if shape != () and isinstance(shape[0], tuple):
         shape = shape[0]
 
-    t = TensorBase(shape)
+    t = TensorBase(shape, dtype=dtype)
     t.randn_(0, 1)
     return Tensor(data=t)
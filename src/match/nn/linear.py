@@ -9,17 +9,18 @@ from .module import Module
 
 
 class Linear(Module):
-    """y = x W^T + b"""
+    """y = activation(x W^T + b), where the activation is "relu", "sigmoid", "tanh" or None (the identity)."""
 
-    def __init__(self, in_features, out_features) -> None:
+    def __init__(self, in_features, out_features, dtype: str = "float64", activation: str | None = None) -> None:
         super().__init__()
         # Kaiming He initialization
-        self.W = match.randn(out_features, in_features) * sqrt((2 / out_features) / 3)
-        self.b = match.randn(out_features, 1) * sqrt((2 / out_features) / 3)
+        self.W = match.randn(out_features, in_features, dtype=dtype) * sqrt((2 / out_features) / 3)
+        self.b = match.randn(out_features, dtype=dtype) * sqrt((2 / out_features) / 3)
+        self.activation = activation
 
     def forward(self, x: Tensor) -> Tensor:
-        # Returns a new Tensor
-        return x @ self.W.T + self.b.T
+        # Returns a new Tensor, computed by one GEMM with the bias and the activation fused into its epilogue.
+        return x.linear(self.W, self.b, self.activation)
 
     def __repr__(self) -> str:
         return f"A: {self.W}\nb: {self.b}"
@@ -18,4 +18,20 @@ class MultiClassCrossEntropyLoss(Module):
 
     def forward(self, prediction: Tensor, target: Tensor) -> float:
 
-        return -(target * prediction.log()).mean()
\ No newline at end of file
+        return -(target * prediction.log()).mean()
+
+
+class CrossEntropyLoss(Module):
+    """
+    loss = - (1/N) * Σ log(softmax(xi)[yi]), computed from the logits xi in one fused pass.
+
+    Targets are (N) class indices or (N, C) class probabilities.
+    """
+
+    def __init__(self, reduction: str = "mean", ignore_index: int = -100) -> None:
+        super().__init__()
+        self.reduction = reduction
+        self.ignore_index = ignore_index
+
+    def forward(self, prediction: Tensor, target: Tensor) -> Tensor:
+        return prediction.cross_entropy(target, reduction=self.reduction, ignore_index=self.ignore_index)
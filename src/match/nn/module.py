@@ -28,9 +28,9 @@ class Module:
                 return x
     """
 
-    def __call__(self, *args) -> Tensor:
+    def __call__(self, *args, **kwargs) -> Tensor:
         """Enable calling the module like a function."""
-        return self.forward(*args)
+        return self.forward(*args, **kwargs)
 
     def forward(self) -> Tensor:
         """Forward must be implemented by the subclass."""
@@ -11,6 +11,15 @@ class Softmax(Module):
         self.dim = dim
 
     def forward(self, x: Tensor):
-        tensor_exp = x.exp()
-        tensor_exp_sum = tensor_exp.sum(dim=self.dim, keepdims=True)
-        return tensor_exp / tensor_exp_sum
\ No newline at end of file
+        return x.softmax(self.dim)
+
+
+class LogSoftmax(Module):
+    """Adapted from https://pytorch.org/docs/stable/generated/torch.nn.LogSoftmax.html"""
+
+    def __init__(self, dim: int):
+        super().__init__()
+        self.dim = dim
+
+    def forward(self, x: Tensor):
+        return x.log_softmax(self.dim)
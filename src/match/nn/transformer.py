@@ -1,13 +1,55 @@
 from __future__ import annotations
 
-from math import sqrt
 from typing import Optional
-from match import Tensor, TensorData
+from match import Tensor, scaled_dot_product_attention
+from match.tensorbase import TensorBase
 from .linear import Linear
 from .module import Module
-from .softmax import Softmax
 from copy import deepcopy
 
+
+class KVCache:
+    """Preallocated keys and values of every layer of a decoder, for incremental (autoregressive) decoding.
+
+    Each layer holds (batch_size, num_heads, max_length, head_dim) keys and values, and every sequence of the batch
+    has its own length. A forward pass with the cache appends the keys and values of its new positions after each
+    sequence's length and attends only its new queries against the cached keys, so a decoding step projects one
+    position per sequence instead of the whole prefix.
+    """
+
+    def __init__(
+        self,
+        num_layers: int,
+        batch_size: int,
+        max_length: int,
+        num_heads: int,
+        head_dim: int,
+        dtype: str = "float64",
+    ):
+        self.max_length = max_length
+        self.keys: list[TensorBase] = []
+        self.values: list[TensorBase] = []
+        for _ in range(num_layers):
+            for cache in (self.keys, self.values):
+                # Zeroed, so the unused positions of a partially used key tile cannot poison the output.
+                layer = TensorBase((batch_size, num_heads, max_length, head_dim), dtype=dtype)
+                layer.fill_(0)
+                cache.append(layer)
+        self.lengths: list[int] = [0] * batch_size
+        self.positions = TensorBase.from_sequence(self.lengths, dtype="int64")
+
+    def advance(self, lengths: list[int] | int) -> None:
+        """Grow every sequence by lengths[i] positions (or all of them by `lengths`), once all layers have run."""
+        if isinstance(lengths, int):
+            lengths = [lengths] * len(self.lengths)
+        self.lengths = [length + n for length, n in zip(self.lengths, lengths)]
+        self.positions = TensorBase.from_sequence(self.lengths, dtype="int64")
+
+    def reset(self) -> None:
+        """Empty every sequence, keeping the preallocated storage."""
+        self.advance([-length for length in self.lengths])
+
+
 class MultiheadAttention(Module):
     """Multi Head Self-Attention"""
 
@@ -26,21 +68,27 @@ class MultiheadAttention(Module):
         self.value_weights = Linear(embed_dim, embed_dim)
         self.concat_weights = Linear(embed_dim, embed_dim)
 
-        # Define softmax layer
-        self.softmax = Softmax(dim=3)
-
     def forward(
-        self, query: Tensor, key: Tensor, value: Tensor, attn_mask: Tensor = None
+        self,
+        query: Tensor,
+        key: Tensor,
+        value: Tensor,
+        attn_mask: Tensor = None,
+        is_causal: bool = False,
+        cache: KVCache = None,
+        layer_index: int = 0,
     ) -> Tensor:
         # The shape of query, key, value are all (batch_size, sequence_length, embedding_dimension).
+        # With a cache, they are the new positions of self-attention, and the keys and values of the previous ones
+        # are read from layer `layer_index` of the cache.
         # Compute Q, K, V.
         batch_size = query.shape[0]
-        sequence_length = query.shape[1]
+        query_length = query.shape[1]
+        key_length = key.shape[1]
 
         query_vectors = self.query_weights(query)
-        key_vectors = self.key_weights(query)
-        value_vectors = self.value_weights(query)
-        print(f"query/key/value vector shape: {query_vectors.shape}")
+        key_vectors = self.key_weights(key)
+        value_vectors = self.value_weights(value)
 
         # Reshape into many heads
         # Value @ Value_weights = (batch_size, sequence_length, embedding_dimension) @ (num_heads, embedding_dimension, d_head)
@@ -49,29 +97,38 @@ class MultiheadAttention(Module):
         # then we have to permute the dimensions 1,2 so get (batches, num_heads, sequence_length, d_head) so all the values are in the right place
         # we can't just reshape into ( batch_size, sequence_length, self.num_heads, self.d_head) directly
         query_vectors = query_vectors.reshape(
-            batch_size, sequence_length, self.num_heads, self.d_head
+            batch_size, query_length, self.num_heads, self.d_head
         ).permute(0, 2, 1, 3)
         key_vectors = key_vectors.reshape(
-            batch_size, sequence_length, self.num_heads, self.d_head
+            batch_size, key_length, self.num_heads, self.d_head
         ).permute(0, 2, 1, 3)
         value_vectors = value_vectors.reshape(
-            batch_size, sequence_length, self.num_heads, self.d_head
+            batch_size, key_length, self.num_heads, self.d_head
         ).permute(0, 2, 1, 3)
-        print(f"query/key/value vector shape (after reshape): {query_vectors.shape}")
-
-        # Apply attention
-        key_vectors_transpose = key_vectors.permute(0, 1, 3, 2)
-        print(f"key vector shape (after transpose): {key_vectors_transpose.shape}")
-        attn_scores = query_vectors @ key_vectors_transpose
-        print(f"attn score shape: {attn_scores.shape}")
-        attn_scores /= sqrt(self.d_head)
-        if attn_mask:
-            attn_scores += attn_mask
-        attn_pattern = self.softmax(attn_scores)
-        attn = attn_pattern @ value_vectors
-
-        # Concat using reshape
-        attn = attn.reshape(query.shape[0], query.shape[1], self.embed_dim)
+
+        if cache is None:
+            # Apply attention: softmax(Q K^T / sqrt(d_head) + mask) V, in one tiled kernel that never stores the
+            # (batch_size, num_heads, sequence_length, sequence_length) attention pattern.
+            attn = scaled_dot_product_attention(
+                query_vectors, key_vectors, value_vectors, attn_mask=attn_mask, is_causal=is_causal
+            )
+        else:
+            # Append the new keys and values after each sequence's cached positions, and attend the new queries to
+            # the cached keys up to their own positions. The cache is for inference, so it is not differentiated.
+            cached_keys, cached_values = cache.keys[layer_index], cache.values[layer_index]
+            cached_keys.kv_cache_write_(key_vectors.data, cache.positions)
+            cached_values.kv_cache_write_(value_vectors.data, cache.positions)
+            out, _ = query_vectors.data.scaled_dot_product_attention(
+                cached_keys,
+                cached_values,
+                mask=None if attn_mask is None else attn_mask.data,
+                causal=is_causal,
+                query_offsets=cache.positions,
+            )
+            attn = Tensor(out)
+
+        # Concat the heads: back to (batch_size, sequence_length, num_heads, d_head), then merge the heads
+        attn = attn.permute(0, 2, 1, 3).reshape(batch_size, query_length, self.embed_dim)
         attn = self.concat_weights(attn)
 
         return attn
@@ -85,6 +142,9 @@ class LayerNorm(Module):
 
     γ and β are learnable parameters applied only if `elementwise_affine` is True.
 
+    The normalization runs as one fused kernel, which can also add a residual to the input first
+    (`layer_norm(x, residual)` computes LayerNorm(x + residual)).
+
     Description adapted from: https://pytorch.org/docs/stable/generated/torch.nn.LayerNorm.html
     """
 
@@ -94,48 +154,35 @@ class LayerNorm(Module):
         eps=1e-05,
         elementwise_affine=True,
         bias=True,
+        dtype: str = "float64",
     ):
         super().__init__()
         if isinstance(normalized_shape, int):
             normalized_shape = (normalized_shape,)
 
+        self.normalized_shape = tuple(normalized_shape)
         self.eps = eps
         self.elementwise_affine = elementwise_affine
         self.include_bias = bias
-        self.dimensions_to_normalize = tuple(
-            -1 * dim for dim in range(len(normalized_shape), 0, -1)
-        )
 
         if elementwise_affine:
-            self.weight: Tensor = Tensor(
-                data=TensorData(*normalized_shape, value=1)
-            )  # γ
+            gamma = TensorBase(self.normalized_shape, dtype=dtype)
+            gamma.fill_(1)
+            self.weight: Tensor = Tensor(data=gamma)  # γ
             if bias:
-                self.bias: Tensor = Tensor(
-                    data=TensorData(*normalized_shape, value=0)
-                )  # β
-
-    def forward(self, x: Tensor):
-        # Calculate mean and variance over the last len(normalized_shape) dimensions.
-        self.dimensions_to_normalize = tuple(
-            dim if dim >= 0 else dim + len(x.shape)
-            for dim in self.dimensions_to_normalize
+                beta = TensorBase(self.normalized_shape, dtype=dtype)
+                beta.fill_(0)
+                self.bias: Tensor = Tensor(data=beta)  # β
+
+    def forward(self, x: Tensor, residual: Tensor = None):
+        return x.layer_norm(
+            self.normalized_shape,
+            weight=self.weight if self.elementwise_affine else None,
+            bias=self.bias if self.elementwise_affine and self.include_bias else None,
+            eps=self.eps,
+            residual=residual,
         )
 
-        mean = x.mean(dim=self.dimensions_to_normalize, keepdims=True)
-        variance = x.var(dim=self.dimensions_to_normalize, keepdims=True)
-
-        # Normalize the tensor (add eps to prevent divide by 0).
-        normalized_tensor = (x - mean) / ((variance + self.eps) ** (0.5))
-
-        # Apply the affine transformation if specified.
-        if self.elementwise_affine:
-            normalized_tensor = normalized_tensor * self.weight
-            if self.include_bias:
-                normalized_tensor += self.bias
-
-        return normalized_tensor
-
 
 # TODO: Implement Embedding
 class Embedding(Module):
@@ -165,24 +212,26 @@ class TransformerDecoderLayer(Module):
         self.first_layer_norm = LayerNorm(normalized_shape=d_model, eps=layer_norm_eps)
         self.second_layer_norm = LayerNorm(normalized_shape=d_model, eps=layer_norm_eps)
 
-    def forward(self, x: Tensor, mask: Optional[Tensor]) -> Tensor:
+    def forward(
+        self,
+        x: Tensor,
+        mask: Optional[Tensor] = None,
+        is_causal: bool = False,
+        cache: Optional[KVCache] = None,
+        layer_index: int = 0,
+    ) -> Tensor:
         # Apply self-attention mechanism to input x
-        attention_result = self.self_attention(x, x, x, mask)
-
-        # Combine original input x with the attention result
-        x_plus_attention = x + attention_result
+        attention_result = self.self_attention(x, x, x, mask, is_causal, cache, layer_index)
 
-        # Normalize the combined result (normalizing each embedding)
-        normalized_x = self.first_layer_norm(x_plus_attention)
+        # Combine original input x with the attention result, and normalize the sum (normalizing each embedding)
+        normalized_x = self.first_layer_norm(x, attention_result)
 
         # Feed the normalized result through a feed-forward network
         feed_forward_result = self.feed_forward(normalized_x)
 
-        # Combine the normalized result with the feed-forward output
-        combined_result = normalized_x + feed_forward_result
-
-        # Normalize the combined result again to produce the final output
-        output = self.second_layer_norm(combined_result)
+        # Combine the normalized result with the feed-forward output, and normalize the sum again to produce the
+        # final output
+        output = self.second_layer_norm(normalized_x, feed_forward_result)
 
         return output
 
@@ -195,15 +244,13 @@ class PositionWiseFeedForward(Module):
 
     def __init__(self, d_model: int, ff_dim: int):
         super().__init__()
-        self.w1 = Linear(d_model, ff_dim)
+        # The ReLU is applied by the first transformation's GEMM, as it writes its output.
+        self.w1 = Linear(d_model, ff_dim, activation="relu")
         self.w2 = Linear(ff_dim, d_model)
 
     def forward(self, x: Tensor) -> Tensor:
-        # Apply first linear transformation
-        linear1_output = self.w1(x)
-
-        # Apply ReLU activation function to the output of the first transformation
-        relu_output = linear1_output.relu()
+        # Apply the first linear transformation, followed by the ReLU activation function
+        relu_output = self.w1(x)
 
         # Apply second linear transformation
         final_output = self.w2(relu_output)
@@ -223,6 +270,8 @@ class GPT2(Module):
     ):
         super().__init__()
         self.num_layers = num_layers
+        self.d_model = decoder_layer.d_model
+        self.num_heads = decoder_layer.num_heads
 
         # Create num_layers clones of the specified decoder layer
         self.decoder_layers = []
@@ -231,18 +280,39 @@ class GPT2(Module):
 
         self.norm = norm
 
-    def forward(self, x: Tensor, mask: Tensor = None):
+    def init_cache(self, batch_size: int, max_length: int, dtype: str = "float64") -> KVCache:
+        """A key/value cache of max_length positions for batch_size sequences, to decode with forward(..., cache)."""
+        return KVCache(
+            self.num_layers, batch_size, max_length, self.num_heads, self.d_model // self.num_heads, dtype
+        )
+
+    def forward(
+        self,
+        x: Tensor,
+        mask: Tensor = None,
+        is_causal: bool = True,
+        cache: KVCache = None,
+        lengths: list[int] | int = None,
+    ):
+        """
+        Apply the decoder layers to the (batch_size, sequence_length, d_model) input.
+
+        With a cache, x holds only the new positions of every sequence: the whole prompt for the first call, and then
+        one position per decoding step. Their keys and values are appended to the cache, and every sequence grows by
+        lengths[i] positions (all of x's positions by default). A prompt shorter than x's sequence length is padded
+        at its end: its padding is overwritten by the next step, and its last real position is lengths[i] - 1.
+        """
         # Apply the decoder layers
-        print(f"GPT2 Input Tensor Shape: {x.shape}")
         output = x
-        for transformer_decoder_layer in self.decoder_layers:
-            output = transformer_decoder_layer(output, None)
+        for layer_index, transformer_decoder_layer in enumerate(self.decoder_layers):
+            output = transformer_decoder_layer(output, mask, is_causal, cache, layer_index)
 
         # Apply a final normalization layer
         if self.norm:
             output = self.norm(output)
 
-        print(f"GPT2 Output Tensor Shape: {output.shape}")
+        if cache is not None:
+            cache.advance(x.shape[1] if lengths is None else lengths)
 
         return output
     
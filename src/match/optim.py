@@ -0,0 +1,134 @@
+from __future__ import annotations
+
+from match import Tensor
+from match.tensorbase import TensorBase, adam_step, sgd_step
+
+
+class Optimizer:
+    """Base class for all optimizers.
+
+    An optimizer updates the data of a list of parameters from their gradients, in place. Each step of the
+    optimizers below is a single fused pass over the elements of all parameters, implemented in the C backend.
+
+        optimizer = match.optim.SGD(model.parameters(), lr=0.04, momentum=0.9)
+        loss.backward()
+        optimizer.step()
+        optimizer.zero_grad()
+    """
+
+    def __init__(self, params: list[Tensor]) -> None:
+        self.params: list[Tensor] = list(params)
+        if not self.params:
+            raise ValueError("Optimizer got an empty parameter list.")
+
+    def step(self) -> None:
+        """Step must be implemented by the subclass."""
+        raise NotImplementedError("Implement in the subclass.")
+
+    def zero_grad(self) -> None:
+        """Set gradients for all parameters to zero."""
+        for param in self.params:
+            param.grad.fill_(0)
+
+    def _zeros_like_params(self) -> list[TensorBase]:
+        """Return a zero-filled state buffer for every parameter."""
+        buffers = []
+        for param in self.params:
+            buffer = TensorBase(param.data.size, dtype=param.data.dtype)
+            buffer.fill_(0)
+            buffers.append(buffer)
+        return buffers
+
+
+class SGD(Optimizer):
+    """Stochastic gradient descent, optionally with (Nesterov) momentum. Matches torch.optim.SGD."""
+
+    def __init__(
+        self,
+        params: list[Tensor],
+        lr: float = 1e-3,
+        momentum: float = 0,
+        dampening: float = 0,
+        weight_decay: float = 0,
+        nesterov: bool = False,
+    ) -> None:
+        super().__init__(params)
+        if nesterov and (momentum <= 0 or dampening != 0):
+            raise ValueError("Nesterov momentum requires a momentum and zero dampening.")
+        self.lr = lr
+        self.momentum = momentum
+        self.dampening = dampening
+        self.weight_decay = weight_decay
+        self.nesterov = nesterov
+        self.momentum_buffers: list[TensorBase] | None = None
+
+    def step(self) -> None:
+        first_step = self.momentum != 0 and self.momentum_buffers is None
+        if first_step:
+            self.momentum_buffers = self._zeros_like_params()
+        sgd_step(
+            [param.data for param in self.params],
+            [param.grad for param in self.params],
+            self.momentum_buffers,
+            lr=self.lr,
+            momentum=self.momentum,
+            dampening=self.dampening,
+            weight_decay=self.weight_decay,
+            nesterov=self.nesterov,
+            first_step=first_step,
+        )
+
+
+class Adam(Optimizer):
+    """Adam, with L2 weight decay added to the gradients. Matches torch.optim.Adam."""
+
+    decoupled_weight_decay = False
+
+    def __init__(
+        self,
+        params: list[Tensor],
+        lr: float = 1e-3,
+        betas: tuple[float, float] = (0.9, 0.999),
+        eps: float = 1e-8,
+        weight_decay: float = 0,
+    ) -> None:
+        super().__init__(params)
+        self.lr = lr
+        self.betas = betas
+        self.eps = eps
+        self.weight_decay = weight_decay
+        self.step_count = 0
+        self.exp_avgs = self._zeros_like_params()
+        self.exp_avg_sqs = self._zeros_like_params()
+
+    def step(self) -> None:
+        self.step_count += 1
+        adam_step(
+            [param.data for param in self.params],
+            [param.grad for param in self.params],
+            self.exp_avgs,
+            self.exp_avg_sqs,
+            step=self.step_count,
+            lr=self.lr,
+            beta1=self.betas[0],
+            beta2=self.betas[1],
+            eps=self.eps,
+            weight_decay=self.weight_decay,
+            decoupled_weight_decay=self.decoupled_weight_decay,
+        )
+
+
+class AdamW(Adam):
+    """Adam with decoupled weight decay, which scales the parameters directly. Matches torch.optim.AdamW."""
+
+    decoupled_weight_decay = True
+
+    def __init__(
+        self,
+        params: list[Tensor],
+        lr: float = 1e-3,
+        betas: tuple[float, float] = (0.9, 0.999),
+        eps: float = 1e-8,
+        weight_decay: float = 1e-2,
+    ) -> None:
+        super().__init__(params, lr=lr, betas=betas, eps=eps, weight_decay=weight_decay)
@@ -16,7 +16,7 @@ class Tensor:
                                         computational graph. Defaults to an empty tuple.
         """
         self.data: TensorBase = data
-        self.grad: TensorBase = TensorBase(data.size)
+        self.grad: TensorBase = TensorBase(data.size, dtype=data.dtype)
         self.grad.fill_(0)
 
         # Backpropagation compute graph
@@ -88,6 +88,11 @@ class Tensor:
         """Return the shape of the tensor."""
         return self.data.size
 
+    @property
+    def dtype(self) -> str:
+        """Return the element type of the tensor ('float32', 'float64', 'int64' or 'bool')."""
+        return self.data.dtype
+
     def sum(self, dim: tuple | int = (), keepdims: bool = False) -> Tensor:
         """
         Return the sum of all values across specified dimensions.
@@ -364,6 +369,130 @@ class Tensor:
         result._gradient = _gradient
         return result
 
+    def im2col(
+        self,
+        kernel_size: tuple[int, int],
+        stride: tuple[int, int] = (1, 1),
+        padding: tuple[int, int] = (0, 0),
+        dilation: tuple[int, int] = (1, 1),
+    ) -> Tensor:
+        """
+        Extract the sliding kernel windows of an image into the columns of a matrix, for convolution by matrix product.
+
+        Args:
+            kernel_size, stride, padding, dilation (tuple[int, int]): The window, for the height and width dimensions.
+
+        Returns:
+            Tensor: (N, C * kh * kw, L) columns of an (N, C, H, W) tensor, or (C * kh * kw, L) columns of a
+                    (C, H, W) tensor, where L is the number of window positions.
+        """
+        result: Tensor = Tensor(
+            self.data.im2col(kernel_size, stride, padding, dilation), children=(self,)
+        )
+
+        def _gradient() -> None:
+            info(f"Gradient of im2col. Shape: {self.shape}")
+            # Sum the gradient of every column back into the window position it was copied from.
+            self.grad += result.grad.col2im(
+                self.shape[-2:], kernel_size, stride, padding, dilation
+            )
+
+        result._gradient = _gradient
+        return result
+
+    def conv2d(
+        self,
+        weight: Tensor,
+        kernel_size: tuple[int, int],
+        bias: Tensor | None = None,
+        stride: tuple[int, int] = (1, 1),
+        padding: tuple[int, int] = (0, 0),
+        dilation: tuple[int, int] = (1, 1),
+        algorithm: str = "auto",
+    ) -> Tensor:
+        """
+        2D cross-correlation of an image with a bank of kernels, computed by the C backend.
+
+        Args:
+            weight (Tensor): (O, C * kh * kw) kernels, one per row.
+            kernel_size, stride, padding, dilation (tuple[int, int]): The window, for the height and width dimensions.
+            bias (Tensor, optional): (O) bias added to every output channel.
+            algorithm (str): One of "im2col", "winograd_2x3", "winograd_4x3" or "fft", or "auto" to let the
+                             backend select (and cache) the algorithm for the shape. Winograd requires a 3x3
+                             kernel with unit stride and dilation.
+
+        Returns:
+            Tensor: (N, O, OH, OW) output of an (N, C, H, W) tensor, or (O, OH, OW) output of a (C, H, W) tensor.
+        """
+        children = (self, weight) if bias is None else (self, weight, bias)
+        result: Tensor = Tensor(
+            self.data.conv2d(
+                weight.data,
+                kernel_size,
+                None if bias is None else bias.data,
+                stride,
+                padding,
+                dilation,
+                algorithm,
+            ),
+            children=children,
+        )
+
+        def _gradient() -> None:
+            info(f"Gradient of conv2d. Shape: {self.shape}")
+            # Whatever the forward algorithm, the gradients are the im2col lowering's: with the columns X of the
+            # input and the output as (O, L) matrices, Y = W @ X, so dX = W^T @ dY and dW = dY @ X^T.
+            out_channels, positions = result.shape[-3], result.shape[-2] * result.shape[-1]
+            grad = result.grad.reshape(result.shape[:-3] + (out_channels, positions))
+            self.grad += (weight.data.transpose() @ grad).col2im(
+                self.shape[-2:], kernel_size, stride, padding, dilation
+            )
+            columns = self.data.im2col(kernel_size, stride, padding, dilation)
+            columns_permutation = tuple(range(len(columns.size) - 2)) + (
+                len(columns.size) - 1,
+                len(columns.size) - 2,
+            )
+            weight.grad += (grad @ columns.permute(columns_permutation)).unbroadcast(
+                weight.shape
+            )
+            if bias is not None:
+                bias.grad += grad.unbroadcast((out_channels, 1)).reshape(bias.shape)
+
+        result._gradient = _gradient
+        return result
+
+    def linear(self, weight: Tensor, bias: Tensor | None = None, activation: str | None = None) -> Tensor:
+        """
+        activation(self @ weight^T + bias), computed by one GEMM that reads the weight in its stored layout and
+        applies the bias and the activation to each tile of the output before writing it.
+
+        Args:
+            weight (Tensor): (out_features, in_features) weights.
+            bias (Tensor, optional): (out_features) bias.
+            activation (str, optional): "relu", "sigmoid", "tanh" or None.
+
+        Returns:
+            Tensor: (..., out_features) output of a (..., in_features) tensor.
+        """
+        children = (self, weight) if bias is None else (self, weight, bias)
+        result: Tensor = Tensor(
+            self.data.linear(weight.data, None if bias is None else bias.data, activation),
+            children=children,
+        )
+
+        def _gradient() -> None:
+            info(f"Gradient of linear. Shape: {self.shape}")
+            grad_input, grad_weight, grad_bias = self.data.linear_backward(
+                weight.data, result.data, result.grad, activation, bias is not None
+            )
+            self.grad += grad_input
+            weight.grad += grad_weight
+            if bias is not None:
+                bias.grad += grad_bias
+
+        result._gradient = _gradient
+        return result
+
     def exp(self) -> Tensor:
         """Performs element-wise exp"""
         result: Tensor = Tensor(self.data.exp(), children=(self,))
@@ -384,6 +513,111 @@ class Tensor:
         result._gradient = _gradient
         return result
 
+    def softmax(self, dim: int) -> Tensor:
+        """Softmax along dim, fused into one kernel that subtracts the max, so large inputs do not overflow."""
+        result: Tensor = Tensor(self.data.softmax(dim), children=(self,))
+
+        def _gradient() -> None:
+            info(f"Gradient of softmax. Shape: {self.shape}")
+            self.grad += result.data.softmax_backward(result.grad, dim)
+
+        result._gradient = _gradient
+        return result
+
+    def log_softmax(self, dim: int) -> Tensor:
+        """Logarithm of the softmax along dim, computed without forming the softmax, so it stays finite."""
+        result: Tensor = Tensor(self.data.log_softmax(dim), children=(self,))
+
+        def _gradient() -> None:
+            info(f"Gradient of log_softmax. Shape: {self.shape}")
+            self.grad += result.data.log_softmax_backward(result.grad, dim)
+
+        result._gradient = _gradient
+        return result
+
+    def cross_entropy(self, target: Tensor, reduction: str = "mean", ignore_index: int = -100) -> Tensor:
+        """
+        Cross-entropy loss of these (N, C) or (C) logits, fused with the log softmax into one kernel.
+
+        Args:
+            target (Tensor): int64 class indices of shape (N) (or a singleton), or class probabilities
+                of the logits' shape. Targets are not differentiated.
+            reduction (str, optional): "mean", "sum" or "none". Defaults to "mean".
+            ignore_index (int, optional): Class index whose rows add nothing to the loss and are left
+                out of the mean. Defaults to -100.
+
+        Returns:
+            Tensor: The loss.
+        """
+        loss, lse = self.data.cross_entropy(target.data, reduction=reduction, ignore_index=ignore_index)
+        result: Tensor = Tensor(loss, children=(self,))
+
+        def _gradient() -> None:
+            info(f"Gradient of cross_entropy. Shape: {self.shape}")
+            self.grad += self.data.cross_entropy_backward(
+                target.data, lse, result.grad, reduction=reduction, ignore_index=ignore_index
+            )
+
+        result._gradient = _gradient
+        return result
+
+    def layer_norm(
+        self,
+        normalized_shape: tuple[int],
+        weight: Tensor | None = None,
+        bias: Tensor | None = None,
+        eps: float = 1e-05,
+        residual: Tensor | None = None,
+    ) -> Tensor:
+        """
+        Layer normalization over the trailing normalized_shape dimensions, fused into one kernel that computes the
+        mean and variance of each row in one pass and normalizes it in a second.
+
+        Args:
+            normalized_shape (tuple[int]): The shape of the trailing dimensions to normalize over.
+            weight, bias (Tensor, optional): γ and β, of shape normalized_shape.
+            eps (float, optional): Added to the variance. Defaults to 1e-05.
+            residual (Tensor, optional): Added to this tensor before normalizing, in the same kernel.
+
+        Returns:
+            Tensor: (self + residual - mean) / sqrt(var + eps) * weight + bias.
+        """
+        normalized_ndim = len(normalized_shape)
+        if tuple(self.shape[len(self.shape) - normalized_ndim:]) != tuple(normalized_shape):
+            raise ValueError(f"Cannot normalize a tensor of shape {self.shape} over {normalized_shape}.")
+
+        out, normalized_input, mean, rstd = self.data.layer_norm(
+            normalized_ndim,
+            weight=None if weight is None else weight.data,
+            bias=None if bias is None else bias.data,
+            eps=eps,
+            residual=None if residual is None else residual.data,
+        )
+        children = tuple(t for t in (self, residual, weight, bias) if t is not None)
+        result: Tensor = Tensor(out, children=children)
+
+        def _gradient() -> None:
+            info(f"Gradient of layer_norm. Shape: {self.shape}")
+            grad_input, grad_weight, grad_bias = normalized_input.layer_norm_backward(
+                result.grad,
+                mean,
+                rstd,
+                normalized_ndim,
+                weight=None if weight is None else weight.data,
+                bias=bias is not None,
+            )
+            # The residual is added to the input, so both receive the input's gradient.
+            self.grad += grad_input
+            if residual is not None:
+                residual.grad += grad_input
+            if weight is not None:
+                weight.grad += grad_weight
+            if bias is not None:
+                bias.grad += grad_bias
+
+        result._gradient = _gradient
+        return result
+
     def var(
         self, dim: tuple | int = None, correction=1, keepdims: bool = False
     ) -> Tensor:
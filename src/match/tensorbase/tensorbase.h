@@ -19,12 +19,30 @@
  *                        GLOBALS                        *
  *********************************************************/
 
-// Tensors will support only float64 elements.
+// Scalars passed to and returned from the API (e.g., fill values, the operand of `t * 2` and `item()`) are float64.
+// Tensor elements have a DType, and are converted from and to scalars where the two meet.
 typedef double scalar;
 
+// Enum for the element types of tensors. The zero value is the default, so zero-initialized tensors are float64.
+// INT64 holds indices (e.g., the results of ARGMAX) and BOOL holds masks (e.g., the results of comparisons). Arithmetic
+// is computed in a floating point dtype, so integer and bool operands are converted (to float64, unless the other
+// operand is float32) first.
+typedef enum
+{
+    TB_FLOAT64,
+    TB_FLOAT32,
+    TB_INT64,
+    TB_BOOL,
+} DType;
+
+#define NUM_DTYPES (TB_BOOL + 1)
+
 // Tensors have a maximum rank of 8.
 #define MAX_RANK 8
 
+// Tensor data (and every buffer of the caching allocator) is aligned to 64 bytes, a cache line and an AVX-512 register.
+#define TB_ALIGNMENT 64
+
 // Define type aliases.
 typedef long IndexArray[MAX_RANK];
 typedef long ShapeArray[MAX_RANK];
@@ -73,6 +91,14 @@ typedef enum
     SCALAR_AGG_ARGMIN,
 } AggScalarOperation;
 
+// Enum for the instruction sets the elementwise kernels are compiled for.
+typedef enum
+{
+    TB_ISA_BASELINE, // The instruction set every CPU of the platform supports (e.g., SSE2 on x86-64, NEON on arm64).
+    TB_ISA_AVX2,     // x86-64 with AVX2 and FMA.
+    TB_ISA_AVX512,   // x86-64 with AVX-512F and AVX-512DQ.
+} InstructionSet;
+
 // Enum for status codes.
 typedef enum
 {
@@ -89,18 +115,43 @@ typedef enum
     TB_SHAPE_MISMATCH_ERROR,
     TB_ELEMENT_COUNT_NOT_ONE_ERROR,
     TB_INDEX_OUT_OF_BOUNDS_ERROR,
-    TB_DIMENSION_OUT_OF_BOUNDS_ERROR
+    TB_DIMENSION_OUT_OF_BOUNDS_ERROR,
+    TB_UNSUPPORTED_DTYPE_ERROR
 } StatusCode;
 
+// Reference-counted data buffer, shared by a tensor and all of its views (e.g., permutations, reshapes and slices).
+typedef struct _TensorBaseStorage
+{
+    long ref_count; // Number of tensors referencing the buffer. The buffer is freed when it drops to zero.
+    long numel;     // Number of elements in the buffer.
+    size_t size;    // Size of the allocation holding this header and the buffer, in bytes.
+    void *data;     // Buffer data
+} TensorBaseStorage;
+
+// Statistics of the caching allocator. Sizes are those of the size classes the requests were rounded up to.
+typedef struct
+{
+    size_t allocated_bytes;      // Bytes of the buffers in use.
+    size_t peak_allocated_bytes; // Maximum of allocated_bytes so far.
+    size_t cached_bytes;         // Bytes of the freed buffers kept for reuse.
+    long allocations;            // Number of allocations, served from the cache or not.
+    long system_allocations;     // Number of allocations the cache could not serve, which called the system allocator.
+    long system_frees;           // Number of buffers returned to the system.
+} TensorBaseMemoryStats;
+
 // Definition of a TensorBase struct.
+// A tensor is a view into its storage: the element at coordinate c is data[sum(c[dim] * strides[dim])], where `data`
+// points at the tensor's first element inside the storage buffer. Singletons have no storage, and store their value
+// in the bits of the data pointer instead (as an element of the tensor's dtype).
 typedef struct _TensorBase
 {
-    long data_ref_count; // Number of references to the data pointer (for deallocation).
-    long numel;          // Number of elements (length of data array)
-    long ndim;           // Number of dimensions
-    ShapeArray shape;    // Shape of tensor (-1 indicates end of array)
-    StrideArray strides; // Strides of tensor (0 indicates end of array)
-    scalar *data;        // Tensor data
+    TensorBaseStorage *storage; // Shared data buffer (NULL for singletons).
+    long numel;                 // Number of elements
+    long ndim;                  // Number of dimensions
+    ShapeArray shape;           // Shape of tensor (-1 indicates end of array)
+    StrideArray strides;        // Strides of tensor, in elements (0 indicates end of array)
+    DType dtype;                // Element type
+    void *data;                 // Tensor data
 } TensorBase;
 
 // The type of indexing primitive used to access data at a particular dimension of a tensor.
@@ -127,13 +178,62 @@ typedef TensorBaseSubscript SubscriptArray[MAX_RANK];
 
 // TODO: Refactor code to calculate ndim in methods instead of passing in ndim to function parameters to increase reliability.
 
+/*********************************************************
+ *                    Kernel Dispatch                    *
+ *********************************************************/
+
+// Elementwise binary kernel: out[i] = a[i * a_step] `op` b[i * b_step] for i in [0, n).
+// A step of 0 repeats a single element (e.g., a scalar operand). `out` may alias `a` or `b`.
+// The operands and the output are arrays of the (floating point) dtype the kernel was retrieved for, except for the
+// outputs of comparisons, which are arrays of bool.
+typedef void (*BinaryKernel)(const void *a, long a_step, const void *b, long b_step, void *out, long n);
+
+// Elementwise unary kernel: out[i] = uop(in[i]) for i in [0, n). `out` may alias `in`.
+typedef void (*UnaryKernel)(const void *in, void *out, long n);
+
+// Detects the CPU's instruction set and fills the kernel dispatch tables. Called once at module initialization.
+EXPORT void TensorBase_init_kernels(void);
+EXPORT InstructionSet TensorBase_get_instruction_set(void);
+EXPORT BinaryKernel TensorBase_get_binary_kernel(BinaryScalarOperation binop, DType dtype);
+EXPORT UnaryKernel TensorBase_get_unary_kernel(UnaryScalarOperation uop, DType dtype);
+// Binary kernel for out[i] = a[i * a_step] * mask[i * mask_step], where `a` and `out` are arrays of the (floating point)
+// dtype and `mask` is an array of bool. The mask is read as is, without converting it to the dtype first.
+EXPORT BinaryKernel TensorBase_get_mask_multiply_kernel(DType dtype);
+// Selects the fast-math accuracy tier for exp, log, tanh, sigmoid and pow. Disabled by default.
+EXPORT void TensorBase_set_fast_math(bool enabled);
+EXPORT bool TensorBase_get_fast_math(void);
+
+/*********************************************************
+ *                      Parallelism                      *
+ *********************************************************/
+
+// Body of a parallel loop: processes the iterations [begin, end). `context` is passed through unchanged.
+typedef void (*ParallelForBody)(void *context, long begin, long end);
+
+// Runs body over the iterations [0, n), split into contiguous chunks that the pool's threads (including the caller)
+// process concurrently. Every chunk has at least `grain_size` iterations, so small loops run serially on the caller.
+EXPORT void TensorBase_parallel_for(long n, long grain_size, ParallelForBody body, void *context);
+// Sets the number of threads (including the caller) parallel loops use. Defaults to the number of online processors.
+EXPORT void TensorBase_set_num_threads(long num_threads);
+EXPORT long TensorBase_get_num_threads(void);
+
 /*********************************************************
  *                    Alloc & Dealloc                    *
  *********************************************************/
 
-EXPORT StatusCode TensorBase_init(TensorBase *tb, ShapeArray shape, long ndim);
+EXPORT StatusCode TensorBase_init(TensorBase *tb, ShapeArray shape, long ndim, DType dtype);
 EXPORT void TensorBase_dealloc(TensorBase *tb);
 
+// Caching allocator for tensor storage and scratch buffers. Freed buffers are kept on per-size-class free lists and
+// reused by later allocations of the same class, so a loop that allocates the same sizes on every iteration (e.g., a
+// training step) stops calling the system allocator after its first iteration. Buffers are aligned to TB_ALIGNMENT.
+// Thread safe. A buffer must be freed with the size it was allocated with.
+EXPORT void *TensorBase_cache_malloc(size_t size);
+EXPORT void TensorBase_cache_free(void *ptr, size_t size);
+// Returns the cached (free) buffers to the system. Buffers in use are not affected.
+EXPORT void TensorBase_empty_cache(void);
+EXPORT void TensorBase_get_memory_stats(TensorBaseMemoryStats *stats);
+
 /*********************************************************
  *                     String Methods                    *
  *********************************************************/
@@ -155,26 +255,83 @@ EXPORT StatusCode TensorBase_unbroadcast(TensorBase *in, ShapeArray target_shape
 EXPORT StatusCode TensorBase_binary_op_tensorbase_tensorbase(TensorBase *a, TensorBase *b, TensorBase *out, BinaryScalarOperation binop);
 EXPORT StatusCode TensorBase_binary_op_tensorbase_scalar(TensorBase *a, scalar s, TensorBase *out, BinaryScalarOperation binop);
 EXPORT StatusCode TensorBase_binary_op_scalar_tensorbase(TensorBase *a, scalar s, TensorBase *out, BinaryScalarOperation binop);
+// a `op`= b, with b broadcasted to the shape of a. a must be float32 or float64, and the operation not a comparison.
+EXPORT StatusCode TensorBase_binary_op_inplace(TensorBase *a, TensorBase *b, BinaryScalarOperation binop);
+EXPORT StatusCode TensorBase_binary_op_inplace_scalar(TensorBase *a, scalar s, BinaryScalarOperation binop);
+// out = a `op` b, written to the existing tensor `out`, which must have the broadcasted shape. The result is converted
+// to the dtype of `out`.
+EXPORT StatusCode TensorBase_binary_op_out(TensorBase *a, TensorBase *b, TensorBase *out, BinaryScalarOperation binop);
 
 EXPORT StatusCode TensorBase_unary_op_inplace(TensorBase *in, UnaryScalarOperation uop);
 EXPORT StatusCode TensorBase_unary_op(TensorBase *in, TensorBase *out, UnaryScalarOperation uop);
 
 EXPORT StatusCode TensorBase_get_matrix_multiplication_shape(TensorBase *a, TensorBase *b, ShapeArray *out);
 EXPORT StatusCode TensorBase_matrix_multiply(TensorBase *a, TensorBase *b, TensorBase *out);
+// Like TensorBase_matrix_multiply, but written to the existing tensor `out`, which must have the shape of the product.
+EXPORT StatusCode TensorBase_matrix_multiply_out(TensorBase *a, TensorBase *b, TensorBase *out);
+
+// Cache-blocked, packed GEMM: out = A @ B, where A is (n x l), B is (l x m) and out is (n x m) with unit column stride.
+// A and B may have arbitrary row and column strides (e.g., swapping them reads the transpose without a copy).
+// A, B and out are arrays of `dtype`, which must be a floating point dtype.
+EXPORT StatusCode TensorBase_gemm(DType dtype, long n, long l, long m,
+                                  void *A, long a_row_stride, long a_col_stride,
+                                  void *B, long b_row_stride, long b_col_stride,
+                                  void *out, long out_row_stride);
+// TensorBase_gemm with an epilogue: out = activation(A @ B + bias), where bias is an array of m elements of `dtype`
+// added to every row (or NULL), and activation is an elementwise kernel of `dtype` (or NULL). The epilogue is applied
+// to every tile of the output before it is stored, so the output is written once.
+EXPORT StatusCode TensorBase_gemm_epilogue(DType dtype, long n, long l, long m,
+                                           void *A, long a_row_stride, long a_col_stride,
+                                           void *B, long b_row_stride, long b_col_stride,
+                                           void *out, long out_row_stride,
+                                           const void *bias, UnaryKernel activation);
+
+// A batch of GEMMs: out[i] = A[i] @ B[i] for i < batch_count, where A[i] starts at A + a_offsets[i], B[i] starts at
+// B + b_offsets[i] and out[i] starts at out + i * out_batch_stride. The entries are computed in parallel, and a B that
+// is shared by every entry (e.g., broadcast) is packed only once.
+EXPORT StatusCode TensorBase_gemm_batched(DType dtype, long batch_count, long n, long l, long m,
+                                          void *A, const long *a_offsets, long a_row_stride, long a_col_stride,
+                                          void *B, const long *b_offsets, long b_row_stride, long b_col_stride,
+                                          void *out, long out_row_stride, long out_batch_stride);
 
 /*********************************************************
  *                      Aggregation                      *
  *********************************************************/
 
+// The results of SUM, MEAN, MAX and MIN have the dtype of the input, except that MEAN of an int64 or bool input is
+// float64 and SUM, MAX and MIN of a bool input are int64. ARGMAX and ARGMIN results are int64.
 EXPORT StatusCode TensorBase_aggregate(TensorBase *in, IndexArray aggregation_dimensions, int keepdim, TensorBase *out, AggScalarOperation agg);
 
 /*********************************************************
  *                     Manipulation                      *
  *********************************************************/
 
+// Permute, transpose and reshape (of contiguous tensors) return views that share the input's storage.
 EXPORT StatusCode TensorBase_permute(TensorBase *in, IndexArray permutation, long ndim, TensorBase *out);
 EXPORT StatusCode TensorBase_transpose(TensorBase *in, TensorBase *out);
 
+// A tensor is contiguous if its elements are laid out in row-major order without gaps.
+EXPORT bool TensorBase_is_contiguous(TensorBase *in);
+// Returns a view of `in` if it is contiguous, and a contiguous copy otherwise.
+EXPORT StatusCode TensorBase_contiguous(TensorBase *in, TensorBase *out);
+// Returns a view of all of `in` that shares its storage, keeping the storage alive until the view is deallocated.
+EXPORT StatusCode TensorBase_view(TensorBase *in, TensorBase *out);
+// Size of an element of the dtype, in bytes.
+EXPORT size_t TensorBase_element_size(DType dtype);
+// Address of the first element. Singletons hold their value in the tensor struct itself.
+EXPORT void *TensorBase_data_ptr(TensorBase *in);
+// Returns a view of `in` if it already has the dtype, and a contiguous copy with the elements converted otherwise.
+EXPORT StatusCode TensorBase_to_dtype(TensorBase *in, DType dtype, TensorBase *out);
+
+// Joins `count` tensors of one dtype and ndim into a new contiguous tensor, along an existing dimension (whose size
+// may differ between the inputs), or along a new dimension `dim` for stack (which requires equal shapes). Negative
+// dimensions count from the end. Each input is copied with one memcpy per row of the dimensions before dim.
+EXPORT StatusCode TensorBase_concatenate(TensorBase **ins, long count, long dim, TensorBase *out);
+EXPORT StatusCode TensorBase_stack(TensorBase **ins, long count, long dim, TensorBase *out);
+// Splits `in` along dim into `count` new contiguous tensors outs[i] of sizes[i] elements along dim (which must sum
+// to the size of dim). This is the inverse of concatenate, and so its gradient.
+EXPORT StatusCode TensorBase_split(TensorBase *in, const long *sizes, long count, long dim, TensorBase *outs);
+
 
 EXPORT StatusCode TensorBase_reshape_inplace(TensorBase *in, ShapeArray shape, long ndim);
 EXPORT StatusCode TensorBase_reshape(TensorBase *in, TensorBase *out, ShapeArray shape, long ndim);
@@ -188,7 +345,189 @@ EXPORT StatusCode TensorBase_item(TensorBase *t, scalar *item);
  *                     Set and Get                       *
  *********************************************************/
 
+// Returns a view of the subscripted elements (or a singleton holding a copy, if every dimension is indexed).
 EXPORT StatusCode TensorBase_get(TensorBase *in, SubscriptArray subscripts, long num_subscripts, TensorBase *out);
 
 EXPORT StatusCode TensorBase_set_scalar(TensorBase *in, SubscriptArray subscripts, long num_subscripts, scalar s);
-EXPORT StatusCode TensorBase_set_tensorbase(TensorBase *in, SubscriptArray subscripts, long num_subscripts, TensorBase *t);
\ No newline at end of file
+EXPORT StatusCode TensorBase_set_tensorbase(TensorBase *in, SubscriptArray subscripts, long num_subscripts, TensorBase *t);
+/*********************************************************
+ *                         Linear                        *
+ *********************************************************/
+
+// Activations that a linear layer applies to its output.
+typedef enum
+{
+    TB_ACTIVATION_NONE,
+    TB_ACTIVATION_RELU,
+    TB_ACTIVATION_SIGMOID,
+    TB_ACTIVATION_TANH,
+} Activation;
+
+// out = activation(in @ weight^T + bias), for a (..., in_features) float tensor `in`, the (out_features, in_features)
+// weight and the (out_features) bias (or NULL) of the same dtype. The result is a (..., out_features) tensor. The
+// weight is read in place through its strides, and the bias and activation are applied by the GEMM's epilogue.
+EXPORT StatusCode TensorBase_linear(TensorBase *in, TensorBase *weight, TensorBase *bias, Activation activation, TensorBase *out);
+// The gradients of linear, from its input, weight, output `out` and the gradient `grad` of the output. The gradient
+// of the activation (computed from the output) and the bias' gradient are computed in one pass over `grad`, followed
+// by a GEMM for each of grad_in and grad_weight. grad_bias may be NULL.
+EXPORT StatusCode TensorBase_linear_backward(TensorBase *in, TensorBase *weight, TensorBase *out, TensorBase *grad, Activation activation,
+                                             TensorBase *grad_in, TensorBase *grad_weight, TensorBase *grad_bias);
+
+/*********************************************************
+ *                      Convolution                      *
+ *********************************************************/
+
+// Geometry of the sliding window of a 2D convolution. Index 0 applies to the height and index 1 to the width.
+typedef struct
+{
+    long kernel_size[2];
+    long stride[2];
+    long padding[2];  // Zeros added to both sides of the input.
+    long dilation[2]; // Spacing between the elements of the window.
+} TensorBaseConv2dWindow;
+
+// Number of positions of the window along a dimension of `size` elements, or a negative number if it does not fit.
+EXPORT long TensorBase_conv2d_output_size(long size, const TensorBaseConv2dWindow *window, long dim);
+// im2col: copies every position of the window over an (N, C, H, W) or (C, H, W) float tensor into a column of an
+// (N, C * kh * kw, L) or (C * kh * kw, L) tensor, where L is the number of window positions (like torch's unfold).
+// Rows are ordered by channel, then kernel row, then kernel column, so a convolution is the matrix product of the
+// (out_channels, C * kh * kw) kernels and the columns. The input may have any strides. Padding reads as zero.
+EXPORT StatusCode TensorBase_im2col(TensorBase *in, const TensorBaseConv2dWindow *window, TensorBase *out);
+// col2im, the adjoint of im2col: sums every column of an (N, C * kh * kw, L) or (C * kh * kw, L) tensor back into
+// the window position it came from, in an (N, C, height, width) or (C, height, width) tensor (like torch's fold).
+// Elements that fall into the padding are dropped. This scatters the gradient of im2col's output to its input.
+EXPORT StatusCode TensorBase_col2im(TensorBase *in, const TensorBaseConv2dWindow *window, long height, long width, TensorBase *out);
+
+// Algorithms that compute a 2D convolution.
+typedef enum
+{
+    TB_CONV2D_AUTO,         // Selected per dtype, input shape, out_channels and window (see TensorBase_conv2d).
+    TB_CONV2D_IM2COL,       // im2col followed by a GEMM. Supports every window.
+    TB_CONV2D_WINOGRAD_2X3, // Winograd F(2x2, 3x3): 2.25x fewer multiplications. 3x3 kernels with stride and dilation 1.
+    TB_CONV2D_WINOGRAD_4X3, // Winograd F(4x4, 3x3): 4x fewer multiplications. 3x3 kernels with stride and dilation 1.
+    TB_CONV2D_FFT,          // Pointwise products of 2D FFTs, whose cost does not grow with the kernel size. Supports every window.
+} Conv2dAlgorithm;
+
+#define NUM_CONV2D_ALGORITHMS (TB_CONV2D_FFT + 1)
+
+// out = conv2d(in, weight) + bias: the cross-correlation of an (N, C, H, W) or (C, H, W) float tensor with the
+// (out_channels, C * kh * kw) kernels `weight`, whose columns are ordered like the rows of im2col's result. The result
+// is an (N, out_channels, OH, OW) or (out_channels, OH, OW) tensor. `bias` is an (out_channels) tensor, or NULL.
+// weight and bias must have the dtype of `in`, and every operand may have any strides. TB_CONV2D_AUTO selects the
+// algorithm with the lowest estimated cost, or (in benchmark mode) times every applicable algorithm on the first call
+// and keeps the fastest. Either way, the selection is cached per dtype, input shape, out_channels and window.
+EXPORT StatusCode TensorBase_conv2d(TensorBase *in, TensorBase *weight, TensorBase *bias, const TensorBaseConv2dWindow *window,
+                                    Conv2dAlgorithm algorithm, TensorBase *out);
+// Whether an algorithm (other than TB_CONV2D_AUTO) supports a window.
+EXPORT bool TensorBase_conv2d_supports(Conv2dAlgorithm algorithm, const TensorBaseConv2dWindow *window);
+// Benchmark mode for TB_CONV2D_AUTO. Disabled by default, since the selected algorithm (and so the rounding of the
+// result) may then vary from run to run. Changing the mode clears the cached selections.
+EXPORT void TensorBase_set_conv2d_benchmark(bool enabled);
+EXPORT bool TensorBase_get_conv2d_benchmark(void);
+
+/*********************************************************
+ *                        Softmax                        *
+ *********************************************************/
+
+// out = softmax(in) along dim, or log_softmax(in) if `log`, as a new contiguous float tensor. The max and the sum of
+// exponentials of each slice are computed in one pass, and the result is written in a second one, so large inputs
+// do not overflow. Negative dimensions count from the end.
+EXPORT StatusCode TensorBase_softmax(TensorBase *in, long dim, bool log, TensorBase *out);
+// out = the gradient of softmax's (or log_softmax's) input, from its `output` and the gradient `grad` of the output.
+EXPORT StatusCode TensorBase_softmax_backward(TensorBase *output, TensorBase *grad, long dim, bool log, TensorBase *out);
+
+// How the losses of the rows are reduced to the loss.
+typedef enum
+{
+    TB_REDUCTION_NONE, // The loss of every row.
+    TB_REDUCTION_MEAN, // The mean over the rows (that are not ignored).
+    TB_REDUCTION_SUM,
+} LossReduction;
+
+// Cross-entropy loss of the (N, C) or (C) float logits against class index targets, an (N) or singleton int64 tensor,
+// or class probability targets (e.g., one-hot), a tensor of the logits' shape and dtype. Rows whose index target is
+// ignore_index have no loss and no gradient. The loss is computed from the log-sum-exp of each row, in one pass over
+// the logits, and `lse` receives the (N) (or (1)) log-sum-exps, for the backward pass.
+EXPORT StatusCode TensorBase_cross_entropy(TensorBase *logits, TensorBase *target, long ignore_index, LossReduction reduction,
+                                           TensorBase *loss, TensorBase *lse);
+// out = the gradient of the logits, (softmax(logits) * sum(target) - target) times the gradient of each row's loss,
+// from the forward's lse and the gradient `grad_loss` of the loss.
+EXPORT StatusCode TensorBase_cross_entropy_backward(TensorBase *logits, TensorBase *target, TensorBase *lse, TensorBase *grad_loss,
+                                                    long ignore_index, LossReduction reduction, TensorBase *out);
+
+/*********************************************************
+ *                       Attention                       *
+ *********************************************************/
+
+// out = softmax(query @ key^T * scale + mask) @ value, for (..., Sq, D) queries, (..., Sk, D) keys and (..., Sk, Dv)
+// values of one float dtype, whose leading (batch and head) dimensions match. mask may be NULL, an (Sq, Sk) tensor
+// shared by every entry, or a (..., Sq, Sk) tensor. With `causal`, query i attends to keys j <= i only. The scores are
+// computed tile by tile and never stored, and `lse` receives the (..., Sq) log-sum-exps of the scores of every query,
+// for the backward pass. A query whose keys are all masked out has a zero output.
+// query_offsets may be NULL, or an (N) int64 tensor for (N, ..., Sq, D) queries (e.g., over a key/value cache): the
+// queries of batch entry n are then the keys' positions query_offsets[n] to query_offsets[n] + Sq - 1, the keys after
+// them are ignored, and with `causal` query i attends to keys j <= query_offsets[n] + i.
+EXPORT StatusCode TensorBase_scaled_dot_product_attention(TensorBase *query, TensorBase *key, TensorBase *value, TensorBase *mask,
+                                                          TensorBase *query_offsets, bool causal, scalar scale, TensorBase *out, TensorBase *lse);
+// The gradients of the query, key and value of scaled_dot_product_attention, from its operands, its output `out`, lse
+// and the gradient `grad` of the output. The probabilities are recomputed tile by tile.
+EXPORT StatusCode TensorBase_scaled_dot_product_attention_backward(TensorBase *query, TensorBase *key, TensorBase *value, TensorBase *mask,
+                                                                   TensorBase *query_offsets, bool causal, scalar scale, TensorBase *out,
+                                                                   TensorBase *lse, TensorBase *grad, TensorBase *grad_query,
+                                                                   TensorBase *grad_key, TensorBase *grad_value);
+// Writes the (N, ..., T, D) rows `in` into the contiguous (N, ..., L, D) key or value cache, at the positions
+// positions[n] to positions[n] + T - 1 of batch entry n, given by the (N) int64 tensor `positions`.
+EXPORT StatusCode TensorBase_kv_cache_write(TensorBase *cache, TensorBase *in, TensorBase *positions);
+
+/*********************************************************
+ *                     Normalization                     *
+ *********************************************************/
+
+// Layer normalization over the last normalized_ndim dimensions of the float tensor `in`, with the biased variance
+// (as torch.nn.LayerNorm): out = (x - mean) / sqrt(var + eps) * weight + bias, where x = in + residual. residual,
+// weight and bias may be NULL; weight and bias have the shape of the normalized dimensions. With a residual, `sum`
+// receives x. mean and rstd receive the mean and 1 / sqrt(var + eps) of every normalized row, for the backward pass.
+EXPORT StatusCode TensorBase_layer_norm(TensorBase *in, TensorBase *residual, TensorBase *weight, TensorBase *bias, long normalized_ndim,
+                                        scalar eps, TensorBase *out, TensorBase *sum, TensorBase *mean, TensorBase *rstd);
+// The gradients of layer_norm, from its normalized input `in` (the sum, if it had a residual), weight, saved mean and
+// rstd, and the gradient `grad` of the output. grad_in receives the gradient of x (and of the residual); grad_weight
+// and grad_bias, if not NULL, receive the gradients of the weight and the bias.
+EXPORT StatusCode TensorBase_layer_norm_backward(TensorBase *in, TensorBase *weight, TensorBase *mean, TensorBase *rstd, TensorBase *grad,
+                                                 long normalized_ndim, TensorBase *grad_in, TensorBase *grad_weight, TensorBase *grad_bias);
+
+/*********************************************************
+ *                       Optimizers                      *
+ *********************************************************/
+
+// Hyperparameters of an SGD step (with the semantics of torch.optim.SGD).
+typedef struct
+{
+    scalar lr;
+    scalar momentum;     // 0 disables the momentum buffers.
+    scalar dampening;
+    scalar weight_decay; // L2 penalty, added to the gradient.
+    bool nesterov;
+    bool first_step;     // The momentum buffers are initialized to the gradient instead of being decayed.
+} TensorBaseSGDOptions;
+
+// Hyperparameters of an Adam or AdamW step (with the semantics of torch.optim.Adam and torch.optim.AdamW).
+typedef struct
+{
+    scalar lr;
+    scalar beta1;
+    scalar beta2;
+    scalar eps;
+    scalar weight_decay;
+    bool decoupled_weight_decay; // AdamW: the parameters are decayed directly instead of through the gradient.
+    long step;                   // Number of the step being taken, starting at 1. Used for bias correction.
+} TensorBaseAdamOptions;
+
+// Fused optimizer steps over a list of `count` parameters. params[i], grads[i] and the state buffers at index i must
+// be contiguous, have the same shape and the same floating point dtype. Every element is updated in a single pass
+// that reads the parameter, its gradient and its state once and writes the parameter and the state once, and the
+// elements of all parameters are processed by one parallel loop.
+// momentum_buffers may be NULL if options->momentum is 0.
+EXPORT StatusCode TensorBase_sgd_step(long count, TensorBase **params, TensorBase **grads, TensorBase **momentum_buffers,
+                                      const TensorBaseSGDOptions *options);
+EXPORT StatusCode TensorBase_adam_step(long count, TensorBase **params, TensorBase **grads, TensorBase **exp_avgs,
+                                       TensorBase **exp_avg_sqs, const TensorBaseAdamOptions *options);
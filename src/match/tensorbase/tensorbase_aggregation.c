@@ -1,6 +1,109 @@
 #include "tensorbase.h"
 #include "tensorbase_util.c"
 
+// The reduction engine walks the input in memory order, one "row" at a time.
+// Adjacent dimensions that are either all reduced or all kept are merged into groups, and the innermost group forms
+// the rows. If it is reduced, every row is a contiguous segment that collapses into a single output element (e.g., the
+// sum over the last dimension, or over the whole tensor). If it is kept, every row is combined elementwise into a
+// contiguous run of the output (e.g., the sum over the first dimension). Either way, the inner loops are unit stride
+// and vectorizable, and the outer groups are walked with an odometer instead of per-element index arithmetic.
+
+// Segments up to this length are summed directly. Longer segments are split in half recursively (pairwise
+// summation), which grows the rounding error with O(log n) rather than O(n) at no extra cost.
+#define AGG_PAIRWISE_BLOCK 128
+// Number of independent partial results per segment, so the inner loops map onto vector registers.
+#define AGG_LANES 8
+// A reduction of the whole tensor is split into blocks of this many elements, whose partial results are combined in
+// order. The blocks do not depend on the number of threads, so neither does the result.
+#define AGG_PARALLEL_BLOCK 65536
+
+static inline bool aggregate_is_better(scalar candidate, scalar best, bool maximize)
+{
+    // MAX keeps the last occurrence of the extremum (>=) and MIN keeps the first (<). NaNs are never selected.
+    return maximize ? candidate >= best : candidate < best;
+}
+
+typedef struct
+{
+    const void *in;    // The contiguous input, an array of its dtype.
+    scalar *sum;       // Running sums (SUM and MEAN).
+    scalar *best;      // Running extrema (MAX, MIN, ARGMAX and ARGMIN).
+    long *best_index;  // Flat input indices of the running extrema.
+    bool is_extremum;
+    bool maximize;
+    long group_count;
+    ShapeArray group_size;
+    StrideArray group_in_stride;
+    StrideArray group_out_stride;
+    long row_count;
+    bool row_is_reduced;
+    // The kept group the threads share out. Every output element is then computed by a single thread, in the same
+    // order as a serial reduction. If it is the inner group, the threads share out the columns of every row instead.
+    // It is -1 if every group is reduced.
+    long split_group;
+} AggregateLoop;
+
+typedef struct
+{
+    const void *in;
+    long numel;
+    bool is_extremum;
+    bool maximize;
+    scalar *partial;      // Partial sum, or extremum, of every block.
+    long *partial_index;  // Flat index of the extremum of every block.
+} AggregateBlocksLoop;
+
+#define AGG_DTYPE float64
+#define AGG_SCALAR double
+#include "tensorbase_aggregation_kernels.c"
+#undef AGG_DTYPE
+#undef AGG_SCALAR
+
+#define AGG_DTYPE float32
+#define AGG_SCALAR float
+#include "tensorbase_aggregation_kernels.c"
+#undef AGG_DTYPE
+#undef AGG_SCALAR
+
+static StatusCode aggregate_all(DType dtype, const void *in, long numel, bool is_extremum, bool maximize, scalar *result, long *result_index)
+{
+    // Reduces a contiguous segment into *result (SUM and MEAN) or into the running extremum *result and its flat
+    // index *result_index. The blocks are reduced in parallel and then combined in order.
+    long block_count = (numel + AGG_PARALLEL_BLOCK - 1) / AGG_PARALLEL_BLOCK;
+    scalar *partial = (scalar *)TensorBase_cache_malloc(block_count * sizeof(scalar));
+    long *partial_index = is_extremum ? (long *)TensorBase_cache_malloc(block_count * sizeof(long)) : NULL;
+    if (partial == NULL || (is_extremum && partial_index == NULL))
+    {
+        TensorBase_cache_free(partial, block_count * sizeof(scalar));
+        TensorBase_cache_free(partial_index, block_count * sizeof(long));
+        return TB_MALLOC_ERROR;
+    }
+
+    AggregateBlocksLoop loop = {in, numel, is_extremum, maximize, partial, partial_index};
+    TensorBase_parallel_for(block_count, 1, dtype == TB_FLOAT32 ? aggregate_blocks_float32 : aggregate_blocks_float64, &loop);
+
+    if (is_extremum)
+    {
+        // Blocks are folded in memory order, so the tie rule of a sequential scan applies across blocks.
+        for (long block = 0; block < block_count; block++)
+        {
+            if (partial_index[block] >= 0 && (*result_index < 0 || aggregate_is_better(partial[block], *result, maximize)))
+            {
+                *result = partial[block];
+                *result_index = partial_index[block];
+            }
+        }
+    }
+    else
+    {
+        *result += aggregate_pairwise_sum_float64(partial, block_count);
+    }
+
+    TensorBase_cache_free(partial, block_count * sizeof(scalar));
+    TensorBase_cache_free(partial_index, block_count * sizeof(long));
+    return TB_OK;
+}
+
 StatusCode TensorBase_aggregate(TensorBase *in, IndexArray aggregation_dimensions, int keepdim, TensorBase *out, AggScalarOperation agg)
 {
     if (in == NULL || out == NULL)
@@ -8,6 +111,35 @@ StatusCode TensorBase_aggregate(TensorBase *in, IndexArray aggregation_dimension
         return TB_NULL_INPUT_ERROR;
     }
 
+    if (!TensorBase_is_floating_dtype(in->dtype))
+    {
+        // Integer and bool tensors are reduced in float64, which is exact for integers up to 2^53. Every result except
+        // MEAN is then converted to int64.
+        TensorBase converted, result;
+        RETURN_IF_ERROR(TensorBase_to_dtype(in, TB_FLOAT64, &converted));
+        StatusCode status = TensorBase_aggregate(&converted, aggregation_dimensions, keepdim, &result, agg);
+        TensorBase_dealloc(&converted);
+        RETURN_IF_ERROR(status);
+        if (agg == SCALAR_AGG_MEAN || result.dtype == TB_INT64)
+        {
+            memcpy(out, &result, sizeof(TensorBase));
+            return TB_OK;
+        }
+        status = TensorBase_to_dtype(&result, TB_INT64, out);
+        TensorBase_dealloc(&result);
+        return status;
+    }
+
+    // The reduction walks the input in row-major order, so views are reduced from a contiguous copy.
+    if (!TensorBase_is_contiguous(in))
+    {
+        TensorBase contiguous_in;
+        RETURN_IF_ERROR(TensorBase_contiguous(in, &contiguous_in));
+        StatusCode status = TensorBase_aggregate(&contiguous_in, aggregation_dimensions, keepdim, out, agg);
+        TensorBase_dealloc(&contiguous_in);
+        return status;
+    }
+
     // This array will act as a "flag" array, where each index corresponds to a dimension of the input tensor.
     // A value of 1 at a specific index means that dimension should be aggregated (reduced),
     // and a 0 means it should be kept.
@@ -38,7 +170,8 @@ StatusCode TensorBase_aggregate(TensorBase *in, IndexArray aggregation_dimension
         if (agg == SCALAR_AGG_ARGMAX || agg == SCALAR_AGG_ARGMIN)
         {
             // The argmax/argmin of a singleton is the only element in the tensor.
-            out->data = 0;
+            out->dtype = TB_INT64;
+            TensorBase_set_singleton_value(out, 0);
         }
 
         return TB_OK;
@@ -59,126 +192,191 @@ StatusCode TensorBase_aggregate(TensorBase *in, IndexArray aggregation_dimension
     for (long dim = in->ndim; dim < MAX_RANK; dim++)
     {
         aggregated_shape[dim] = -1;
-    }  
+    }
 
     // Boolean to indicate if only one dimension is being reduced (for ARGMAX and ARGMIN).
     // If only one dimension is being reduced (aggregated away), then the second element in aggregation_dimensions would be negative (not set).
     bool only_one_dimensions_reduced = aggregation_dimensions[1] < 0;
 
-    // Initialize the output tensor with the new shape.
-    RETURN_IF_ERROR(TensorBase_init(out, aggregated_shape, in->ndim));
+    bool is_extremum = agg == SCALAR_AGG_MAX || agg == SCALAR_AGG_MIN || agg == SCALAR_AGG_ARGMAX || agg == SCALAR_AGG_ARGMIN;
+    bool is_index = agg == SCALAR_AGG_ARGMAX || agg == SCALAR_AGG_ARGMIN;
+    bool maximize = agg == SCALAR_AGG_MAX || agg == SCALAR_AGG_ARGMAX;
 
-    // Store a temporary buffer that holds the output (aggregated) tensors data on the stack for fast access.
-    scalar temporary_output_buffer[out->numel];
-    // Store another temporary buffer to store the max and min elements for MAX, MIN, ARGMAX, and ARGMIN aggregation operations.
-    scalar min_max_buffer[out->numel];
+    // Initialize the output tensor with the new shape. Indices are int64, everything else keeps the input's dtype.
+    RETURN_IF_ERROR(TensorBase_init(out, aggregated_shape, in->ndim, is_index ? TB_INT64 : in->dtype));
 
-    // Initialization of this array depends on the aggregation operation.
-    switch (agg)
+    // Merge adjacent dimensions with the same role into groups. Dimensions of size 1 play no role.
+    long group_count = 0;
+    ShapeArray group_size;
+    bool group_is_reduced[MAX_RANK];
+    for (long dim = 0; dim < in->ndim; dim++)
     {
-    case SCALAR_AGG_MAX:
-    case SCALAR_AGG_ARGMAX:
-        for (long i = 0; i < out->numel; i++)
+        if (in->shape[dim] == 1)
         {
-            min_max_buffer[i] = -DBL_MAX;
+            continue;
         }
-        break;
-    case SCALAR_AGG_MIN:
-    case SCALAR_AGG_ARGMIN:
-        for (long i = 0; i < out->numel; i++)
+        bool is_reduced = dimensions_to_aggregate[dim] != 0;
+        if (group_count > 0 && group_is_reduced[group_count - 1] == is_reduced)
         {
-            min_max_buffer[i] = DBL_MAX;
+            group_size[group_count - 1] *= in->shape[dim];
+        }
+        else
+        {
+            group_size[group_count] = in->shape[dim];
+            group_is_reduced[group_count] = is_reduced;
+            group_count++;
         }
-        break;
-    case SCALAR_AGG_SUM:
-    case SCALAR_AGG_MEAN:
-        memset(temporary_output_buffer, 0, sizeof(scalar) * out->numel);
-        break;
-    default:
-        break;
     }
-
-    // Loop through each element in the input tensors data, and map what position in the aggregated tensors data.
-    for (long in_data_index = 0; in_data_index < in->numel; in_data_index++)
+    if (group_count == 0)
     {
-        long temporary_index = in_data_index;
-        long out_data_index = 0;
-        IndexArray in_coordinate;
-        // At this point, the dimensions of the input and output tensors are equal.
-        for (long dim = out->ndim - 1; dim >= 0; dim--)
-        {
-            // Calculate the coordinate within the current dimension of the input tensor.
-            long in_coordinate_at_current_dimension = temporary_index % in->shape[dim];
-            in_coordinate[dim] = in_coordinate_at_current_dimension;
+        // A single element.
+        group_size[0] = 1;
+        group_is_reduced[0] = true;
+        group_count = 1;
+    }
 
-            // Calculate the corresponding coordinate within the current dimension of the output tensor.
-            // If dimensions_to_aggregate[dim] is 1, !dimensions_to_aggregate[dim] is 0, and the coordinate is reduced.
-            // Vice versa, if 0, it is preserved.
-            long out_coordinate_at_current_dimension = !dimensions_to_aggregate[dim] * in_coordinate_at_current_dimension;
+    // Output strides of the groups. Reduced groups do not move through the output.
+    StrideArray group_out_stride;
+    long out_stride = 1;
+    for (long group = group_count - 1; group >= 0; group--)
+    {
+        group_out_stride[group] = group_is_reduced[group] ? 0 : out_stride;
+        out_stride *= group_is_reduced[group] ? 1 : group_size[group];
+    }
 
-            // Update the linear index for the output data by adding the offset caused by the
-            // coordinate in the current dimension, scaled by the stride for that dimension.
-            // Strides are used to calculate the memory offset based on multi-dimensional indices.
-            out_data_index += out_coordinate_at_current_dimension * out->strides[dim];
+    long inner_group = group_count - 1;
+    long row_length = group_size[inner_group];
+    bool row_is_reduced = group_is_reduced[inner_group];
 
-            // Update the temporary linear index of the input tensor by removing the contribution
-            // of the current dimension.
-            temporary_index /= in->shape[dim];
+    // Running extrema and their flat input indices live in scratch buffers (the output may be arbitrarily large).
+    scalar *best = NULL;
+    long *best_index = NULL;
+    if (is_extremum)
+    {
+        best = (scalar *)TensorBase_cache_malloc(out->numel * sizeof(scalar));
+        best_index = (long *)TensorBase_cache_malloc(out->numel * sizeof(long));
+        if (best == NULL || best_index == NULL)
+        {
+            TensorBase_cache_free(best, out->numel * sizeof(scalar));
+            TensorBase_cache_free(best_index, out->numel * sizeof(long));
+            TensorBase_dealloc(out);
+            return TB_MALLOC_ERROR;
         }
+        for (long i = 0; i < out->numel; i++)
+        {
+            best[i] = maximize ? -INFINITY : INFINITY;
+            best_index[i] = -1;
+        }
+    }
+    // Running sums are accumulated in double precision: directly in the output if it is float64, and in a scratch
+    // buffer that is rounded into the output at the end otherwise.
+    scalar *sum = NULL;
+    if (!is_extremum)
+    {
+        sum = out->dtype == TB_FLOAT64 ? (scalar *)out->data : (scalar *)TensorBase_cache_malloc(out->numel * sizeof(scalar));
+        if (sum == NULL)
+        {
+            TensorBase_dealloc(out);
+            return TB_MALLOC_ERROR;
+        }
+        memset(sum, 0, out->numel * sizeof(scalar));
+    }
 
-        scalar temp = min_max_buffer[out_data_index];;
+    if (group_count == 1 && row_is_reduced && row_length > AGG_PARALLEL_BLOCK)
+    {
+        // A reduction of the whole tensor: split the single segment into blocks.
+        StatusCode status = aggregate_all(in->dtype, in->data, in->numel, is_extremum, maximize, is_extremum ? best : sum, best_index);
+        if (status != TB_OK)
+        {
+            TensorBase_cache_free(best, out->numel * sizeof(scalar));
+            TensorBase_cache_free(best_index, out->numel * sizeof(long));
+            if (sum != out->data)
+            {
+                TensorBase_cache_free(sum, out->numel * sizeof(scalar));
+            }
+            TensorBase_dealloc(out);
+            return status;
+        }
+    }
+    else
+    {
+        AggregateLoop loop = {in->data, sum, best, best_index, is_extremum, maximize, group_count, {0}, {0}, {0},
+                              in->numel / row_length, row_is_reduced, -1};
+        long in_stride = 1;
+        for (long group = group_count - 1; group >= 0; group--)
+        {
+            loop.group_size[group] = group_size[group];
+            loop.group_in_stride[group] = in_stride;
+            loop.group_out_stride[group] = group_out_stride[group];
+            in_stride *= group_size[group];
+        }
 
-        switch (agg)
+        // Share out the largest kept group (preferring an outer group, whose slices are contiguous).
+        long split_size = 0;
+        for (long group = 0; group < group_count; group++)
         {
-        case SCALAR_AGG_MAX:
-            if (in->data[in_data_index] >= temp)
+            if (!group_is_reduced[group] && group_size[group] > split_size)
             {
-                min_max_buffer[out_data_index] = in->data[in_data_index];
-                temporary_output_buffer[out_data_index] = in->data[in_data_index];
+                loop.split_group = group;
+                split_size = group_size[group];
             }
-            break;
-        case SCALAR_AGG_MIN:
-            if (in->data[in_data_index] < temp)
+        }
+        if (split_size == 0)
+        {
+            // Every group is reduced (a single short segment), so there is nothing to share out.
+            split_size = 1;
+        }
+        long elements_per_unit = max_long(1, in->numel / split_size);
+        TensorBase_parallel_for(split_size, max_long(1, PARALLEL_GRAIN_ELEMENTS / elements_per_unit),
+                                in->dtype == TB_FLOAT32 ? aggregate_rows_float32 : aggregate_rows_float64, &loop);
+    }
+
+    if (is_extremum)
+    {
+        for (long i = 0; i < out->numel; i++)
+        {
+            long index = best_index[i];
+            if (index < 0)
             {
-                min_max_buffer[out_data_index] = in->data[in_data_index];
-                temporary_output_buffer[out_data_index] = in->data[in_data_index];
+                // Nothing was selected (e.g., every element was NaN): fall back to the first element of the reduction,
+                // whose coordinates are the output coordinates with the reduced dimensions at 0.
+                index = 0;
+                long remainder = i;
+                for (long dim = out->ndim - 1; dim >= 0; dim--)
+                {
+                    index += (remainder % out->shape[dim]) * in->strides[dim];
+                    remainder /= out->shape[dim];
+                }
             }
-            break;
-        case SCALAR_AGG_ARGMAX:
-            if (in->data[in_data_index] >= temp)
+
+            if (agg == SCALAR_AGG_MAX || agg == SCALAR_AGG_MIN)
             {
-                min_max_buffer[out_data_index] = in->data[in_data_index];
-                temporary_output_buffer[out_data_index] = only_one_dimensions_reduced ? in_coordinate[aggregation_dimensions[0]] : in_data_index;
+                store_element(out->dtype, out->data, i, best_index[i] < 0 ? load_element(in->dtype, in->data, index) : best[i]);
             }
-            break;
-        case SCALAR_AGG_ARGMIN:
-            if (in->data[in_data_index] < temp)
+            else
             {
-                min_max_buffer[out_data_index] = in->data[in_data_index];
-                temporary_output_buffer[out_data_index] = only_one_dimensions_reduced ? in_coordinate[aggregation_dimensions[0]] : in_data_index;
+                // If only one dimension is reduced, the result is the coordinate along that dimension. Otherwise, it is the flat index.
+                long reduced_dim = aggregation_dimensions[0];
+                ((int64_t *)out->data)[i] = only_one_dimensions_reduced ? (index / in->strides[reduced_dim]) % in->shape[reduced_dim] : index;
             }
-            break;
-        case SCALAR_AGG_MEAN:
-        case SCALAR_AGG_SUM:
-            // For both MEAN and SUM aggregations, accumulate the input data into the temporary output buffer.
-            temporary_output_buffer[out_data_index] += in->data[in_data_index];
-            break;
-        default:
-            break;
         }
+        TensorBase_cache_free(best, out->numel * sizeof(scalar));
+        TensorBase_cache_free(best_index, out->numel * sizeof(long));
     }
 
-    if (agg == SCALAR_AGG_MEAN)
+    if (!is_extremum)
     {
-        scalar num_elements_in_aggregation = in->numel / out->numel;
+        scalar num_elements_in_aggregation = agg == SCALAR_AGG_MEAN ? in->numel / out->numel : 1;
         for (long i = 0; i < out->numel; i++)
         {
-            temporary_output_buffer[i] /= num_elements_in_aggregation;
+            store_element(out->dtype, out->data, i, sum[i] / num_elements_in_aggregation);
+        }
+        if (sum != out->data)
+        {
+            TensorBase_cache_free(sum, out->numel * sizeof(scalar));
         }
     }
 
-    memcpy(out->data, temporary_output_buffer, out->numel * sizeof(scalar));
-
     if (keepdim)
     {
         return TB_OK;
@@ -0,0 +1,208 @@
+// Reduction kernel template.
+// This file is included once per dtype by tensorbase_aggregation.c, with the following macros defined:
+// * AGG_DTYPE: A suffix that makes the names of the generated functions unique (e.g., float32).
+// * AGG_SCALAR: The C type of the input elements (e.g., float).
+// Sums and extrema are accumulated in double precision (scalar) for every dtype.
+
+#define AGG_NAME_(name, dtype) name##_##dtype
+#define AGG_NAME(name, dtype) AGG_NAME_(name, dtype)
+#define AGG(name) AGG_NAME(name, AGG_DTYPE)
+
+static scalar AGG(aggregate_pairwise_sum)(const AGG_SCALAR *data, long n)
+{
+    if (n <= AGG_PAIRWISE_BLOCK)
+    {
+        scalar lanes[AGG_LANES] = {0};
+        long i = 0;
+        for (; i + AGG_LANES <= n; i += AGG_LANES)
+        {
+            for (long j = 0; j < AGG_LANES; j++)
+            {
+                lanes[j] += data[i + j];
+            }
+        }
+        scalar sum = ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) + ((lanes[4] + lanes[5]) + (lanes[6] + lanes[7]));
+        for (; i < n; i++)
+        {
+            sum += data[i];
+        }
+        return sum;
+    }
+
+    // Split on a multiple of AGG_LANES so both halves run full lanes.
+    long half = n / 2 / AGG_LANES * AGG_LANES;
+    return AGG(aggregate_pairwise_sum)(data, half) + AGG(aggregate_pairwise_sum)(data + half, n - half);
+}
+
+static inline void AGG(aggregate_segment_extremum)(const AGG_SCALAR *data, long n, long first_index, bool maximize, scalar *best, long *best_index)
+{
+    // Folds the extremum of a contiguous segment (and its flat index) into *best and *best_index.
+    // Every lane tracks the extremum of a strided subsequence. Merging the lanes, ties go to the larger index for MAX
+    // and to the smaller index for MIN, so the result matches a sequential scan.
+    scalar lane_best[AGG_LANES];
+    long lane_index[AGG_LANES];
+    for (long j = 0; j < AGG_LANES; j++)
+    {
+        lane_best[j] = maximize ? -INFINITY : INFINITY;
+        lane_index[j] = -1;
+    }
+
+    long i = 0;
+    for (; i + AGG_LANES <= n; i += AGG_LANES)
+    {
+        for (long j = 0; j < AGG_LANES; j++)
+        {
+            scalar x = data[i + j];
+            bool better = aggregate_is_better(x, lane_best[j], maximize);
+            lane_best[j] = better ? x : lane_best[j];
+            lane_index[j] = better ? i + j : lane_index[j];
+        }
+    }
+
+    scalar segment_best = maximize ? -INFINITY : INFINITY;
+    long segment_index = -1;
+    for (long j = 0; j < AGG_LANES; j++)
+    {
+        if (lane_index[j] < 0)
+        {
+            continue;
+        }
+        bool strictly_better = maximize ? lane_best[j] > segment_best : lane_best[j] < segment_best;
+        bool wins_tie = lane_best[j] == segment_best && (maximize ? lane_index[j] > segment_index : lane_index[j] < segment_index);
+        if (segment_index < 0 || strictly_better || wins_tie)
+        {
+            segment_best = lane_best[j];
+            segment_index = lane_index[j];
+        }
+    }
+    // The tail comes after every lane element, so a sequential comparison preserves the tie rule.
+    for (; i < n; i++)
+    {
+        if (aggregate_is_better(data[i], segment_best, maximize))
+        {
+            segment_best = data[i];
+            segment_index = i;
+        }
+    }
+
+    // Segments are folded in memory order, so the same tie rule applies across segments.
+    if (segment_index >= 0 && (*best_index < 0 || aggregate_is_better(segment_best, *best, maximize)))
+    {
+        *best = segment_best;
+        *best_index = first_index + segment_index;
+    }
+}
+
+static inline void AGG(aggregate_row_extremum)(const AGG_SCALAR *data, long n, long first_index, bool maximize, scalar *best, long *best_index)
+{
+    // Folds a row elementwise into the running extrema best[0..n) and their flat indices.
+    for (long j = 0; j < n; j++)
+    {
+        scalar x = data[j];
+        bool better = aggregate_is_better(x, best[j], maximize);
+        best[j] = better ? x : best[j];
+        best_index[j] = better ? first_index + j : best_index[j];
+    }
+}
+
+static void AGG(aggregate_rows)(void *context, long begin, long end)
+{
+    AggregateLoop *loop = (AggregateLoop *)context;
+    long inner_group = loop->group_count - 1;
+    long split_group = loop->split_group;
+    long row_length = loop->group_size[inner_group];
+
+    // Either the slices [begin, end) of the split group, each with every column, or a single pass over every row
+    // restricted to the columns [begin, end). Without a split group (nothing is kept), a single pass over every row.
+    bool split_columns = split_group == inner_group;
+    bool split_slices = split_group >= 0 && !split_columns;
+    long column_begin = split_columns ? begin : 0;
+    long column_end = split_columns ? end : row_length;
+    long slice_begin = split_slices ? begin : 0;
+    long slice_end = split_slices ? end : 1;
+    long rows_per_slice = split_slices ? loop->row_count / loop->group_size[split_group] : loop->row_count;
+
+    for (long slice = slice_begin; slice < slice_end; slice++)
+    {
+        long in_data_index = split_slices ? slice * loop->group_in_stride[split_group] : 0;
+        long out_data_index = split_slices ? slice * loop->group_out_stride[split_group] : 0;
+        IndexArray group_coordinate = {0};
+        for (long row_index = 0; row_index < rows_per_slice; row_index++)
+        {
+            const AGG_SCALAR *row = (const AGG_SCALAR *)loop->in + in_data_index + column_begin;
+            long length = column_end - column_begin;
+            long first_index = in_data_index + column_begin;
+            long out_index = out_data_index + (loop->row_is_reduced ? 0 : column_begin);
+            if (loop->is_extremum)
+            {
+                if (loop->row_is_reduced)
+                {
+                    AGG(aggregate_segment_extremum)(row, length, first_index, loop->maximize, loop->best + out_index, loop->best_index + out_index);
+                }
+                else
+                {
+                    AGG(aggregate_row_extremum)(row, length, first_index, loop->maximize, loop->best + out_index, loop->best_index + out_index);
+                }
+            }
+            else
+            {
+                // SUM and MEAN.
+                if (loop->row_is_reduced)
+                {
+                    loop->sum[out_index] += AGG(aggregate_pairwise_sum)(row, length);
+                }
+                else
+                {
+                    scalar *out_row = loop->sum + out_index;
+                    for (long j = 0; j < length; j++)
+                    {
+                        out_row[j] += row[j];
+                    }
+                }
+            }
+
+            // Advance the odometer over the outer groups, except the split group.
+            for (long group = inner_group - 1; group >= 0; group--)
+            {
+                if (group == split_group)
+                {
+                    continue;
+                }
+                group_coordinate[group]++;
+                in_data_index += loop->group_in_stride[group];
+                out_data_index += loop->group_out_stride[group];
+                if (group_coordinate[group] < loop->group_size[group])
+                {
+                    break;
+                }
+                group_coordinate[group] = 0;
+                in_data_index -= loop->group_in_stride[group] * loop->group_size[group];
+                out_data_index -= loop->group_out_stride[group] * loop->group_size[group];
+            }
+        }
+    }
+}
+
+static void AGG(aggregate_blocks)(void *context, long begin, long end)
+{
+    AggregateBlocksLoop *loop = (AggregateBlocksLoop *)context;
+    for (long block = begin; block < end; block++)
+    {
+        long first_index = block * AGG_PARALLEL_BLOCK;
+        long length = min_long(AGG_PARALLEL_BLOCK, loop->numel - first_index);
+        if (loop->is_extremum)
+        {
+            loop->partial[block] = loop->maximize ? -INFINITY : INFINITY;
+            loop->partial_index[block] = -1;
+            AGG(aggregate_segment_extremum)((const AGG_SCALAR *)loop->in + first_index, length, first_index, loop->maximize, loop->partial + block, loop->partial_index + block);
+        }
+        else
+        {
+            loop->partial[block] = AGG(aggregate_pairwise_sum)((const AGG_SCALAR *)loop->in + first_index, length);
+        }
+    }
+}
+
+#undef AGG
+#undef AGG_NAME
+#undef AGG_NAME_
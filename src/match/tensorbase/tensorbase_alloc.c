@@ -1,7 +1,164 @@
 #include "tensorbase.h"
 #include "tensorbase_util.c"
+#include <pthread.h>
 
-StatusCode TensorBase_init(TensorBase *tb, ShapeArray shape, long ndim)
+// Caching allocator.
+// Requests are rounded up to a size class: multiples of TB_ALIGNMENT up to 4 * TB_ALIGNMENT bytes, and four classes
+// per power of two above that, which wastes at most a quarter of a buffer. Every class has a free list of the buffers
+// freed in it (linked through their first bytes), which later allocations of the class pop before calling the
+// system allocator. Buffers stay cached until TensorBase_empty_cache is called, or a system allocation fails.
+
+#define ALLOCATOR_SMALL_CLASSES 4
+#define ALLOCATOR_CLASSES_PER_POWER_OF_TWO 4
+#define ALLOCATOR_NUM_SIZE_CLASSES (ALLOCATOR_SMALL_CLASSES + 64 * ALLOCATOR_CLASSES_PER_POWER_OF_TWO)
+
+typedef struct _CachedBuffer
+{
+    struct _CachedBuffer *next;
+} CachedBuffer;
+
+static pthread_mutex_t allocator_mutex = PTHREAD_MUTEX_INITIALIZER;
+static CachedBuffer *allocator_free_lists[ALLOCATOR_NUM_SIZE_CLASSES];
+static TensorBaseMemoryStats allocator_stats;
+static pthread_once_t allocator_once = PTHREAD_ONCE_INIT;
+
+static void allocator_before_fork(void)
+{
+    // Hold the allocator across fork(), so the child never inherits it locked by a thread that no longer exists.
+    pthread_mutex_lock(&allocator_mutex);
+}
+
+static void allocator_after_fork(void)
+{
+    // Runs in the parent and in the child, on the thread that forked (which holds the lock in both).
+    pthread_mutex_unlock(&allocator_mutex);
+}
+
+static void allocator_init_once(void)
+{
+    pthread_atfork(allocator_before_fork, allocator_after_fork, allocator_after_fork);
+}
+
+static void allocator_lock(void)
+{
+    pthread_once(&allocator_once, allocator_init_once);
+    pthread_mutex_lock(&allocator_mutex);
+}
+
+static long allocator_size_class(size_t size, size_t *class_size)
+{
+    // Returns the index of the size class of `size`, and the size of the buffers in the class.
+    if (size <= ALLOCATOR_SMALL_CLASSES * TB_ALIGNMENT)
+    {
+        long index = size <= TB_ALIGNMENT ? 0 : (long)((size - 1) / TB_ALIGNMENT);
+        *class_size = (index + 1) * TB_ALIGNMENT;
+        return index;
+    }
+
+    // The classes between the powers of two 2^e < size <= 2^(e + 1) are 2^e + k * 2^e / 4 for k in [1, 4].
+    long exponent = 63 - __builtin_clzl(size - 1);
+    size_t power_of_two = (size_t)1 << exponent;
+    size_t step = power_of_two / ALLOCATOR_CLASSES_PER_POWER_OF_TWO;
+    size_t k = (size - 1 - power_of_two) / step + 1;
+    *class_size = power_of_two + k * step;
+    long smallest_exponent = 63 - __builtin_clzl(ALLOCATOR_SMALL_CLASSES * TB_ALIGNMENT);
+    return ALLOCATOR_SMALL_CLASSES + (exponent - smallest_exponent) * ALLOCATOR_CLASSES_PER_POWER_OF_TWO + (long)k - 1;
+}
+
+static void allocator_record_allocation(size_t class_size)
+{
+    // Assumes allocator_mutex is held.
+    allocator_stats.allocations++;
+    allocator_stats.allocated_bytes += class_size;
+    if (allocator_stats.allocated_bytes > allocator_stats.peak_allocated_bytes)
+    {
+        allocator_stats.peak_allocated_bytes = allocator_stats.allocated_bytes;
+    }
+}
+
+void *TensorBase_cache_malloc(size_t size)
+{
+    size_t class_size;
+    long size_class = allocator_size_class(size, &class_size);
+
+    allocator_lock();
+    CachedBuffer *buffer = allocator_free_lists[size_class];
+    if (buffer != NULL)
+    {
+        allocator_free_lists[size_class] = buffer->next;
+        allocator_stats.cached_bytes -= class_size;
+        allocator_record_allocation(class_size);
+        pthread_mutex_unlock(&allocator_mutex);
+        return buffer;
+    }
+    pthread_mutex_unlock(&allocator_mutex);
+
+    // The system allocator is called without holding the lock, so other threads can still hit the cache meanwhile.
+    buffer = (CachedBuffer *)aligned_alloc(TB_ALIGNMENT, class_size);
+    if (buffer == NULL)
+    {
+        // The cached buffers of other classes may be what the system is missing.
+        TensorBase_empty_cache();
+        buffer = (CachedBuffer *)aligned_alloc(TB_ALIGNMENT, class_size);
+        if (buffer == NULL)
+        {
+            return NULL;
+        }
+    }
+
+    allocator_lock();
+    allocator_stats.system_allocations++;
+    allocator_record_allocation(class_size);
+    pthread_mutex_unlock(&allocator_mutex);
+    return buffer;
+}
+
+void TensorBase_cache_free(void *ptr, size_t size)
+{
+    if (ptr == NULL)
+    {
+        return;
+    }
+
+    size_t class_size;
+    long size_class = allocator_size_class(size, &class_size);
+    CachedBuffer *buffer = (CachedBuffer *)ptr;
+
+    allocator_lock();
+    buffer->next = allocator_free_lists[size_class];
+    allocator_free_lists[size_class] = buffer;
+    allocator_stats.allocated_bytes -= class_size;
+    allocator_stats.cached_bytes += class_size;
+    pthread_mutex_unlock(&allocator_mutex);
+}
+
+void TensorBase_empty_cache(void)
+{
+    allocator_lock();
+    for (long size_class = 0; size_class < ALLOCATOR_NUM_SIZE_CLASSES; size_class++)
+    {
+        CachedBuffer *buffer = allocator_free_lists[size_class];
+        while (buffer != NULL)
+        {
+            CachedBuffer *next = buffer->next;
+            free(buffer);
+            allocator_stats.system_frees++;
+            buffer = next;
+        }
+        allocator_free_lists[size_class] = NULL;
+    }
+    allocator_stats.cached_bytes = 0;
+    pthread_mutex_unlock(&allocator_mutex);
+}
+
+void TensorBase_get_memory_stats(TensorBaseMemoryStats *stats)
+{
+    allocator_lock();
+    *stats = allocator_stats;
+    pthread_mutex_unlock(&allocator_mutex);
+}
+
+StatusCode TensorBase_init(TensorBase *tb, ShapeArray shape, long ndim, DType dtype)
 {
     if (ndim > MAX_RANK || ndim < 0)
     {
@@ -35,14 +192,12 @@ StatusCode TensorBase_init(TensorBase *tb, ShapeArray shape, long ndim)
 
     // Allocate (ONLY) the memory for the underlying data of the TensorBase struct.
     // If the TensorBase is singleton, the data pointer will hold the value instead of pointing to a one element array.
-    scalar *data;
+    TensorBaseStorage *storage = NULL;
+    void *data;
     if (ndim != 0)
     {
-        data = (scalar *)malloc(numel * sizeof(scalar));
-        if (data == NULL)
-        {
-            return TB_MALLOC_ERROR;
-        }
+        RETURN_IF_ERROR(TensorBaseStorage_alloc(numel, dtype, &storage));
+        data = storage->data;
     }
     else
     {
@@ -50,6 +205,8 @@ StatusCode TensorBase_init(TensorBase *tb, ShapeArray shape, long ndim)
         data = NULL;
     }
 
+    tb->storage = storage;
+    tb->dtype = dtype;
     tb->numel = numel;
     tb->ndim = ndim;
     memcpy(tb->shape, shape, MAX_RANK * sizeof(long));
@@ -66,11 +223,11 @@ void TensorBase_dealloc(TensorBase *tb)
         return;
     }
 
-    // Frees tensorbase data, except for singletons. Assumes exclusive data ownership to avoid implementing reference counting.
-    // Singletons store data directly, not on the heap (i.e., with malloc).
-    if (tb->data != NULL && !TensorBase_is_singleton(tb))
+    // Releases the tensor's reference to its storage, which frees the data once no view references it anymore.
+    // Singletons store data directly, not on the heap (i.e., with the allocator), and have no storage.
+    if (!TensorBase_is_singleton(tb))
     {
-        free(tb->data);
+        TensorBaseStorage_release(tb->storage);
     }
     // Use memset to zero out shape and strides arrays safely.
     memset(tb, 0, sizeof(TensorBase));
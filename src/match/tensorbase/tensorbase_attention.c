@@ -0,0 +1,430 @@
+#include "tensorbase.h"
+#include "tensorbase_util.c"
+
+// Memory-efficient scaled dot-product attention.
+// The operands are viewed as entries (the batch and head dimensions) of (query_length, head_dim) queries,
+// (key_length, head_dim) keys and (key_length, value_dim) values. Each query tile visits the key tiles in order and
+// folds them into its output with the online softmax recurrence, so only one (ATTENTION_BLOCK_QUERIES x
+// ATTENTION_BLOCK_KEYS) score tile per worker is ever stored, and memory is linear in the sequence length. Causal
+// attention skips the key tiles that are entirely masked. The forward pass saves the log-sum-exp of every query's
+// scores, from which the backward pass recomputes the probabilities tile by tile: once per key tile for the gradients
+// of the keys and values, and once per query tile for the gradient of the queries, so that no two workers write to
+// the same rows.
+// For incremental decoding, the keys and values are preallocated caches, and each batch entry's queries are the
+// newest positions of its sequence: query_offsets gives the position of each entry's first query, and the keys after
+// its last query (the unused part of the cache) are masked and skipped, so a step costs time linear in the length of
+// each sequence rather than in the size of the cache.
+
+// Number of queries of a tile.
+#define ATTENTION_BLOCK_QUERIES 64
+// Number of keys of a tile.
+#define ATTENTION_BLOCK_KEYS 64
+
+typedef struct
+{
+    const void *query;
+    const void *key;
+    const void *value;
+    const void *mask;       // Added to the scores, or NULL.
+    long mask_entry_stride; // 0 if every entry shares the mask.
+    const int64_t *query_offsets; // The position of the first query of every batch entry among the keys, or NULL.
+    long entries_per_offset;      // Entries (heads) per batch entry.
+    const void *grad;       // The gradient of the output (backward).
+    void *out;              // The output (the forward's output, in the backward pass).
+    void *lse;              // The log-sum-exp of every query's scores.
+    void *delta;            // rowsum(grad * out) of every query (backward).
+    void *grad_query;
+    void *grad_key;
+    void *grad_value;
+    long entries;
+    long query_length;
+    long key_length;
+    long head_dim;
+    long value_dim;
+    long query_tiles;
+    long key_tiles;
+    double scale;
+    bool causal;
+    UnaryKernel exp; // The dispatched exp kernel of the dtype.
+    StatusCode status;
+} AttentionLoop;
+
+static inline long attention_query_offset(const AttentionLoop *loop, long entry)
+{
+    return loop->query_offsets == NULL ? 0 : loop->query_offsets[entry / loop->entries_per_offset];
+}
+
+static inline long attention_key_count(const AttentionLoop *loop, long entry)
+{
+    // The number of keys the entry attends to: all of them, or those up to its last query.
+    return loop->query_offsets == NULL ? loop->key_length : attention_query_offset(loop, entry) + loop->query_length;
+}
+
+#define ATTENTION_DTYPE float64
+#define ATTENTION_SCALAR double
+#define ATTENTION_MATH_SUFFIX
+#include "tensorbase_attention_kernels.c"
+#undef ATTENTION_DTYPE
+#undef ATTENTION_SCALAR
+#undef ATTENTION_MATH_SUFFIX
+
+#define ATTENTION_DTYPE float32
+#define ATTENTION_SCALAR float
+#define ATTENTION_MATH_SUFFIX f
+#include "tensorbase_attention_kernels.c"
+#undef ATTENTION_DTYPE
+#undef ATTENTION_SCALAR
+#undef ATTENTION_MATH_SUFFIX
+
+// Indices of the operands' contiguous copies.
+enum
+{
+    ATTENTION_QUERY,
+    ATTENTION_KEY,
+    ATTENTION_VALUE,
+    ATTENTION_MASK,
+    NUM_ATTENTION_OPERANDS
+};
+
+static bool same_leading_shape(TensorBase *a, TensorBase *b)
+{
+    // Whether a and b have the same ndim and the same sizes, except in their last two dimensions.
+    if (a->ndim != b->ndim)
+    {
+        return false;
+    }
+    for (long d = 0; d < a->ndim - 2; d++)
+    {
+        if (a->shape[d] != b->shape[d])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static StatusCode attention_setup(TensorBase *query, TensorBase *key, TensorBase *value, TensorBase *mask, TensorBase *query_offsets,
+                                  bool causal, scalar scale, AttentionLoop *loop, TensorBase contiguous[NUM_ATTENTION_OPERANDS])
+{
+    // Validates the operands, and fills the loop with contiguous copies of them, which the caller deallocates.
+    if (query == NULL || key == NULL || value == NULL)
+    {
+        return TB_NULL_INPUT_ERROR;
+    }
+    if (query->dtype != TB_FLOAT32 && query->dtype != TB_FLOAT64)
+    {
+        return TB_UNSUPPORTED_DTYPE_ERROR;
+    }
+    if (key->dtype != query->dtype || value->dtype != query->dtype || (mask != NULL && mask->dtype != query->dtype))
+    {
+        return TB_UNSUPPORTED_DTYPE_ERROR;
+    }
+    if (query->ndim < 2)
+    {
+        return TB_INVALID_NDIM_ERROR;
+    }
+    long ndim = query->ndim;
+    if (!same_leading_shape(query, key) || !same_leading_shape(query, value) ||
+        key->shape[ndim - 1] != query->shape[ndim - 1] || value->shape[ndim - 2] != key->shape[ndim - 2])
+    {
+        return TB_SHAPE_MISMATCH_ERROR;
+    }
+
+    memset(loop, 0, sizeof(AttentionLoop));
+    loop->query_length = query->shape[ndim - 2];
+    loop->key_length = key->shape[ndim - 2];
+    loop->head_dim = query->shape[ndim - 1];
+    loop->value_dim = value->shape[ndim - 1];
+    loop->entries = 1;
+    for (long d = 0; d < ndim - 2; d++)
+    {
+        loop->entries *= query->shape[d];
+    }
+    loop->query_tiles = (loop->query_length + ATTENTION_BLOCK_QUERIES - 1) / ATTENTION_BLOCK_QUERIES;
+    loop->key_tiles = (loop->key_length + ATTENTION_BLOCK_KEYS - 1) / ATTENTION_BLOCK_KEYS;
+    loop->scale = scale;
+    loop->causal = causal;
+    loop->exp = TensorBase_get_unary_kernel(SCALAR_EXP, query->dtype);
+    loop->status = TB_OK;
+
+    // The mask is (query_length, key_length), shared by every entry, or has a mask for every entry.
+    if (mask != NULL)
+    {
+        if (mask->ndim < 2 || mask->shape[mask->ndim - 2] != loop->query_length || mask->shape[mask->ndim - 1] != loop->key_length ||
+            (mask->ndim != 2 && !same_leading_shape(query, mask)))
+        {
+            return TB_SHAPE_MISMATCH_ERROR;
+        }
+        loop->mask_entry_stride = mask->ndim == 2 ? 0 : loop->query_length * loop->key_length;
+    }
+
+    // The query offsets are an (N) int64 tensor for (N, ..., Sq, D) queries, and the queries of every entry must fit
+    // in the keys.
+    if (query_offsets != NULL)
+    {
+        if (query_offsets->dtype != TB_INT64)
+        {
+            return TB_UNSUPPORTED_DTYPE_ERROR;
+        }
+        if (ndim < 3 || query_offsets->ndim != 1 || query_offsets->shape[0] != query->shape[0])
+        {
+            return TB_SHAPE_MISMATCH_ERROR;
+        }
+        if (!TensorBase_is_contiguous(query_offsets))
+        {
+            return TB_NOT_IMPLEMENTED_ERROR;
+        }
+        loop->query_offsets = (const int64_t *)TensorBase_data_ptr(query_offsets);
+        loop->entries_per_offset = query->shape[0] == 0 ? 1 : loop->entries / query->shape[0];
+        for (long i = 0; i < query->shape[0]; i++)
+        {
+            if (loop->query_offsets[i] < 0 || loop->query_offsets[i] + loop->query_length > loop->key_length)
+            {
+                return TB_INDEX_OUT_OF_BOUNDS_ERROR;
+            }
+        }
+    }
+
+    TensorBase *operands[NUM_ATTENTION_OPERANDS] = {query, key, value, mask};
+    memset(contiguous, 0, NUM_ATTENTION_OPERANDS * sizeof(TensorBase));
+    for (int i = 0; i < NUM_ATTENTION_OPERANDS; i++)
+    {
+        if (operands[i] == NULL)
+        {
+            continue;
+        }
+        StatusCode status = TensorBase_contiguous(operands[i], &contiguous[i]);
+        if (status != TB_OK)
+        {
+            for (int j = 0; j < i; j++)
+            {
+                TensorBase_dealloc(&contiguous[j]);
+            }
+            return status;
+        }
+    }
+    loop->query = TensorBase_data_ptr(&contiguous[ATTENTION_QUERY]);
+    loop->key = TensorBase_data_ptr(&contiguous[ATTENTION_KEY]);
+    loop->value = TensorBase_data_ptr(&contiguous[ATTENTION_VALUE]);
+    loop->mask = mask == NULL ? NULL : TensorBase_data_ptr(&contiguous[ATTENTION_MASK]);
+    return TB_OK;
+}
+
+static void attention_teardown(TensorBase contiguous[NUM_ATTENTION_OPERANDS])
+{
+    // Zeroed entries (absent operands) are safe to deallocate.
+    for (int i = 0; i < NUM_ATTENTION_OPERANDS; i++)
+    {
+        TensorBase_dealloc(&contiguous[i]);
+    }
+}
+
+static void run_attention(AttentionLoop *loop, long count, long elements_per_item, DType dtype,
+                          ParallelForBody float32_body, ParallelForBody float64_body)
+{
+    TensorBase_parallel_for(count, max_long(1, PARALLEL_GRAIN_ELEMENTS / max_long(elements_per_item, 1)),
+                            dtype == TB_FLOAT32 ? float32_body : float64_body, loop);
+}
+
+static void attention_output_shape(TensorBase *query, long last, ShapeArray shape, long *ndim)
+{
+    // The shape of the queries, with the last dimension replaced by `last`, or removed if `last` is negative.
+    for (long d = 0; d < MAX_RANK; d++)
+    {
+        shape[d] = d < query->ndim - 1 ? query->shape[d] : -1;
+    }
+    shape[query->ndim - 1] = last;
+    *ndim = last < 0 ? query->ndim - 1 : query->ndim;
+}
+
+StatusCode TensorBase_scaled_dot_product_attention(TensorBase *query, TensorBase *key, TensorBase *value, TensorBase *mask,
+                                                   TensorBase *query_offsets, bool causal, scalar scale, TensorBase *out, TensorBase *lse)
+{
+    if (out == NULL || lse == NULL)
+    {
+        return TB_NULL_INPUT_ERROR;
+    }
+
+    AttentionLoop loop;
+    TensorBase contiguous[NUM_ATTENTION_OPERANDS];
+    RETURN_IF_ERROR(attention_setup(query, key, value, mask, query_offsets, causal, scale, &loop, contiguous));
+
+    ShapeArray out_shape, lse_shape;
+    long out_ndim, lse_ndim;
+    attention_output_shape(query, loop.value_dim, out_shape, &out_ndim);
+    attention_output_shape(query, -1, lse_shape, &lse_ndim);
+    StatusCode status = TensorBase_init(out, out_shape, out_ndim, query->dtype);
+    if (status == TB_OK)
+    {
+        status = TensorBase_init(lse, lse_shape, lse_ndim, query->dtype);
+        if (status != TB_OK)
+        {
+            TensorBase_dealloc(out);
+        }
+    }
+
+    if (status == TB_OK)
+    {
+        loop.out = TensorBase_data_ptr(out);
+        loop.lse = TensorBase_data_ptr(lse);
+        run_attention(&loop, loop.entries * loop.query_tiles,
+                      ATTENTION_BLOCK_QUERIES * loop.key_length * (loop.head_dim + loop.value_dim), query->dtype,
+                      attention_forward_float32, attention_forward_float64);
+        status = loop.status;
+        if (status != TB_OK)
+        {
+            TensorBase_dealloc(out);
+            TensorBase_dealloc(lse);
+        }
+    }
+
+    attention_teardown(contiguous);
+    return status;
+}
+
+StatusCode TensorBase_scaled_dot_product_attention_backward(TensorBase *query, TensorBase *key, TensorBase *value, TensorBase *mask,
+                                                            TensorBase *query_offsets, bool causal, scalar scale, TensorBase *out, TensorBase *lse, TensorBase *grad,
+                                                            TensorBase *grad_query, TensorBase *grad_key, TensorBase *grad_value)
+{
+    if (out == NULL || lse == NULL || grad == NULL || grad_query == NULL || grad_key == NULL || grad_value == NULL)
+    {
+        return TB_NULL_INPUT_ERROR;
+    }
+
+    AttentionLoop loop;
+    TensorBase contiguous[NUM_ATTENTION_OPERANDS];
+    RETURN_IF_ERROR(attention_setup(query, key, value, mask, query_offsets, causal, scale, &loop, contiguous));
+
+    // The forward's output and the gradient are (..., query_length, value_dim), and lse is (..., query_length).
+    ShapeArray out_shape;
+    long out_ndim;
+    attention_output_shape(query, loop.value_dim, out_shape, &out_ndim);
+    StatusCode status = TB_OK;
+    if (out->dtype != query->dtype || lse->dtype != query->dtype || grad->dtype != query->dtype)
+    {
+        status = TB_UNSUPPORTED_DTYPE_ERROR;
+    }
+    else if (out->ndim != out_ndim || !TensorBase_same_shape(out->shape, out_shape) ||
+             grad->ndim != out_ndim || !TensorBase_same_shape(grad->shape, out_shape) ||
+             lse->numel != loop.entries * loop.query_length)
+    {
+        status = TB_SHAPE_MISMATCH_ERROR;
+    }
+
+    TensorBase contiguous_out = {0}, contiguous_lse = {0}, contiguous_grad = {0};
+    if (status == TB_OK)
+    {
+        status = TensorBase_contiguous(out, &contiguous_out);
+    }
+    if (status == TB_OK)
+    {
+        status = TensorBase_contiguous(lse, &contiguous_lse);
+    }
+    if (status == TB_OK)
+    {
+        status = TensorBase_contiguous(grad, &contiguous_grad);
+    }
+
+    size_t delta_size = max_long(loop.entries * loop.query_length, 1) * (query->dtype == TB_FLOAT32 ? sizeof(float) : sizeof(double));
+    loop.delta = status == TB_OK ? TensorBase_cache_malloc(delta_size) : NULL;
+    if (status == TB_OK && loop.delta == NULL)
+    {
+        status = TB_MALLOC_ERROR;
+    }
+
+    TensorBase *grads[3] = {grad_query, grad_key, grad_value};
+    TensorBase *like[3] = {&contiguous[ATTENTION_QUERY], &contiguous[ATTENTION_KEY], &contiguous[ATTENTION_VALUE]};
+    int created = 0;
+    for (; status == TB_OK && created < 3; created++)
+    {
+        status = TensorBase_create_empty_like(like[created], grads[created]);
+        if (status != TB_OK)
+        {
+            break;
+        }
+    }
+
+    if (status == TB_OK)
+    {
+        loop.out = TensorBase_data_ptr(&contiguous_out);
+        loop.lse = TensorBase_data_ptr(&contiguous_lse);
+        loop.grad = TensorBase_data_ptr(&contiguous_grad);
+        loop.grad_query = TensorBase_data_ptr(grad_query);
+        loop.grad_key = TensorBase_data_ptr(grad_key);
+        loop.grad_value = TensorBase_data_ptr(grad_value);
+        run_attention(&loop, loop.entries * loop.query_length, loop.value_dim, query->dtype,
+                      attention_delta_float32, attention_delta_float64);
+        long tile_work = (loop.head_dim + loop.value_dim) * ATTENTION_BLOCK_QUERIES;
+        run_attention(&loop, loop.entries * loop.key_tiles, tile_work * loop.query_length, query->dtype,
+                      attention_backward_keys_float32, attention_backward_keys_float64);
+        run_attention(&loop, loop.entries * loop.query_tiles, tile_work * loop.key_length, query->dtype,
+                      attention_backward_queries_float32, attention_backward_queries_float64);
+        status = loop.status;
+    }
+    if (status != TB_OK)
+    {
+        for (int i = 0; i < created; i++)
+        {
+            TensorBase_dealloc(grads[i]);
+        }
+    }
+
+    if (loop.delta != NULL)
+    {
+        TensorBase_cache_free(loop.delta, delta_size);
+    }
+    TensorBase_dealloc(&contiguous_out);
+    TensorBase_dealloc(&contiguous_lse);
+    TensorBase_dealloc(&contiguous_grad);
+    attention_teardown(contiguous);
+    return status;
+}
+
+StatusCode TensorBase_kv_cache_write(TensorBase *cache, TensorBase *in, TensorBase *positions)
+{
+    if (cache == NULL || in == NULL || positions == NULL)
+    {
+        return TB_NULL_INPUT_ERROR;
+    }
+    if (in->dtype != cache->dtype || positions->dtype != TB_INT64)
+    {
+        return TB_UNSUPPORTED_DTYPE_ERROR;
+    }
+    long ndim = cache->ndim;
+    if (ndim < 3 || !same_leading_shape(cache, in) || in->shape[ndim - 1] != cache->shape[ndim - 1] ||
+        positions->ndim != 1 || positions->shape[0] != cache->shape[0])
+    {
+        return TB_SHAPE_MISMATCH_ERROR;
+    }
+    if (!TensorBase_is_contiguous(cache) || !TensorBase_is_contiguous(positions))
+    {
+        return TB_NOT_IMPLEMENTED_ERROR;
+    }
+
+    long capacity = cache->shape[ndim - 2], length = in->shape[ndim - 2], width = in->shape[ndim - 1];
+    const int64_t *offsets = (const int64_t *)TensorBase_data_ptr(positions);
+    for (long i = 0; i < cache->shape[0]; i++)
+    {
+        if (offsets[i] < 0 || offsets[i] + length > capacity)
+        {
+            return TB_INDEX_OUT_OF_BOUNDS_ERROR;
+        }
+    }
+
+    // Every (batch, ...) entry's rows are one contiguous block of the cache, starting at the entry's position.
+    TensorBase contiguous_in;
+    RETURN_IF_ERROR(TensorBase_contiguous(in, &contiguous_in));
+    long entries = cache->numel / max_long(capacity * width, 1);
+    long entries_per_position = cache->shape[0] == 0 ? 1 : entries / cache->shape[0];
+    size_t element_size = TensorBase_element_size(cache->dtype);
+    char *dst = (char *)TensorBase_data_ptr(cache);
+    const char *src = (const char *)TensorBase_data_ptr(&contiguous_in);
+    for (long entry = 0; entry < entries && capacity * width > 0; entry++)
+    {
+        long position = offsets[entry / entries_per_position];
+        memcpy(dst + (entry * capacity + position) * width * element_size, src + entry * length * width * element_size,
+               length * width * element_size);
+    }
+    TensorBase_dealloc(&contiguous_in);
+    return TB_OK;
+}
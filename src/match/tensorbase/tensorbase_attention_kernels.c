@@ -0,0 +1,418 @@
+// Scaled dot-product attention kernel template.
+// This file is included once per dtype by tensorbase_attention.c, with the following macros defined:
+// * ATTENTION_DTYPE: A suffix that makes the names of the generated kernels unique (e.g., float32).
+// * ATTENTION_SCALAR: The C type of the elements (e.g., float).
+// * ATTENTION_MATH_SUFFIX: The suffix of the libm functions for ATTENTION_SCALAR (f for float, empty for double).
+// The kernels work on tiles of up to ATTENTION_BLOCK_QUERIES queries and ATTENTION_BLOCK_KEYS keys of one (batch,
+// head) entry. Every product of two tiles is written as a sequence of row updates (out_row += a * in_row), so the
+// inner loops are contiguous and branch free, and the compiler vectorizes them. Exponentials are computed by the
+// dispatched (vectorized) exp kernel.
+
+#define ATTENTION_NAME_(name, dtype) name##_##dtype
+#define ATTENTION_NAME(name, dtype) ATTENTION_NAME_(name, dtype)
+#define ATTENTION(name) ATTENTION_NAME(name, ATTENTION_DTYPE)
+#define ATTENTION_MATH_(function, suffix) function##suffix
+#define ATTENTION_MATH(function, suffix) ATTENTION_MATH_(function, suffix)
+#define ATTENTION_LIBM(function) ATTENTION_MATH(function, ATTENTION_MATH_SUFFIX)
+
+// The scratch space of a worker: a score tile, the transposed key and value tiles, and the accumulators.
+typedef struct
+{
+    ATTENTION_SCALAR *scores;      // ATTENTION_BLOCK_QUERIES x ATTENTION_BLOCK_KEYS: the scores, then the probabilities.
+    ATTENTION_SCALAR *grad_scores; // ATTENTION_BLOCK_QUERIES x ATTENTION_BLOCK_KEYS (backward).
+    ATTENTION_SCALAR *key_t;       // head_dim x ATTENTION_BLOCK_KEYS.
+    ATTENTION_SCALAR *value_t;     // value_dim x ATTENTION_BLOCK_KEYS (backward).
+    ATTENTION_SCALAR *acc;         // The output (forward) or the gradients of the tile's rows (backward).
+    ATTENTION_SCALAR *acc2;        // The gradient of the value tile (backward).
+    ATTENTION_SCALAR *row_max;     // ATTENTION_BLOCK_QUERIES running maxima (forward).
+    ATTENTION_SCALAR *row_sum;     // ATTENTION_BLOCK_QUERIES running sums of exponentials (forward).
+    size_t size;
+    void *memory;
+} ATTENTION(AttentionScratch);
+
+static bool ATTENTION(scratch_alloc)(const AttentionLoop *loop, ATTENTION(AttentionScratch) *scratch)
+{
+    long tile = ATTENTION_BLOCK_QUERIES * ATTENTION_BLOCK_KEYS;
+    long rows = max_long(ATTENTION_BLOCK_QUERIES, ATTENTION_BLOCK_KEYS);
+    long width = max_long(loop->head_dim, loop->value_dim);
+    long counts[8] = {tile, tile, loop->head_dim * ATTENTION_BLOCK_KEYS, loop->value_dim * ATTENTION_BLOCK_KEYS,
+                      rows * width, rows * width, ATTENTION_BLOCK_QUERIES, ATTENTION_BLOCK_QUERIES};
+    long total = 0;
+    for (int i = 0; i < 8; i++)
+    {
+        total += counts[i];
+    }
+    scratch->size = max_long(total, 1) * sizeof(ATTENTION_SCALAR);
+    scratch->memory = TensorBase_cache_malloc(scratch->size);
+    if (scratch->memory == NULL)
+    {
+        return false;
+    }
+    ATTENTION_SCALAR **arrays[8] = {&scratch->scores, &scratch->grad_scores, &scratch->key_t, &scratch->value_t,
+                                    &scratch->acc, &scratch->acc2, &scratch->row_max, &scratch->row_sum};
+    ATTENTION_SCALAR *next = (ATTENTION_SCALAR *)scratch->memory;
+    for (int i = 0; i < 8; i++)
+    {
+        *arrays[i] = next;
+        next += counts[i];
+    }
+    return true;
+}
+
+static inline void ATTENTION(axpy)(ATTENTION_SCALAR a, const ATTENTION_SCALAR *restrict x, ATTENTION_SCALAR *restrict y, long n)
+{
+    for (long i = 0; i < n; i++)
+    {
+        y[i] += a * x[i];
+    }
+}
+
+static void ATTENTION(transpose_tile)(const ATTENTION_SCALAR *rows, long count, long width, ATTENTION_SCALAR *out)
+{
+    // out (width x ATTENTION_BLOCK_KEYS) = the transpose of `count` rows of `width` elements.
+    for (long j = 0; j < count; j++)
+    {
+        for (long d = 0; d < width; d++)
+        {
+            out[d * ATTENTION_BLOCK_KEYS + j] = rows[j * width + d];
+        }
+    }
+}
+
+static void ATTENTION(tile_scores)(const AttentionLoop *loop, long entry, long q0, long nq, long k0, long nk,
+                                   ATTENTION(AttentionScratch) *scratch)
+{
+    // scores = query tile @ key tile^T * scale + mask, with the keys after each query set to -inf if causal, and the
+    // keys past the entry's key count set to -inf. The key tile must already be transposed into scratch->key_t.
+    long head_dim = loop->head_dim;
+    long offset = attention_query_offset(loop, entry);
+    long key_count = attention_key_count(loop, entry);
+    const ATTENTION_SCALAR *query = (const ATTENTION_SCALAR *)loop->query + (entry * loop->query_length + q0) * head_dim;
+    const ATTENTION_SCALAR *mask = loop->mask == NULL ? NULL : (const ATTENTION_SCALAR *)loop->mask + entry * loop->mask_entry_stride;
+    ATTENTION_SCALAR scale = (ATTENTION_SCALAR)loop->scale;
+    for (long i = 0; i < nq; i++)
+    {
+        ATTENTION_SCALAR *s = scratch->scores + i * ATTENTION_BLOCK_KEYS;
+        memset(s, 0, nk * sizeof(ATTENTION_SCALAR));
+        for (long d = 0; d < head_dim; d++)
+        {
+            ATTENTION(axpy)(query[i * head_dim + d], scratch->key_t + d * ATTENTION_BLOCK_KEYS, s, nk);
+        }
+        for (long j = 0; j < nk; j++)
+        {
+            s[j] *= scale;
+        }
+        if (mask != NULL)
+        {
+            const ATTENTION_SCALAR *m = mask + (q0 + i) * loop->key_length + k0;
+            for (long j = 0; j < nk; j++)
+            {
+                s[j] += m[j];
+            }
+        }
+        if (loop->causal)
+        {
+            // Query q attends to keys k <= q + offset.
+            for (long j = max_long(0, q0 + i + offset - k0 + 1); j < nk; j++)
+            {
+                s[j] = -INFINITY;
+            }
+        }
+        for (long j = max_long(0, key_count - k0); j < nk; j++)
+        {
+            s[j] = -INFINITY;
+        }
+    }
+}
+
+static long ATTENTION(key_tile_end)(const AttentionLoop *loop, long entry, long q0, long nq)
+{
+    // The number of key tiles a query tile attends to: the tiles past the entry's key count, and for causal attention
+    // the tiles after its last query, are skipped.
+    long keys = attention_key_count(loop, entry);
+    if (loop->causal)
+    {
+        keys = min_long(keys, q0 + nq + attention_query_offset(loop, entry));
+    }
+    return (keys + ATTENTION_BLOCK_KEYS - 1) / ATTENTION_BLOCK_KEYS;
+}
+
+static void ATTENTION(tile_probabilities)(const AttentionLoop *loop, long entry, long q0, long nq, long nk,
+                                          ATTENTION(AttentionScratch) *scratch)
+{
+    // Turns the scores into the probabilities exp(score - lse) of the forward pass, from the saved log-sum-exps.
+    const ATTENTION_SCALAR *lse = (const ATTENTION_SCALAR *)loop->lse + entry * loop->query_length + q0;
+    for (long i = 0; i < nq; i++)
+    {
+        ATTENTION_SCALAR *p = scratch->scores + i * ATTENTION_BLOCK_KEYS;
+        if (lse[i] == -INFINITY)
+        {
+            // A row whose keys are all masked out has no output, and no gradient.
+            memset(p, 0, nk * sizeof(ATTENTION_SCALAR));
+            continue;
+        }
+        for (long j = 0; j < nk; j++)
+        {
+            p[j] -= lse[i];
+        }
+        loop->exp(p, p, nk);
+    }
+}
+
+static void ATTENTION(tile_grad_scores)(const AttentionLoop *loop, long entry, long q0, long nq, long nk,
+                                        ATTENTION(AttentionScratch) *scratch)
+{
+    // grad_scores = P * (grad @ value tile^T - delta), the gradient of the scores (the softmax's input). The value tile must
+    // already be transposed into scratch->value_t.
+    long value_dim = loop->value_dim;
+    const ATTENTION_SCALAR *grad = (const ATTENTION_SCALAR *)loop->grad + (entry * loop->query_length + q0) * value_dim;
+    const ATTENTION_SCALAR *delta = (const ATTENTION_SCALAR *)loop->delta + entry * loop->query_length + q0;
+    for (long i = 0; i < nq; i++)
+    {
+        ATTENTION_SCALAR *ds = scratch->grad_scores + i * ATTENTION_BLOCK_KEYS;
+        const ATTENTION_SCALAR *p = scratch->scores + i * ATTENTION_BLOCK_KEYS;
+        memset(ds, 0, nk * sizeof(ATTENTION_SCALAR));
+        for (long e = 0; e < value_dim; e++)
+        {
+            ATTENTION(axpy)(grad[i * value_dim + e], scratch->value_t + e * ATTENTION_BLOCK_KEYS, ds, nk);
+        }
+        for (long j = 0; j < nk; j++)
+        {
+            ds[j] = p[j] * (ds[j] - delta[i]);
+        }
+    }
+}
+
+static void ATTENTION(attention_forward)(void *context, long begin, long end)
+{
+    // One query tile of one entry per item. The key tiles are visited in order with the online softmax recurrence:
+    // every row keeps its running max m and sum l of exp(score - m), and its output accumulator is rescaled by
+    // exp(m_old - m_new) whenever m grows, so the full score matrix is never stored.
+    AttentionLoop *loop = (AttentionLoop *)context;
+    ATTENTION(AttentionScratch) scratch;
+    if (!ATTENTION(scratch_alloc)(loop, &scratch))
+    {
+        __atomic_store_n(&loop->status, TB_MALLOC_ERROR, __ATOMIC_RELAXED);
+        return;
+    }
+    long head_dim = loop->head_dim, value_dim = loop->value_dim;
+    for (long item = begin; item < end; item++)
+    {
+        long entry = item / loop->query_tiles;
+        long q0 = (item % loop->query_tiles) * ATTENTION_BLOCK_QUERIES;
+        long nq = min_long(ATTENTION_BLOCK_QUERIES, loop->query_length - q0);
+        for (long i = 0; i < nq; i++)
+        {
+            scratch.row_max[i] = -INFINITY;
+            scratch.row_sum[i] = 0;
+        }
+        memset(scratch.acc, 0, nq * value_dim * sizeof(ATTENTION_SCALAR));
+
+        long tiles = ATTENTION(key_tile_end)(loop, entry, q0, nq);
+        for (long tile = 0; tile < tiles; tile++)
+        {
+            long k0 = tile * ATTENTION_BLOCK_KEYS;
+            long nk = min_long(ATTENTION_BLOCK_KEYS, loop->key_length - k0);
+            const ATTENTION_SCALAR *key = (const ATTENTION_SCALAR *)loop->key + (entry * loop->key_length + k0) * head_dim;
+            const ATTENTION_SCALAR *value = (const ATTENTION_SCALAR *)loop->value + (entry * loop->key_length + k0) * value_dim;
+            ATTENTION(transpose_tile)(key, nk, head_dim, scratch.key_t);
+            ATTENTION(tile_scores)(loop, entry, q0, nq, k0, nk, &scratch);
+
+            for (long i = 0; i < nq; i++)
+            {
+                ATTENTION_SCALAR *s = scratch.scores + i * ATTENTION_BLOCK_KEYS;
+                ATTENTION_SCALAR tile_max = -INFINITY;
+                for (long j = 0; j < nk; j++)
+                {
+                    tile_max = ATTENTION_LIBM(fmax)(tile_max, s[j]);
+                }
+                ATTENTION_SCALAR max = ATTENTION_LIBM(fmax)(scratch.row_max[i], tile_max);
+                if (max == -INFINITY)
+                {
+                    // Every key so far is masked out.
+                    continue;
+                }
+                for (long j = 0; j < nk; j++)
+                {
+                    s[j] -= max;
+                }
+                loop->exp(s, s, nk);
+                ATTENTION_SCALAR sum = 0;
+                for (long j = 0; j < nk; j++)
+                {
+                    sum += s[j];
+                }
+
+                ATTENTION_SCALAR *acc = scratch.acc + i * value_dim;
+                if (max > scratch.row_max[i])
+                {
+                    ATTENTION_SCALAR rescale = ATTENTION_LIBM(exp)(scratch.row_max[i] - max);
+                    scratch.row_sum[i] *= rescale;
+                    for (long e = 0; e < value_dim; e++)
+                    {
+                        acc[e] *= rescale;
+                    }
+                    scratch.row_max[i] = max;
+                }
+                scratch.row_sum[i] += sum;
+                for (long j = 0; j < nk; j++)
+                {
+                    ATTENTION(axpy)(s[j], value + j * value_dim, acc, value_dim);
+                }
+            }
+        }
+
+        ATTENTION_SCALAR *out = (ATTENTION_SCALAR *)loop->out + (entry * loop->query_length + q0) * value_dim;
+        ATTENTION_SCALAR *lse = (ATTENTION_SCALAR *)loop->lse + entry * loop->query_length + q0;
+        for (long i = 0; i < nq; i++)
+        {
+            bool masked = scratch.row_max[i] == -INFINITY;
+            ATTENTION_SCALAR inverse = masked ? 0 : 1 / scratch.row_sum[i];
+            for (long e = 0; e < value_dim; e++)
+            {
+                out[i * value_dim + e] = scratch.acc[i * value_dim + e] * inverse;
+            }
+            lse[i] = masked ? -INFINITY : scratch.row_max[i] + ATTENTION_LIBM(log)(scratch.row_sum[i]);
+        }
+    }
+    TensorBase_cache_free(scratch.memory, scratch.size);
+}
+
+static void ATTENTION(attention_delta)(void *context, long begin, long end)
+{
+    // delta = rowsum(grad * out) of every query, the correction term of the softmax gradient.
+    const AttentionLoop *loop = (const AttentionLoop *)context;
+    long value_dim = loop->value_dim;
+    for (long row = begin; row < end; row++)
+    {
+        const ATTENTION_SCALAR *grad = (const ATTENTION_SCALAR *)loop->grad + row * value_dim;
+        const ATTENTION_SCALAR *out = (const ATTENTION_SCALAR *)loop->out + row * value_dim;
+        ATTENTION_SCALAR sum = 0;
+        for (long e = 0; e < value_dim; e++)
+        {
+            sum += grad[e] * out[e];
+        }
+        ((ATTENTION_SCALAR *)loop->delta)[row] = sum;
+    }
+}
+
+static void ATTENTION(attention_backward_keys)(void *context, long begin, long end)
+{
+    // One key tile of one entry per item: the gradients of the key and value tiles, accumulated over the query tiles
+    // that attend to it, with the probabilities recomputed from the scores and the saved log-sum-exps.
+    AttentionLoop *loop = (AttentionLoop *)context;
+    ATTENTION(AttentionScratch) scratch;
+    if (!ATTENTION(scratch_alloc)(loop, &scratch))
+    {
+        __atomic_store_n(&loop->status, TB_MALLOC_ERROR, __ATOMIC_RELAXED);
+        return;
+    }
+    long head_dim = loop->head_dim, value_dim = loop->value_dim;
+    for (long item = begin; item < end; item++)
+    {
+        long entry = item / loop->key_tiles;
+        long k0 = (item % loop->key_tiles) * ATTENTION_BLOCK_KEYS;
+        long nk = min_long(ATTENTION_BLOCK_KEYS, loop->key_length - k0);
+        const ATTENTION_SCALAR *key = (const ATTENTION_SCALAR *)loop->key + (entry * loop->key_length + k0) * head_dim;
+        const ATTENTION_SCALAR *value = (const ATTENTION_SCALAR *)loop->value + (entry * loop->key_length + k0) * value_dim;
+        ATTENTION(transpose_tile)(key, nk, head_dim, scratch.key_t);
+        ATTENTION(transpose_tile)(value, nk, value_dim, scratch.value_t);
+        ATTENTION_SCALAR *grad_key = scratch.acc, *grad_value = scratch.acc2;
+        memset(grad_key, 0, nk * head_dim * sizeof(ATTENTION_SCALAR));
+        memset(grad_value, 0, nk * value_dim * sizeof(ATTENTION_SCALAR));
+
+        // Key tiles past the entry's key count get no gradient, and causal attention skips the query tiles before the
+        // key tile's first key.
+        long first_tile = loop->causal ? max_long(0, k0 - attention_query_offset(loop, entry)) / ATTENTION_BLOCK_QUERIES : 0;
+        long last_tile = k0 < attention_key_count(loop, entry) ? loop->query_tiles : 0;
+        for (long tile = first_tile; tile < last_tile; tile++)
+        {
+            long q0 = tile * ATTENTION_BLOCK_QUERIES;
+            long nq = min_long(ATTENTION_BLOCK_QUERIES, loop->query_length - q0);
+            const ATTENTION_SCALAR *query = (const ATTENTION_SCALAR *)loop->query + (entry * loop->query_length + q0) * head_dim;
+            const ATTENTION_SCALAR *grad = (const ATTENTION_SCALAR *)loop->grad + (entry * loop->query_length + q0) * value_dim;
+            ATTENTION(tile_scores)(loop, entry, q0, nq, k0, nk, &scratch);
+            ATTENTION(tile_probabilities)(loop, entry, q0, nq, nk, &scratch);
+            ATTENTION(tile_grad_scores)(loop, entry, q0, nq, nk, &scratch);
+            for (long i = 0; i < nq; i++)
+            {
+                const ATTENTION_SCALAR *p = scratch.scores + i * ATTENTION_BLOCK_KEYS;
+                const ATTENTION_SCALAR *ds = scratch.grad_scores + i * ATTENTION_BLOCK_KEYS;
+                for (long j = 0; j < nk; j++)
+                {
+                    ATTENTION(axpy)(p[j], grad + i * value_dim, grad_value + j * value_dim, value_dim);
+                    ATTENTION(axpy)(ds[j], query + i * head_dim, grad_key + j * head_dim, head_dim);
+                }
+            }
+        }
+
+        ATTENTION_SCALAR scale = (ATTENTION_SCALAR)loop->scale;
+        ATTENTION_SCALAR *out_key = (ATTENTION_SCALAR *)loop->grad_key + (entry * loop->key_length + k0) * head_dim;
+        ATTENTION_SCALAR *out_value = (ATTENTION_SCALAR *)loop->grad_value + (entry * loop->key_length + k0) * value_dim;
+        for (long i = 0; i < nk * head_dim; i++)
+        {
+            out_key[i] = grad_key[i] * scale;
+        }
+        memcpy(out_value, grad_value, nk * value_dim * sizeof(ATTENTION_SCALAR));
+    }
+    TensorBase_cache_free(scratch.memory, scratch.size);
+}
+
+static void ATTENTION(attention_backward_queries)(void *context, long begin, long end)
+{
+    // One query tile of one entry per item: the gradient of the query tile, accumulated over the key tiles it
+    // attends to. Keeping it separate from the key pass means no two items write to the same rows.
+    AttentionLoop *loop = (AttentionLoop *)context;
+    ATTENTION(AttentionScratch) scratch;
+    if (!ATTENTION(scratch_alloc)(loop, &scratch))
+    {
+        __atomic_store_n(&loop->status, TB_MALLOC_ERROR, __ATOMIC_RELAXED);
+        return;
+    }
+    long head_dim = loop->head_dim, value_dim = loop->value_dim;
+    for (long item = begin; item < end; item++)
+    {
+        long entry = item / loop->query_tiles;
+        long q0 = (item % loop->query_tiles) * ATTENTION_BLOCK_QUERIES;
+        long nq = min_long(ATTENTION_BLOCK_QUERIES, loop->query_length - q0);
+        ATTENTION_SCALAR *grad_query = scratch.acc;
+        memset(grad_query, 0, nq * head_dim * sizeof(ATTENTION_SCALAR));
+
+        long tiles = ATTENTION(key_tile_end)(loop, entry, q0, nq);
+        for (long tile = 0; tile < tiles; tile++)
+        {
+            long k0 = tile * ATTENTION_BLOCK_KEYS;
+            long nk = min_long(ATTENTION_BLOCK_KEYS, loop->key_length - k0);
+            const ATTENTION_SCALAR *key = (const ATTENTION_SCALAR *)loop->key + (entry * loop->key_length + k0) * head_dim;
+            const ATTENTION_SCALAR *value = (const ATTENTION_SCALAR *)loop->value + (entry * loop->key_length + k0) * value_dim;
+            ATTENTION(transpose_tile)(key, nk, head_dim, scratch.key_t);
+            ATTENTION(transpose_tile)(value, nk, value_dim, scratch.value_t);
+            ATTENTION(tile_scores)(loop, entry, q0, nq, k0, nk, &scratch);
+            ATTENTION(tile_probabilities)(loop, entry, q0, nq, nk, &scratch);
+            ATTENTION(tile_grad_scores)(loop, entry, q0, nq, nk, &scratch);
+            for (long i = 0; i < nq; i++)
+            {
+                const ATTENTION_SCALAR *ds = scratch.grad_scores + i * ATTENTION_BLOCK_KEYS;
+                for (long j = 0; j < nk; j++)
+                {
+                    ATTENTION(axpy)(ds[j], key + j * head_dim, grad_query + i * head_dim, head_dim);
+                }
+            }
+        }
+
+        ATTENTION_SCALAR scale = (ATTENTION_SCALAR)loop->scale;
+        ATTENTION_SCALAR *out = (ATTENTION_SCALAR *)loop->grad_query + (entry * loop->query_length + q0) * head_dim;
+        for (long i = 0; i < nq * head_dim; i++)
+        {
+            out[i] = grad_query[i] * scale;
+        }
+    }
+    TensorBase_cache_free(scratch.memory, scratch.size);
+}
+
+#undef ATTENTION_NAME_
+#undef ATTENTION_NAME
+#undef ATTENTION
+#undef ATTENTION_MATH_
+#undef ATTENTION_MATH
+#undef ATTENTION_LIBM
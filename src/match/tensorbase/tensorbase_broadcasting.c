@@ -8,12 +8,7 @@ StatusCode TensorBase_broadcast_to(TensorBase *in, ShapeArray target_shape, long
 
 StatusCode TensorBase_unbroadcast(TensorBase *in, ShapeArray target_shape, long target_ndim, TensorBase *out)
 {
-    RETURN_IF_ERROR(TensorBase_create_empty_like(in, out));
-
-    if (!TensorBase_is_singleton(in))
-    {
-        memcpy(out->data, in->data, sizeof(scalar) * out->numel);
-    }
+    RETURN_IF_ERROR(TensorBase_deepcopy(in, out));
 
     if (!TensorBase_same_shape(in->shape, target_shape))
     {
@@ -32,6 +27,8 @@ StatusCode TensorBase_unbroadcast(TensorBase *in, ShapeArray target_shape, long
                 summation_dimensions[dim] = -1;
             }
 
+            // The aggregation initializes 'out' again, so release the copy made above first.
+            TensorBase_dealloc(out);
             RETURN_IF_ERROR(TensorBase_aggregate(in, summation_dimensions, 0, out, SCALAR_AGG_SUM));
         }
 
@@ -0,0 +1,942 @@
+#include "tensorbase.h"
+#include "tensorbase_util.c"
+#include <pthread.h>
+#include <time.h>
+
+// im2col lowers a 2D convolution to a matrix product. Every position of the kernel window over the image becomes a
+// column of a (C * kh * kw, L) matrix, so multiplying the (out_channels, C * kh * kw) kernels by it (with the GEMM
+// engine) computes every output channel at every position. Each row of the columns is a strided copy of one channel,
+// which im2col writes in a single pass. col2im scatters (sums) the columns back into the image, which is the
+// gradient of im2col.
+// TensorBase_conv2d also implements two algorithms that need fewer multiplications than the matrix product:
+// * Winograd F(m x m, 3 x 3) computes every m x m output tile of a 3x3 convolution from an (m + 2) x (m + 2) input
+//   tile as A^T [(G g G^T) . (B^T d B)] A. Summed over the channels, the elementwise products become (m + 2)^2
+//   independent GEMMs of (out_channels x C) transformed kernels by (C x tiles) transformed inputs.
+// * FFT convolution multiplies the 2D spectra of the zero padded images and kernels, so its cost grows with the
+//   image size but not with the kernel size. It is the cheapest algorithm for large kernels.
+
+typedef struct
+{
+    const TensorBaseConv2dWindow *window;
+    void *image;   // (N, C, height, width) image, read by im2col and written (contiguous) by col2im.
+    void *columns; // (N, C * kh * kw, L) columns, written (contiguous) by im2col and read by col2im.
+    long channels;
+    long height;
+    long width;
+    long out_height; // Number of window positions along the height.
+    long out_width;  // Number of window positions along the width.
+    long image_strides[4];  // Batch, channel, row and column strides of the image read by im2col, in elements.
+    long column_strides[3]; // Batch, row and position strides of the columns read by col2im, in elements.
+} ConvolutionLoop;
+
+static inline void window_valid_range(long offset, long stride, long size, long count, long *begin, long *end)
+{
+    // The positions p in [0, count) whose element p * stride + offset lies inside [0, size) form the range [begin, end).
+    *begin = offset >= 0 ? 0 : (-offset + stride - 1) / stride;
+    *end = offset >= size ? 0 : (size - offset + stride - 1) / stride;
+    *end = min_long(*end, count);
+    *begin = min_long(*begin, *end);
+}
+
+typedef struct
+{
+    const void *bias;
+    long bias_stride;
+    void *out;
+    long out_channels;
+    long plane_size;
+} BiasLoop;
+
+#define WINOGRAD_MAX_ALPHA 6
+
+// Transform matrices of Winograd F(m x m, 3 x 3), whose input tiles are alpha = m + 2 elements wide. The
+// interpolation points are 0, 1 and -1 for m = 2, and 0, 1, -1, 2 and -2 for m = 4 (Lavin and Gray, 2016).
+typedef struct
+{
+    long m;
+    long alpha;
+    double BT[WINOGRAD_MAX_ALPHA][WINOGRAD_MAX_ALPHA]; // Input transform B^T (alpha x alpha).
+    double G[WINOGRAD_MAX_ALPHA][3];                   // Kernel transform G (alpha x 3).
+    double AT[4][WINOGRAD_MAX_ALPHA];                  // Output transform A^T (m x alpha).
+} WinogradTransform;
+
+static const WinogradTransform winograd_2x3 = {
+    2,
+    4,
+    {{1, 0, -1, 0}, {0, 1, 1, 0}, {0, -1, 1, 0}, {0, 1, 0, -1}},
+    {{1, 0, 0}, {0.5, 0.5, 0.5}, {0.5, -0.5, 0.5}, {0, 0, 1}},
+    {{1, 1, 1, 0}, {0, 1, -1, -1}},
+};
+
+static const WinogradTransform winograd_4x3 = {
+    4,
+    6,
+    {{4, 0, -5, 0, 1, 0}, {0, -4, -4, 1, 1, 0}, {0, 4, -4, -1, 1, 0}, {0, -2, -1, 2, 1, 0}, {0, 2, -1, -2, 1, 0}, {0, 4, 0, -5, 0, 1}},
+    {{1.0 / 4, 0, 0}, {-1.0 / 6, -1.0 / 6, -1.0 / 6}, {-1.0 / 6, 1.0 / 6, -1.0 / 6}, {1.0 / 24, 1.0 / 12, 1.0 / 6}, {1.0 / 24, -1.0 / 12, 1.0 / 6}, {0, 0, 1}},
+    {{1, 1, 1, 1, 1, 0}, {0, 1, -1, 2, -2, 0}, {0, 1, 1, 4, 4, 0}, {0, 1, -1, 8, -8, 1}},
+};
+
+// The shapes of a convolution, shared by the algorithms.
+typedef struct
+{
+    const TensorBaseConv2dWindow *window;
+    DType dtype;
+    const void *image;
+    long image_strides[4]; // Batch (0 for a 3D image), channel, row and column strides, in elements.
+    const void *weight;
+    long weight_strides[2];
+    const void *bias; // NULL if there is no bias.
+    long bias_stride;
+    void *out; // Contiguous (N, out_channels, OH, OW) result.
+    long batch_size;
+    long channels;
+    long height;
+    long width;
+    long out_channels;
+    long out_height;
+    long out_width;
+} Conv2dProblem;
+
+typedef struct
+{
+    Conv2dProblem problem;
+    const WinogradTransform *transform;
+    long tiles_height;
+    long tiles_width;
+    long tile_count; // Number of tiles of all images.
+    void *U;         // alpha^2 (out_channels x C) matrices of transformed kernels.
+    void *V;         // alpha^2 (C x tile_count) matrices of transformed input tiles.
+    void *M;         // alpha^2 (out_channels x tile_count) products.
+} WinogradLoop;
+
+typedef struct
+{
+    Conv2dProblem problem;
+    long fft_height; // Size of the transforms, a power of two that holds every element the output depends on.
+    long fft_width;
+    const double *twiddles_height; // exp(-2 pi i k / fft_height) for k < fft_height / 2, real parts then imaginary parts.
+    const double *twiddles_width;
+    double *image_spectra;  // Spectra of the N * C image channels.
+    double *kernel_spectra; // Spectra of the out_channels * C kernels.
+    StatusCode status;      // Set by a worker that fails to allocate its scratch planes.
+} FFTLoop;
+
+#define CONV_DTYPE float64
+#define CONV_SCALAR double
+#include "tensorbase_convolution_kernels.c"
+#undef CONV_DTYPE
+#undef CONV_SCALAR
+
+#define CONV_DTYPE float32
+#define CONV_SCALAR float
+#include "tensorbase_convolution_kernels.c"
+#undef CONV_DTYPE
+#undef CONV_SCALAR
+
+long TensorBase_conv2d_output_size(long size, const TensorBaseConv2dWindow *window, long dim)
+{
+    long span = window->dilation[dim] * (window->kernel_size[dim] - 1) + 1;
+    long padded_size = size + 2 * window->padding[dim];
+    return padded_size < span ? -1 : (padded_size - span) / window->stride[dim] + 1;
+}
+
+static StatusCode check_window(const TensorBaseConv2dWindow *window)
+{
+    if (window == NULL)
+    {
+        return TB_NULL_INPUT_ERROR;
+    }
+    for (long dim = 0; dim < 2; dim++)
+    {
+        if (window->kernel_size[dim] < 1 || window->stride[dim] < 1 || window->dilation[dim] < 1 || window->padding[dim] < 0)
+        {
+            return TB_INVALID_DIMENSION_SIZE_ERROR;
+        }
+    }
+    return TB_OK;
+}
+
+StatusCode TensorBase_im2col(TensorBase *in, const TensorBaseConv2dWindow *window, TensorBase *out)
+{
+    if (in == NULL || out == NULL)
+    {
+        return TB_NULL_INPUT_ERROR;
+    }
+    RETURN_IF_ERROR(check_window(window));
+    if (in->ndim != 3 && in->ndim != 4)
+    {
+        return TB_INVALID_NDIM_ERROR;
+    }
+    if (in->dtype != TB_FLOAT32 && in->dtype != TB_FLOAT64)
+    {
+        return TB_UNSUPPORTED_DTYPE_ERROR;
+    }
+
+    // A 3D image is a batch of one, with a batch stride that is never used.
+    bool is_batched = in->ndim == 4;
+    long batch_dims = is_batched ? 1 : 0;
+    ConvolutionLoop loop;
+    loop.window = window;
+    loop.channels = in->shape[batch_dims];
+    loop.height = in->shape[batch_dims + 1];
+    loop.width = in->shape[batch_dims + 2];
+    loop.out_height = TensorBase_conv2d_output_size(loop.height, window, 0);
+    loop.out_width = TensorBase_conv2d_output_size(loop.width, window, 1);
+    if (loop.out_height < 1 || loop.out_width < 1)
+    {
+        return TB_INVALID_DIMENSION_SIZE_ERROR;
+    }
+    loop.image_strides[0] = is_batched ? in->strides[0] : 0;
+    for (long dim = 0; dim < 3; dim++)
+    {
+        loop.image_strides[dim + 1] = in->strides[batch_dims + dim];
+    }
+
+    long batch_size = is_batched ? in->shape[0] : 1;
+    long rows = loop.channels * window->kernel_size[0] * window->kernel_size[1];
+    long positions = loop.out_height * loop.out_width;
+    if (is_batched)
+    {
+        ShapeArray shape = {batch_size, rows, positions};
+        RETURN_IF_ERROR(TensorBase_init(out, shape, 3, in->dtype));
+    }
+    else
+    {
+        ShapeArray shape = {rows, positions};
+        RETURN_IF_ERROR(TensorBase_init(out, shape, 2, in->dtype));
+    }
+
+    loop.image = in->data;
+    loop.columns = out->data;
+    TensorBase_parallel_for(batch_size * rows, max_long(1, PARALLEL_GRAIN_ELEMENTS / positions),
+                            in->dtype == TB_FLOAT32 ? im2col_rows_float32 : im2col_rows_float64, &loop);
+    return TB_OK;
+}
+
+StatusCode TensorBase_col2im(TensorBase *in, const TensorBaseConv2dWindow *window, long height, long width, TensorBase *out)
+{
+    if (in == NULL || out == NULL)
+    {
+        return TB_NULL_INPUT_ERROR;
+    }
+    RETURN_IF_ERROR(check_window(window));
+    if (in->ndim != 2 && in->ndim != 3)
+    {
+        return TB_INVALID_NDIM_ERROR;
+    }
+    if (in->dtype != TB_FLOAT32 && in->dtype != TB_FLOAT64)
+    {
+        return TB_UNSUPPORTED_DTYPE_ERROR;
+    }
+
+    bool is_batched = in->ndim == 3;
+    long batch_dims = is_batched ? 1 : 0;
+    long kernel_area = window->kernel_size[0] * window->kernel_size[1];
+    ConvolutionLoop loop;
+    loop.window = window;
+    loop.height = height;
+    loop.width = width;
+    loop.out_height = TensorBase_conv2d_output_size(height, window, 0);
+    loop.out_width = TensorBase_conv2d_output_size(width, window, 1);
+    if (height < 0 || width < 0 || loop.out_height < 1 || loop.out_width < 1)
+    {
+        return TB_INVALID_DIMENSION_SIZE_ERROR;
+    }
+    if (in->shape[batch_dims] % kernel_area != 0 || in->shape[batch_dims + 1] != loop.out_height * loop.out_width)
+    {
+        return TB_SHAPE_MISMATCH_ERROR;
+    }
+    loop.channels = in->shape[batch_dims] / kernel_area;
+    loop.column_strides[0] = is_batched ? in->strides[0] : 0;
+    loop.column_strides[1] = in->strides[batch_dims];
+    loop.column_strides[2] = in->strides[batch_dims + 1];
+
+    long batch_size = is_batched ? in->shape[0] : 1;
+    if (is_batched)
+    {
+        ShapeArray shape = {batch_size, loop.channels, height, width};
+        RETURN_IF_ERROR(TensorBase_init(out, shape, 4, in->dtype));
+    }
+    else
+    {
+        ShapeArray shape = {loop.channels, height, width};
+        RETURN_IF_ERROR(TensorBase_init(out, shape, 3, in->dtype));
+    }
+
+    loop.columns = in->data;
+    loop.image = out->data;
+    TensorBase_parallel_for(batch_size * loop.channels, max_long(1, PARALLEL_GRAIN_ELEMENTS / max_long(1, kernel_area * in->shape[batch_dims + 1])),
+                            in->dtype == TB_FLOAT32 ? col2im_planes_float32 : col2im_planes_float64, &loop);
+    return TB_OK;
+}
+
+/*********************************************************
+ *                    Conv2d Algorithms                  *
+ *********************************************************/
+
+// Estimated spectra larger than this rule out the FFT algorithm for TB_CONV2D_AUTO.
+#define FFT_MAX_SPECTRA_BYTES ((size_t)1 << 28)
+
+// Number of (dtype, shape, window) combinations whose selected algorithm is cached.
+#define CONV2D_CACHE_SIZE 64
+
+static void add_bias(const Conv2dProblem *problem)
+{
+    BiasLoop loop = {problem->bias, problem->bias_stride, problem->out, problem->out_channels, problem->out_height * problem->out_width};
+    TensorBase_parallel_for(problem->batch_size * problem->out_channels, max_long(1, PARALLEL_GRAIN_ELEMENTS / max_long(1, loop.plane_size)),
+                            problem->dtype == TB_FLOAT32 ? add_bias_planes_float32 : add_bias_planes_float64, &loop);
+}
+
+static StatusCode conv2d_im2col(const Conv2dProblem *problem, TensorBase *in)
+{
+    // out[n] = weight @ im2col(in)[n], computed by the GEMM engine straight into the result.
+    TensorBase columns;
+    RETURN_IF_ERROR(TensorBase_im2col(in, problem->window, &columns));
+
+    long rows = columns.shape[columns.ndim - 2];
+    long positions = columns.shape[columns.ndim - 1];
+    long *offsets = (long *)TensorBase_cache_malloc(2 * problem->batch_size * sizeof(long));
+    if (offsets == NULL)
+    {
+        TensorBase_dealloc(&columns);
+        return TB_MALLOC_ERROR;
+    }
+    long *weight_offsets = offsets;
+    long *column_offsets = offsets + problem->batch_size;
+    for (long n = 0; n < problem->batch_size; n++)
+    {
+        weight_offsets[n] = 0;
+        column_offsets[n] = n * rows * positions;
+    }
+
+    StatusCode status = TensorBase_gemm_batched(problem->dtype, problem->batch_size, problem->out_channels, rows, positions,
+                                                (void *)problem->weight, weight_offsets, problem->weight_strides[0], problem->weight_strides[1],
+                                                columns.data, column_offsets, positions, 1,
+                                                problem->out, positions, problem->out_channels * positions);
+    TensorBase_cache_free(offsets, 2 * problem->batch_size * sizeof(long));
+    TensorBase_dealloc(&columns);
+    if (status == TB_OK && problem->bias != NULL)
+    {
+        add_bias(problem);
+    }
+    return status;
+}
+
+static StatusCode conv2d_winograd(const Conv2dProblem *problem, const WinogradTransform *transform)
+{
+    WinogradLoop loop;
+    loop.problem = *problem;
+    loop.transform = transform;
+    loop.tiles_height = (problem->out_height + transform->m - 1) / transform->m;
+    loop.tiles_width = (problem->out_width + transform->m - 1) / transform->m;
+    loop.tile_count = problem->batch_size * loop.tiles_height * loop.tiles_width;
+
+    long alpha_squared = transform->alpha * transform->alpha;
+    long out_channels = problem->out_channels;
+    long channels = problem->channels;
+    long tiles = loop.tile_count;
+    size_t element_size = TensorBase_element_size(problem->dtype);
+    size_t U_size = alpha_squared * out_channels * channels * element_size;
+    size_t V_size = alpha_squared * channels * tiles * element_size;
+    size_t M_size = alpha_squared * out_channels * tiles * element_size;
+    size_t offsets_size = 3 * alpha_squared * sizeof(long);
+    loop.U = TensorBase_cache_malloc(U_size);
+    loop.V = TensorBase_cache_malloc(V_size);
+    loop.M = TensorBase_cache_malloc(M_size);
+    long *offsets = (long *)TensorBase_cache_malloc(offsets_size);
+
+    StatusCode status = TB_MALLOC_ERROR;
+    if (loop.U != NULL && loop.V != NULL && loop.M != NULL && offsets != NULL)
+    {
+        bool is_float32 = problem->dtype == TB_FLOAT32;
+        TensorBase_parallel_for(out_channels * channels, max_long(1, PARALLEL_GRAIN_ELEMENTS / (9 * alpha_squared)),
+                                is_float32 ? winograd_filter_transform_float32 : winograd_filter_transform_float64, &loop);
+        TensorBase_parallel_for(channels * tiles, max_long(1, PARALLEL_GRAIN_ELEMENTS / (4 * alpha_squared)),
+                                is_float32 ? winograd_input_transform_float32 : winograd_input_transform_float64, &loop);
+
+        // M[e] = U[e] @ V[e] for each of the alpha^2 elements e of a tile.
+        for (long e = 0; e < alpha_squared; e++)
+        {
+            offsets[e] = e * out_channels * channels;
+            offsets[alpha_squared + e] = e * channels * tiles;
+        }
+        status = TensorBase_gemm_batched(problem->dtype, alpha_squared, out_channels, channels, tiles,
+                                         loop.U, offsets, channels, 1,
+                                         loop.V, offsets + alpha_squared, tiles, 1,
+                                         loop.M, tiles, out_channels * tiles);
+        if (status == TB_OK)
+        {
+            TensorBase_parallel_for(out_channels * tiles, max_long(1, PARALLEL_GRAIN_ELEMENTS / (4 * alpha_squared)),
+                                    is_float32 ? winograd_output_transform_float32 : winograd_output_transform_float64, &loop);
+        }
+    }
+
+    TensorBase_cache_free(loop.U, U_size);
+    TensorBase_cache_free(loop.V, V_size);
+    TensorBase_cache_free(loop.M, M_size);
+    TensorBase_cache_free(offsets, offsets_size);
+    return status;
+}
+
+static void fft_twiddles(long n, double *twiddles)
+{
+    // exp(-2 pi i k / n) for k < n / 2: the real parts, followed by the imaginary parts.
+    long half = n / 2;
+    for (long k = 0; k < half; k++)
+    {
+        twiddles[k] = cos(2 * M_PI * k / n);
+        twiddles[half + k] = -sin(2 * M_PI * k / n);
+    }
+}
+
+static void fft_1d(double *re, double *im, long n, long stride, const double *twiddles, bool inverse)
+{
+    // In-place iterative radix-2 FFT of the n (a power of two) elements re[i * stride] + i im[i * stride].
+    // The inverse transform is not scaled.
+    for (long i = 1, j = 0; i < n; i++)
+    {
+        long bit = n >> 1;
+        for (; j & bit; bit >>= 1)
+        {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j)
+        {
+            double t = re[i * stride];
+            re[i * stride] = re[j * stride];
+            re[j * stride] = t;
+            t = im[i * stride];
+            im[i * stride] = im[j * stride];
+            im[j * stride] = t;
+        }
+    }
+
+    long half_n = n / 2;
+    double sign = inverse ? -1 : 1;
+    for (long length = 2; length <= n; length <<= 1)
+    {
+        long half = length / 2;
+        long step = n / length;
+        for (long start = 0; start < n; start += length)
+        {
+            for (long k = 0; k < half; k++)
+            {
+                double w_re = twiddles[k * step];
+                double w_im = sign * twiddles[half_n + k * step];
+                long a = (start + k) * stride;
+                long b = a + half * stride;
+                double x_re = re[b] * w_re - im[b] * w_im;
+                double x_im = re[b] * w_im + im[b] * w_re;
+                re[b] = re[a] - x_re;
+                im[b] = im[a] - x_im;
+                re[a] += x_re;
+                im[a] += x_im;
+            }
+        }
+    }
+}
+
+static void fft_2d(const FFTLoop *loop, double *re, double *im, bool inverse)
+{
+    // Transforms the rows, then the columns, of a fft_height x fft_width grid.
+    for (long row = 0; row < loop->fft_height; row++)
+    {
+        fft_1d(re + row * loop->fft_width, im + row * loop->fft_width, loop->fft_width, 1, loop->twiddles_width, inverse);
+    }
+    for (long col = 0; col < loop->fft_width; col++)
+    {
+        fft_1d(re + col, im + col, loop->fft_height, loop->fft_width, loop->twiddles_height, inverse);
+    }
+}
+
+static void fft_image_spectra(void *context, long begin, long end)
+{
+    // Spectra of the image channels (n, c) in [begin, end).
+    FFTLoop *loop = (FFTLoop *)context;
+    long grid_size = loop->fft_height * loop->fft_width;
+    for (long i = begin; i < end; i++)
+    {
+        double *re = loop->image_spectra + 2 * i * grid_size;
+        double *im = re + grid_size;
+        memset(re, 0, 2 * grid_size * sizeof(double));
+        long n = i / loop->problem.channels;
+        long c = i % loop->problem.channels;
+        if (loop->problem.dtype == TB_FLOAT32)
+        {
+            fft_load_image_float32(loop, n, c, re);
+        }
+        else
+        {
+            fft_load_image_float64(loop, n, c, re);
+        }
+        fft_2d(loop, re, im, false);
+    }
+}
+
+static void fft_kernel_spectra(void *context, long begin, long end)
+{
+    // Spectra of the kernels (o, c) in [begin, end).
+    FFTLoop *loop = (FFTLoop *)context;
+    long grid_size = loop->fft_height * loop->fft_width;
+    for (long i = begin; i < end; i++)
+    {
+        double *re = loop->kernel_spectra + 2 * i * grid_size;
+        double *im = re + grid_size;
+        memset(re, 0, 2 * grid_size * sizeof(double));
+        long o = i / loop->problem.channels;
+        long c = i % loop->problem.channels;
+        if (loop->problem.dtype == TB_FLOAT32)
+        {
+            fft_load_kernel_float32(loop, o, c, re);
+        }
+        else
+        {
+            fft_load_kernel_float64(loop, o, c, re);
+        }
+        fft_2d(loop, re, im, false);
+    }
+}
+
+static void fft_output_planes(void *context, long begin, long end)
+{
+    // Computes the output planes (n, o) in [begin, end) as the inverse transform of sum_c X[n, c] * conj(K[o, c]),
+    // which is the circular cross-correlation of the image with the kernel.
+    FFTLoop *loop = (FFTLoop *)context;
+    long grid_size = loop->fft_height * loop->fft_width;
+    long channels = loop->problem.channels;
+    double *re = (double *)TensorBase_cache_malloc(2 * grid_size * sizeof(double));
+    if (re == NULL)
+    {
+        __atomic_store_n(&loop->status, TB_MALLOC_ERROR, __ATOMIC_RELAXED);
+        return;
+    }
+    double *im = re + grid_size;
+
+    for (long i = begin; i < end; i++)
+    {
+        long n = i / loop->problem.out_channels;
+        long o = i % loop->problem.out_channels;
+        memset(re, 0, 2 * grid_size * sizeof(double));
+        for (long c = 0; c < channels; c++)
+        {
+            const double *x_re = loop->image_spectra + 2 * (n * channels + c) * grid_size;
+            const double *x_im = x_re + grid_size;
+            const double *k_re = loop->kernel_spectra + 2 * (o * channels + c) * grid_size;
+            const double *k_im = k_re + grid_size;
+            for (long f = 0; f < grid_size; f++)
+            {
+                re[f] += x_re[f] * k_re[f] + x_im[f] * k_im[f];
+                im[f] += x_im[f] * k_re[f] - x_re[f] * k_im[f];
+            }
+        }
+        fft_2d(loop, re, im, true);
+        if (loop->problem.dtype == TB_FLOAT32)
+        {
+            fft_store_output_float32(loop, n, o, re);
+        }
+        else
+        {
+            fft_store_output_float64(loop, n, o, re);
+        }
+    }
+    TensorBase_cache_free(re, 2 * grid_size * sizeof(double));
+}
+
+static long next_power_of_two(long n)
+{
+    long power = 1;
+    while (power < n)
+    {
+        power <<= 1;
+    }
+    return power;
+}
+
+static void fft_grid_size(const Conv2dProblem *problem, long *fft_height, long *fft_width)
+{
+    // The grid must hold every (padded) element an output reads, so that the circular correlation does not wrap.
+    const TensorBaseConv2dWindow *window = problem->window;
+    long span_height = window->dilation[0] * (window->kernel_size[0] - 1) + 1;
+    long span_width = window->dilation[1] * (window->kernel_size[1] - 1) + 1;
+    *fft_height = next_power_of_two((problem->out_height - 1) * window->stride[0] + span_height);
+    *fft_width = next_power_of_two((problem->out_width - 1) * window->stride[1] + span_width);
+}
+
+static StatusCode conv2d_fft(const Conv2dProblem *problem)
+{
+    FFTLoop loop;
+    loop.problem = *problem;
+    loop.status = TB_OK;
+    fft_grid_size(problem, &loop.fft_height, &loop.fft_width);
+
+    long grid_size = loop.fft_height * loop.fft_width;
+    size_t image_spectra_size = 2 * problem->batch_size * problem->channels * grid_size * sizeof(double);
+    size_t kernel_spectra_size = 2 * problem->out_channels * problem->channels * grid_size * sizeof(double);
+    size_t twiddles_size = (loop.fft_height + loop.fft_width) * sizeof(double);
+    loop.image_spectra = (double *)TensorBase_cache_malloc(image_spectra_size);
+    loop.kernel_spectra = (double *)TensorBase_cache_malloc(kernel_spectra_size);
+    double *twiddles = (double *)TensorBase_cache_malloc(twiddles_size);
+
+    StatusCode status = TB_MALLOC_ERROR;
+    if (loop.image_spectra != NULL && loop.kernel_spectra != NULL && twiddles != NULL)
+    {
+        fft_twiddles(loop.fft_height, twiddles);
+        fft_twiddles(loop.fft_width, twiddles + loop.fft_height);
+        loop.twiddles_height = twiddles;
+        loop.twiddles_width = twiddles + loop.fft_height;
+
+        // Each pass reads the spectra of the previous ones, so a failed pass ends the convolution.
+        TensorBase_parallel_for(problem->batch_size * problem->channels, 1, fft_image_spectra, &loop);
+        if (loop.status == TB_OK)
+        {
+            TensorBase_parallel_for(problem->out_channels * problem->channels, 1, fft_kernel_spectra, &loop);
+        }
+        if (loop.status == TB_OK)
+        {
+            TensorBase_parallel_for(problem->batch_size * problem->out_channels, 1, fft_output_planes, &loop);
+        }
+        status = loop.status;
+    }
+
+    TensorBase_cache_free(loop.image_spectra, image_spectra_size);
+    TensorBase_cache_free(loop.kernel_spectra, kernel_spectra_size);
+    TensorBase_cache_free(twiddles, twiddles_size);
+    return status;
+}
+
+/*********************************************************
+ *                  Algorithm Selection                  *
+ *********************************************************/
+
+typedef struct
+{
+    DType dtype;
+    long batch_size;
+    long channels;
+    long height;
+    long width;
+    long out_channels;
+    TensorBaseConv2dWindow window;
+} Conv2dKey;
+
+static pthread_mutex_t conv2d_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static Conv2dKey conv2d_cache_keys[CONV2D_CACHE_SIZE];
+static Conv2dAlgorithm conv2d_cache_algorithms[CONV2D_CACHE_SIZE];
+static long conv2d_cache_count = 0;
+static long conv2d_cache_next = 0; // Entry replaced next once the cache is full.
+static bool conv2d_benchmark_enabled = false;
+static pthread_once_t conv2d_cache_once = PTHREAD_ONCE_INIT;
+
+static void conv2d_cache_before_fork(void)
+{
+    // Hold the selection cache across fork(), so the child never inherits it locked by a thread that no longer exists.
+    pthread_mutex_lock(&conv2d_cache_mutex);
+}
+
+static void conv2d_cache_after_fork(void)
+{
+    // Runs in the parent and in the child, on the thread that forked (which holds the lock in both).
+    pthread_mutex_unlock(&conv2d_cache_mutex);
+}
+
+static void conv2d_cache_init_once(void)
+{
+    pthread_atfork(conv2d_cache_before_fork, conv2d_cache_after_fork, conv2d_cache_after_fork);
+}
+
+static void conv2d_cache_lock(void)
+{
+    pthread_once(&conv2d_cache_once, conv2d_cache_init_once);
+    pthread_mutex_lock(&conv2d_cache_mutex);
+}
+
+bool TensorBase_conv2d_supports(Conv2dAlgorithm algorithm, const TensorBaseConv2dWindow *window)
+{
+    switch (algorithm)
+    {
+    case TB_CONV2D_IM2COL:
+    case TB_CONV2D_FFT:
+        return true;
+    case TB_CONV2D_WINOGRAD_2X3:
+    case TB_CONV2D_WINOGRAD_4X3:
+        return window->kernel_size[0] == 3 && window->kernel_size[1] == 3 && window->stride[0] == 1 && window->stride[1] == 1 &&
+               window->dilation[0] == 1 && window->dilation[1] == 1;
+    default:
+        return false;
+    }
+}
+
+void TensorBase_set_conv2d_benchmark(bool enabled)
+{
+    conv2d_cache_lock();
+    conv2d_benchmark_enabled = enabled;
+    conv2d_cache_count = 0;
+    conv2d_cache_next = 0;
+    pthread_mutex_unlock(&conv2d_cache_mutex);
+}
+
+bool TensorBase_get_conv2d_benchmark(void)
+{
+    return conv2d_benchmark_enabled;
+}
+
+static double conv2d_estimated_cost(Conv2dAlgorithm algorithm, const Conv2dProblem *problem)
+{
+    // Estimated floating point operations of an algorithm, or INFINITY if the algorithm should not be used.
+    const TensorBaseConv2dWindow *window = problem->window;
+    double N = problem->batch_size;
+    double C = problem->channels;
+    double O = problem->out_channels;
+    double positions = (double)problem->out_height * problem->out_width;
+    double kernel_area = (double)window->kernel_size[0] * window->kernel_size[1];
+
+    switch (algorithm)
+    {
+    case TB_CONV2D_IM2COL:
+        // The GEMM, and the copy into the columns.
+        return 2 * N * O * C * kernel_area * positions + N * C * kernel_area * positions;
+    case TB_CONV2D_WINOGRAD_2X3:
+    case TB_CONV2D_WINOGRAD_4X3:
+    {
+        const WinogradTransform *transform = algorithm == TB_CONV2D_WINOGRAD_2X3 ? &winograd_2x3 : &winograd_4x3;
+        double m = transform->m;
+        double alpha = transform->alpha;
+        double tiles = N * ceil(problem->out_height / m) * ceil(problem->out_width / m);
+        // The GEMMs, the input and output transforms (two small matrix products per tile) and the kernel transforms.
+        return 2 * alpha * alpha * O * C * tiles + 4 * alpha * alpha * alpha * C * tiles + 4 * alpha * alpha * m * O * tiles +
+               4 * alpha * alpha * 3 * O * C;
+    }
+    case TB_CONV2D_FFT:
+    {
+        long fft_height, fft_width;
+        fft_grid_size(problem, &fft_height, &fft_width);
+        double grid_size = (double)fft_height * fft_width;
+        double spectra_bytes = 2 * (N * C + O * C) * grid_size * sizeof(double);
+        if (spectra_bytes > (double)FFT_MAX_SPECTRA_BYTES)
+        {
+            return INFINITY;
+        }
+        // 5 n log2(n) per complex FFT of n points, and a complex multiply-add per channel and frequency.
+        return 5 * grid_size * log2(grid_size) * (N * C + O * C + N * O) + 8 * N * O * C * grid_size;
+    }
+    default:
+        return INFINITY;
+    }
+}
+
+static StatusCode conv2d_run(Conv2dAlgorithm algorithm, const Conv2dProblem *problem, TensorBase *in)
+{
+    switch (algorithm)
+    {
+    case TB_CONV2D_IM2COL:
+        return conv2d_im2col(problem, in);
+    case TB_CONV2D_WINOGRAD_2X3:
+        return conv2d_winograd(problem, &winograd_2x3);
+    case TB_CONV2D_WINOGRAD_4X3:
+        return conv2d_winograd(problem, &winograd_4x3);
+    case TB_CONV2D_FFT:
+        return conv2d_fft(problem);
+    default:
+        return TB_NOT_IMPLEMENTED_ERROR;
+    }
+}
+
+static double seconds_since(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start->tv_sec) + (double)(now.tv_nsec - start->tv_nsec) * 1e-9;
+}
+
+static StatusCode conv2d_auto(Conv2dProblem *problem, TensorBase *in, TensorBase *out)
+{
+    // Runs the cached algorithm for the problem's key, after selecting it if the key is not cached yet.
+    Conv2dKey key;
+    memset(&key, 0, sizeof(key)); // The key is compared with memcmp, padding bytes included.
+    key.dtype = problem->dtype;
+    key.batch_size = problem->batch_size;
+    key.channels = problem->channels;
+    key.height = problem->height;
+    key.width = problem->width;
+    key.out_channels = problem->out_channels;
+    key.window = *problem->window;
+
+    Conv2dAlgorithm algorithm = TB_CONV2D_AUTO;
+    conv2d_cache_lock();
+    bool benchmark = conv2d_benchmark_enabled;
+    for (long i = 0; i < conv2d_cache_count; i++)
+    {
+        if (memcmp(&conv2d_cache_keys[i], &key, sizeof(key)) == 0)
+        {
+            algorithm = conv2d_cache_algorithms[i];
+            break;
+        }
+    }
+    pthread_mutex_unlock(&conv2d_cache_mutex);
+
+    if (algorithm != TB_CONV2D_AUTO)
+    {
+        return conv2d_run(algorithm, problem, in);
+    }
+
+    if (!benchmark)
+    {
+        double best_cost = INFINITY;
+        algorithm = TB_CONV2D_IM2COL;
+        for (Conv2dAlgorithm candidate = TB_CONV2D_IM2COL; candidate < NUM_CONV2D_ALGORITHMS; candidate++)
+        {
+            double cost = TensorBase_conv2d_supports(candidate, problem->window) ? conv2d_estimated_cost(candidate, problem) : INFINITY;
+            if (cost < best_cost)
+            {
+                best_cost = cost;
+                algorithm = candidate;
+            }
+        }
+        RETURN_IF_ERROR(conv2d_run(algorithm, problem, in));
+    }
+    else
+    {
+        // Times every applicable algorithm, each writing its own result, and keeps the result of the fastest.
+        double best_time = INFINITY;
+        TensorBase candidate_out;
+        for (Conv2dAlgorithm candidate = TB_CONV2D_IM2COL; candidate < NUM_CONV2D_ALGORITHMS; candidate++)
+        {
+            if (!TensorBase_conv2d_supports(candidate, problem->window) || (candidate == TB_CONV2D_FFT && isinf(conv2d_estimated_cost(candidate, problem))))
+            {
+                continue;
+            }
+            TensorBase *target = algorithm == TB_CONV2D_AUTO ? out : &candidate_out;
+            if (target == &candidate_out)
+            {
+                RETURN_IF_ERROR(TensorBase_init(&candidate_out, out->shape, out->ndim, out->dtype));
+            }
+            Conv2dProblem candidate_problem = *problem;
+            candidate_problem.out = target->data;
+
+            struct timespec start;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            StatusCode status = conv2d_run(candidate, &candidate_problem, in);
+            double time = seconds_since(&start);
+            if (status != TB_OK)
+            {
+                if (target == &candidate_out)
+                {
+                    TensorBase_dealloc(&candidate_out);
+                }
+                continue;
+            }
+
+            if (time < best_time)
+            {
+                if (target == &candidate_out)
+                {
+                    // The candidate's result replaces the previous best.
+                    TensorBase_dealloc(out);
+                    *out = candidate_out;
+                }
+                best_time = time;
+                algorithm = candidate;
+            }
+            else
+            {
+                TensorBase_dealloc(&candidate_out);
+            }
+        }
+        if (algorithm == TB_CONV2D_AUTO)
+        {
+            return TB_MALLOC_ERROR;
+        }
+    }
+
+    conv2d_cache_lock();
+    long slot = conv2d_cache_count < CONV2D_CACHE_SIZE ? conv2d_cache_count++ : conv2d_cache_next++ % CONV2D_CACHE_SIZE;
+    conv2d_cache_keys[slot] = key;
+    conv2d_cache_algorithms[slot] = algorithm;
+    pthread_mutex_unlock(&conv2d_cache_mutex);
+    return TB_OK;
+}
+
+StatusCode TensorBase_conv2d(TensorBase *in, TensorBase *weight, TensorBase *bias, const TensorBaseConv2dWindow *window,
+                             Conv2dAlgorithm algorithm, TensorBase *out)
+{
+    if (in == NULL || weight == NULL || out == NULL)
+    {
+        return TB_NULL_INPUT_ERROR;
+    }
+    RETURN_IF_ERROR(check_window(window));
+    if (in->ndim != 3 && in->ndim != 4)
+    {
+        return TB_INVALID_NDIM_ERROR;
+    }
+    if (in->dtype != TB_FLOAT32 && in->dtype != TB_FLOAT64)
+    {
+        return TB_UNSUPPORTED_DTYPE_ERROR;
+    }
+    if (weight->dtype != in->dtype || (bias != NULL && bias->dtype != in->dtype))
+    {
+        return TB_UNSUPPORTED_DTYPE_ERROR;
+    }
+
+    bool is_batched = in->ndim == 4;
+    long batch_dims = is_batched ? 1 : 0;
+    Conv2dProblem problem;
+    problem.window = window;
+    problem.dtype = in->dtype;
+    problem.batch_size = is_batched ? in->shape[0] : 1;
+    problem.channels = in->shape[batch_dims];
+    problem.height = in->shape[batch_dims + 1];
+    problem.width = in->shape[batch_dims + 2];
+    problem.out_height = TensorBase_conv2d_output_size(problem.height, window, 0);
+    problem.out_width = TensorBase_conv2d_output_size(problem.width, window, 1);
+    if (problem.out_height < 1 || problem.out_width < 1)
+    {
+        return TB_INVALID_DIMENSION_SIZE_ERROR;
+    }
+
+    long kernel_area = window->kernel_size[0] * window->kernel_size[1];
+    if (weight->ndim != 2 || weight->shape[1] != problem.channels * kernel_area)
+    {
+        return TB_SHAPE_MISMATCH_ERROR;
+    }
+    problem.out_channels = weight->shape[0];
+    if (bias != NULL && (bias->ndim != 1 || bias->shape[0] != problem.out_channels))
+    {
+        return TB_SHAPE_MISMATCH_ERROR;
+    }
+    if (algorithm != TB_CONV2D_AUTO && !TensorBase_conv2d_supports(algorithm, window))
+    {
+        return TB_NOT_IMPLEMENTED_ERROR;
+    }
+
+    problem.image = in->data;
+    problem.image_strides[0] = is_batched ? in->strides[0] : 0;
+    for (long dim = 0; dim < 3; dim++)
+    {
+        problem.image_strides[dim + 1] = in->strides[batch_dims + dim];
+    }
+    problem.weight = weight->data;
+    problem.weight_strides[0] = weight->strides[0];
+    problem.weight_strides[1] = weight->strides[1];
+    problem.bias = bias == NULL ? NULL : TensorBase_data_ptr(bias);
+    problem.bias_stride = bias == NULL ? 0 : bias->strides[0];
+
+    if (is_batched)
+    {
+        ShapeArray shape = {problem.batch_size, problem.out_channels, problem.out_height, problem.out_width};
+        RETURN_IF_ERROR(TensorBase_init(out, shape, 4, in->dtype));
+    }
+    else
+    {
+        ShapeArray shape = {problem.out_channels, problem.out_height, problem.out_width};
+        RETURN_IF_ERROR(TensorBase_init(out, shape, 3, in->dtype));
+    }
+    problem.out = out->data;
+
+    StatusCode status = algorithm == TB_CONV2D_AUTO ? conv2d_auto(&problem, in, out) : conv2d_run(algorithm, &problem, in);
+    if (status != TB_OK)
+    {
+        TensorBase_dealloc(out);
+    }
+    return status;
+}
@@ -0,0 +1,348 @@
+// Convolution kernel template: im2col and col2im, the Winograd transforms and the FFT loads and stores.
+// This file is included once per dtype by tensorbase_convolution.c, with the following macros defined:
+// * CONV_DTYPE: A suffix that makes the names of the generated kernels unique (e.g., float32).
+// * CONV_SCALAR: The C type of the elements (e.g., float).
+// The Winograd transforms and the FFTs compute in double precision, whatever the dtype.
+
+#define CONV_NAME_(name, dtype) name##_##dtype
+#define CONV_NAME(name, dtype) CONV_NAME_(name, dtype)
+#define CONV(name) CONV_NAME(name, CONV_DTYPE)
+
+static void CONV(im2col_rows)(void *context, long begin, long end)
+{
+    // Writes the rows [begin, end) of the columns. Every row holds one element of the window (a channel, kernel row
+    // and kernel column) at every window position, so it is a strided copy of one channel of the image.
+    ConvolutionLoop *loop = (ConvolutionLoop *)context;
+    const TensorBaseConv2dWindow *window = loop->window;
+    long kernel_area = window->kernel_size[0] * window->kernel_size[1];
+    long positions = loop->out_height * loop->out_width;
+    const long *image_strides = loop->image_strides;
+
+    for (long row = begin; row < end; row++)
+    {
+        long n = row / (loop->channels * kernel_area);
+        long c = row / kernel_area % loop->channels;
+        long ki = row % kernel_area / window->kernel_size[1];
+        long kj = row % window->kernel_size[1];
+        const CONV_SCALAR *image = (const CONV_SCALAR *)loop->image + n * image_strides[0] + c * image_strides[1];
+        CONV_SCALAR *column = (CONV_SCALAR *)loop->columns + row * positions;
+
+        // The window position (oh, ow) reads the image element (oh * stride + row_offset, ow * stride + col_offset).
+        long row_offset = ki * window->dilation[0] - window->padding[0];
+        long col_offset = kj * window->dilation[1] - window->padding[1];
+        long oh_begin, oh_end, ow_begin, ow_end;
+        window_valid_range(row_offset, window->stride[0], loop->height, loop->out_height, &oh_begin, &oh_end);
+        window_valid_range(col_offset, window->stride[1], loop->width, loop->out_width, &ow_begin, &ow_end);
+
+        // Positions in the padding rows read zeros.
+        memset(column, 0, oh_begin * loop->out_width * sizeof(CONV_SCALAR));
+        memset(column + oh_end * loop->out_width, 0, (loop->out_height - oh_end) * loop->out_width * sizeof(CONV_SCALAR));
+
+        long step = window->stride[1] * image_strides[3];
+        for (long oh = oh_begin; oh < oh_end; oh++)
+        {
+            CONV_SCALAR *out = column + oh * loop->out_width;
+            const CONV_SCALAR *in = image + (oh * window->stride[0] + row_offset) * image_strides[2] + col_offset * image_strides[3];
+            for (long ow = 0; ow < ow_begin; ow++)
+            {
+                out[ow] = 0;
+            }
+            if (step == 1)
+            {
+                memcpy(out + ow_begin, in + ow_begin, (ow_end - ow_begin) * sizeof(CONV_SCALAR));
+            }
+            else
+            {
+                for (long ow = ow_begin; ow < ow_end; ow++)
+                {
+                    out[ow] = in[ow * step];
+                }
+            }
+            for (long ow = ow_end; ow < loop->out_width; ow++)
+            {
+                out[ow] = 0;
+            }
+        }
+    }
+}
+
+static void CONV(col2im_planes)(void *context, long begin, long end)
+{
+    // Accumulates the columns into the image planes (one per batch entry and channel) [begin, end). A plane is only
+    // written by the kernel_area rows of its channel, so every plane is summed by a single thread, without atomics.
+    ConvolutionLoop *loop = (ConvolutionLoop *)context;
+    const TensorBaseConv2dWindow *window = loop->window;
+    long kernel_area = window->kernel_size[0] * window->kernel_size[1];
+    long plane_size = loop->height * loop->width;
+    const long *column_strides = loop->column_strides;
+
+    for (long plane = begin; plane < end; plane++)
+    {
+        long n = plane / loop->channels;
+        long c = plane % loop->channels;
+        CONV_SCALAR *image = (CONV_SCALAR *)loop->image + plane * plane_size;
+        const CONV_SCALAR *columns = (const CONV_SCALAR *)loop->columns + n * column_strides[0] + c * kernel_area * column_strides[1];
+        memset(image, 0, plane_size * sizeof(CONV_SCALAR));
+
+        for (long k = 0; k < kernel_area; k++)
+        {
+            const CONV_SCALAR *column = columns + k * column_strides[1];
+            long row_offset = k / window->kernel_size[1] * window->dilation[0] - window->padding[0];
+            long col_offset = k % window->kernel_size[1] * window->dilation[1] - window->padding[1];
+            long oh_begin, oh_end, ow_begin, ow_end;
+            window_valid_range(row_offset, window->stride[0], loop->height, loop->out_height, &oh_begin, &oh_end);
+            window_valid_range(col_offset, window->stride[1], loop->width, loop->out_width, &ow_begin, &ow_end);
+
+            long in_step = column_strides[2];
+            long out_step = window->stride[1];
+            for (long oh = oh_begin; oh < oh_end; oh++)
+            {
+                CONV_SCALAR *out = image + (oh * window->stride[0] + row_offset) * loop->width + col_offset;
+                const CONV_SCALAR *in = column + oh * loop->out_width * in_step;
+                if (in_step == 1 && out_step == 1)
+                {
+                    for (long ow = ow_begin; ow < ow_end; ow++)
+                    {
+                        out[ow] += in[ow];
+                    }
+                }
+                else
+                {
+                    for (long ow = ow_begin; ow < ow_end; ow++)
+                    {
+                        out[ow * out_step] += in[ow * in_step];
+                    }
+                }
+            }
+        }
+    }
+}
+
+static void CONV(add_bias_planes)(void *context, long begin, long end)
+{
+    // Adds bias[o] to the output planes [begin, end) of an (N, out_channels, OH, OW) result.
+    BiasLoop *loop = (BiasLoop *)context;
+    const CONV_SCALAR *bias = (const CONV_SCALAR *)loop->bias;
+    for (long plane = begin; plane < end; plane++)
+    {
+        CONV_SCALAR *out = (CONV_SCALAR *)loop->out + plane * loop->plane_size;
+        CONV_SCALAR b = bias[plane % loop->out_channels * loop->bias_stride];
+        for (long i = 0; i < loop->plane_size; i++)
+        {
+            out[i] += b;
+        }
+    }
+}
+
+static void CONV(winograd_filter_transform)(void *context, long begin, long end)
+{
+    // U = G g G^T for the kernels (o, c) in [begin, end), where g is the 3x3 kernel of output channel o and channel c.
+    // Element (a, b) of U is stored in the (out_channels x C) matrix U[a * alpha + b].
+    WinogradLoop *loop = (WinogradLoop *)context;
+    const Conv2dProblem *problem = &loop->problem;
+    const WinogradTransform *transform = loop->transform;
+    long alpha = transform->alpha;
+    const CONV_SCALAR *weight = (const CONV_SCALAR *)problem->weight;
+    CONV_SCALAR *U = (CONV_SCALAR *)loop->U;
+    long matrix_size = problem->out_channels * problem->channels;
+
+    for (long i = begin; i < end; i++)
+    {
+        long o = i / problem->channels;
+        long c = i % problem->channels;
+        double g[3][3];
+        for (long k = 0; k < 9; k++)
+        {
+            g[k / 3][k % 3] = weight[o * problem->weight_strides[0] + (c * 9 + k) * problem->weight_strides[1]];
+        }
+
+        double Gg[WINOGRAD_MAX_ALPHA][3];
+        for (long a = 0; a < alpha; a++)
+        {
+            for (long l = 0; l < 3; l++)
+            {
+                Gg[a][l] = transform->G[a][0] * g[0][l] + transform->G[a][1] * g[1][l] + transform->G[a][2] * g[2][l];
+            }
+        }
+        for (long a = 0; a < alpha; a++)
+        {
+            for (long b = 0; b < alpha; b++)
+            {
+                double u = Gg[a][0] * transform->G[b][0] + Gg[a][1] * transform->G[b][1] + Gg[a][2] * transform->G[b][2];
+                U[(a * alpha + b) * matrix_size + i] = (CONV_SCALAR)u;
+            }
+        }
+    }
+}
+
+static void CONV(winograd_input_transform)(void *context, long begin, long end)
+{
+    // V = B^T d B for the (channel, tile) pairs [begin, end), where d is the alpha x alpha input tile (zero outside of
+    // the image). Element (a, b) of V is stored in the (C x tile_count) matrix V[a * alpha + b].
+    WinogradLoop *loop = (WinogradLoop *)context;
+    const Conv2dProblem *problem = &loop->problem;
+    const WinogradTransform *transform = loop->transform;
+    long alpha = transform->alpha;
+    long m = transform->m;
+    const CONV_SCALAR *image = (const CONV_SCALAR *)problem->image;
+    const long *strides = problem->image_strides;
+    CONV_SCALAR *V = (CONV_SCALAR *)loop->V;
+    long tiles_per_image = loop->tiles_height * loop->tiles_width;
+    long matrix_size = problem->channels * loop->tile_count;
+
+    for (long i = begin; i < end; i++)
+    {
+        long c = i / loop->tile_count;
+        long tile = i % loop->tile_count;
+        long n = tile / tiles_per_image;
+        long row = tile % tiles_per_image / loop->tiles_width * m - problem->window->padding[0];
+        long col = tile % loop->tiles_width * m - problem->window->padding[1];
+        const CONV_SCALAR *channel = image + n * strides[0] + c * strides[1];
+
+        double d[WINOGRAD_MAX_ALPHA][WINOGRAD_MAX_ALPHA];
+        for (long a = 0; a < alpha; a++)
+        {
+            long ih = row + a;
+            for (long b = 0; b < alpha; b++)
+            {
+                long iw = col + b;
+                bool inside = ih >= 0 && ih < problem->height && iw >= 0 && iw < problem->width;
+                d[a][b] = inside ? channel[ih * strides[2] + iw * strides[3]] : 0;
+            }
+        }
+
+        double BTd[WINOGRAD_MAX_ALPHA][WINOGRAD_MAX_ALPHA];
+        for (long a = 0; a < alpha; a++)
+        {
+            for (long b = 0; b < alpha; b++)
+            {
+                double sum = 0;
+                for (long k = 0; k < alpha; k++)
+                {
+                    sum += transform->BT[a][k] * d[k][b];
+                }
+                BTd[a][b] = sum;
+            }
+        }
+        for (long a = 0; a < alpha; a++)
+        {
+            for (long b = 0; b < alpha; b++)
+            {
+                double sum = 0;
+                for (long k = 0; k < alpha; k++)
+                {
+                    sum += BTd[a][k] * transform->BT[b][k];
+                }
+                V[(a * alpha + b) * matrix_size + i] = (CONV_SCALAR)sum;
+            }
+        }
+    }
+}
+
+static void CONV(winograd_output_transform)(void *context, long begin, long end)
+{
+    // Y = A^T M A for the (output channel, tile) pairs [begin, end), where element (a, b) of M is read from the
+    // (out_channels x tile_count) matrix M[a * alpha + b]. Y is the m x m output tile, clipped to the output.
+    WinogradLoop *loop = (WinogradLoop *)context;
+    const Conv2dProblem *problem = &loop->problem;
+    const WinogradTransform *transform = loop->transform;
+    long alpha = transform->alpha;
+    long m = transform->m;
+    const CONV_SCALAR *M = (const CONV_SCALAR *)loop->M;
+    const CONV_SCALAR *bias = (const CONV_SCALAR *)problem->bias;
+    CONV_SCALAR *out = (CONV_SCALAR *)problem->out;
+    long tiles_per_image = loop->tiles_height * loop->tiles_width;
+    long matrix_size = problem->out_channels * loop->tile_count;
+
+    for (long i = begin; i < end; i++)
+    {
+        long o = i / loop->tile_count;
+        long tile = i % loop->tile_count;
+        long n = tile / tiles_per_image;
+        long row = tile % tiles_per_image / loop->tiles_width * m;
+        long col = tile % loop->tiles_width * m;
+
+        double ATM[4][WINOGRAD_MAX_ALPHA];
+        for (long a = 0; a < m; a++)
+        {
+            for (long b = 0; b < alpha; b++)
+            {
+                double sum = 0;
+                for (long k = 0; k < alpha; k++)
+                {
+                    sum += transform->AT[a][k] * M[(k * alpha + b) * matrix_size + i];
+                }
+                ATM[a][b] = sum;
+            }
+        }
+
+        double b_o = bias == NULL ? 0 : bias[o * problem->bias_stride];
+        CONV_SCALAR *plane = out + (n * problem->out_channels + o) * problem->out_height * problem->out_width;
+        for (long a = 0; a < m && row + a < problem->out_height; a++)
+        {
+            for (long b = 0; b < m && col + b < problem->out_width; b++)
+            {
+                double sum = b_o;
+                for (long k = 0; k < alpha; k++)
+                {
+                    sum += ATM[a][k] * transform->AT[b][k];
+                }
+                plane[(row + a) * problem->out_width + col + b] = (CONV_SCALAR)sum;
+            }
+        }
+    }
+}
+
+static void CONV(fft_load_image)(const FFTLoop *loop, long n, long c, double *re)
+{
+    // Places channel c of image n into the (zeroed) fft_height x fft_width grid, offset by the padding.
+    const Conv2dProblem *problem = &loop->problem;
+    const CONV_SCALAR *channel = (const CONV_SCALAR *)problem->image + n * problem->image_strides[0] + c * problem->image_strides[1];
+    for (long ih = 0; ih < problem->height && ih + problem->window->padding[0] < loop->fft_height; ih++)
+    {
+        double *grid_row = re + (ih + problem->window->padding[0]) * loop->fft_width + problem->window->padding[1];
+        const CONV_SCALAR *image_row = channel + ih * problem->image_strides[2];
+        long row_length = min_long(problem->width, loop->fft_width - problem->window->padding[1]);
+        for (long iw = 0; iw < row_length; iw++)
+        {
+            grid_row[iw] = image_row[iw * problem->image_strides[3]];
+        }
+    }
+}
+
+static void CONV(fft_load_kernel)(const FFTLoop *loop, long o, long c, double *re)
+{
+    // Places the (dilated) kernel of output channel o and channel c at the origin of the (zeroed) grid.
+    const Conv2dProblem *problem = &loop->problem;
+    const TensorBaseConv2dWindow *window = problem->window;
+    const CONV_SCALAR *weight = (const CONV_SCALAR *)problem->weight + o * problem->weight_strides[0];
+    long kernel_area = window->kernel_size[0] * window->kernel_size[1];
+    for (long k = 0; k < kernel_area; k++)
+    {
+        long row = k / window->kernel_size[1] * window->dilation[0];
+        long col = k % window->kernel_size[1] * window->dilation[1];
+        re[row * loop->fft_width + col] = weight[(c * kernel_area + k) * problem->weight_strides[1]];
+    }
+}
+
+static void CONV(fft_store_output)(const FFTLoop *loop, long n, long o, const double *re)
+{
+    // Writes the (strided) samples of the inverse transform into output plane (n, o), scaled by 1 / (grid size).
+    const Conv2dProblem *problem = &loop->problem;
+    const TensorBaseConv2dWindow *window = problem->window;
+    CONV_SCALAR *plane = (CONV_SCALAR *)problem->out + (n * problem->out_channels + o) * problem->out_height * problem->out_width;
+    double scale = 1.0 / (loop->fft_height * loop->fft_width);
+    double b = problem->bias == NULL ? 0 : ((const CONV_SCALAR *)problem->bias)[o * problem->bias_stride];
+    for (long oh = 0; oh < problem->out_height; oh++)
+    {
+        const double *grid_row = re + oh * window->stride[0] * loop->fft_width;
+        for (long ow = 0; ow < problem->out_width; ow++)
+        {
+            plane[oh * problem->out_width + ow] = (CONV_SCALAR)(grid_row[ow * window->stride[1]] * scale + b);
+        }
+    }
+}
+
+#undef CONV
+#undef CONV_NAME
+#undef CONV_NAME_
@@ -0,0 +1,180 @@
+#include "tensorbase.h"
+#include "tensorbase_util.c"
+
+// Runtime dispatch of the elementwise kernels.
+// The kernel template (tensorbase_kernels.c) is compiled for every floating point dtype, once for the baseline instruction set of the
+// platform and, on x86-64, once more for each wider vector extension. The best variant supported by the CPU is selected
+// once (at module initialization) and stored in dispatch tables indexed by DType and by BinaryScalarOperation or
+// UnaryScalarOperation.
+
+#define NUM_BINARY_SCALAR_OPERATIONS (SCALAR_GEQ + 1)
+#define NUM_UNARY_SCALAR_OPERATIONS (SCALAR_RELU + 1)
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define TB_X86_DISPATCH 1
+#else
+#define TB_X86_DISPATCH 0
+#endif
+
+// The baseline variant (SSE2 on x86-64, NEON on arm64).
+#define KERNEL_ISA baseline
+#define KERNEL_TARGET
+#define KERNEL_DTYPE float64
+#define KERNEL_SCALAR double
+#define KERNEL_MATH_SUFFIX
+#include "tensorbase_kernels.c"
+#undef KERNEL_DTYPE
+#undef KERNEL_SCALAR
+#undef KERNEL_MATH_SUFFIX
+#define KERNEL_DTYPE float32
+#define KERNEL_SCALAR float
+#define KERNEL_MATH_SUFFIX f
+#include "tensorbase_kernels.c"
+#undef KERNEL_DTYPE
+#undef KERNEL_SCALAR
+#undef KERNEL_MATH_SUFFIX
+#undef KERNEL_ISA
+#undef KERNEL_TARGET
+
+#if TB_X86_DISPATCH
+#define KERNEL_ISA avx2
+#define KERNEL_TARGET __attribute__((target("avx2,fma")))
+#define KERNEL_DTYPE float64
+#define KERNEL_SCALAR double
+#define KERNEL_MATH_SUFFIX
+#include "tensorbase_kernels.c"
+#undef KERNEL_DTYPE
+#undef KERNEL_SCALAR
+#undef KERNEL_MATH_SUFFIX
+#define KERNEL_DTYPE float32
+#define KERNEL_SCALAR float
+#define KERNEL_MATH_SUFFIX f
+#include "tensorbase_kernels.c"
+#undef KERNEL_DTYPE
+#undef KERNEL_SCALAR
+#undef KERNEL_MATH_SUFFIX
+#undef KERNEL_ISA
+#undef KERNEL_TARGET
+
+#define KERNEL_ISA avx512
+#define KERNEL_TARGET __attribute__((target("avx512f,avx512dq")))
+#define KERNEL_DTYPE float64
+#define KERNEL_SCALAR double
+#define KERNEL_MATH_SUFFIX
+#include "tensorbase_kernels.c"
+#undef KERNEL_DTYPE
+#undef KERNEL_SCALAR
+#undef KERNEL_MATH_SUFFIX
+#define KERNEL_DTYPE float32
+#define KERNEL_SCALAR float
+#define KERNEL_MATH_SUFFIX f
+#include "tensorbase_kernels.c"
+#undef KERNEL_DTYPE
+#undef KERNEL_SCALAR
+#undef KERNEL_MATH_SUFFIX
+#undef KERNEL_ISA
+#undef KERNEL_TARGET
+#endif
+
+static BinaryKernel binary_kernels[NUM_DTYPES][NUM_BINARY_SCALAR_OPERATIONS];
+static UnaryKernel unary_kernels[NUM_DTYPES][NUM_UNARY_SCALAR_OPERATIONS];
+static BinaryKernel mask_multiply_kernels[NUM_DTYPES];
+static InstructionSet selected_instruction_set = TB_ISA_BASELINE;
+static bool kernels_initialized = false;
+static bool fast_math_enabled = false;
+
+static InstructionSet detect_instruction_set(void)
+{
+#if TB_X86_DISPATCH
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq"))
+    {
+        return TB_ISA_AVX512;
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    {
+        return TB_ISA_AVX2;
+    }
+#endif
+    return TB_ISA_BASELINE;
+}
+
+static void fill_kernel_tables(void)
+{
+    switch (selected_instruction_set)
+    {
+#if TB_X86_DISPATCH
+    case TB_ISA_AVX512:
+        fill_kernel_tables_avx512_float64(binary_kernels[TB_FLOAT64], unary_kernels[TB_FLOAT64], &mask_multiply_kernels[TB_FLOAT64], fast_math_enabled);
+        fill_kernel_tables_avx512_float32(binary_kernels[TB_FLOAT32], unary_kernels[TB_FLOAT32], &mask_multiply_kernels[TB_FLOAT32], fast_math_enabled);
+        break;
+    case TB_ISA_AVX2:
+        fill_kernel_tables_avx2_float64(binary_kernels[TB_FLOAT64], unary_kernels[TB_FLOAT64], &mask_multiply_kernels[TB_FLOAT64], fast_math_enabled);
+        fill_kernel_tables_avx2_float32(binary_kernels[TB_FLOAT32], unary_kernels[TB_FLOAT32], &mask_multiply_kernels[TB_FLOAT32], fast_math_enabled);
+        break;
+#endif
+    default:
+        fill_kernel_tables_baseline_float64(binary_kernels[TB_FLOAT64], unary_kernels[TB_FLOAT64], &mask_multiply_kernels[TB_FLOAT64], fast_math_enabled);
+        fill_kernel_tables_baseline_float32(binary_kernels[TB_FLOAT32], unary_kernels[TB_FLOAT32], &mask_multiply_kernels[TB_FLOAT32], fast_math_enabled);
+        break;
+    }
+}
+
+void TensorBase_init_kernels(void)
+{
+    selected_instruction_set = detect_instruction_set();
+    fill_kernel_tables();
+    kernels_initialized = true;
+}
+
+void TensorBase_set_fast_math(bool enabled)
+{
+    // The fast tier trades accuracy for speed in exp, log, tanh, sigmoid and pow (see tensorbase_math.c for the bounds).
+    if (!kernels_initialized)
+    {
+        TensorBase_init_kernels();
+    }
+    fast_math_enabled = enabled;
+    fill_kernel_tables();
+}
+
+bool TensorBase_get_fast_math(void)
+{
+    return fast_math_enabled;
+}
+
+InstructionSet TensorBase_get_instruction_set(void)
+{
+    if (!kernels_initialized)
+    {
+        TensorBase_init_kernels();
+    }
+    return selected_instruction_set;
+}
+
+BinaryKernel TensorBase_get_binary_kernel(BinaryScalarOperation binop, DType dtype)
+{
+    if (!kernels_initialized)
+    {
+        TensorBase_init_kernels();
+    }
+    return binary_kernels[dtype][binop];
+}
+
+UnaryKernel TensorBase_get_unary_kernel(UnaryScalarOperation uop, DType dtype)
+{
+    if (!kernels_initialized)
+    {
+        TensorBase_init_kernels();
+    }
+    return unary_kernels[dtype][uop];
+}
+
+BinaryKernel TensorBase_get_mask_multiply_kernel(DType dtype)
+{
+    if (!kernels_initialized)
+    {
+        TensorBase_init_kernels();
+    }
+    return mask_multiply_kernels[dtype];
+}
@@ -0,0 +1,100 @@
+#include "tensorbase.h"
+#include "tensorbase_util.c"
+
+// The GEMM engine computes out = A @ B for a (n x l) matrix A and a (l x m) matrix B.
+// It follows the classic Goto/BLIS design:
+// 1. The output is partitioned into column panels of width GEMM_NC (loop over `jc`).
+// 2. The shared dimension is partitioned into slabs of depth GEMM_KC (loop over `pc`), and
+//    the corresponding GEMM_KC x GEMM_NC block of B is packed into a contiguous buffer.
+// 3. The rows are partitioned into blocks of height GEMM_MC (loop over `ic`), and the
+//    corresponding GEMM_MC x GEMM_KC block of A is packed into a contiguous buffer.
+// 4. A register-blocked micro-kernel computes a GEMM_MR x GEMM_NR tile of the output
+//    from one micro-panel of packed A and one micro-panel of packed B.
+// Packing turns every strided access into a unit-stride stream, so the micro-kernel never
+// misses in cache regardless of the layout (or transposition) of the operands.
+// An optional epilogue, out = activation(A @ B + bias), is fused into the micro-kernel: it is
+// applied to each tile after its last slab of the shared dimension, before the tile is stored.
+
+// Register block (micro-tile) dimensions. The micro-kernel keeps a GEMM_MR x GEMM_NR tile of the output in registers.
+#define GEMM_MR 4
+#define GEMM_NR 8
+
+// Cache block dimensions.
+// * A GEMM_KC x GEMM_NR micro-panel of packed B (16KB of float64) stays resident in the L1 cache.
+// * A GEMM_MC x GEMM_KC block of packed A (256KB of float64) stays resident in the L2 cache.
+// * A GEMM_KC x GEMM_NC block of packed B (4MB of float64) stays resident in the L3 cache.
+#define GEMM_MC 128
+#define GEMM_KC 256
+#define GEMM_NC 2048
+
+// Products with fewer multiply-adds than this are computed directly, since packing would cost more than it saves.
+#define GEMM_SMALL_THRESHOLD (48 * 48 * 48)
+
+#define GEMM_DTYPE float64
+#define GEMM_SCALAR double
+#include "tensorbase_gemm_kernels.c"
+#undef GEMM_DTYPE
+#undef GEMM_SCALAR
+
+#define GEMM_DTYPE float32
+#define GEMM_SCALAR float
+#include "tensorbase_gemm_kernels.c"
+#undef GEMM_DTYPE
+#undef GEMM_SCALAR
+
+StatusCode TensorBase_gemm(DType dtype, long n, long l, long m,
+                           void *A, long a_row_stride, long a_col_stride,
+                           void *B, long b_row_stride, long b_col_stride,
+                           void *out, long out_row_stride)
+{
+    switch (dtype)
+    {
+    case TB_FLOAT32:
+        return gemm_float32(n, l, m, (float *)A, a_row_stride, a_col_stride, (float *)B, b_row_stride, b_col_stride, (float *)out, out_row_stride, NULL, NULL);
+    case TB_FLOAT64:
+        return gemm_float64(n, l, m, (double *)A, a_row_stride, a_col_stride, (double *)B, b_row_stride, b_col_stride, (double *)out, out_row_stride, NULL, NULL);
+    default:
+        return TB_UNSUPPORTED_DTYPE_ERROR;
+    }
+}
+
+StatusCode TensorBase_gemm_epilogue(DType dtype, long n, long l, long m,
+                                    void *A, long a_row_stride, long a_col_stride,
+                                    void *B, long b_row_stride, long b_col_stride,
+                                    void *out, long out_row_stride,
+                                    const void *bias, UnaryKernel activation)
+{
+    switch (dtype)
+    {
+    case TB_FLOAT32:
+        return gemm_float32(n, l, m, (float *)A, a_row_stride, a_col_stride, (float *)B, b_row_stride, b_col_stride, (float *)out, out_row_stride,
+                            (const float *)bias, activation);
+    case TB_FLOAT64:
+        return gemm_float64(n, l, m, (double *)A, a_row_stride, a_col_stride, (double *)B, b_row_stride, b_col_stride, (double *)out, out_row_stride,
+                            (const double *)bias, activation);
+    default:
+        return TB_UNSUPPORTED_DTYPE_ERROR;
+    }
+}
+
+StatusCode TensorBase_gemm_batched(DType dtype, long batch_count, long n, long l, long m,
+                                   void *A, const long *a_offsets, long a_row_stride, long a_col_stride,
+                                   void *B, const long *b_offsets, long b_row_stride, long b_col_stride,
+                                   void *out, long out_row_stride, long out_batch_stride)
+{
+    switch (dtype)
+    {
+    case TB_FLOAT32:
+        return gemm_batched_float32(batch_count, n, l, m,
+                                    (float *)A, a_offsets, a_row_stride, a_col_stride,
+                                    (float *)B, b_offsets, b_row_stride, b_col_stride,
+                                    (float *)out, out_row_stride, out_batch_stride);
+    case TB_FLOAT64:
+        return gemm_batched_float64(batch_count, n, l, m,
+                                    (double *)A, a_offsets, a_row_stride, a_col_stride,
+                                    (double *)B, b_offsets, b_row_stride, b_col_stride,
+                                    (double *)out, out_row_stride, out_batch_stride);
+    default:
+        return TB_UNSUPPORTED_DTYPE_ERROR;
+    }
+}
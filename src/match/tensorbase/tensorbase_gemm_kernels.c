@@ -0,0 +1,410 @@
+// GEMM kernel template.
+// This file is included once per dtype by tensorbase_gemm.c, with the following macros defined:
+// * GEMM_DTYPE: A suffix that makes the names of the generated functions unique (e.g., float32).
+// * GEMM_SCALAR: The C type of the elements (e.g., float).
+// The blocking parameters are shared by every dtype. A float32 block takes half the cache of a float64 one.
+
+#define GEMM_NAME_(name, dtype) name##_##dtype
+#define GEMM_NAME(name, dtype) GEMM_NAME_(name, dtype)
+#define GEMM(name) GEMM_NAME(name, GEMM_DTYPE)
+
+static void GEMM(gemm_pack_a)(long mc, long kc, GEMM_SCALAR *A, long a_row_stride, long a_col_stride, GEMM_SCALAR *packed)
+{
+    // Packs a mc x kc block of A into consecutive micro-panels of GEMM_MR rows.
+    // Within a micro-panel, the GEMM_MR elements of each column are contiguous, matching the order the micro-kernel reads them.
+    // Rows past the edge of the matrix are zero padded so the micro-kernel always operates on full panels.
+    for (long ir = 0; ir < mc; ir += GEMM_MR)
+    {
+        long mr = min_long(GEMM_MR, mc - ir);
+        GEMM_SCALAR *A_panel = A + ir * a_row_stride;
+        for (long p = 0; p < kc; p++)
+        {
+            long i = 0;
+            for (; i < mr; i++)
+            {
+                packed[i] = A_panel[i * a_row_stride + p * a_col_stride];
+            }
+            for (; i < GEMM_MR; i++)
+            {
+                packed[i] = 0;
+            }
+            packed += GEMM_MR;
+        }
+    }
+}
+
+static void GEMM(gemm_pack_b)(long kc, long nc, GEMM_SCALAR *B, long b_row_stride, long b_col_stride, GEMM_SCALAR *packed)
+{
+    // Packs a kc x nc block of B into consecutive micro-panels of GEMM_NR columns.
+    // Within a micro-panel, the GEMM_NR elements of each row are contiguous, matching the order the micro-kernel reads them.
+    // Columns past the edge of the matrix are zero padded so the micro-kernel always operates on full panels.
+    for (long jr = 0; jr < nc; jr += GEMM_NR)
+    {
+        long nr = min_long(GEMM_NR, nc - jr);
+        GEMM_SCALAR *B_panel = B + jr * b_col_stride;
+        for (long p = 0; p < kc; p++)
+        {
+            long j = 0;
+            for (; j < nr; j++)
+            {
+                packed[j] = B_panel[p * b_row_stride + j * b_col_stride];
+            }
+            for (; j < GEMM_NR; j++)
+            {
+                packed[j] = 0;
+            }
+            packed += GEMM_NR;
+        }
+    }
+}
+
+static void GEMM(gemm_epilogue)(GEMM_SCALAR *values, const GEMM_SCALAR *bias, UnaryKernel activation, long n)
+{
+    // values = activation(values + bias), for n consecutive elements of an output row.
+    if (bias != NULL)
+    {
+        for (long j = 0; j < n; j++)
+        {
+            values[j] += bias[j];
+        }
+    }
+    if (activation != NULL)
+    {
+        activation(values, values, n);
+    }
+}
+
+static void GEMM(gemm_micro_kernel)(long kc, const GEMM_SCALAR *restrict a, const GEMM_SCALAR *restrict b, GEMM_SCALAR *restrict out, long out_row_stride, long mr, long nr, bool accumulate,
+                                    const GEMM_SCALAR *bias, UnaryKernel activation)
+{
+    // Computes the GEMM_MR x GEMM_NR tile out (+)= a @ b, where `a` is a packed micro-panel of A and `b` is a packed micro-panel of B.
+    // The accumulator has compile-time dimensions so the compiler fully unrolls the inner loops and keeps the tile in vector registers.
+    // With a bias or an activation (only passed for the last slab of the shared dimension), the epilogue is applied to
+    // each row of the finished tile before it is stored, so the output is written once.
+    GEMM_SCALAR accumulator[GEMM_MR][GEMM_NR] = {{0}};
+
+    for (long p = 0; p < kc; p++)
+    {
+        for (long i = 0; i < GEMM_MR; i++)
+        {
+            GEMM_SCALAR a_value = a[i];
+            for (long j = 0; j < GEMM_NR; j++)
+            {
+                accumulator[i][j] += a_value * b[j];
+            }
+        }
+        a += GEMM_MR;
+        b += GEMM_NR;
+    }
+
+    if (bias != NULL || activation != NULL)
+    {
+        for (long i = 0; i < mr; i++)
+        {
+            GEMM_SCALAR *out_row = out + i * out_row_stride;
+            GEMM_SCALAR row[GEMM_NR];
+            for (long j = 0; j < nr; j++)
+            {
+                row[j] = accumulate ? out_row[j] + accumulator[i][j] : accumulator[i][j];
+            }
+            GEMM(gemm_epilogue)(row, bias, activation, nr);
+            memcpy(out_row, row, nr * sizeof(GEMM_SCALAR));
+        }
+        return;
+    }
+
+    // Write back only the part of the tile that lies within the output matrix.
+    for (long i = 0; i < mr; i++)
+    {
+        GEMM_SCALAR *out_row = out + i * out_row_stride;
+        if (accumulate)
+        {
+            for (long j = 0; j < nr; j++)
+            {
+                out_row[j] += accumulator[i][j];
+            }
+        }
+        else
+        {
+            for (long j = 0; j < nr; j++)
+            {
+                out_row[j] = accumulator[i][j];
+            }
+        }
+    }
+}
+
+static void GEMM(gemm_small)(long n, long l, long m, GEMM_SCALAR *A, long a_row_stride, long a_col_stride, GEMM_SCALAR *B, long b_row_stride, GEMM_SCALAR *out, long out_row_stride,
+                             const GEMM_SCALAR *bias, UnaryKernel activation)
+{
+    // Direct i-k-j product for small matrices (B must have unit column stride).
+    // The innermost loop streams a row of B and a row of the output with unit stride, so it vectorizes without packing.
+    // The epilogue is applied to each output row as soon as it is complete, while it is still in the L1 cache.
+    for (long i = 0; i < n; i++)
+    {
+        GEMM_SCALAR *restrict out_row = out + i * out_row_stride;
+        for (long j = 0; j < m; j++)
+        {
+            out_row[j] = 0;
+        }
+        for (long k = 0; k < l; k++)
+        {
+            GEMM_SCALAR a_value = A[i * a_row_stride + k * a_col_stride];
+            const GEMM_SCALAR *restrict B_row = B + k * b_row_stride;
+            for (long j = 0; j < m; j++)
+            {
+                out_row[j] += a_value * B_row[j];
+            }
+        }
+        GEMM(gemm_epilogue)(out_row, bias, activation, m);
+    }
+}
+
+typedef struct
+{
+    long n;
+    long kc;
+    long nc;
+    long row_panel_count;      // Number of row micro-panels per batch entry.
+    GEMM_SCALAR *A;                 // The top-left element of the kc-deep slab of A.
+    const long *a_offsets;     // Offset of A for every batch entry (NULL for a single product).
+    long a_row_stride;
+    long a_col_stride;
+    const GEMM_SCALAR *packed_B;
+    GEMM_SCALAR *out;               // The top-left element of the nc-wide column panel of the output.
+    long out_row_stride;
+    long out_batch_stride;
+    bool accumulate;
+    const GEMM_SCALAR *bias;        // The bias of the nc-wide column panel, or NULL (only set for the last slab).
+    UnaryKernel activation;         // The activation, or NULL (only set for the last slab).
+    StatusCode status;
+} GEMM(GemmRowPanelLoop);
+
+static void GEMM(gemm_row_panels)(void *context, long begin, long end)
+{
+    // Multiplies the row micro-panels [begin, end) with the packed block of B. Panels are numbered across the batch
+    // entries (entry-major), which all share the packed block of B. Each share of the loop packs its rows of A into
+    // its own buffer.
+    GEMM(GemmRowPanelLoop) *loop = (GEMM(GemmRowPanelLoop) *)context;
+    long kc = loop->kc;
+    long nc = loop->nc;
+
+    // The packed rows are zero padded to whole micro-panels.
+    long mc_max = min_long(GEMM_MC, (end - begin) * GEMM_MR);
+    size_t packed_A_size = mc_max * kc * sizeof(GEMM_SCALAR);
+    GEMM_SCALAR *packed_A = (GEMM_SCALAR *)TensorBase_cache_malloc(packed_A_size);
+    if (packed_A == NULL)
+    {
+        __atomic_store_n(&loop->status, TB_MALLOC_ERROR, __ATOMIC_RELAXED);
+        return;
+    }
+
+    long unit = begin;
+    while (unit < end)
+    {
+        long batch = unit / loop->row_panel_count;
+        long panel_begin = unit % loop->row_panel_count;
+        long panel_end = min_long(loop->row_panel_count, panel_begin + end - unit);
+        unit += panel_end - panel_begin;
+
+        GEMM_SCALAR *A = loop->A + (loop->a_offsets == NULL ? 0 : loop->a_offsets[batch]);
+        GEMM_SCALAR *out = loop->out + batch * loop->out_batch_stride;
+        long row_end = min_long(panel_end * GEMM_MR, loop->n);
+        for (long ic = panel_begin * GEMM_MR; ic < row_end; ic += GEMM_MC)
+        {
+            long mc = min_long(GEMM_MC, row_end - ic);
+
+            GEMM(gemm_pack_a)(mc, kc, A + ic * loop->a_row_stride, loop->a_row_stride, loop->a_col_stride, packed_A);
+
+            for (long jr = 0; jr < nc; jr += GEMM_NR)
+            {
+                long nr = min_long(GEMM_NR, nc - jr);
+                for (long ir = 0; ir < mc; ir += GEMM_MR)
+                {
+                    long mr = min_long(GEMM_MR, mc - ir);
+                    GEMM(gemm_micro_kernel)(kc,
+                                      packed_A + ir * kc,
+                                      loop->packed_B + jr * kc,
+                                      out + (ic + ir) * loop->out_row_stride + jr,
+                                      loop->out_row_stride,
+                                      mr,
+                                      nr,
+                                      loop->accumulate,
+                                      loop->bias == NULL ? NULL : loop->bias + jr,
+                                      loop->activation);
+                }
+            }
+        }
+    }
+
+    TensorBase_cache_free(packed_A, packed_A_size);
+}
+
+static StatusCode GEMM(gemm_packed)(long batch_count, long n, long l, long m,
+                                    GEMM_SCALAR *A, const long *a_offsets, long a_row_stride, long a_col_stride,
+                                    GEMM_SCALAR *B, long b_row_stride, long b_col_stride,
+                                    GEMM_SCALAR *out, long out_row_stride, long out_batch_stride,
+                                    const GEMM_SCALAR *bias, UnaryKernel activation)
+{
+    // The packed product of every batch entry of A with the same B (assumes n, l, m > 0).
+    // Every block of B is packed once, and the row micro-panels of all the entries are shared out between threads.
+    // The epilogue (bias and activation) is applied by the micro-kernel during the last slab of the shared dimension.
+
+    // Size the packing buffer of B to the largest block this product actually needs.
+    long kc_max = min_long(GEMM_KC, l);
+    long nc_max = min_long(GEMM_NC, (m + GEMM_NR - 1) / GEMM_NR * GEMM_NR);
+
+    size_t packed_B_size = kc_max * nc_max * sizeof(GEMM_SCALAR);
+    GEMM_SCALAR *packed_B = (GEMM_SCALAR *)TensorBase_cache_malloc(packed_B_size);
+    if (packed_B == NULL)
+    {
+        return TB_MALLOC_ERROR;
+    }
+
+    long row_panel_count = (n + GEMM_MR - 1) / GEMM_MR;
+    for (long jc = 0; jc < m; jc += GEMM_NC)
+    {
+        long nc = min_long(GEMM_NC, m - jc);
+        for (long pc = 0; pc < l; pc += GEMM_KC)
+        {
+            long kc = min_long(GEMM_KC, l - pc);
+
+            GEMM(gemm_pack_b)(kc, nc, B + pc * b_row_stride + jc * b_col_stride, b_row_stride, b_col_stride, packed_B);
+
+            // Each share of the loop gets at least PARALLEL_GRAIN_ELEMENTS multiply-adds. The first slab of the shared
+            // dimension initializes the output, later slabs accumulate into it, and the last one applies the epilogue.
+            bool last_slab = pc + kc >= l;
+            GEMM(GemmRowPanelLoop) loop = {n, kc, nc, row_panel_count, A + pc * a_col_stride, a_offsets, a_row_stride, a_col_stride,
+                                     packed_B, out + jc, out_row_stride, out_batch_stride, pc != 0,
+                                     last_slab && bias != NULL ? bias + jc : NULL, last_slab ? activation : NULL, TB_OK};
+            long grain = max_long(1, PARALLEL_GRAIN_ELEMENTS / (GEMM_MR * kc * nc));
+            TensorBase_parallel_for(batch_count * row_panel_count, grain, GEMM(gemm_row_panels), &loop);
+            if (loop.status != TB_OK)
+            {
+                TensorBase_cache_free(packed_B, packed_B_size);
+                return loop.status;
+            }
+        }
+    }
+
+    TensorBase_cache_free(packed_B, packed_B_size);
+    return TB_OK;
+}
+
+static StatusCode GEMM(gemm)(long n, long l, long m,
+                             GEMM_SCALAR *A, long a_row_stride, long a_col_stride,
+                             GEMM_SCALAR *B, long b_row_stride, long b_col_stride,
+                             GEMM_SCALAR *out, long out_row_stride,
+                             const GEMM_SCALAR *bias, UnaryKernel activation)
+{
+    // out = activation(A @ B + bias), where bias and activation may be NULL.
+    if (n <= 0 || m <= 0)
+    {
+        return TB_OK;
+    }
+
+    if (l <= 0)
+    {
+        // An empty shared dimension yields a matrix of zeros (before the epilogue).
+        for (long i = 0; i < n; i++)
+        {
+            memset(out + i * out_row_stride, 0, m * sizeof(GEMM_SCALAR));
+            GEMM(gemm_epilogue)(out + i * out_row_stride, bias, activation, m);
+        }
+        return TB_OK;
+    }
+
+    if (b_col_stride == 1 && n * l * m <= GEMM_SMALL_THRESHOLD)
+    {
+        GEMM(gemm_small)(n, l, m, A, a_row_stride, a_col_stride, B, b_row_stride, out, out_row_stride, bias, activation);
+        return TB_OK;
+    }
+
+    return GEMM(gemm_packed)(1, n, l, m, A, NULL, a_row_stride, a_col_stride, B, b_row_stride, b_col_stride, out, out_row_stride, 0,
+                             bias, activation);
+}
+
+typedef struct
+{
+    long n;
+    long l;
+    long m;
+    GEMM_SCALAR *A;
+    const long *a_offsets;
+    long a_row_stride;
+    long a_col_stride;
+    GEMM_SCALAR *B;
+    const long *b_offsets;
+    long b_row_stride;
+    long b_col_stride;
+    GEMM_SCALAR *out;
+    long out_row_stride;
+    long out_batch_stride;
+    StatusCode status;
+} GEMM(GemmBatchLoop);
+
+static void GEMM(gemm_batch_entries)(void *context, long begin, long end)
+{
+    // Computes the products of the batch entries [begin, end), one after the other.
+    GEMM(GemmBatchLoop) *loop = (GEMM(GemmBatchLoop) *)context;
+    for (long batch = begin; batch < end; batch++)
+    {
+        StatusCode status = GEMM(gemm)(loop->n, loop->l, loop->m,
+                                       loop->A + loop->a_offsets[batch], loop->a_row_stride, loop->a_col_stride,
+                                       loop->B + loop->b_offsets[batch], loop->b_row_stride, loop->b_col_stride,
+                                       loop->out + batch * loop->out_batch_stride, loop->out_row_stride, NULL, NULL);
+        if (status != TB_OK)
+        {
+            __atomic_store_n(&loop->status, status, __ATOMIC_RELAXED);
+            return;
+        }
+    }
+}
+
+static StatusCode GEMM(gemm_batched)(long batch_count, long n, long l, long m,
+                                     GEMM_SCALAR *A, const long *a_offsets, long a_row_stride, long a_col_stride,
+                                     GEMM_SCALAR *B, const long *b_offsets, long b_row_stride, long b_col_stride,
+                                     GEMM_SCALAR *out, long out_row_stride, long out_batch_stride)
+{
+    if (batch_count <= 0 || n <= 0 || m <= 0)
+    {
+        return TB_OK;
+    }
+
+    bool is_small = l <= 0 || (b_col_stride == 1 && n * l * m <= GEMM_SMALL_THRESHOLD);
+    bool b_is_shared = true;
+    for (long batch = 1; batch < batch_count && b_is_shared; batch++)
+    {
+        b_is_shared = b_offsets[batch] == b_offsets[0];
+    }
+
+    if (b_is_shared && !is_small)
+    {
+        // B is broadcast over the batch (e.g., activations @ weights): pack it once for every entry.
+        return GEMM(gemm_packed)(batch_count, n, l, m,
+                                 A, a_offsets, a_row_stride, a_col_stride,
+                                 B + b_offsets[0], b_row_stride, b_col_stride,
+                                 out, out_row_stride, out_batch_stride, NULL, NULL);
+    }
+
+    GEMM(GemmBatchLoop) loop = {n, l, m,
+                          A, a_offsets, a_row_stride, a_col_stride,
+                          B, b_offsets, b_row_stride, b_col_stride,
+                          out, out_row_stride, out_batch_stride, TB_OK};
+    if (batch_count < TensorBase_get_num_threads())
+    {
+        // Too few entries to go around: multiply them one after the other, each with every thread.
+        GEMM(gemm_batch_entries)(&loop, 0, batch_count);
+    }
+    else
+    {
+        // Share out whole entries. Each is then multiplied on a single thread (nested loops run serially).
+        long grain = max_long(1, PARALLEL_GRAIN_ELEMENTS / max_long(1, n * l * m));
+        TensorBase_parallel_for(batch_count, grain, GEMM(gemm_batch_entries), &loop);
+    }
+    return loop.status;
+}
+
+#undef GEMM
+#undef GEMM_NAME
+#undef GEMM_NAME_
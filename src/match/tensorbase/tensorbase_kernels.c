@@ -0,0 +1,265 @@
+// Elementwise kernel template.
+// This file is included once per instruction set and dtype by tensorbase_dispatch.c, with the following macros defined:
+// * KERNEL_ISA: A suffix that makes the names of the generated kernels unique (e.g., avx2).
+// * KERNEL_TARGET: A function attribute that lets the compiler use the instruction set (empty for the baseline).
+// * KERNEL_DTYPE: The dtype of the operands, which is also part of the names (e.g., float32).
+// * KERNEL_SCALAR: The C type of the dtype (e.g., float).
+// * KERNEL_MATH_SUFFIX: The suffix of the libm functions for KERNEL_SCALAR (f for float, empty for double).
+// The float32 kernels evaluate the transcendental functions of tensorbase_math.c in double precision and round the
+// result, which keeps them within 1 ULP of float32 while still vectorizing.
+// Every kernel hoists the operation out of its loop and is specialized for the common operand layouts, so the
+// compiler can vectorize each loop for the target instruction set.
+// Transcendental functions use the call-free implementations of tensorbase_math.c, so their loops vectorize too.
+
+#include "tensorbase_math.c"
+
+#define KERNEL_NAME_(name, isa, dtype) name##_##isa##_##dtype
+#define KERNEL_NAME(name, isa, dtype) KERNEL_NAME_(name, isa, dtype)
+#define KERNEL(name) KERNEL_NAME(name, KERNEL_ISA, KERNEL_DTYPE)
+#define KERNEL_MATH_(function, suffix) function##suffix
+#define KERNEL_MATH(function, suffix) KERNEL_MATH_(function, suffix)
+// The libm function for KERNEL_SCALAR (e.g., KERNEL_LIBM(floor) is floorf for float).
+#define KERNEL_LIBM(function) KERNEL_MATH(function, KERNEL_MATH_SUFFIX)
+
+// Defines out[i] = a[i * a_step] `op` b[i * b_step], where `expression` computes the result from `x` and `y`.
+// `a` is an array of KERNEL_SCALAR, while `b` and `out` are arrays of b_type and out_type.
+#define DEFINE_BINARY_KERNEL_TYPED(name, b_type, out_type, expression)                                                         \
+    KERNEL_TARGET static void KERNEL(binary_kernel_##name)(const void *a_data, long a_step, const void *b_data, long b_step, void *out_data, long n) \
+    {                                                                                                                          \
+        const KERNEL_SCALAR *a = (const KERNEL_SCALAR *)a_data;                                                                \
+        const b_type *b = (const b_type *)b_data;                                                                              \
+        out_type *out = (out_type *)out_data;                                                                                  \
+        if (a_step == 1 && b_step == 1)                                                                                        \
+        {                                                                                                                      \
+            for (long i = 0; i < n; i++)                                                                                       \
+            {                                                                                                                  \
+                KERNEL_SCALAR x = a[i];                                                                                        \
+                b_type y = b[i];                                                                                               \
+                out[i] = (out_type)(expression);                                                                               \
+            }                                                                                                                  \
+        }                                                                                                                      \
+        else if (a_step == 1 && b_step == 0)                                                                                   \
+        {                                                                                                                      \
+            b_type y = *b;                                                                                                     \
+            for (long i = 0; i < n; i++)                                                                                       \
+            {                                                                                                                  \
+                KERNEL_SCALAR x = a[i];                                                                                        \
+                out[i] = (out_type)(expression);                                                                               \
+            }                                                                                                                  \
+        }                                                                                                                      \
+        else if (a_step == 0 && b_step == 1)                                                                                   \
+        {                                                                                                                      \
+            KERNEL_SCALAR x = *a;                                                                                              \
+            for (long i = 0; i < n; i++)                                                                                       \
+            {                                                                                                                  \
+                b_type y = b[i];                                                                                               \
+                out[i] = (out_type)(expression);                                                                               \
+            }                                                                                                                  \
+        }                                                                                                                      \
+        else                                                                                                                   \
+        {                                                                                                                      \
+            for (long i = 0; i < n; i++)                                                                                       \
+            {                                                                                                                  \
+                KERNEL_SCALAR x = a[i * a_step];                                                                               \
+                b_type y = b[i * b_step];                                                                                      \
+                out[i] = (out_type)(expression);                                                                               \
+            }                                                                                                                  \
+        }                                                                                                                      \
+    }
+
+// Defines an arithmetic kernel, whose operands and output are arrays of KERNEL_SCALAR.
+#define DEFINE_BINARY_KERNEL(name, expression) DEFINE_BINARY_KERNEL_TYPED(name, KERNEL_SCALAR, KERNEL_SCALAR, expression)
+
+// Defines a comparison kernel, whose output is an array of bool.
+#define DEFINE_COMPARISON_KERNEL(name, expression) DEFINE_BINARY_KERNEL_TYPED(name, KERNEL_SCALAR, bool, expression)
+
+// Defines out[i] = uop(in[i]), where `expression` computes the result from `x`.
+#define DEFINE_UNARY_KERNEL(name, expression)                                                                     \
+    KERNEL_TARGET static void KERNEL(unary_kernel_##name)(const void *in_data, void *out_data, long n)           \
+    {                                                                                                             \
+        const KERNEL_SCALAR *in = (const KERNEL_SCALAR *)in_data;                                                 \
+        KERNEL_SCALAR *out = (KERNEL_SCALAR *)out_data;                                                           \
+        for (long i = 0; i < n; i++)                                                                              \
+        {                                                                                                         \
+            KERNEL_SCALAR x = in[i];                                                                              \
+            out[i] = (KERNEL_SCALAR)(expression);                                                                 \
+        }                                                                                                         \
+    }
+
+DEFINE_BINARY_KERNEL(add, x + y)
+DEFINE_BINARY_KERNEL(sub, x - y)
+DEFINE_BINARY_KERNEL(mult, x * y)
+DEFINE_BINARY_KERNEL(floordiv, KERNEL_LIBM(floor)(x / y))
+DEFINE_BINARY_KERNEL(truediv, x / y)
+DEFINE_BINARY_KERNEL(power_libm, KERNEL_LIBM(pow)(x, y))
+DEFINE_BINARY_KERNEL(power_fast, vm_pow_fast(x, y))
+DEFINE_COMPARISON_KERNEL(eq, x == y)
+DEFINE_COMPARISON_KERNEL(lt, x < y)
+DEFINE_COMPARISON_KERNEL(gt, x > y)
+DEFINE_COMPARISON_KERNEL(neq, x != y)
+DEFINE_COMPARISON_KERNEL(leq, x <= y)
+DEFINE_COMPARISON_KERNEL(geq, x >= y)
+
+// Multiplies by a bool mask (e.g., the gradient of relu), reading one byte per mask element. Converting the mask
+// instead of selecting keeps IEEE semantics (e.g., inf * false is nan). The mask is read as bytes and widened through
+// int32, since compilers vectorize that conversion but not the one from bool.
+DEFINE_BINARY_KERNEL_TYPED(mult_mask, uint8_t, KERNEL_SCALAR, x * (KERNEL_SCALAR)(int32_t)y)
+
+DEFINE_UNARY_KERNEL(negative, -x)
+DEFINE_UNARY_KERNEL(absolute, KERNEL_LIBM(fabs)(x))
+DEFINE_UNARY_KERNEL(cos, KERNEL_LIBM(cos)(x))
+DEFINE_UNARY_KERNEL(sin, KERNEL_LIBM(sin)(x))
+DEFINE_UNARY_KERNEL(tan, KERNEL_LIBM(tan)(x))
+DEFINE_UNARY_KERNEL(tanh, vm_tanh(x))
+DEFINE_UNARY_KERNEL(log, vm_log(x))
+DEFINE_UNARY_KERNEL(exp, vm_exp(x))
+DEFINE_UNARY_KERNEL(sigmoid, vm_sigmoid(x))
+DEFINE_UNARY_KERNEL(relu, x > 0 ? x : 0)
+
+DEFINE_UNARY_KERNEL(tanh_fast, vm_tanh_fast(x))
+DEFINE_UNARY_KERNEL(log_fast, vm_log_fast(x))
+DEFINE_UNARY_KERNEL(exp_fast, vm_exp_fast(x))
+DEFINE_UNARY_KERNEL(sigmoid_fast, vm_sigmoid_fast(x))
+
+KERNEL_TARGET static bool KERNEL(power_by_constant)(const KERNEL_SCALAR *a, long a_step, KERNEL_SCALAR y, KERNEL_SCALAR *out, long n)
+{
+    // Raises a contiguous operand to a constant exponent with a cheaper equivalent of pow, if one exists.
+    // The equivalents are exact for 0, 1, 2 and -1 (a single rounding, like pow), and within 1 ULP for 0.5 and -0.5.
+    // Returns false if the exponent or the layout has no specialization.
+    if (a_step != 1)
+    {
+        return false;
+    }
+
+    if (y == 2.0)
+    {
+        for (long i = 0; i < n; i++)
+        {
+            out[i] = a[i] * a[i];
+        }
+    }
+    else if (y == 1.0)
+    {
+        for (long i = 0; i < n; i++)
+        {
+            out[i] = a[i];
+        }
+    }
+    else if (y == 0.0)
+    {
+        for (long i = 0; i < n; i++)
+        {
+            out[i] = 1;
+        }
+    }
+    else if (y == -1.0)
+    {
+        for (long i = 0; i < n; i++)
+        {
+            out[i] = 1 / a[i];
+        }
+    }
+    else if (y == 0.5)
+    {
+        // pow(-0, 0.5) = +0 and pow(-inf, 0.5) = +inf, while sqrt returns -0 and nan.
+        for (long i = 0; i < n; i++)
+        {
+            KERNEL_SCALAR x = a[i];
+            out[i] = x == -INFINITY ? INFINITY : KERNEL_LIBM(sqrt)(x) + 0;
+        }
+    }
+    else if (y == -0.5)
+    {
+        for (long i = 0; i < n; i++)
+        {
+            KERNEL_SCALAR x = a[i];
+            out[i] = x == -INFINITY ? 0 : 1 / (KERNEL_LIBM(sqrt)(x) + 0);
+        }
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+KERNEL_TARGET static void KERNEL(binary_kernel_power)(const void *a_data, long a_step, const void *b_data, long b_step, void *out_data, long n)
+{
+    const KERNEL_SCALAR *a = (const KERNEL_SCALAR *)a_data;
+    const KERNEL_SCALAR *b = (const KERNEL_SCALAR *)b_data;
+    if (b_step == 0 && KERNEL(power_by_constant)(a, a_step, *b, (KERNEL_SCALAR *)out_data, n))
+    {
+        return;
+    }
+    KERNEL(binary_kernel_power_libm)(a_data, a_step, b_data, b_step, out_data, n);
+}
+
+KERNEL_TARGET static void KERNEL(binary_kernel_power_fast_math)(const void *a_data, long a_step, const void *b_data, long b_step, void *out_data, long n)
+{
+    const KERNEL_SCALAR *a = (const KERNEL_SCALAR *)a_data;
+    const KERNEL_SCALAR *b = (const KERNEL_SCALAR *)b_data;
+    if (b_step == 0 && KERNEL(power_by_constant)(a, a_step, *b, (KERNEL_SCALAR *)out_data, n))
+    {
+        return;
+    }
+
+    // exp(y * log(x)) is only valid for positive, finite operands. Other operands are rare, so they are detected up front
+    // (`out` may alias an operand) and fall back to pow instead of adding selects to the vectorized loop.
+    bool all_regular = true;
+    for (long i = 0; i < n; i++)
+    {
+        KERNEL_SCALAR x = a[i * a_step];
+        KERNEL_SCALAR y = b[i * b_step];
+        all_regular &= x > 0 && x < INFINITY && y > -INFINITY && y < INFINITY;
+    }
+
+    if (all_regular)
+    {
+        KERNEL(binary_kernel_power_fast)(a_data, a_step, b_data, b_step, out_data, n);
+    }
+    else
+    {
+        KERNEL(binary_kernel_power_libm)(a_data, a_step, b_data, b_step, out_data, n);
+    }
+}
+
+// Fills the rows of the dispatch tables for KERNEL_DTYPE.
+static void KERNEL(fill_kernel_tables)(BinaryKernel *binary_kernels, UnaryKernel *unary_kernels, BinaryKernel *mask_multiply_kernel, bool fast_math)
+{
+    *mask_multiply_kernel = KERNEL(binary_kernel_mult_mask);
+
+    binary_kernels[SCALAR_ADD] = KERNEL(binary_kernel_add);
+    binary_kernels[SCALAR_SUB] = KERNEL(binary_kernel_sub);
+    binary_kernels[SCALAR_MULT] = KERNEL(binary_kernel_mult);
+    binary_kernels[SCALAR_FLOORDIV] = KERNEL(binary_kernel_floordiv);
+    binary_kernels[SCALAR_TRUEDIV] = KERNEL(binary_kernel_truediv);
+    binary_kernels[SCALAR_POWER] = fast_math ? KERNEL(binary_kernel_power_fast_math) : KERNEL(binary_kernel_power);
+    binary_kernels[SCALAR_EQ] = KERNEL(binary_kernel_eq);
+    binary_kernels[SCALAR_LT] = KERNEL(binary_kernel_lt);
+    binary_kernels[SCALAR_GT] = KERNEL(binary_kernel_gt);
+    binary_kernels[SCALAR_NEQ] = KERNEL(binary_kernel_neq);
+    binary_kernels[SCALAR_LEQ] = KERNEL(binary_kernel_leq);
+    binary_kernels[SCALAR_GEQ] = KERNEL(binary_kernel_geq);
+
+    unary_kernels[SCALAR_NEGATIVE] = KERNEL(unary_kernel_negative);
+    unary_kernels[SCALAR_ABSOLUTE] = KERNEL(unary_kernel_absolute);
+    unary_kernels[SCALAR_COS] = KERNEL(unary_kernel_cos);
+    unary_kernels[SCALAR_SIN] = KERNEL(unary_kernel_sin);
+    unary_kernels[SCALAR_TAN] = KERNEL(unary_kernel_tan);
+    unary_kernels[SCALAR_TANH] = fast_math ? KERNEL(unary_kernel_tanh_fast) : KERNEL(unary_kernel_tanh);
+    unary_kernels[SCALAR_LOG] = fast_math ? KERNEL(unary_kernel_log_fast) : KERNEL(unary_kernel_log);
+    unary_kernels[SCALAR_EXP] = fast_math ? KERNEL(unary_kernel_exp_fast) : KERNEL(unary_kernel_exp);
+    unary_kernels[SCALAR_SIGMOID] = fast_math ? KERNEL(unary_kernel_sigmoid_fast) : KERNEL(unary_kernel_sigmoid);
+    unary_kernels[SCALAR_RELU] = KERNEL(unary_kernel_relu);
+}
+
+#undef DEFINE_BINARY_KERNEL
+#undef DEFINE_BINARY_KERNEL_TYPED
+#undef DEFINE_COMPARISON_KERNEL
+#undef DEFINE_UNARY_KERNEL
+#undef KERNEL
+#undef KERNEL_NAME
+#undef KERNEL_NAME_
+#undef KERNEL_LIBM
+#undef KERNEL_MATH
+#undef KERNEL_MATH_
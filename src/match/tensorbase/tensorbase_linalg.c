@@ -1,92 +1,347 @@
 #include "tensorbase.h"
 #include "tensorbase_util.c"
 
+// Number of elements of a strided run gathered into a contiguous buffer for the unary kernels.
+#define UNARY_GATHER_BLOCK 256
+
+typedef struct
+{
+    BinaryKernel kernel;
+    DType lhs_dtype;
+    const void *lhs;
+    long lhs_step;
+    DType rhs_dtype;
+    const void *rhs;
+    long rhs_step;
+    DType out_dtype;
+    void *out;
+} BinaryLoop;
+
+static void binary_op_contiguous_range(void *context, long begin, long end)
+{
+    BinaryLoop *loop = (BinaryLoop *)context;
+    loop->kernel(data_at(loop->lhs_dtype, loop->lhs, begin * loop->lhs_step), loop->lhs_step,
+                 data_at(loop->rhs_dtype, loop->rhs, begin * loop->rhs_step), loop->rhs_step,
+                 data_at(loop->out_dtype, loop->out, begin), end - begin);
+}
+
+static void binary_op_contiguous(BinaryKernel kernel,
+                                 DType lhs_dtype, const void *lhs, long lhs_step,
+                                 DType rhs_dtype, const void *rhs, long rhs_step,
+                                 DType out_dtype, void *out, long n)
+{
+    // out[i] = lhs[i * lhs_step] `op` rhs[i * rhs_step], where a step of 0 repeats a scalar operand.
+    // The operands and the output are arrays of their dtypes, which are the ones the kernel was retrieved for.
+    BinaryLoop loop = {kernel, lhs_dtype, lhs, lhs_step, rhs_dtype, rhs, rhs_step, out_dtype, out};
+    TensorBase_parallel_for(n, PARALLEL_GRAIN_ELEMENTS, binary_op_contiguous_range, &loop);
+}
+
+typedef struct
+{
+    BinaryKernel kernel;
+    DType lhs_dtype;
+    const void *lhs;
+    DType rhs_dtype;
+    const void *rhs;
+    DType out_dtype;
+    void *out;
+    bool out_follows_lhs; // The output is lhs itself (in place), with runs at lhs's data indices instead of contiguous.
+    BroadcastIterator it;
+    long segment_length; // Length of the segments the runs are split into.
+    long segment_count;  // Number of segments per run.
+} BinaryStridedLoop;
+
+static void binary_op_strided_segments(void *context, long begin, long end)
+{
+    BinaryStridedLoop *loop = (BinaryStridedLoop *)context;
+    BroadcastIterator it = loop->it;
+    long inner_dim = it.ndim - 1;
+    long run_length = it.shape[inner_dim];
+    long lhs_step = it.a_strides[inner_dim];
+    long rhs_step = it.b_strides[inner_dim];
+
+    BroadcastIterator_seek(&it, inner_dim, begin / loop->segment_count);
+    long segment = begin % loop->segment_count;
+    for (long segment_index = begin; segment_index < end; segment_index++)
+    {
+        long run_index = segment_index / loop->segment_count;
+        long segment_start = segment * loop->segment_length;
+        long segment_length = min_long(loop->segment_length, run_length - segment_start);
+        long out_index = loop->out_follows_lhs ? it.a_data_index + segment_start : run_index * run_length + segment_start;
+        loop->kernel(data_at(loop->lhs_dtype, loop->lhs, it.a_data_index + segment_start * lhs_step), lhs_step,
+                     data_at(loop->rhs_dtype, loop->rhs, it.b_data_index + segment_start * rhs_step), rhs_step,
+                     data_at(loop->out_dtype, loop->out, out_index), segment_length);
+
+        segment++;
+        if (segment == loop->segment_count)
+        {
+            segment = 0;
+            BroadcastIterator_next(&it, inner_dim);
+        }
+    }
+}
+
+static void binary_op_strided_run(BinaryStridedLoop *loop, long numel)
+{
+    // The innermost merged dimension is processed in runs by the kernel, with the operands' strides as steps
+    // (a step of 0 repeats the broadcasted element). The remaining dimensions are walked by the iterator.
+    // Long runs are split into segments, so that the threads can share them as well.
+    long run_length = loop->it.shape[loop->it.ndim - 1];
+    loop->segment_length = min_long(run_length, PARALLEL_GRAIN_ELEMENTS);
+    loop->segment_count = (run_length + loop->segment_length - 1) / loop->segment_length;
+    long segment_total = numel / run_length * loop->segment_count;
+    TensorBase_parallel_for(segment_total, max_long(1, PARALLEL_GRAIN_ELEMENTS / loop->segment_length), binary_op_strided_segments, loop);
+}
+
+static void binary_op_strided(BinaryKernel kernel,
+                              DType lhs_dtype, void *lhs_data, ShapeArray lhs_shape, StrideArray lhs_strides, long lhs_ndim,
+                              DType rhs_dtype, void *rhs_data, ShapeArray rhs_shape, StrideArray rhs_strides, long rhs_ndim,
+                              TensorBase *out)
+{
+    // out[c] = lhs[c] `op` rhs[c] for every coordinate c of out, where the operands may be broadcasted and have
+    // arbitrary strides (e.g., views). A scalar operand is passed with ndim 0.
+    if (out->numel == 0)
+    {
+        return;
+    }
+
+    BinaryStridedLoop loop = {kernel, lhs_dtype, lhs_data, rhs_dtype, rhs_data, out->dtype, out->data, false};
+    BroadcastIterator_init(&loop.it,
+                           lhs_shape, lhs_strides, lhs_ndim,
+                           rhs_shape, rhs_strides, rhs_ndim,
+                           out->shape, out->ndim);
+    binary_op_strided_run(&loop, out->numel);
+}
+
+static bool binary_op_strided_inplace(BinaryKernel kernel, TensorBase *lhs, DType rhs_dtype, void *rhs_data, ShapeArray rhs_shape, StrideArray rhs_strides, long rhs_ndim)
+{
+    // lhs[c] = lhs[c] `op` rhs[c] for every coordinate c of the (strided) lhs, with rhs broadcasted to lhs's shape.
+    // The kernels write contiguous runs, so this only applies if lhs's innermost merged dimension is contiguous; returns
+    // false (without writing anything) otherwise.
+    if (lhs->numel == 0)
+    {
+        return true;
+    }
+
+    BinaryStridedLoop loop = {kernel, lhs->dtype, lhs->data, rhs_dtype, rhs_data, lhs->dtype, lhs->data, true};
+    BroadcastIterator_init(&loop.it,
+                           lhs->shape, lhs->strides, lhs->ndim,
+                           rhs_shape, rhs_strides, rhs_ndim,
+                           lhs->shape, lhs->ndim);
+    if (loop.it.a_strides[loop.it.ndim - 1] != 1 && loop.it.shape[loop.it.ndim - 1] != 1)
+    {
+        return false;
+    }
+    binary_op_strided_run(&loop, lhs->numel);
+    return true;
+}
+
+typedef struct
+{
+    UnaryKernel kernel;
+    DType dtype;
+    const void *in;
+    void *out;
+} UnaryLoop;
+
+static void unary_op_contiguous_range(void *context, long begin, long end)
+{
+    UnaryLoop *loop = (UnaryLoop *)context;
+    loop->kernel(data_at(loop->dtype, loop->in, begin), data_at(loop->dtype, loop->out, begin), end - begin);
+}
+
+static void unary_op_contiguous(DType dtype, const void *in, void *out, long n, UnaryScalarOperation uop)
+{
+    // out[i] = uop(in[i]), where `in` and `out` are arrays of `dtype`.
+    UnaryLoop loop = {TensorBase_get_unary_kernel(uop, dtype), dtype, in, out};
+    TensorBase_parallel_for(n, PARALLEL_GRAIN_ELEMENTS, unary_op_contiguous_range, &loop);
+}
+
+typedef struct
+{
+    UnaryKernel kernel;
+    DType dtype;
+    const void *in;
+    void *out;
+    BroadcastIterator it;
+} UnaryStridedLoop;
+
+static void unary_op_strided_runs(void *context, long begin, long end)
+{
+    UnaryStridedLoop *loop = (UnaryStridedLoop *)context;
+    BroadcastIterator it = loop->it;
+    long inner_dim = it.ndim - 1;
+    long run_length = it.shape[inner_dim];
+    long in_step = it.a_strides[inner_dim];
+    long out_step = it.b_strides[inner_dim];
+
+    size_t element_size = TensorBase_dtype_size(loop->dtype);
+    double buffer[UNARY_GATHER_BLOCK]; // Large enough for a block of any dtype.
+    BroadcastIterator_seek(&it, inner_dim, begin);
+    for (long run_index = begin; run_index < end; run_index++)
+    {
+        const void *in_run = data_at(loop->dtype, loop->in, it.a_data_index);
+        void *out_run = data_at(loop->dtype, loop->out, it.b_data_index);
+        if (in_step == 1 && out_step == 1)
+        {
+            loop->kernel(in_run, out_run, run_length);
+        }
+        else
+        {
+            // The kernels need contiguous elements: gather a block, apply the kernel in place and scatter it.
+            for (long block_start = 0; block_start < run_length; block_start += UNARY_GATHER_BLOCK)
+            {
+                long block_length = min_long(UNARY_GATHER_BLOCK, run_length - block_start);
+                copy_run(element_size, data_at(loop->dtype, in_run, block_start * in_step), in_step, buffer, 1, block_length);
+                loop->kernel(buffer, buffer, block_length);
+                copy_run(element_size, buffer, 1, data_at(loop->dtype, out_run, block_start * out_step), out_step, block_length);
+            }
+        }
+        BroadcastIterator_next(&it, inner_dim);
+    }
+}
+
+static void unary_op_strided(DType dtype, void *in_data, StrideArray in_strides, void *out_data, StrideArray out_strides, ShapeArray shape, long ndim, UnaryScalarOperation uop)
+{
+    // out[c] = uop(in[c]) for every coordinate c of shape, where `in` and `out` are arrays of `dtype` with arbitrary strides.
+    long numel = 1;
+    for (long dim = 0; dim < ndim; dim++)
+    {
+        numel *= shape[dim];
+    }
+    if (numel == 0)
+    {
+        return;
+    }
+
+    UnaryStridedLoop loop = {TensorBase_get_unary_kernel(uop, dtype), dtype, in_data, out_data};
+    BroadcastIterator_init(&loop.it, shape, in_strides, ndim, shape, out_strides, ndim, shape, ndim);
+    long run_length = loop.it.shape[loop.it.ndim - 1];
+    TensorBase_parallel_for(numel / run_length, max_long(1, PARALLEL_GRAIN_ELEMENTS / run_length), unary_op_strided_runs, &loop);
+}
+
+static StatusCode binary_op_converted_scalar(TensorBase *a, scalar s, TensorBase *out, BinaryScalarOperation binop, bool scalar_is_lhs)
+{
+    // Integer and bool tensors are computed in float64.
+    TensorBase converted;
+    RETURN_IF_ERROR(TensorBase_to_dtype(a, TB_FLOAT64, &converted));
+    StatusCode status = scalar_is_lhs ? TensorBase_binary_op_scalar_tensorbase(&converted, s, out, binop)
+                                      : TensorBase_binary_op_tensorbase_scalar(&converted, s, out, binop);
+    TensorBase_dealloc(&converted);
+    return status;
+}
+
 StatusCode TensorBase_binary_op_tensorbase_scalar(TensorBase *a, scalar s, TensorBase *out, BinaryScalarOperation binop)
 {
-    RETURN_IF_ERROR(TensorBase_create_empty_like(a, out));
+    if (!TensorBase_is_floating_dtype(a->dtype))
+    {
+        return binary_op_converted_scalar(a, s, out, binop, false);
+    }
+
+    // The scalar is converted to the dtype of the tensor, which is also the dtype of the result (or bool, for comparisons).
+    DType out_dtype = is_comparison(binop) ? TB_BOOL : a->dtype;
+    RETURN_IF_ERROR(TensorBase_create_empty_with_dtype(a, out_dtype, out));
+    BinaryKernel kernel = TensorBase_get_binary_kernel(binop, a->dtype);
+    scalar s_element;
+    store_element(a->dtype, &s_element, 0, s);
 
     if (TensorBase_is_singleton(a))
     {
-        // Copy the bits of a->data into a_value.
-        scalar a_value;
-        memcpy(&a_value, &(a->data), sizeof(scalar));
-        // Compute the result of the operator.
-        scalar result;
-        apply_binop(binop, a_value, s, &result);
-        // Copy the bits of result into out->data.
-        memcpy(&(out->data), &result, sizeof(scalar));
+        // The value is held in the bits of the data pointers: out->data = a->data `op` s, with the same kernel as
+        // tensors so the results agree.
+        kernel(&a->data, 0, &s_element, 0, &out->data, 1);
+    }
+    else if (TensorBase_is_contiguous(a))
+    {
+        // out->data[i] = a->data[i] `op` s;
+        binary_op_contiguous(kernel, a->dtype, a->data, 1, a->dtype, &s_element, 0, out_dtype, out->data, out->numel);
     }
     else
     {
-        scalar *a_data = a->data;
-        scalar *out_data = out->data;
-        for (long i = 0; i < out->numel; i++)
-        {
-            apply_binop(binop, a_data[i], s, out_data + i); // out->data[i] = a->data[i] `op` s;
-        }
+        binary_op_strided(kernel, a->dtype, a->data, a->shape, a->strides, a->ndim, a->dtype, &s_element, a->shape, a->strides, 0, out);
     }
     return TB_OK;
 }
 
 StatusCode TensorBase_binary_op_scalar_tensorbase(TensorBase *a, scalar s, TensorBase *out, BinaryScalarOperation binop)
 {
-    RETURN_IF_ERROR(TensorBase_create_empty_like(a, out));
+    if (!TensorBase_is_floating_dtype(a->dtype))
+    {
+        return binary_op_converted_scalar(a, s, out, binop, true);
+    }
+
+    // The scalar is converted to the dtype of the tensor, which is also the dtype of the result (or bool, for comparisons).
+    DType out_dtype = is_comparison(binop) ? TB_BOOL : a->dtype;
+    RETURN_IF_ERROR(TensorBase_create_empty_with_dtype(a, out_dtype, out));
+    BinaryKernel kernel = TensorBase_get_binary_kernel(binop, a->dtype);
+    scalar s_element;
+    store_element(a->dtype, &s_element, 0, s);
 
     if (TensorBase_is_singleton(a))
     {
-        // Copy the bits of a->data into a_value.
-        scalar a_value;
-        memcpy(&a_value, &(a->data), sizeof(scalar));
-        // Compute the result of the operator.
-        scalar result;
-        apply_binop(binop, s, a_value, &result);
-        // Copy the bits of result into out->data.
-        memcpy(&(out->data), &result, sizeof(scalar));
+        // out->data = s `op` a->data, on the bits of the data pointers.
+        kernel(&s_element, 0, &a->data, 0, &out->data, 1);
+    }
+    else if (TensorBase_is_contiguous(a))
+    {
+        // out->data[i] = s `op` a->data[i];
+        binary_op_contiguous(kernel, a->dtype, &s_element, 0, a->dtype, a->data, 1, out_dtype, out->data, out->numel);
     }
     else
     {
-        scalar *a_data = a->data;
-        scalar *out_data = out->data;
-        for (long i = 0; i < out->numel; i++)
-        {
-            apply_binop(binop, s, a_data[i], out_data + i); // out->data[i] = s `op` a->data[i];
-        }
+        binary_op_strided(kernel, a->dtype, &s_element, a->shape, a->strides, 0, a->dtype, a->data, a->shape, a->strides, a->ndim, out);
     }
     return TB_OK;
 }
 
-StatusCode TensorBase_binary_op_tensorbase_tensorbase(TensorBase *lhs, TensorBase *rhs, TensorBase *out, BinaryScalarOperation binop)
+static StatusCode binary_op_promoted(TensorBase *lhs, TensorBase *rhs, TensorBase *out, BinaryScalarOperation binop)
 {
-    // If `lhs` is lhs singleton, perform operation as if `lhs` is a scalar.
-    if (TensorBase_is_singleton(lhs))
+    // Applies the operation to operands of different (or integer) dtypes by converting both to the promoted dtype first.
+    DType dtype = promote_dtypes(lhs->dtype, rhs->dtype);
+    TensorBase lhs_promoted, rhs_promoted;
+    RETURN_IF_ERROR(TensorBase_to_dtype(lhs, dtype, &lhs_promoted));
+    StatusCode status = TensorBase_to_dtype(rhs, dtype, &rhs_promoted);
+    if (status != TB_OK)
     {
-        scalar lhs_s;
-        memcpy(&lhs_s, &(lhs->data), sizeof(scalar));
-        // Yes, the flipped rhs/lhs ordering looks weird here.
-        return TensorBase_binary_op_scalar_tensorbase(rhs, lhs_s, out, binop);
+        TensorBase_dealloc(&lhs_promoted);
+        return status;
     }
+    status = TensorBase_binary_op_tensorbase_tensorbase(&lhs_promoted, &rhs_promoted, out, binop);
+    TensorBase_dealloc(&lhs_promoted);
+    TensorBase_dealloc(&rhs_promoted);
+    return status;
+}
 
-    // If `rhs` is a singleton, perform operation as if `rhs` is a scalar.
-    if (TensorBase_is_singleton(rhs))
+static void binary_op_write(BinaryKernel kernel, TensorBase *lhs, TensorBase *rhs, TensorBase *out)
+{
+    // out = lhs `op` rhs, written to the existing contiguous `out` of the broadcasted shape, whose dtype (like the
+    // operands') is the one the kernel was retrieved for. A singleton operand is a scalar.
+    bool lhs_matches = TensorBase_is_singleton(lhs) || (TensorBase_same_shape(lhs->shape, out->shape) && TensorBase_is_contiguous(lhs));
+    bool rhs_matches = TensorBase_is_singleton(rhs) || (TensorBase_same_shape(rhs->shape, out->shape) && TensorBase_is_contiguous(rhs));
+    if (lhs_matches && rhs_matches)
     {
-        scalar s;
-        memcpy(&s, &(rhs->data), sizeof(scalar));
-        return TensorBase_binary_op_tensorbase_scalar(lhs, s, out, binop);
+        // No broadcasting is required: out->data[i] = lhs->data[i] `op` rhs->data[i];
+        binary_op_contiguous(kernel,
+                             lhs->dtype, TensorBase_data_ptr(lhs), TensorBase_is_singleton(lhs) ? 0 : 1,
+                             rhs->dtype, TensorBase_data_ptr(rhs), TensorBase_is_singleton(rhs) ? 0 : 1,
+                             out->dtype, TensorBase_data_ptr(out), out->numel);
     }
+    else
+    {
+        binary_op_strided(kernel,
+                          lhs->dtype, TensorBase_data_ptr(lhs), lhs->shape, lhs->strides, lhs->ndim,
+                          rhs->dtype, TensorBase_data_ptr(rhs), rhs->shape, rhs->strides, rhs->ndim,
+                          out);
+    }
+}
 
+static StatusCode binary_op_tensors(BinaryKernel kernel, TensorBase *lhs, TensorBase *rhs, DType out_dtype, TensorBase *out)
+{
+    // Applies the kernel to two (non-singleton) tensors, whose dtypes are the ones the kernel was retrieved for.
     if (TensorBase_same_shape(lhs->shape, rhs->shape))
     {
         // They have the same shape, so no broadcasting is required.
-        RETURN_IF_ERROR(TensorBase_create_empty_like(lhs, out));
-
-        scalar *lhs_data = lhs->data;
-        scalar *rhs_data = rhs->data;
-        scalar *out_data = out->data;
-
-        for (long i = 0; i < out->numel; i++)
-        {
-            apply_binop(binop, lhs_data[i], rhs_data[i], out_data + i); // out->data[i] = lhs->data[i] `op` rhs->data[i];
-        }
+        RETURN_IF_ERROR(TensorBase_create_empty_with_dtype(lhs, out_dtype, out));
     }
     else
     {
@@ -95,30 +350,185 @@ StatusCode TensorBase_binary_op_tensorbase_tensorbase(TensorBase *lhs, TensorBas
         long broadcasted_tensor_ndim;
         RETURN_IF_ERROR(TensorBase_get_broadcast_shape(lhs->shape, lhs->ndim, rhs->shape, rhs->ndim, broadcasted_tensor_shape, &broadcasted_tensor_ndim));
 
-        RETURN_IF_ERROR(TensorBase_init(out, broadcasted_tensor_shape, broadcasted_tensor_ndim));
-        // Loop through each element in the broadcasted tensor's data.
-        for (long broadcasted_data_index = 0; broadcasted_data_index < out->numel; broadcasted_data_index++)
+        RETURN_IF_ERROR(TensorBase_init(out, broadcasted_tensor_shape, broadcasted_tensor_ndim, out_dtype));
+    }
+
+    binary_op_write(kernel, lhs, rhs, out);
+    return TB_OK;
+}
+
+StatusCode TensorBase_binary_op_tensorbase_tensorbase(TensorBase *lhs, TensorBase *rhs, TensorBase *out, BinaryScalarOperation binop)
+{
+    // A singleton is treated as a scalar, so the result has the dtype of the other operand (unless both are singletons).
+    if (TensorBase_is_singleton(lhs) && !(TensorBase_is_singleton(rhs) && lhs->dtype != rhs->dtype))
+    {
+        // Yes, the flipped rhs/lhs ordering looks weird here.
+        return TensorBase_binary_op_scalar_tensorbase(rhs, TensorBase_get_singleton_value(lhs), out, binop);
+    }
+
+    if (TensorBase_is_singleton(rhs) && !TensorBase_is_singleton(lhs))
+    {
+        return TensorBase_binary_op_tensorbase_scalar(lhs, TensorBase_get_singleton_value(rhs), out, binop);
+    }
+
+    if (binop == SCALAR_MULT && lhs->dtype == TB_BOOL && TensorBase_is_floating_dtype(rhs->dtype))
+    {
+        // Multiplication commutes, so the mask kernel reads the mask as its second operand.
+        return binary_op_tensors(TensorBase_get_mask_multiply_kernel(rhs->dtype), rhs, lhs, rhs->dtype, out);
+    }
+
+    if (binop == SCALAR_MULT && rhs->dtype == TB_BOOL && TensorBase_is_floating_dtype(lhs->dtype))
+    {
+        // A (broadcasted) mask is applied without converting it first.
+        return binary_op_tensors(TensorBase_get_mask_multiply_kernel(lhs->dtype), lhs, rhs, lhs->dtype, out);
+    }
+
+    if (lhs->dtype != rhs->dtype || !TensorBase_is_floating_dtype(lhs->dtype))
+    {
+        return binary_op_promoted(lhs, rhs, out, binop);
+    }
+
+    return binary_op_tensors(TensorBase_get_binary_kernel(binop, lhs->dtype), lhs, rhs, is_comparison(binop) ? TB_BOOL : lhs->dtype, out);
+}
+
+static StatusCode copy_result_into(TensorBase *result, TensorBase *out)
+{
+    // Copies `result`, which has the shape of `out`, into the existing elements of `out`, converted to its dtype.
+    TensorBase converted;
+    RETURN_IF_ERROR(TensorBase_to_dtype(result, out->dtype, &converted));
+    if (TensorBase_is_singleton(out))
+    {
+        out->data = converted.data;
+    }
+    else
+    {
+        copy_strided(out->dtype, converted.data, converted.strides, out->data, out->strides, out->shape, out->ndim);
+    }
+    TensorBase_dealloc(&converted);
+    return TB_OK;
+}
+
+StatusCode TensorBase_binary_op_inplace(TensorBase *lhs, TensorBase *rhs, BinaryScalarOperation binop)
+{
+    if (lhs == NULL || rhs == NULL)
+    {
+        return TB_NULL_INPUT_ERROR;
+    }
+
+    if (!TensorBase_is_floating_dtype(lhs->dtype) || is_comparison(binop))
+    {
+        // The result is floating point (or bool), which does not fit in the elements of lhs.
+        return TB_UNSUPPORTED_DTYPE_ERROR;
+    }
+
+    // rhs is broadcasted to the shape of lhs, which does not change.
+    ShapeArray broadcasted_shape;
+    long broadcasted_ndim;
+    RETURN_IF_ERROR(TensorBase_get_broadcast_shape(lhs->shape, lhs->ndim, rhs->shape, rhs->ndim, broadcasted_shape, &broadcasted_ndim));
+    if (broadcasted_ndim != lhs->ndim || !TensorBase_same_shape(broadcasted_shape, lhs->shape))
+    {
+        return TB_INCOMPATABLE_BROASCAST_SHAPES_ERROR;
+    }
+
+    // The kernel reads rhs in the dtype of lhs, except for a mask, which is multiplied without converting it. An rhs
+    // that overlaps lhs other than element for element is copied first, since lhs is overwritten while rhs is read.
+    bool is_mask = binop == SCALAR_MULT && rhs->dtype == TB_BOOL;
+    BinaryKernel kernel = is_mask ? TensorBase_get_mask_multiply_kernel(lhs->dtype) : TensorBase_get_binary_kernel(binop, lhs->dtype);
+    TensorBase operand;
+    if (!is_mask && rhs->dtype != lhs->dtype)
+    {
+        RETURN_IF_ERROR(TensorBase_to_dtype(rhs, lhs->dtype, &operand));
+    }
+    else if (TensorBase_shares_storage(lhs, rhs) && !TensorBase_same_layout(lhs, rhs))
+    {
+        RETURN_IF_ERROR(TensorBase_deepcopy(rhs, &operand));
+    }
+    else
+    {
+        RETURN_IF_ERROR(TensorBase_view(rhs, &operand));
+    }
+
+    StatusCode status = TB_OK;
+    if (TensorBase_is_singleton(lhs) || TensorBase_is_contiguous(lhs))
+    {
+        // Element i of lhs is element i of the output, so lhs is both the first operand and the output.
+        binary_op_write(kernel, lhs, &operand, lhs);
+    }
+    else if (!binary_op_strided_inplace(kernel, lhs, operand.dtype, TensorBase_data_ptr(&operand), operand.shape, operand.strides, operand.ndim))
+    {
+        // No dimension of lhs is contiguous (e.g., a strided slice): compute the result apart and copy it back.
+        TensorBase result;
+        status = TensorBase_create_empty_like(lhs, &result);
+        if (status == TB_OK)
         {
-            // Calculate the corresponding data index in each of the input tensors data array.
-            long lhs_data_index, rhs_data_index;
-            TensorBase_get_translated_data_indices_from_broadcasted_index(
-                /* a_shape= */ lhs->shape,
-                /* a_strides= */ lhs->strides,
-                /* a_ndim= */ lhs->ndim,
-                /* b_shape= */ rhs->shape,
-                /* b_strides= */ rhs->strides,
-                /* b_ndim= */ rhs->ndim,
-                /* broadcasted_shape= */ broadcasted_tensor_shape,
-                /* broadcasted_ndim= */ broadcasted_tensor_ndim,
-                /* broadcasted_data_index= */ broadcasted_data_index,
-                &lhs_data_index,
-                &rhs_data_index);
-
-            apply_binop(binop, lhs->data[lhs_data_index], rhs->data[rhs_data_index], out->data + broadcasted_data_index);
+            binary_op_write(kernel, lhs, &operand, &result);
+            copy_strided(lhs->dtype, result.data, result.strides, lhs->data, lhs->strides, lhs->shape, lhs->ndim);
+            TensorBase_dealloc(&result);
         }
     }
+    TensorBase_dealloc(&operand);
+    return status;
+}
 
-    return TB_OK;
+StatusCode TensorBase_binary_op_inplace_scalar(TensorBase *lhs, scalar s, BinaryScalarOperation binop)
+{
+    if (lhs == NULL)
+    {
+        return TB_NULL_INPUT_ERROR;
+    }
+
+    // The scalar is a singleton of the dtype of lhs.
+    TensorBase rhs;
+    ShapeArray shape;
+    RETURN_IF_ERROR(TensorBase_init(&rhs, shape, 0, lhs->dtype));
+    TensorBase_set_singleton_value(&rhs, s);
+    return TensorBase_binary_op_inplace(lhs, &rhs, binop);
+}
+
+StatusCode TensorBase_binary_op_out(TensorBase *lhs, TensorBase *rhs, TensorBase *out, BinaryScalarOperation binop)
+{
+    if (lhs == NULL || rhs == NULL || out == NULL)
+    {
+        return TB_NULL_INPUT_ERROR;
+    }
+
+    // `out` keeps its shape and dtype: it must have the broadcasted shape, and the result is converted to its dtype.
+    ShapeArray broadcasted_shape;
+    long broadcasted_ndim;
+    RETURN_IF_ERROR(TensorBase_get_broadcast_shape(lhs->shape, lhs->ndim, rhs->shape, rhs->ndim, broadcasted_shape, &broadcasted_ndim));
+    if (broadcasted_ndim != out->ndim || !TensorBase_same_shape(broadcasted_shape, out->shape))
+    {
+        return TB_SHAPE_MISMATCH_ERROR;
+    }
+
+    if (TensorBase_shares_storage(out, lhs) && TensorBase_same_layout(out, lhs) && TensorBase_is_floating_dtype(out->dtype) &&
+        out->dtype == lhs->dtype && !is_comparison(binop))
+    {
+        return TensorBase_binary_op_inplace(out, rhs, binop);
+    }
+
+    // The kernels write straight to a contiguous `out` that does not overlap the operands, if no conversion is needed.
+    bool writable = (TensorBase_is_singleton(out) || TensorBase_is_contiguous(out)) &&
+                    !TensorBase_shares_storage(out, lhs) && !TensorBase_shares_storage(out, rhs);
+    if (writable && TensorBase_is_floating_dtype(lhs->dtype))
+    {
+        if (binop == SCALAR_MULT && rhs->dtype == TB_BOOL && out->dtype == lhs->dtype)
+        {
+            binary_op_write(TensorBase_get_mask_multiply_kernel(lhs->dtype), lhs, rhs, out);
+            return TB_OK;
+        }
+        if (rhs->dtype == lhs->dtype && out->dtype == (is_comparison(binop) ? TB_BOOL : lhs->dtype))
+        {
+            binary_op_write(TensorBase_get_binary_kernel(binop, lhs->dtype), lhs, rhs, out);
+            return TB_OK;
+        }
+    }
+
+    TensorBase result;
+    RETURN_IF_ERROR(TensorBase_binary_op_tensorbase_tensorbase(lhs, rhs, &result, binop));
+    StatusCode status = copy_result_into(&result, out);
+    TensorBase_dealloc(&result);
+    return status;
 }
 
 StatusCode TensorBase_unary_op_inplace(TensorBase *in, UnaryScalarOperation uop)
@@ -128,23 +538,27 @@ StatusCode TensorBase_unary_op_inplace(TensorBase *in, UnaryScalarOperation uop)
         return TB_NULL_INPUT_ERROR;
     }
 
+    if (!TensorBase_is_floating_dtype(in->dtype))
+    {
+        // The result is floating point, which does not fit in the elements of an integer or bool tensor.
+        return TB_UNSUPPORTED_DTYPE_ERROR;
+    }
+
     if (TensorBase_is_singleton(in))
     {
-        // Copy the bits held in in->data into the scalar variable.
-        scalar in_value;
-        memcpy(&in_value, &(in->data), sizeof(scalar));
-        // Apply the unary operation: result = uop(in_value);
-        scalar result;
-        apply_uop(uop, in_value, &result);
-        // Copy the bits of result into out->data.
-        memcpy(&(in->data), &result, sizeof(scalar));
+        // Apply the unary operation to the value held in the bits of in->data, with the same kernel as tensors so the
+        // results agree.
+        TensorBase_get_unary_kernel(uop, in->dtype)(&in->data, &in->data, 1);
+    }
+    else if (TensorBase_is_contiguous(in))
+    {
+        // in->data[i] = uop(in->data[i]).
+        unary_op_contiguous(in->dtype, in->data, in->data, in->numel, uop);
     }
     else
     {
-        for (long i = 0; i < in->numel; i++)
-        {
-            apply_uop(uop, in->data[i], in->data + i); // in->data[i] = uop(in->data[i]).
-        }
+        // Update the elements of the view in place.
+        unary_op_strided(in->dtype, in->data, in->strides, in->data, in->strides, in->shape, in->ndim, uop);
     }
     return TB_OK;
 }
@@ -156,62 +570,104 @@ StatusCode TensorBase_unary_op(TensorBase *in, TensorBase *out, UnaryScalarOpera
         return TB_NULL_INPUT_ERROR;
     }
 
+    if (!TensorBase_is_floating_dtype(in->dtype))
+    {
+        // Integer and bool tensors are computed in float64.
+        TensorBase converted;
+        RETURN_IF_ERROR(TensorBase_to_dtype(in, TB_FLOAT64, &converted));
+        StatusCode status = TensorBase_unary_op(&converted, out, uop);
+        TensorBase_dealloc(&converted);
+        return status;
+    }
+
     RETURN_IF_ERROR(TensorBase_create_empty_like(in, out));
 
     if (TensorBase_is_singleton(in))
     {
-        // Copy the bits held in in->data into the scalar variable.
-        scalar in_value;
-        memcpy(&in_value, &(in->data), sizeof(scalar));
-        // Apply the unary operation: result = uop(in_value);
-        scalar result;
-        apply_uop(uop, in_value, &result);
-        // Copy the bits of result into bits of the out->data pointer.
-        memcpy(&(out->data), &result, sizeof(scalar));
+        // out->data = uop(in->data), on the bits of the data pointers.
+        TensorBase_get_unary_kernel(uop, in->dtype)(&in->data, &out->data, 1);
+    }
+    else if (TensorBase_is_contiguous(in))
+    {
+        // out->data[i] = uop(in->data[i]).
+        unary_op_contiguous(in->dtype, in->data, out->data, out->numel, uop);
     }
     else
     {
-        for (long i = 0; i < out->numel; i++)
-        {
-            apply_uop(uop, in->data[i], out->data + i); // out->data[i] = uop(in->data[i]).
-        }
+        unary_op_strided(in->dtype, in->data, in->strides, out->data, out->strides, in->shape, in->ndim, uop);
     }
     return TB_OK;
 }
 
-StatusCode TensorBase_matrix_multiply(TensorBase *lhs, TensorBase *rhs, TensorBase *out)
+static scalar dot_product(DType dtype, const void *a, long a_step, const void *b, long b_step, long n)
 {
-    if (lhs == NULL || rhs == NULL || out == NULL)
+    // sum(a[i * a_step] * b[i * b_step]) over i < n, accumulated in the dtype.
+    if (dtype == TB_FLOAT32)
     {
-        return TB_NULL_INPUT_ERROR;
+        const float *a_elements = (const float *)a;
+        const float *b_elements = (const float *)b;
+        float sum = 0;
+        for (long i = 0; i < n; i++)
+        {
+            sum += a_elements[i * a_step] * b_elements[i * b_step];
+        }
+        return sum;
     }
 
-    RETURN_IF_ERROR(TensorBase_initialize_for_matrix_multiplication(lhs, rhs, out));
+    const double *a_elements = (const double *)a;
+    const double *b_elements = (const double *)b;
+    double sum = 0;
+    for (long i = 0; i < n; i++)
+    {
+        sum += a_elements[i * a_step] * b_elements[i * b_step];
+    }
+    return sum;
+}
+
+static StatusCode matrix_multiply_write(TensorBase *lhs, TensorBase *rhs, TensorBase *out)
+{
+    // out = lhs @ rhs, written to the existing contiguous `out` of the right shape. The operands and `out` have the
+    // same floating point dtype.
+    DType dtype = out->dtype;
+
+    // The GEMM engine reads the operands through their row and column strides, so views (e.g., `.T`) are multiplied
+    // without a copy. A vector operand is a single row (lhs) or a single column (rhs).
+    long lhs_row_stride = lhs->ndim > 1 ? lhs->strides[lhs->ndim - 2] : 0;
+    long lhs_col_stride = lhs->strides[lhs->ndim - 1];
+    long rhs_row_stride = rhs->ndim > 1 ? rhs->strides[rhs->ndim - 2] : rhs->strides[0];
+    long rhs_col_stride = rhs->ndim > 1 ? rhs->strides[rhs->ndim - 1] : 0;
 
     if (lhs->ndim == 1 && rhs->ndim == 1)
     {
         // If both tensors are one dimensional, compute the dot product
-        scalar sum = 0;
-        for (long i = 0; i < lhs->numel; i++)
-        {
-            sum += lhs->data[i] * rhs->data[i];
-        }
-        memcpy(&out->data, &sum, sizeof(scalar));
+        TensorBase_set_singleton_value(out, dot_product(dtype, lhs->data, lhs_col_stride, rhs->data, rhs_row_stride, lhs->numel));
     }
     else if (lhs->ndim == 1 && rhs->ndim == 2)
     {
         // (a) @ (a, b) is interpreted as (1, a) @ (a, b).
-        matrix_multiply_2d(lhs->data, rhs->data, 1, lhs->shape[0] /* rhs->shape[0] */, rhs->shape[1], out->data);
+        long l = lhs->shape[0] /* rhs->shape[0] */, m = rhs->shape[1];
+        RETURN_IF_ERROR(TensorBase_gemm(dtype, 1, l, m,
+                                        lhs->data, lhs_row_stride, lhs_col_stride,
+                                        rhs->data, rhs_row_stride, rhs_col_stride,
+                                        out->data, m));
     }
     else if (lhs->ndim == 2 && rhs->ndim == 1)
     {
         // (a, b) @ (b) is interpreted as (a, b) @ (b, 1).
-        matrix_multiply_2d(lhs->data, rhs->data, lhs->shape[0], rhs->shape[0] /* lhs->shape[1] */, 1, out->data);
+        long n = lhs->shape[0], l = rhs->shape[0] /* lhs->shape[1] */;
+        RETURN_IF_ERROR(TensorBase_gemm(dtype, n, l, 1,
+                                        lhs->data, lhs_row_stride, lhs_col_stride,
+                                        rhs->data, rhs_row_stride, rhs_col_stride,
+                                        out->data, 1));
     }
     else if (lhs->ndim == 2 && rhs->ndim == 2)
     {
         // (a, b) @ (b, c) is interpreted normally.
-        matrix_multiply_2d(lhs->data, rhs->data, lhs->shape[0], lhs->shape[1] /* rhs->shape[0] */, rhs->shape[1], out->data);
+        long n = lhs->shape[0], l = lhs->shape[1] /* rhs->shape[0] */, m = rhs->shape[1];
+        RETURN_IF_ERROR(TensorBase_gemm(dtype, n, l, m,
+                                        lhs->data, lhs_row_stride, lhs_col_stride,
+                                        rhs->data, rhs_row_stride, rhs_col_stride,
+                                        out->data, m));
     }
     else
     {
@@ -250,28 +706,98 @@ StatusCode TensorBase_matrix_multiply(TensorBase *lhs, TensorBase *rhs, TensorBa
             m = rhs->shape[batch_dims_b + 1];
         }
 
-        // Loop through each element in the non matrix dimensions broadcasted tensor's data.
-        for (long broadcasted_data_index = 0; broadcasted_data_index < numel_in_batch_dims; broadcasted_data_index++)
+        // Walk the batch dimensions of the broadcasted output, collecting the offset of the corresponding matrix in
+        // each input. A broadcast batch dimension has a stride of 0, so its matrix repeats.
+        size_t batch_offsets_size = 2 * numel_in_batch_dims * sizeof(long);
+        long *batch_offsets = (long *)TensorBase_cache_malloc(batch_offsets_size);
+        if (batch_offsets == NULL)
+        {
+            return TB_MALLOC_ERROR;
+        }
+        long *lhs_offsets = batch_offsets;
+        long *rhs_offsets = batch_offsets + numel_in_batch_dims;
+        BroadcastIterator it;
+        BroadcastIterator_init(&it,
+                               lhs->shape, lhs->strides, batch_dims_a,
+                               rhs->shape, rhs->strides, batch_dims_b,
+                               out->shape, batch_dims);
+        for (long batch_index = 0; batch_index < numel_in_batch_dims; batch_index++)
         {
-            // For each element in the data index, calculate the corresponding
-            // element in each of the input tensors.
-            long lhs_data_index, rhs_data_index;
-            TensorBase_get_translated_data_indices_from_broadcasted_index(
-                /* a_shape= */ lhs->shape,
-                /* a_strides= */ lhs->strides,
-                /* a_ndim= */ batch_dims_a,
-                /* b_shape= */ rhs->shape,
-                /* b_strides= */ rhs->strides,
-                /* b_ndim= */ batch_dims_b,
-                /* broadcasted_shape= */ out->shape,
-                /* broadcasted_ndim= */ batch_dims,
-                /* broadcasted_data_index= */ broadcasted_data_index,
-                &lhs_data_index,
-                &rhs_data_index);
-
-            matrix_multiply_2d(lhs->data + lhs_data_index, rhs->data + rhs_data_index, n, l, m, out->data + broadcasted_data_index * n * m);
+            lhs_offsets[batch_index] = it.a_data_index;
+            rhs_offsets[batch_index] = it.b_data_index;
+            BroadcastIterator_next(&it, it.ndim);
         }
+
+        StatusCode status = TensorBase_gemm_batched(dtype, numel_in_batch_dims, n, l, m,
+                                                    lhs->data, lhs_offsets, lhs_row_stride, lhs_col_stride,
+                                                    rhs->data, rhs_offsets, rhs_row_stride, rhs_col_stride,
+                                                    out->data, m, n * m);
+        TensorBase_cache_free(batch_offsets, batch_offsets_size);
+        RETURN_IF_ERROR(status);
     }
 
     return TB_OK;
-}
\ No newline at end of file
+}
+
+StatusCode TensorBase_matrix_multiply(TensorBase *lhs, TensorBase *rhs, TensorBase *out)
+{
+    if (lhs == NULL || rhs == NULL || out == NULL)
+    {
+        return TB_NULL_INPUT_ERROR;
+    }
+
+    if (lhs->dtype != rhs->dtype || !TensorBase_is_floating_dtype(lhs->dtype))
+    {
+        // Multiply in the promoted dtype.
+        DType dtype = promote_dtypes(lhs->dtype, rhs->dtype);
+        TensorBase lhs_promoted, rhs_promoted;
+        RETURN_IF_ERROR(TensorBase_to_dtype(lhs, dtype, &lhs_promoted));
+        StatusCode status = TensorBase_to_dtype(rhs, dtype, &rhs_promoted);
+        if (status == TB_OK)
+        {
+            status = TensorBase_matrix_multiply(&lhs_promoted, &rhs_promoted, out);
+            TensorBase_dealloc(&rhs_promoted);
+        }
+        TensorBase_dealloc(&lhs_promoted);
+        return status;
+    }
+
+    RETURN_IF_ERROR(TensorBase_initialize_for_matrix_multiplication(lhs, rhs, out));
+    StatusCode status = matrix_multiply_write(lhs, rhs, out);
+    if (status != TB_OK)
+    {
+        TensorBase_dealloc(out);
+    }
+    return status;
+}
+
+StatusCode TensorBase_matrix_multiply_out(TensorBase *lhs, TensorBase *rhs, TensorBase *out)
+{
+    if (lhs == NULL || rhs == NULL || out == NULL)
+    {
+        return TB_NULL_INPUT_ERROR;
+    }
+
+    // `out` keeps its shape and dtype: it must have the shape of the product, which is converted to its dtype.
+    ShapeArray shape;
+    long ndim;
+    RETURN_IF_ERROR(matrix_multiplication_shape(lhs, rhs, shape, &ndim));
+    if (ndim != out->ndim || !TensorBase_same_shape(shape, out->shape))
+    {
+        return TB_SHAPE_MISMATCH_ERROR;
+    }
+
+    // The GEMM engine writes straight to a contiguous `out` that does not overlap the operands.
+    if (lhs->dtype == rhs->dtype && lhs->dtype == out->dtype && TensorBase_is_floating_dtype(out->dtype) &&
+        (TensorBase_is_singleton(out) || TensorBase_is_contiguous(out)) &&
+        !TensorBase_shares_storage(out, lhs) && !TensorBase_shares_storage(out, rhs))
+    {
+        return matrix_multiply_write(lhs, rhs, out);
+    }
+
+    TensorBase result;
+    RETURN_IF_ERROR(TensorBase_matrix_multiply(lhs, rhs, &result));
+    StatusCode status = copy_result_into(&result, out);
+    TensorBase_dealloc(&result);
+    return status;
+}
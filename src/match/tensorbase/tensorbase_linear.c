@@ -0,0 +1,258 @@
+#include "tensorbase.h"
+#include "tensorbase_util.c"
+
+// Fused linear layer: out = activation(in @ weight^T + bias).
+// The input is viewed as a (rows, in_features) matrix. The forward pass is a single GEMM, which reads the
+// (out_features, in_features) weight through its strides as its (in_features, out_features) transpose, and adds the
+// bias and applies the activation in its epilogue, so the output is written once. The backward pass computes the
+// gradient g of the GEMM's output (from the saved output) and the bias' gradient in one pass over the output's
+// gradient, followed by grad_in = g @ weight and grad_weight = g^T @ in, which read g^T through its strides.
+
+// Number of columns of the output's gradient whose bias gradients are accumulated together in the backward pass.
+#define LINEAR_COLUMN_BLOCK 256
+
+typedef struct
+{
+    const void *grad; // The gradient of the output.
+    const void *out;  // The output, from which the activation's gradient is computed.
+    void *grad_pre;   // The gradient of the GEMM's output (grad itself, without an activation).
+    void *grad_bias;  // The gradient of the bias, or NULL.
+    long rows;
+    long columns;
+    Activation activation;
+} LinearBackwardLoop;
+
+#define LINEAR_DTYPE float64
+#define LINEAR_SCALAR double
+#include "tensorbase_linear_kernels.c"
+#undef LINEAR_DTYPE
+#undef LINEAR_SCALAR
+
+#define LINEAR_DTYPE float32
+#define LINEAR_SCALAR float
+#include "tensorbase_linear_kernels.c"
+#undef LINEAR_DTYPE
+#undef LINEAR_SCALAR
+
+static StatusCode activation_kernel(Activation activation, DType dtype, UnaryKernel *kernel)
+{
+    // The elementwise kernel of the activation, or NULL for TB_ACTIVATION_NONE.
+    switch (activation)
+    {
+    case TB_ACTIVATION_NONE:
+        *kernel = NULL;
+        return TB_OK;
+    case TB_ACTIVATION_RELU:
+        *kernel = TensorBase_get_unary_kernel(SCALAR_RELU, dtype);
+        return TB_OK;
+    case TB_ACTIVATION_SIGMOID:
+        *kernel = TensorBase_get_unary_kernel(SCALAR_SIGMOID, dtype);
+        return TB_OK;
+    case TB_ACTIVATION_TANH:
+        *kernel = TensorBase_get_unary_kernel(SCALAR_TANH, dtype);
+        return TB_OK;
+    default:
+        return TB_NOT_IMPLEMENTED_ERROR;
+    }
+}
+
+static StatusCode check_linear_operands(TensorBase *in, TensorBase *weight, TensorBase *bias)
+{
+    // A (..., in_features) input, an (out_features, in_features) weight and an (out_features) bias, of one float dtype.
+    if (in->dtype != TB_FLOAT32 && in->dtype != TB_FLOAT64)
+    {
+        return TB_UNSUPPORTED_DTYPE_ERROR;
+    }
+    if (weight->dtype != in->dtype || (bias != NULL && bias->dtype != in->dtype))
+    {
+        return TB_UNSUPPORTED_DTYPE_ERROR;
+    }
+    if (in->ndim < 1 || weight->ndim != 2 || (bias != NULL && bias->ndim != 1))
+    {
+        return TB_INVALID_NDIM_ERROR;
+    }
+    if (in->shape[in->ndim - 1] != weight->shape[1] || (bias != NULL && bias->shape[0] != weight->shape[0]))
+    {
+        return TB_SHAPE_MISMATCH_ERROR;
+    }
+    return TB_OK;
+}
+
+static long linear_output_shape(TensorBase *in, TensorBase *weight, ShapeArray shape)
+{
+    // Fills the (..., out_features) shape of the output, and returns the number of rows of the input.
+    long rows = 1;
+    for (long d = 0; d < MAX_RANK; d++)
+    {
+        shape[d] = d < in->ndim ? in->shape[d] : -1;
+    }
+    for (long d = 0; d < in->ndim - 1; d++)
+    {
+        rows *= in->shape[d];
+    }
+    shape[in->ndim - 1] = weight->shape[0];
+    return rows;
+}
+
+StatusCode TensorBase_linear(TensorBase *in, TensorBase *weight, TensorBase *bias, Activation activation, TensorBase *out)
+{
+    if (in == NULL || weight == NULL || out == NULL)
+    {
+        return TB_NULL_INPUT_ERROR;
+    }
+    RETURN_IF_ERROR(check_linear_operands(in, weight, bias));
+    UnaryKernel kernel;
+    RETURN_IF_ERROR(activation_kernel(activation, in->dtype, &kernel));
+
+    ShapeArray shape;
+    long rows = linear_output_shape(in, weight, shape);
+    long in_features = weight->shape[1], out_features = weight->shape[0];
+
+    // The input and the bias are read as contiguous arrays, the weight through its strides.
+    TensorBase contiguous[2] = {0};
+    StatusCode status = TensorBase_contiguous(in, &contiguous[0]);
+    if (status == TB_OK && bias != NULL)
+    {
+        status = TensorBase_contiguous(bias, &contiguous[1]);
+    }
+    bool has_out = false;
+    if (status == TB_OK)
+    {
+        status = TensorBase_init(out, shape, in->ndim, in->dtype);
+        has_out = status == TB_OK;
+    }
+    if (status == TB_OK)
+    {
+        status = TensorBase_gemm_epilogue(in->dtype, rows, in_features, out_features,
+                                          TensorBase_data_ptr(&contiguous[0]), in_features, 1,
+                                          TensorBase_data_ptr(weight), weight->strides[1], weight->strides[0],
+                                          TensorBase_data_ptr(out), out_features,
+                                          bias == NULL ? NULL : TensorBase_data_ptr(&contiguous[1]), kernel);
+    }
+    if (status != TB_OK && has_out)
+    {
+        TensorBase_dealloc(out);
+    }
+
+    TensorBase_dealloc(&contiguous[0]);
+    TensorBase_dealloc(&contiguous[1]);
+    return status;
+}
+
+StatusCode TensorBase_linear_backward(TensorBase *in, TensorBase *weight, TensorBase *out, TensorBase *grad, Activation activation,
+                                      TensorBase *grad_in, TensorBase *grad_weight, TensorBase *grad_bias)
+{
+    if (in == NULL || weight == NULL || out == NULL || grad == NULL || grad_in == NULL || grad_weight == NULL)
+    {
+        return TB_NULL_INPUT_ERROR;
+    }
+    RETURN_IF_ERROR(check_linear_operands(in, weight, NULL));
+    UnaryKernel kernel;
+    RETURN_IF_ERROR(activation_kernel(activation, in->dtype, &kernel));
+    if (out->dtype != in->dtype || grad->dtype != in->dtype)
+    {
+        return TB_UNSUPPORTED_DTYPE_ERROR;
+    }
+    ShapeArray shape;
+    long rows = linear_output_shape(in, weight, shape);
+    long in_features = weight->shape[1], out_features = weight->shape[0];
+    if (out->ndim != in->ndim || !TensorBase_same_shape(out->shape, shape) ||
+        grad->ndim != in->ndim || !TensorBase_same_shape(grad->shape, shape))
+    {
+        return TB_SHAPE_MISMATCH_ERROR;
+    }
+
+    TensorBase contiguous[3] = {0};
+    TensorBase *operands[3] = {in, out, grad};
+    StatusCode status = TB_OK;
+    for (int i = 0; i < 3 && status == TB_OK; i++)
+    {
+        status = TensorBase_contiguous(operands[i], &contiguous[i]);
+    }
+
+    // Without an activation, the gradient of the GEMM's output is the gradient of the output.
+    LinearBackwardLoop loop = {0};
+    size_t grad_pre_size = rows * out_features * TensorBase_element_size(in->dtype);
+    if (status == TB_OK)
+    {
+        loop.grad = TensorBase_data_ptr(&contiguous[2]);
+        loop.out = TensorBase_data_ptr(&contiguous[1]);
+        loop.grad_pre = (void *)loop.grad;
+        if (activation != TB_ACTIVATION_NONE)
+        {
+            loop.grad_pre = TensorBase_cache_malloc(max_long(grad_pre_size, 1));
+            status = loop.grad_pre == NULL ? TB_MALLOC_ERROR : TB_OK;
+        }
+    }
+
+    bool has_grad_in = false, has_grad_weight = false;
+    if (status == TB_OK)
+    {
+        status = TensorBase_create_empty_like(&contiguous[0], grad_in);
+        has_grad_in = status == TB_OK;
+    }
+    if (status == TB_OK)
+    {
+        ShapeArray weight_shape = {out_features, in_features, -1, -1, -1, -1, -1, -1};
+        status = TensorBase_init(grad_weight, weight_shape, 2, in->dtype);
+        has_grad_weight = status == TB_OK;
+    }
+    if (status == TB_OK && grad_bias != NULL)
+    {
+        ShapeArray bias_shape = {out_features, -1, -1, -1, -1, -1, -1, -1};
+        status = TensorBase_init(grad_bias, bias_shape, 1, in->dtype);
+    }
+
+    if (status == TB_OK)
+    {
+        // One pass over the output's gradient for the activation's gradient and the bias' gradient.
+        loop.grad_bias = grad_bias == NULL ? NULL : TensorBase_data_ptr(grad_bias);
+        loop.rows = rows;
+        loop.columns = out_features;
+        loop.activation = activation;
+        if (activation != TB_ACTIVATION_NONE || grad_bias != NULL)
+        {
+            long blocks = (out_features + LINEAR_COLUMN_BLOCK - 1) / LINEAR_COLUMN_BLOCK;
+            long grain = max_long(1, PARALLEL_GRAIN_ELEMENTS / max_long(rows * LINEAR_COLUMN_BLOCK, 1));
+            TensorBase_parallel_for(blocks, grain, in->dtype == TB_FLOAT32 ? linear_backward_columns_float32 : linear_backward_columns_float64, &loop);
+        }
+
+        // grad_in = g @ weight, and grad_weight = g^T @ in.
+        status = TensorBase_gemm(in->dtype, rows, out_features, in_features,
+                                 loop.grad_pre, out_features, 1,
+                                 TensorBase_data_ptr(weight), weight->strides[0], weight->strides[1],
+                                 TensorBase_data_ptr(grad_in), in_features);
+        if (status == TB_OK)
+        {
+            status = TensorBase_gemm(in->dtype, out_features, rows, in_features,
+                                     loop.grad_pre, 1, out_features,
+                                     TensorBase_data_ptr(&contiguous[0]), in_features, 1,
+                                     TensorBase_data_ptr(grad_weight), in_features);
+        }
+        if (status != TB_OK && grad_bias != NULL)
+        {
+            TensorBase_dealloc(grad_bias);
+        }
+    }
+    if (status != TB_OK)
+    {
+        if (has_grad_in)
+        {
+            TensorBase_dealloc(grad_in);
+        }
+        if (has_grad_weight)
+        {
+            TensorBase_dealloc(grad_weight);
+        }
+    }
+
+    if (activation != TB_ACTIVATION_NONE && loop.grad_pre != NULL)
+    {
+        TensorBase_cache_free(loop.grad_pre, max_long(grad_pre_size, 1));
+    }
+    for (int i = 0; i < 3; i++)
+    {
+        TensorBase_dealloc(&contiguous[i]);
+    }
+    return status;
+}
@@ -0,0 +1,78 @@
+// Linear layer kernel template.
+// This file is included once per dtype by tensorbase_linear.c, with the following macros defined:
+// * LINEAR_DTYPE: A suffix that makes the names of the generated kernels unique (e.g., float32).
+// * LINEAR_SCALAR: The C type of the elements (e.g., float).
+// The inner loops are branch free, so the compiler vectorizes them.
+
+#define LINEAR_NAME_(name, dtype) name##_##dtype
+#define LINEAR_NAME(name, dtype) LINEAR_NAME_(name, dtype)
+#define LINEAR(name) LINEAR_NAME(name, LINEAR_DTYPE)
+
+static void LINEAR(linear_backward_columns)(void *context, long begin, long end)
+{
+    // Backward pass of the epilogue, over blocks of LINEAR_COLUMN_BLOCK columns of the (rows, columns) gradient of the
+    // output. The gradient of the GEMM's output, grad * activation'(out), is computed from the output and written to
+    // grad_pre (which is grad itself without an activation), and its column sums, the gradient of the bias, are
+    // accumulated in double. Each block sums its rows in order, so the result does not depend on the number of threads.
+    const LinearBackwardLoop *loop = (const LinearBackwardLoop *)context;
+    long columns = loop->columns;
+    double sums[LINEAR_COLUMN_BLOCK];
+    for (long block = begin; block < end; block++)
+    {
+        long first = block * LINEAR_COLUMN_BLOCK;
+        long n = min_long(LINEAR_COLUMN_BLOCK, columns - first);
+        memset(sums, 0, n * sizeof(double));
+
+        for (long row = 0; row < loop->rows; row++)
+        {
+            const LINEAR_SCALAR *grad = (const LINEAR_SCALAR *)loop->grad + row * columns + first;
+            const LINEAR_SCALAR *out = (const LINEAR_SCALAR *)loop->out + row * columns + first;
+            LINEAR_SCALAR *grad_pre = (LINEAR_SCALAR *)loop->grad_pre + row * columns + first;
+            switch (loop->activation)
+            {
+            case TB_ACTIVATION_RELU:
+                // Multiplying by the mask instead of selecting keeps IEEE semantics (e.g., inf * 0 is nan), like relu.
+                for (long i = 0; i < n; i++)
+                {
+                    grad_pre[i] = grad[i] * (LINEAR_SCALAR)(out[i] > 0);
+                }
+                break;
+            case TB_ACTIVATION_SIGMOID:
+                for (long i = 0; i < n; i++)
+                {
+                    grad_pre[i] = grad[i] * out[i] * (1 - out[i]);
+                }
+                break;
+            case TB_ACTIVATION_TANH:
+                for (long i = 0; i < n; i++)
+                {
+                    grad_pre[i] = grad[i] * (1 - out[i] * out[i]);
+                }
+                break;
+            default:
+                break;
+            }
+
+            if (loop->grad_bias != NULL)
+            {
+                for (long i = 0; i < n; i++)
+                {
+                    sums[i] += grad_pre[i];
+                }
+            }
+        }
+
+        if (loop->grad_bias != NULL)
+        {
+            LINEAR_SCALAR *grad_bias = (LINEAR_SCALAR *)loop->grad_bias + first;
+            for (long i = 0; i < n; i++)
+            {
+                grad_bias[i] = (LINEAR_SCALAR)sums[i];
+            }
+        }
+    }
+}
+
+#undef LINEAR_NAME_
+#undef LINEAR_NAME
+#undef LINEAR
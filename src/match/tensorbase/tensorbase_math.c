@@ -0,0 +1,242 @@
+#pragma once
+
+#include "tensorbase.h"
+#include <stdint.h>
+
+// Vectorizable transcendental functions.
+// libm evaluates one element per call, which prevents the compiler from vectorizing the elementwise kernels.
+// The functions below contain no calls or branches (special cases are handled with vm_select), so a loop over them
+// vectorizes for the AVX2 and AVX-512 kernel variants. (GCC does not vectorize the selects for plain SSE2, so the
+// x86-64 baseline variant evaluates them as branch-free scalar code.)
+//
+// Error bounds, measured against an extended precision (long double) reference over 10^7 random inputs per range:
+//
+// Accurate tier (the default):
+// * vm_exp:     < 1 ULP, including subnormal results. Overflows to inf and underflows to 0 like exp().
+// * vm_log:     < 1 ULP, including subnormal inputs. log(0) = -inf, log(x < 0) = nan and log(inf) = inf.
+// * vm_tanh:    < 1.5 ULP.
+// * vm_sigmoid: < 2.5 ULP, including subnormal results.
+//
+// Fast tier (opt-in with TensorBase_set_fast_math):
+// * vm_exp_fast:     relative error < 3e-10. Results for x < -708 flush to 0.
+// * vm_log_fast:     relative error < 3e-9.
+// * vm_tanh_fast:    absolute error < 2e-10 (the relative error grows as x approaches 0).
+// * vm_sigmoid_fast: relative error < 3e-10 for x >= -708.
+// * vm_pow_fast:     relative error of roughly 3e-9 * (1 + |y * log(x)|), for x > 0 only.
+
+static inline uint64_t vm_as_bits(double x)
+{
+    uint64_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    return bits;
+}
+
+static inline double vm_from_bits(uint64_t bits)
+{
+    double x;
+    memcpy(&x, &bits, sizeof(x));
+    return x;
+}
+
+static inline double vm_select(bool condition, double if_true, double if_false)
+{
+    // A bitwise select. Unlike `condition ? if_true : if_false`, the compiler cannot turn it back into a branch that
+    // skips computing the unselected value, which it would then refuse to vectorize (floating-point math may trap).
+    uint64_t mask = (uint64_t)0 - (uint64_t)condition;
+    return vm_from_bits((vm_as_bits(if_true) & mask) | (vm_as_bits(if_false) & ~mask));
+}
+
+// Adding (and then subtracting) 1.5 * 2^52 rounds a double of magnitude below 2^51 to the nearest integer, and
+// leaves that integer in the low bits of the sum's representation. This replaces double-to-integer conversions,
+// which most vector instruction sets lack for 64-bit integers.
+#define VM_ROUND_MAGIC 6755399441055744.0
+#define VM_ROUND_MAGIC_BITS 0x4338000000000000ULL
+
+// ln(2) split so that k * VM_LN2_HI is exact for |k| < 2^11 (Cody-Waite range reduction).
+#define VM_LN2_HI 6.93147180369123816490e-01
+#define VM_LN2_LO 1.90821492927058770002e-10
+#define VM_LOG2E 1.44269504088896338700e+00
+
+// 2^(k + offset), built directly from the exponent bits. `k_bits` is the representation of VM_ROUND_MAGIC + k.
+static inline double vm_pow2_from_round_bits(uint64_t k_bits)
+{
+    return vm_from_bits((k_bits - VM_ROUND_MAGIC_BITS + 1023) << 52);
+}
+
+static inline double vm_exp(double x)
+{
+    // Range reduction: x = k * ln(2) + r with |r| <= ln(2) / 2.
+    double k_rounded = x * VM_LOG2E + VM_ROUND_MAGIC;
+    double k = k_rounded - VM_ROUND_MAGIC;
+    double r = (x - k * VM_LN2_HI) - k * VM_LN2_LO;
+
+    // exp(r) = 1 + r + r^2 * q(r), where q is the Taylor polynomial of (exp(r) - 1 - r) / r^2 of degree 11
+    // (truncation error below 2^-60 for |r| <= ln(2) / 2). Adding the two leading terms last keeps the rounding error small.
+    double q = 1.0 / 6227020800.0;
+    q = q * r + 1.0 / 479001600.0;
+    q = q * r + 1.0 / 39916800.0;
+    q = q * r + 1.0 / 3628800.0;
+    q = q * r + 1.0 / 362880.0;
+    q = q * r + 1.0 / 40320.0;
+    q = q * r + 1.0 / 5040.0;
+    q = q * r + 1.0 / 720.0;
+    q = q * r + 1.0 / 120.0;
+    q = q * r + 1.0 / 24.0;
+    q = q * r + 1.0 / 6.0;
+    q = q * r + 0.5;
+    double p = 1.0 + (r + r * r * q);
+
+    // Scale by 2^k = 2^k1 * 2^(k - k1). Splitting k in half keeps both factors normal for every k in [-1076, 1024],
+    // so results that overflow, underflow or are subnormal are rounded exactly once, by the last multiplication.
+    double k1_rounded = k * 0.5 + VM_ROUND_MAGIC;
+    double k1 = k1_rounded - VM_ROUND_MAGIC;
+    double k2_rounded = (k - k1) + VM_ROUND_MAGIC;
+    double result = p * vm_pow2_from_round_bits(vm_as_bits(k1_rounded)) * vm_pow2_from_round_bits(vm_as_bits(k2_rounded));
+
+    // Beyond these bounds the result overflows to inf (or underflows to 0) and the scale factors above are meaningless.
+    // NaN fails both comparisons and propagates through r.
+    result = vm_select(x > 709.8, INFINITY, result);
+    result = vm_select(x < -746.0, 0.0, result);
+    return result;
+}
+
+static inline double vm_exp_fast(double x)
+{
+    double k_rounded = x * VM_LOG2E + VM_ROUND_MAGIC;
+    double k = k_rounded - VM_ROUND_MAGIC;
+    double r = (x - k * VM_LN2_HI) - k * VM_LN2_LO;
+
+    // Taylor polynomial of degree 8 (truncation error below 2.1e-10 for |r| <= ln(2) / 2).
+    double q = 1.0 / 40320.0;
+    q = q * r + 1.0 / 5040.0;
+    q = q * r + 1.0 / 720.0;
+    q = q * r + 1.0 / 120.0;
+    q = q * r + 1.0 / 24.0;
+    q = q * r + 1.0 / 6.0;
+    q = q * r + 0.5;
+    double p = 1.0 + (r + r * r * q);
+
+    // A single scale factor 2^(k - 1) is normal for k in [-1021, 1024]. Results outside that range are selected.
+    double result = p * vm_pow2_from_round_bits(vm_as_bits(k_rounded) - 1) * 2.0;
+    result = vm_select(x > 709.78, INFINITY, result);
+    result = vm_select(x < -708.0, 0.0, result);
+    return result;
+}
+
+// Coefficients of the minimax approximation of (log(1 + f) - 2s) / s with s = f / (2 + f) from fdlibm's e_log.c.
+#define VM_LG1 6.666666666666735130e-01
+#define VM_LG2 3.999999999940941908e-01
+#define VM_LG3 2.857142874366239149e-01
+#define VM_LG4 2.222219843214978396e-01
+#define VM_LG5 1.818357216161805012e-01
+#define VM_LG6 1.531383769920937332e-01
+#define VM_LG7 1.479819860511658591e-01
+
+// Decomposes a positive, finite x into x = 2^e * (1 + f) with 1 + f in [sqrt(1/2), sqrt(2)).
+static inline void vm_log_reduce(double x, double *e, double *f)
+{
+    // Scale subnormal inputs into the normal range.
+    bool is_subnormal = x < DBL_MIN;
+    x *= vm_select(is_subnormal, 18014398509481984.0 /* 2^54 */, 1.0);
+    uint64_t bits = vm_as_bits(x);
+
+    // The mantissa with the exponent of 1.0, in [1, 2).
+    double m = vm_from_bits((bits & 0x000fffffffffffffULL) | 0x3ff0000000000000ULL);
+    // The biased exponent, converted to a double through the same magic-number trick used for rounding.
+    double biased_exponent = vm_from_bits(((bits >> 52) & 0x7ff) | 0x4330000000000000ULL) - 4503599627370496.0 /* 2^52 */;
+
+    bool is_above_sqrt2 = m > M_SQRT2;
+    m *= vm_select(is_above_sqrt2, 0.5, 1.0);
+
+    *e = biased_exponent - 1023.0 + vm_select(is_above_sqrt2, 1.0, 0.0) - vm_select(is_subnormal, 54.0, 0.0);
+    *f = m - 1.0;
+}
+
+static inline double vm_log_special_cases(double x, double result)
+{
+    result = vm_select(x == 0, -INFINITY, result);
+    result = vm_select(x < 0, NAN, result);
+    result = vm_select(x == INFINITY, INFINITY, result);
+    result = vm_select(x != x, x, result); // NaN propagates.
+    return result;
+}
+
+static inline double vm_log(double x)
+{
+    double e, f;
+    vm_log_reduce(x, &e, &f);
+
+    // log(1 + f) = f - f^2 / 2 + s * (f^2 / 2 + R(s^2)), evaluated as in fdlibm.
+    double s = f / (2.0 + f);
+    double z = s * s;
+    double w = z * z;
+    double t1 = w * (VM_LG2 + w * (VM_LG4 + w * VM_LG6));
+    double t2 = z * (VM_LG1 + w * (VM_LG3 + w * (VM_LG5 + w * VM_LG7)));
+    double R = t2 + t1;
+    double half_f_squared = 0.5 * f * f;
+    double result = e * VM_LN2_HI - ((half_f_squared - (s * (half_f_squared + R) + e * VM_LN2_LO)) - f);
+
+    return vm_log_special_cases(x, result);
+}
+
+static inline double vm_log_fast(double x)
+{
+    double e, f;
+    vm_log_reduce(x, &e, &f);
+
+    // The same reduction with the series truncated after the fourth term.
+    double s = f / (2.0 + f);
+    double z = s * s;
+    double R = z * (VM_LG1 + z * (VM_LG2 + z * (VM_LG3 + z * VM_LG4)));
+    double half_f_squared = 0.5 * f * f;
+    double result = e * VM_LN2_HI - ((half_f_squared - (s * (half_f_squared + R) + e * VM_LN2_LO)) - f);
+
+    return vm_log_special_cases(x, result);
+}
+
+// Coefficients of the rational approximation of tanh on |x| < 0.625 from the Cephes library.
+#define VM_TANH_P0 -9.64399179425052238628E-1
+#define VM_TANH_P1 -9.92877231001918586564E1
+#define VM_TANH_P2 -1.61468768441708447952E3
+#define VM_TANH_Q0 1.12811678491632931402E2
+#define VM_TANH_Q1 2.23548839060100448583E3
+#define VM_TANH_Q2 4.84406305325125486048E3
+
+static inline double vm_tanh(double x)
+{
+    // For |x| >= 0.625, tanh(|x|) = 1 - 2 / (exp(2|x|) + 1) has no cancellation.
+    double e = vm_exp(2.0 * fabs(x));
+    double large = copysign(1.0 - 2.0 / (e + 1.0), x);
+
+    // For |x| < 0.625, tanh(x) = x + x * z * P(z) / Q(z) with z = x^2.
+    double z = x * x;
+    double p = (VM_TANH_P0 * z + VM_TANH_P1) * z + VM_TANH_P2;
+    double q = ((z + VM_TANH_Q0) * z + VM_TANH_Q1) * z + VM_TANH_Q2;
+    double small = copysign(fabs(x) + fabs(x) * z * (p / q), x);
+
+    return vm_select(fabs(x) < 0.625, small, large);
+}
+
+static inline double vm_tanh_fast(double x)
+{
+    double e = vm_exp_fast(2.0 * fabs(x));
+    return copysign(1.0 - 2.0 / (e + 1.0), x);
+}
+
+static inline double vm_sigmoid(double x)
+{
+    // Evaluating exp(-|x|) never overflows, so sigmoid(x) = e / (1 + e) stays accurate where the result is tiny.
+    double e = vm_exp(-fabs(x));
+    return vm_select(x >= 0, 1.0, e) / (1.0 + e);
+}
+
+static inline double vm_sigmoid_fast(double x)
+{
+    return 1.0 / (1.0 + vm_exp_fast(-x));
+}
+
+static inline double vm_pow_fast(double x, double y)
+{
+    // Only valid for x > 0. Callers must handle other bases separately.
+    return vm_exp_fast(y * vm_log_fast(x));
+}
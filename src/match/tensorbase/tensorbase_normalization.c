@@ -0,0 +1,334 @@
+#include "tensorbase.h"
+#include "tensorbase_util.c"
+
+// Fused layer normalization.
+// The operand is viewed as (rows, size) rows, where size is the number of elements of the normalized (trailing)
+// dimensions. The forward pass gathers the mean and variance of a row in one Welford pass, optionally adding a
+// residual on the way, and normalizes and applies γ and β in a second one, without any temporaries. The mean and the
+// reciprocal standard deviation of each row are saved for the backward pass, which writes the input's gradient in two
+// passes over each row and reduces the gradients of γ and β over fixed blocks of rows, so the result does not depend
+// on the number of threads.
+
+// Number of elements of a row reduced together (and kept in cache) before they are merged into the row's statistics.
+#define LAYER_NORM_CHUNK 256
+// Maximum number of blocks of rows whose gradients of γ and β are accumulated separately in the backward pass.
+#define LAYER_NORM_MAX_BLOCKS 32
+
+typedef struct
+{
+    const void *in;       // The input (forward), or the normalized input, i.e., the sum with the residual (backward).
+    const void *residual; // Added to the input before normalizing, or NULL.
+    void *sum;            // in + residual (forward, with a residual).
+    const void *weight;   // γ, or NULL.
+    const void *bias;     // β, or NULL.
+    const void *grad;     // The gradient of the output (backward).
+    void *out;            // The output (forward), or the gradient of the input (backward).
+    void *mean;           // The mean of every row.
+    void *rstd;           // 1 / sqrt(variance + eps) of every row.
+    long size;
+    long rows;
+    double eps;
+    long block_rows; // Rows per block (backward).
+    double *partials; // Σ grad * x̂ and Σ grad of every block, 2 * size elements each, or NULL (backward).
+} LayerNormLoop;
+
+#define LAYER_NORM_DTYPE float64
+#define LAYER_NORM_SCALAR double
+#define LAYER_NORM_MATH_SUFFIX
+#include "tensorbase_normalization_kernels.c"
+#undef LAYER_NORM_DTYPE
+#undef LAYER_NORM_SCALAR
+#undef LAYER_NORM_MATH_SUFFIX
+
+#define LAYER_NORM_DTYPE float32
+#define LAYER_NORM_SCALAR float
+#define LAYER_NORM_MATH_SUFFIX f
+#include "tensorbase_normalization_kernels.c"
+#undef LAYER_NORM_DTYPE
+#undef LAYER_NORM_SCALAR
+#undef LAYER_NORM_MATH_SUFFIX
+
+static StatusCode layer_norm_layout(TensorBase *in, long normalized_ndim, LayerNormLoop *loop)
+{
+    // Fills the (rows, size) view of `in` into the loop.
+    if (in == NULL)
+    {
+        return TB_NULL_INPUT_ERROR;
+    }
+    if (in->dtype != TB_FLOAT32 && in->dtype != TB_FLOAT64)
+    {
+        return TB_UNSUPPORTED_DTYPE_ERROR;
+    }
+    if (normalized_ndim < 1 || normalized_ndim > in->ndim)
+    {
+        return TB_INVALID_NDIM_ERROR;
+    }
+
+    memset(loop, 0, sizeof(LayerNormLoop));
+    loop->size = 1;
+    for (long d = in->ndim - normalized_ndim; d < in->ndim; d++)
+    {
+        loop->size *= in->shape[d];
+    }
+    loop->rows = loop->size == 0 ? 0 : in->numel / loop->size;
+    return TB_OK;
+}
+
+static StatusCode check_normalized_operand(TensorBase *in, long normalized_ndim, TensorBase *operand)
+{
+    // γ, β and their gradients have the shape of the normalized dimensions of `in`.
+    if (operand->dtype != in->dtype)
+    {
+        return TB_UNSUPPORTED_DTYPE_ERROR;
+    }
+    if (operand->ndim != normalized_ndim)
+    {
+        return TB_SHAPE_MISMATCH_ERROR;
+    }
+    for (long d = 0; d < normalized_ndim; d++)
+    {
+        if (operand->shape[d] != in->shape[in->ndim - normalized_ndim + d])
+        {
+            return TB_SHAPE_MISMATCH_ERROR;
+        }
+    }
+    return TB_OK;
+}
+
+static StatusCode init_row_statistics(TensorBase *in, long rows, TensorBase *statistics)
+{
+    ShapeArray shape = {rows};
+    return TensorBase_init(statistics, shape, 1, in->dtype);
+}
+
+static void run_layer_norm(LayerNormLoop *loop, long count, long elements_per_item, DType dtype,
+                           ParallelForBody float32_body, ParallelForBody float64_body)
+{
+    TensorBase_parallel_for(count, max_long(1, PARALLEL_GRAIN_ELEMENTS / max_long(elements_per_item, 1)),
+                            dtype == TB_FLOAT32 ? float32_body : float64_body, loop);
+}
+
+StatusCode TensorBase_layer_norm(TensorBase *in, TensorBase *residual, TensorBase *weight, TensorBase *bias, long normalized_ndim,
+                                 scalar eps, TensorBase *out, TensorBase *sum, TensorBase *mean, TensorBase *rstd)
+{
+    if (out == NULL || mean == NULL || rstd == NULL || (residual != NULL && sum == NULL))
+    {
+        return TB_NULL_INPUT_ERROR;
+    }
+
+    LayerNormLoop loop;
+    RETURN_IF_ERROR(layer_norm_layout(in, normalized_ndim, &loop));
+    if (residual != NULL)
+    {
+        if (residual->dtype != in->dtype)
+        {
+            return TB_UNSUPPORTED_DTYPE_ERROR;
+        }
+        if (residual->ndim != in->ndim || !TensorBase_same_shape(residual->shape, in->shape))
+        {
+            return TB_SHAPE_MISMATCH_ERROR;
+        }
+    }
+    if (weight != NULL)
+    {
+        RETURN_IF_ERROR(check_normalized_operand(in, normalized_ndim, weight));
+    }
+    if (bias != NULL)
+    {
+        RETURN_IF_ERROR(check_normalized_operand(in, normalized_ndim, bias));
+    }
+
+    // Contiguous views (or copies) of the operands, or zeroed (empty) tensors for the ones that are absent.
+    TensorBase contiguous[4] = {0};
+    TensorBase *operands[4] = {in, residual, weight, bias};
+    StatusCode status = TB_OK;
+    for (int i = 0; i < 4 && status == TB_OK; i++)
+    {
+        if (operands[i] != NULL)
+        {
+            status = TensorBase_contiguous(operands[i], &contiguous[i]);
+        }
+    }
+
+    bool has_out = false, has_sum = false, has_mean = false;
+    if (status == TB_OK)
+    {
+        status = TensorBase_create_empty_like(&contiguous[0], out);
+        has_out = status == TB_OK;
+    }
+    if (status == TB_OK && residual != NULL)
+    {
+        status = TensorBase_create_empty_like(&contiguous[0], sum);
+        has_sum = status == TB_OK;
+    }
+    if (status == TB_OK)
+    {
+        status = init_row_statistics(in, loop.rows, mean);
+        has_mean = status == TB_OK;
+    }
+    if (status == TB_OK)
+    {
+        status = init_row_statistics(in, loop.rows, rstd);
+    }
+
+    if (status == TB_OK)
+    {
+        loop.in = TensorBase_data_ptr(&contiguous[0]);
+        loop.residual = residual == NULL ? NULL : TensorBase_data_ptr(&contiguous[1]);
+        loop.sum = residual == NULL ? NULL : TensorBase_data_ptr(sum);
+        loop.weight = weight == NULL ? NULL : TensorBase_data_ptr(&contiguous[2]);
+        loop.bias = bias == NULL ? NULL : TensorBase_data_ptr(&contiguous[3]);
+        loop.out = TensorBase_data_ptr(out);
+        loop.mean = mean->data;
+        loop.rstd = rstd->data;
+        loop.eps = eps;
+        run_layer_norm(&loop, loop.rows, loop.size, in->dtype, layer_norm_rows_float32, layer_norm_rows_float64);
+    }
+    else
+    {
+        if (has_out)
+        {
+            TensorBase_dealloc(out);
+        }
+        if (has_sum)
+        {
+            TensorBase_dealloc(sum);
+        }
+        if (has_mean)
+        {
+            TensorBase_dealloc(mean);
+        }
+    }
+
+    for (int i = 0; i < 4; i++)
+    {
+        if (operands[i] != NULL)
+        {
+            TensorBase_dealloc(&contiguous[i]);
+        }
+    }
+    return status;
+}
+
+StatusCode TensorBase_layer_norm_backward(TensorBase *in, TensorBase *weight, TensorBase *mean, TensorBase *rstd, TensorBase *grad,
+                                          long normalized_ndim, TensorBase *grad_in, TensorBase *grad_weight, TensorBase *grad_bias)
+{
+    if (mean == NULL || rstd == NULL || grad == NULL || grad_in == NULL)
+    {
+        return TB_NULL_INPUT_ERROR;
+    }
+
+    LayerNormLoop loop;
+    RETURN_IF_ERROR(layer_norm_layout(in, normalized_ndim, &loop));
+    if (grad->dtype != in->dtype || mean->dtype != in->dtype || rstd->dtype != in->dtype)
+    {
+        return TB_UNSUPPORTED_DTYPE_ERROR;
+    }
+    if (grad->ndim != in->ndim || !TensorBase_same_shape(grad->shape, in->shape) ||
+        mean->ndim != 1 || mean->numel != loop.rows || rstd->ndim != 1 || rstd->numel != loop.rows)
+    {
+        return TB_SHAPE_MISMATCH_ERROR;
+    }
+    if (weight != NULL)
+    {
+        RETURN_IF_ERROR(check_normalized_operand(in, normalized_ndim, weight));
+    }
+
+    TensorBase contiguous[3] = {0};
+    TensorBase *operands[3] = {in, grad, weight};
+    StatusCode status = TB_OK;
+    for (int i = 0; i < 3 && status == TB_OK; i++)
+    {
+        if (operands[i] != NULL)
+        {
+            status = TensorBase_contiguous(operands[i], &contiguous[i]);
+        }
+    }
+
+    // The gradients of γ and β are accumulated in double, in up to LAYER_NORM_MAX_BLOCKS blocks of rows.
+    bool wants_partials = grad_weight != NULL || grad_bias != NULL;
+    loop.block_rows = max_long(1, (loop.rows + LAYER_NORM_MAX_BLOCKS - 1) / LAYER_NORM_MAX_BLOCKS);
+    long blocks = (loop.rows + loop.block_rows - 1) / loop.block_rows;
+    size_t partials_size = max_long(blocks, 1) * 2 * max_long(loop.size, 1) * sizeof(double);
+    if (status == TB_OK && wants_partials)
+    {
+        loop.partials = (double *)TensorBase_cache_malloc(partials_size);
+        status = loop.partials == NULL ? TB_MALLOC_ERROR : TB_OK;
+    }
+
+    bool has_grad_in = false, has_grad_weight = false;
+    if (status == TB_OK)
+    {
+        status = TensorBase_create_empty_like(&contiguous[0], grad_in);
+        has_grad_in = status == TB_OK;
+    }
+    ShapeArray normalized_shape;
+    for (long d = 0; d < normalized_ndim; d++)
+    {
+        normalized_shape[d] = in->shape[in->ndim - normalized_ndim + d];
+    }
+    if (status == TB_OK && grad_weight != NULL)
+    {
+        status = TensorBase_init(grad_weight, normalized_shape, normalized_ndim, in->dtype);
+        has_grad_weight = status == TB_OK;
+    }
+    if (status == TB_OK && grad_bias != NULL)
+    {
+        status = TensorBase_init(grad_bias, normalized_shape, normalized_ndim, in->dtype);
+    }
+
+    if (status == TB_OK)
+    {
+        loop.in = TensorBase_data_ptr(&contiguous[0]);
+        loop.grad = TensorBase_data_ptr(&contiguous[1]);
+        loop.weight = weight == NULL ? NULL : TensorBase_data_ptr(&contiguous[2]);
+        loop.out = TensorBase_data_ptr(grad_in);
+        loop.mean = TensorBase_data_ptr(mean);
+        loop.rstd = TensorBase_data_ptr(rstd);
+        run_layer_norm(&loop, blocks, loop.block_rows * loop.size, in->dtype,
+                       layer_norm_backward_blocks_float32, layer_norm_backward_blocks_float64);
+
+        // The blocks' partial sums are added up in order.
+        for (long i = 0; wants_partials && i < loop.size; i++)
+        {
+            double weight_sum = 0, bias_sum = 0;
+            for (long block = 0; block < blocks; block++)
+            {
+                weight_sum += loop.partials[2 * block * loop.size + i];
+                bias_sum += loop.partials[(2 * block + 1) * loop.size + i];
+            }
+            if (grad_weight != NULL)
+            {
+                store_element(in->dtype, TensorBase_data_ptr(grad_weight), i, weight_sum);
+            }
+            if (grad_bias != NULL)
+            {
+                store_element(in->dtype, TensorBase_data_ptr(grad_bias), i, bias_sum);
+            }
+        }
+    }
+    else
+    {
+        if (has_grad_in)
+        {
+            TensorBase_dealloc(grad_in);
+        }
+        if (has_grad_weight)
+        {
+            TensorBase_dealloc(grad_weight);
+        }
+    }
+
+    if (loop.partials != NULL)
+    {
+        TensorBase_cache_free(loop.partials, partials_size);
+    }
+    for (int i = 0; i < 3; i++)
+    {
+        if (operands[i] != NULL)
+        {
+            TensorBase_dealloc(&contiguous[i]);
+        }
+    }
+    return status;
+}
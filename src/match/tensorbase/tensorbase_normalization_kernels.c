@@ -0,0 +1,173 @@
+// Layer normalization kernel template.
+// This file is included once per dtype by tensorbase_normalization.c, with the following macros defined:
+// * LAYER_NORM_DTYPE: A suffix that makes the names of the generated kernels unique (e.g., float32).
+// * LAYER_NORM_SCALAR: The C type of the elements (e.g., float).
+// * LAYER_NORM_MATH_SUFFIX: The suffix of the libm functions for LAYER_NORM_SCALAR (f for float, empty for double).
+// Every kernel processes rows of LayerNormLoop: contiguous runs of `size` elements that are normalized together.
+// The inner loops are branch free, so the compiler vectorizes them.
+
+#define LAYER_NORM_NAME_(name, dtype) name##_##dtype
+#define LAYER_NORM_NAME(name, dtype) LAYER_NORM_NAME_(name, dtype)
+#define LAYER_NORM(name) LAYER_NORM_NAME(name, LAYER_NORM_DTYPE)
+#define LAYER_NORM_MATH_(function, suffix) function##suffix
+#define LAYER_NORM_MATH(function, suffix) LAYER_NORM_MATH_(function, suffix)
+#define LAYER_NORM_LIBM(function) LAYER_NORM_MATH(function, LAYER_NORM_MATH_SUFFIX)
+
+static void LAYER_NORM(layer_norm_rows)(void *context, long begin, long end)
+{
+    // Forward pass. The statistics of a row are gathered in one pass: every chunk of LAYER_NORM_CHUNK elements (first
+    // summed with the residual, if any) is reduced to its mean and its sum of squared deviations while it is in cache,
+    // and the chunks are merged with Welford's (Chan's) update. A second pass normalizes and applies γ and β.
+    const LayerNormLoop *loop = (const LayerNormLoop *)context;
+    long size = loop->size;
+    const LAYER_NORM_SCALAR *weight = (const LAYER_NORM_SCALAR *)loop->weight;
+    const LAYER_NORM_SCALAR *bias = (const LAYER_NORM_SCALAR *)loop->bias;
+    for (long row = begin; row < end; row++)
+    {
+        const LAYER_NORM_SCALAR *x = (const LAYER_NORM_SCALAR *)loop->in + row * size;
+        if (loop->residual != NULL)
+        {
+            const LAYER_NORM_SCALAR *in = x;
+            const LAYER_NORM_SCALAR *residual = (const LAYER_NORM_SCALAR *)loop->residual + row * size;
+            x = (LAYER_NORM_SCALAR *)loop->sum + row * size;
+            for (long start = 0; start < size; start += LAYER_NORM_CHUNK)
+            {
+                long n = min_long(LAYER_NORM_CHUNK, size - start);
+                LAYER_NORM_SCALAR *s = (LAYER_NORM_SCALAR *)x + start;
+                for (long i = 0; i < n; i++)
+                {
+                    s[i] = in[start + i] + residual[start + i];
+                }
+            }
+        }
+
+        double mean = 0, m2 = 0;
+        for (long start = 0; start < size; start += LAYER_NORM_CHUNK)
+        {
+            long n = min_long(LAYER_NORM_CHUNK, size - start);
+            const LAYER_NORM_SCALAR *c = x + start;
+            LAYER_NORM_SCALAR chunk_sum = 0;
+            for (long i = 0; i < n; i++)
+            {
+                chunk_sum += c[i];
+            }
+            LAYER_NORM_SCALAR chunk_mean = chunk_sum / n;
+            LAYER_NORM_SCALAR chunk_m2 = 0;
+            for (long i = 0; i < n; i++)
+            {
+                LAYER_NORM_SCALAR deviation = c[i] - chunk_mean;
+                chunk_m2 += deviation * deviation;
+            }
+            double delta = chunk_mean - mean;
+            double merged = start + n;
+            mean += delta * n / merged;
+            m2 += chunk_m2 + delta * delta * start * n / merged;
+        }
+
+        // The biased variance, as torch.nn.LayerNorm.
+        LAYER_NORM_SCALAR rstd = 1 / LAYER_NORM_LIBM(sqrt)((LAYER_NORM_SCALAR)(m2 / size + loop->eps));
+        LAYER_NORM_SCALAR shift = (LAYER_NORM_SCALAR)-mean * rstd;
+        ((LAYER_NORM_SCALAR *)loop->mean)[row] = (LAYER_NORM_SCALAR)mean;
+        ((LAYER_NORM_SCALAR *)loop->rstd)[row] = rstd;
+
+        LAYER_NORM_SCALAR *y = (LAYER_NORM_SCALAR *)loop->out + row * size;
+        if (weight != NULL && bias != NULL)
+        {
+            for (long i = 0; i < size; i++)
+            {
+                y[i] = (x[i] * rstd + shift) * weight[i] + bias[i];
+            }
+        }
+        else if (weight != NULL)
+        {
+            for (long i = 0; i < size; i++)
+            {
+                y[i] = (x[i] * rstd + shift) * weight[i];
+            }
+        }
+        else
+        {
+            for (long i = 0; i < size; i++)
+            {
+                y[i] = x[i] * rstd + shift;
+            }
+            if (bias != NULL)
+            {
+                for (long i = 0; i < size; i++)
+                {
+                    y[i] += bias[i];
+                }
+            }
+        }
+    }
+}
+
+static void LAYER_NORM(layer_norm_backward_blocks)(void *context, long begin, long end)
+{
+    // Backward pass, over blocks of block_rows rows. With x̂ = (x - mean) * rstd and g = grad * γ, the gradient of a
+    // row is rstd * (g - mean(g) - x̂ * mean(g * x̂)). Each block also accumulates Σ grad * x̂ (the gradient of γ)
+    // and Σ grad (the gradient of β) of its rows into its own partial sums, which the caller adds up in order.
+    const LayerNormLoop *loop = (const LayerNormLoop *)context;
+    long size = loop->size;
+    const LAYER_NORM_SCALAR *weight = (const LAYER_NORM_SCALAR *)loop->weight;
+    LAYER_NORM_SCALAR g[LAYER_NORM_CHUNK];
+    for (long block = begin; block < end; block++)
+    {
+        double *grad_weight = loop->partials == NULL ? NULL : loop->partials + 2 * block * size;
+        double *grad_bias = grad_weight == NULL ? NULL : grad_weight + size;
+        if (grad_weight != NULL)
+        {
+            memset(grad_weight, 0, 2 * size * sizeof(double));
+        }
+
+        long last_row = min_long(loop->rows, (block + 1) * loop->block_rows);
+        for (long row = block * loop->block_rows; row < last_row; row++)
+        {
+            const LAYER_NORM_SCALAR *x = (const LAYER_NORM_SCALAR *)loop->in + row * size;
+            const LAYER_NORM_SCALAR *grad = (const LAYER_NORM_SCALAR *)loop->grad + row * size;
+            LAYER_NORM_SCALAR *dx = (LAYER_NORM_SCALAR *)loop->out + row * size;
+            LAYER_NORM_SCALAR mean = ((const LAYER_NORM_SCALAR *)loop->mean)[row];
+            LAYER_NORM_SCALAR rstd = ((const LAYER_NORM_SCALAR *)loop->rstd)[row];
+
+            LAYER_NORM_SCALAR sum_g = 0, sum_g_xhat = 0;
+            for (long start = 0; start < size; start += LAYER_NORM_CHUNK)
+            {
+                long n = min_long(LAYER_NORM_CHUNK, size - start);
+                for (long i = 0; i < n; i++)
+                {
+                    g[i] = weight == NULL ? grad[start + i] : grad[start + i] * weight[start + i];
+                }
+                for (long i = 0; i < n; i++)
+                {
+                    LAYER_NORM_SCALAR xhat = (x[start + i] - mean) * rstd;
+                    sum_g += g[i];
+                    sum_g_xhat += g[i] * xhat;
+                }
+                if (grad_weight != NULL)
+                {
+                    for (long i = 0; i < n; i++)
+                    {
+                        LAYER_NORM_SCALAR xhat = (x[start + i] - mean) * rstd;
+                        grad_weight[start + i] += grad[start + i] * xhat;
+                        grad_bias[start + i] += grad[start + i];
+                    }
+                }
+            }
+
+            LAYER_NORM_SCALAR mean_g = sum_g / size, mean_g_xhat = sum_g_xhat / size;
+            for (long i = 0; i < size; i++)
+            {
+                LAYER_NORM_SCALAR xhat = (x[i] - mean) * rstd;
+                LAYER_NORM_SCALAR gi = weight == NULL ? grad[i] : grad[i] * weight[i];
+                dx[i] = rstd * (gi - mean_g - xhat * mean_g_xhat);
+            }
+        }
+    }
+}
+
+#undef LAYER_NORM_NAME_
+#undef LAYER_NORM_NAME
+#undef LAYER_NORM
+#undef LAYER_NORM_MATH_
+#undef LAYER_NORM_MATH
+#undef LAYER_NORM_LIBM
@@ -0,0 +1,239 @@
+#include "tensorbase.h"
+#include "tensorbase_util.c"
+
+// Fused optimizer steps.
+// A step updates every element of every parameter in a single pass: the parameter, its gradient and its state buffers
+// (e.g., momentum) are each read once, and the parameter and the state are each written once, without temporaries.
+// The parameters of a model are split into chunks of about PARALLEL_GRAIN_ELEMENTS elements, and the chunks of all
+// parameters are processed by one parallel loop, so a model with many small parameters (e.g., biases) does not pay
+// for a parallel loop (or a serial pass) per parameter.
+
+// Maximum number of state buffers per parameter (Adam keeps two).
+#define OPTIM_MAX_STATES 2
+
+// Coefficients of an Adam step, derived from TensorBaseAdamOptions once per step.
+typedef struct
+{
+    scalar beta1;
+    scalar beta2;
+    scalar eps;
+    scalar grad_weight_decay;     // Weight decay added to the gradient (Adam).
+    scalar param_scale;           // Factor the parameters are decayed by (AdamW).
+    scalar step_size;             // lr / (1 - beta1^step).
+    scalar bias_correction2_sqrt; // sqrt(1 - beta2^step).
+} AdamCoefficients;
+
+#define OPTIM_DTYPE float64
+#define OPTIM_SCALAR double
+#define OPTIM_MATH_SUFFIX
+#include "tensorbase_optim_kernels.c"
+#undef OPTIM_DTYPE
+#undef OPTIM_SCALAR
+#undef OPTIM_MATH_SUFFIX
+
+#define OPTIM_DTYPE float32
+#define OPTIM_SCALAR float
+#define OPTIM_MATH_SUFFIX f
+#include "tensorbase_optim_kernels.c"
+#undef OPTIM_DTYPE
+#undef OPTIM_SCALAR
+#undef OPTIM_MATH_SUFFIX
+
+// A range of the elements of one parameter, with the matching ranges of its gradient and state buffers.
+typedef struct
+{
+    DType dtype;
+    long n;
+    void *param;
+    void *grad;
+    void *states[OPTIM_MAX_STATES];
+} OptimizerChunk;
+
+typedef struct
+{
+    OptimizerChunk *chunks;
+    const void *options;
+} OptimizerLoop;
+
+static StatusCode check_optimizer_operand(TensorBase *param, TensorBase *operand)
+{
+    if (operand == NULL)
+    {
+        return TB_NULL_INPUT_ERROR;
+    }
+    if (operand->dtype != param->dtype)
+    {
+        return TB_UNSUPPORTED_DTYPE_ERROR;
+    }
+    if (operand->ndim != param->ndim || !TensorBase_same_shape(operand->shape, param->shape))
+    {
+        return TB_SHAPE_MISMATCH_ERROR;
+    }
+    if (!TensorBase_is_contiguous(operand))
+    {
+        return TB_NOT_IMPLEMENTED_ERROR;
+    }
+    return TB_OK;
+}
+
+static StatusCode split_into_chunks(long count, TensorBase **params, TensorBase **grads, TensorBase **states[OPTIM_MAX_STATES],
+                                    long state_count, OptimizerChunk **chunks, long *chunk_count, size_t *chunks_size)
+{
+    // Validates the operands and splits them into chunks, which are returned in a buffer of the caching allocator.
+    *chunk_count = 0;
+    for (long i = 0; i < count; i++)
+    {
+        if (params[i] == NULL)
+        {
+            return TB_NULL_INPUT_ERROR;
+        }
+        if (params[i]->dtype != TB_FLOAT32 && params[i]->dtype != TB_FLOAT64)
+        {
+            return TB_UNSUPPORTED_DTYPE_ERROR;
+        }
+        if (!TensorBase_is_contiguous(params[i]))
+        {
+            return TB_NOT_IMPLEMENTED_ERROR;
+        }
+        RETURN_IF_ERROR(check_optimizer_operand(params[i], grads[i]));
+        for (long s = 0; s < state_count; s++)
+        {
+            RETURN_IF_ERROR(check_optimizer_operand(params[i], states[s][i]));
+        }
+        *chunk_count += (params[i]->numel + PARALLEL_GRAIN_ELEMENTS - 1) / PARALLEL_GRAIN_ELEMENTS;
+    }
+
+    *chunks_size = max_long(1, *chunk_count) * sizeof(OptimizerChunk);
+    *chunks = (OptimizerChunk *)TensorBase_cache_malloc(*chunks_size);
+    if (*chunks == NULL)
+    {
+        return TB_MALLOC_ERROR;
+    }
+
+    OptimizerChunk *chunk = *chunks;
+    for (long i = 0; i < count; i++)
+    {
+        size_t element_size = TensorBase_element_size(params[i]->dtype);
+        char *param = (char *)TensorBase_data_ptr(params[i]);
+        char *grad = (char *)TensorBase_data_ptr(grads[i]);
+        char *state[OPTIM_MAX_STATES] = {NULL};
+        for (long s = 0; s < state_count; s++)
+        {
+            state[s] = (char *)TensorBase_data_ptr(states[s][i]);
+        }
+
+        for (long begin = 0; begin < params[i]->numel; begin += PARALLEL_GRAIN_ELEMENTS)
+        {
+            size_t offset = begin * element_size;
+            chunk->dtype = params[i]->dtype;
+            chunk->n = min_long(PARALLEL_GRAIN_ELEMENTS, params[i]->numel - begin);
+            chunk->param = param + offset;
+            chunk->grad = grad + offset;
+            for (long s = 0; s < OPTIM_MAX_STATES; s++)
+            {
+                chunk->states[s] = s < state_count ? state[s] + offset : NULL;
+            }
+            chunk++;
+        }
+    }
+    return TB_OK;
+}
+
+static void sgd_chunks(void *context, long begin, long end)
+{
+    OptimizerLoop *loop = (OptimizerLoop *)context;
+    const TensorBaseSGDOptions *options = (const TensorBaseSGDOptions *)loop->options;
+    for (long i = begin; i < end; i++)
+    {
+        OptimizerChunk *chunk = &loop->chunks[i];
+        if (chunk->dtype == TB_FLOAT32)
+        {
+            sgd_kernel_float32((float *)chunk->param, (const float *)chunk->grad, (float *)chunk->states[0], chunk->n, options);
+        }
+        else
+        {
+            sgd_kernel_float64((double *)chunk->param, (const double *)chunk->grad, (double *)chunk->states[0], chunk->n, options);
+        }
+    }
+}
+
+static void adam_chunks(void *context, long begin, long end)
+{
+    OptimizerLoop *loop = (OptimizerLoop *)context;
+    const AdamCoefficients *coefficients = (const AdamCoefficients *)loop->options;
+    for (long i = begin; i < end; i++)
+    {
+        OptimizerChunk *chunk = &loop->chunks[i];
+        if (chunk->dtype == TB_FLOAT32)
+        {
+            adam_kernel_float32((float *)chunk->param, (const float *)chunk->grad, (float *)chunk->states[0],
+                                (float *)chunk->states[1], chunk->n, coefficients);
+        }
+        else
+        {
+            adam_kernel_float64((double *)chunk->param, (const double *)chunk->grad, (double *)chunk->states[0],
+                                (double *)chunk->states[1], chunk->n, coefficients);
+        }
+    }
+}
+
+static StatusCode run_optimizer(long count, TensorBase **params, TensorBase **grads, TensorBase **states[OPTIM_MAX_STATES],
+                                long state_count, ParallelForBody body, const void *options)
+{
+    if (params == NULL || grads == NULL)
+    {
+        return TB_NULL_INPUT_ERROR;
+    }
+    for (long s = 0; s < state_count; s++)
+    {
+        if (states[s] == NULL)
+        {
+            return TB_NULL_INPUT_ERROR;
+        }
+    }
+
+    OptimizerLoop loop;
+    long chunk_count;
+    size_t chunks_size;
+    RETURN_IF_ERROR(split_into_chunks(count, params, grads, states, state_count, &loop.chunks, &chunk_count, &chunks_size));
+    loop.options = options;
+    TensorBase_parallel_for(chunk_count, 1, body, &loop);
+    TensorBase_cache_free(loop.chunks, chunks_size);
+    return TB_OK;
+}
+
+StatusCode TensorBase_sgd_step(long count, TensorBase **params, TensorBase **grads, TensorBase **momentum_buffers,
+                               const TensorBaseSGDOptions *options)
+{
+    if (options == NULL)
+    {
+        return TB_NULL_INPUT_ERROR;
+    }
+    TensorBase **states[OPTIM_MAX_STATES] = {momentum_buffers, NULL};
+    return run_optimizer(count, params, grads, states, options->momentum == 0 ? 0 : 1, sgd_chunks, options);
+}
+
+StatusCode TensorBase_adam_step(long count, TensorBase **params, TensorBase **grads, TensorBase **exp_avgs,
+                                TensorBase **exp_avg_sqs, const TensorBaseAdamOptions *options)
+{
+    if (options == NULL)
+    {
+        return TB_NULL_INPUT_ERROR;
+    }
+    if (options->step < 1)
+    {
+        return TB_INVALID_DIMENSION_SIZE_ERROR;
+    }
+
+    AdamCoefficients coefficients;
+    coefficients.beta1 = options->beta1;
+    coefficients.beta2 = options->beta2;
+    coefficients.eps = options->eps;
+    coefficients.grad_weight_decay = options->decoupled_weight_decay ? 0 : options->weight_decay;
+    coefficients.param_scale = options->decoupled_weight_decay ? 1 - options->lr * options->weight_decay : 1;
+    coefficients.step_size = options->lr / (1 - pow(options->beta1, (scalar)options->step));
+    coefficients.bias_correction2_sqrt = sqrt(1 - pow(options->beta2, (scalar)options->step));
+
+    TensorBase **states[OPTIM_MAX_STATES] = {exp_avgs, exp_avg_sqs};
+    return run_optimizer(count, params, grads, states, 2, adam_chunks, &coefficients);
+}
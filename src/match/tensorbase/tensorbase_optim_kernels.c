@@ -0,0 +1,88 @@
+// Optimizer kernel template.
+// This file is included once per dtype by tensorbase_optim.c, with the following macros defined:
+// * OPTIM_DTYPE: A suffix that makes the names of the generated kernels unique (e.g., float32).
+// * OPTIM_SCALAR: The C type of the elements (e.g., float).
+// * OPTIM_MATH_SUFFIX: The suffix of the libm functions for OPTIM_SCALAR (f for float, empty for double).
+// The update of an element is computed in registers from one load of each operand, and the loops only branch on
+// loop-invariant hyperparameters, so the compiler can vectorize them.
+
+#define OPTIM_NAME_(name, dtype) name##_##dtype
+#define OPTIM_NAME(name, dtype) OPTIM_NAME_(name, dtype)
+#define OPTIM(name) OPTIM_NAME(name, OPTIM_DTYPE)
+#define OPTIM_MATH_(function, suffix) function##suffix
+#define OPTIM_MATH(function, suffix) OPTIM_MATH_(function, suffix)
+#define OPTIM_LIBM(function) OPTIM_MATH(function, OPTIM_MATH_SUFFIX)
+
+static void OPTIM(sgd_kernel)(OPTIM_SCALAR *restrict param, const OPTIM_SCALAR *restrict grad, OPTIM_SCALAR *restrict buffer,
+                              long n, const TensorBaseSGDOptions *options)
+{
+    OPTIM_SCALAR lr = (OPTIM_SCALAR)options->lr;
+    OPTIM_SCALAR weight_decay = (OPTIM_SCALAR)options->weight_decay;
+    OPTIM_SCALAR momentum = (OPTIM_SCALAR)options->momentum;
+    OPTIM_SCALAR grad_scale = (OPTIM_SCALAR)(1 - options->dampening);
+
+    if (options->momentum == 0)
+    {
+        for (long i = 0; i < n; i++)
+        {
+            OPTIM_SCALAR p = param[i];
+            param[i] = p - lr * (grad[i] + weight_decay * p);
+        }
+    }
+    else if (options->first_step)
+    {
+        // The buffers are initialized to the (undampened) gradient, whatever they held before.
+        bool nesterov = options->nesterov;
+        for (long i = 0; i < n; i++)
+        {
+            OPTIM_SCALAR p = param[i];
+            OPTIM_SCALAR g = grad[i] + weight_decay * p;
+            buffer[i] = g;
+            param[i] = p - lr * (nesterov ? g + momentum * g : g);
+        }
+    }
+    else
+    {
+        bool nesterov = options->nesterov;
+        for (long i = 0; i < n; i++)
+        {
+            OPTIM_SCALAR p = param[i];
+            OPTIM_SCALAR g = grad[i] + weight_decay * p;
+            OPTIM_SCALAR b = momentum * buffer[i] + grad_scale * g;
+            buffer[i] = b;
+            param[i] = p - lr * (nesterov ? g + momentum * b : b);
+        }
+    }
+}
+
+static void OPTIM(adam_kernel)(OPTIM_SCALAR *restrict param, const OPTIM_SCALAR *restrict grad, OPTIM_SCALAR *restrict exp_avg,
+                               OPTIM_SCALAR *restrict exp_avg_sq, long n, const AdamCoefficients *coefficients)
+{
+    OPTIM_SCALAR beta1 = (OPTIM_SCALAR)coefficients->beta1;
+    OPTIM_SCALAR beta2 = (OPTIM_SCALAR)coefficients->beta2;
+    OPTIM_SCALAR one_minus_beta1 = (OPTIM_SCALAR)(1 - coefficients->beta1);
+    OPTIM_SCALAR one_minus_beta2 = (OPTIM_SCALAR)(1 - coefficients->beta2);
+    OPTIM_SCALAR eps = (OPTIM_SCALAR)coefficients->eps;
+    OPTIM_SCALAR grad_weight_decay = (OPTIM_SCALAR)coefficients->grad_weight_decay;
+    OPTIM_SCALAR param_scale = (OPTIM_SCALAR)coefficients->param_scale;
+    OPTIM_SCALAR step_size = (OPTIM_SCALAR)coefficients->step_size;
+    OPTIM_SCALAR bias_correction2_sqrt = (OPTIM_SCALAR)coefficients->bias_correction2_sqrt;
+
+    for (long i = 0; i < n; i++)
+    {
+        OPTIM_SCALAR p = param[i];
+        OPTIM_SCALAR g = grad[i] + grad_weight_decay * p;
+        OPTIM_SCALAR m = beta1 * exp_avg[i] + one_minus_beta1 * g;
+        OPTIM_SCALAR v = beta2 * exp_avg_sq[i] + one_minus_beta2 * g * g;
+        exp_avg[i] = m;
+        exp_avg_sq[i] = v;
+        param[i] = param_scale * p - step_size * m / (OPTIM_LIBM(sqrt)(v) / bias_correction2_sqrt + eps);
+    }
+}
+
+#undef OPTIM
+#undef OPTIM_NAME
+#undef OPTIM_NAME_
+#undef OPTIM_LIBM
+#undef OPTIM_MATH
+#undef OPTIM_MATH_
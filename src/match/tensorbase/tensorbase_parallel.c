@@ -0,0 +1,222 @@
+#include "tensorbase.h"
+#include "tensorbase_util.c"
+#include <pthread.h>
+#include <stdint.h>
+#include <unistd.h>
+
+// A persistent pool of worker threads for TensorBase_parallel_for.
+// The workers are started on the first parallel loop and then sleep on a condition variable between loops, so a loop
+// costs a wake-up rather than a thread creation. The calling thread works on the loop as well, so a pool of
+// `num_threads` threads has `num_threads - 1` workers.
+
+#define PARALLEL_MAX_THREADS 256
+
+typedef struct
+{
+    ParallelForBody body;
+    void *context;
+    long n;
+    long chunk_count;
+    long next_chunk;       // Index of the next unclaimed chunk (claimed atomically).
+    long remaining_chunks; // Number of chunks that have not finished yet (guarded by pool_mutex).
+    long active_workers;   // Number of workers holding a pointer to the job (guarded by pool_mutex).
+} ParallelJob;
+
+// pool_submit_mutex is held by the thread running a parallel loop (or resizing the pool). pool_mutex guards the state
+// shared with the workers.
+static pthread_mutex_t pool_submit_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pool_job_available = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t pool_job_done = PTHREAD_COND_INITIALIZER;
+static pthread_once_t pool_once = PTHREAD_ONCE_INIT;
+
+static pthread_t pool_workers[PARALLEL_MAX_THREADS];
+static long pool_worker_count = 0;
+static long pool_num_threads = 0;
+static bool pool_shutdown = false;
+
+// The job currently being executed (NULL between jobs), and a counter that changes with every new job.
+static ParallelJob *pool_job = NULL;
+static unsigned long pool_generation = 0;
+
+// Set while a thread executes the body of a parallel loop. Nested loops run serially on the thread that reaches them.
+static __thread bool in_parallel_region = false;
+
+static void parallel_run_chunks(ParallelJob *job)
+{
+    bool was_in_parallel_region = in_parallel_region;
+    in_parallel_region = true;
+
+    long finished_chunks = 0;
+    while (true)
+    {
+        long chunk = __atomic_fetch_add(&job->next_chunk, 1, __ATOMIC_RELAXED);
+        if (chunk >= job->chunk_count)
+        {
+            break;
+        }
+        // Split [0, n) into chunk_count ranges whose lengths differ by at most one.
+        long begin = job->n * chunk / job->chunk_count;
+        long end = job->n * (chunk + 1) / job->chunk_count;
+        job->body(job->context, begin, end);
+        finished_chunks++;
+    }
+
+    in_parallel_region = was_in_parallel_region;
+
+    if (finished_chunks > 0)
+    {
+        pthread_mutex_lock(&pool_mutex);
+        job->remaining_chunks -= finished_chunks;
+        if (job->remaining_chunks == 0)
+        {
+            pthread_cond_broadcast(&pool_job_done);
+        }
+        pthread_mutex_unlock(&pool_mutex);
+    }
+}
+
+static void *parallel_worker(void *argument)
+{
+    // The argument is the generation at the time the worker was created, so a worker started for a job still runs it.
+    unsigned long seen_generation = (unsigned long)(uintptr_t)argument;
+    pthread_mutex_lock(&pool_mutex);
+    while (true)
+    {
+        while (!pool_shutdown && (pool_generation == seen_generation || pool_job == NULL))
+        {
+            pthread_cond_wait(&pool_job_available, &pool_mutex);
+        }
+        if (pool_shutdown)
+        {
+            break;
+        }
+        seen_generation = pool_generation;
+
+        // Hold on to the job while working on it, so the caller does not return (and release it) before this worker
+        // is done with it.
+        ParallelJob *job = pool_job;
+        job->active_workers++;
+        pthread_mutex_unlock(&pool_mutex);
+
+        parallel_run_chunks(job);
+
+        pthread_mutex_lock(&pool_mutex);
+        job->active_workers--;
+        if (job->active_workers == 0)
+        {
+            pthread_cond_broadcast(&pool_job_done);
+        }
+    }
+    pthread_mutex_unlock(&pool_mutex);
+    return NULL;
+}
+
+static void parallel_stop_workers(void)
+{
+    // Assumes pool_mutex is not held and no job is running.
+    pthread_mutex_lock(&pool_mutex);
+    pool_shutdown = true;
+    pthread_cond_broadcast(&pool_job_available);
+    pthread_mutex_unlock(&pool_mutex);
+
+    for (long i = 0; i < pool_worker_count; i++)
+    {
+        pthread_join(pool_workers[i], NULL);
+    }
+
+    pthread_mutex_lock(&pool_mutex);
+    pool_worker_count = 0;
+    pool_shutdown = false;
+    pthread_mutex_unlock(&pool_mutex);
+}
+
+static void parallel_after_fork_in_child(void)
+{
+    // Only the forking thread survives a fork(), so the child starts over with an empty pool.
+    pthread_mutex_init(&pool_submit_mutex, NULL);
+    pthread_mutex_init(&pool_mutex, NULL);
+    pthread_cond_init(&pool_job_available, NULL);
+    pthread_cond_init(&pool_job_done, NULL);
+    pool_worker_count = 0;
+    pool_shutdown = false;
+    pool_job = NULL;
+}
+
+static void parallel_init_once(void)
+{
+    pthread_atfork(NULL, NULL, parallel_after_fork_in_child);
+    if (pool_num_threads == 0)
+    {
+        // Default to one thread per online processor.
+        long processor_count = sysconf(_SC_NPROCESSORS_ONLN);
+        pool_num_threads = min_long(max_long(processor_count, 1), PARALLEL_MAX_THREADS);
+    }
+}
+
+void TensorBase_set_num_threads(long num_threads)
+{
+    pthread_once(&pool_once, parallel_init_once);
+    num_threads = min_long(max_long(num_threads, 1), PARALLEL_MAX_THREADS);
+
+    pthread_mutex_lock(&pool_submit_mutex);
+    if (num_threads != pool_num_threads)
+    {
+        // Workers are started again (with the new count) by the next parallel loop.
+        parallel_stop_workers();
+        pool_num_threads = num_threads;
+    }
+    pthread_mutex_unlock(&pool_submit_mutex);
+}
+
+long TensorBase_get_num_threads(void)
+{
+    pthread_once(&pool_once, parallel_init_once);
+    return pool_num_threads;
+}
+
+void TensorBase_parallel_for(long n, long grain_size, ParallelForBody body, void *context)
+{
+    pthread_once(&pool_once, parallel_init_once);
+
+    // Every chunk gets at least `grain_size` iterations, so loops that are too small to amortize waking the workers
+    // run serially. Nested loops, and loops started while another thread runs one, also run serially.
+    long chunk_count = min_long(pool_num_threads, n / max_long(grain_size, 1));
+    if (chunk_count <= 1 || in_parallel_region || pthread_mutex_trylock(&pool_submit_mutex) != 0)
+    {
+        if (n > 0)
+        {
+            body(context, 0, n);
+        }
+        return;
+    }
+
+    ParallelJob job = {body, context, n, chunk_count, 0, chunk_count, 0};
+
+    pthread_mutex_lock(&pool_mutex);
+    while (pool_worker_count < pool_num_threads - 1)
+    {
+        if (pthread_create(&pool_workers[pool_worker_count], NULL, parallel_worker, (void *)(uintptr_t)pool_generation) != 0)
+        {
+            // Run with the workers that could be started.
+            break;
+        }
+        pool_worker_count++;
+    }
+    pool_job = &job;
+    pool_generation++;
+    pthread_cond_broadcast(&pool_job_available);
+    pthread_mutex_unlock(&pool_mutex);
+
+    parallel_run_chunks(&job);
+
+    pthread_mutex_lock(&pool_mutex);
+    while (job.remaining_chunks > 0 || job.active_workers > 0)
+    {
+        pthread_cond_wait(&pool_job_done, &pool_mutex);
+    }
+    pool_job = NULL;
+    pthread_mutex_unlock(&pool_mutex);
+
+    pthread_mutex_unlock(&pool_submit_mutex);
+}
@@ -0,0 +1,382 @@
+#include "tensorbase.h"
+#include "tensorbase_util.c"
+
+// Fused softmax and log-softmax.
+// The operand is viewed as (outer, size, inner), where size is the softmax dimension. The max is subtracted before
+// exponentiating, so large logits cannot overflow, and no temporaries are allocated.
+// * A softmax over the last dimension (inner == 1) reads each row once: the max and the sum of exponentials are
+//   computed online, chunk by chunk, with the exponentials written to the output, which one more pass normalizes.
+// * Otherwise, tiles of up to SOFTMAX_TILE adjacent columns are small enough to stay in cache across the max pass,
+//   the exponential pass and the normalization pass.
+// The backward passes make one reduction pass and one output pass over the saved output and the gradient.
+// The cross-entropy loss of logits computes the log-sum-exp and the negative log-likelihood of each row in the same
+// pass, so neither the softmax nor a one-hot target is ever materialized, and its backward writes
+// softmax(x) - target directly from the saved log-sum-exp.
+
+// Number of adjacent columns (along the dimensions after the softmax dimension) processed together.
+#define SOFTMAX_TILE 256
+// Number of elements of a contiguous row (a softmax over the last dimension) that share a running max.
+#define SOFTMAX_CHUNK 256
+
+typedef struct
+{
+    const void *in;   // The input (forward), or the saved output (backward).
+    const void *grad; // The gradient of the output (backward).
+    void *out;
+    long size;
+    long inner;
+    long tiles; // Lines per outer index: ceil(inner / SOFTMAX_TILE).
+    bool log;
+    UnaryKernel exp;   // The dispatched exp kernel of the dtype.
+    StatusCode status; // Set by a worker that fails to allocate its scratch (forward).
+} SoftmaxLoop;
+
+typedef struct
+{
+    SoftmaxLoop softmax;        // in: the logits, out: their gradient (backward), size: the number of classes.
+    const int64_t *indices;     // Class index targets, or NULL.
+    const void *probabilities;  // Class probability targets (of the logits' dtype), or NULL.
+    long ignore_index;          // Class index whose rows are ignored.
+    void *lse;                  // log(sum(exp(row))) of every row, of the logits' dtype.
+    double *losses;             // The loss of every row (forward).
+    const double *grad_losses;  // The gradient of the loss of every row (backward).
+    long grad_losses_step;      // 0 if the loss was reduced, so every row shares the gradient.
+    double grad_scale;          // The factor of the reduction: 1 / count for a mean, 1 otherwise.
+} CrossEntropyLoop;
+
+#define SOFTMAX_DTYPE float64
+#define SOFTMAX_SCALAR double
+#define SOFTMAX_MATH_SUFFIX
+#include "tensorbase_softmax_kernels.c"
+#undef SOFTMAX_DTYPE
+#undef SOFTMAX_SCALAR
+#undef SOFTMAX_MATH_SUFFIX
+
+#define SOFTMAX_DTYPE float32
+#define SOFTMAX_SCALAR float
+#define SOFTMAX_MATH_SUFFIX f
+#include "tensorbase_softmax_kernels.c"
+#undef SOFTMAX_DTYPE
+#undef SOFTMAX_SCALAR
+#undef SOFTMAX_MATH_SUFFIX
+
+static StatusCode softmax_layout(TensorBase *in, long dim, SoftmaxLoop *loop, long *lines)
+{
+    // Fills the shape of the (outer, size, inner) view of `in` along dim into the loop.
+    if (in->dtype != TB_FLOAT32 && in->dtype != TB_FLOAT64)
+    {
+        return TB_UNSUPPORTED_DTYPE_ERROR;
+    }
+    // A singleton is a softmax over a single element, along dimension 0 (or -1).
+    long ndim = max_long(in->ndim, 1);
+    if (dim < 0)
+    {
+        dim += ndim;
+    }
+    if (dim < 0 || dim >= ndim)
+    {
+        return TB_DIMENSION_OUT_OF_BOUNDS_ERROR;
+    }
+
+    long outer = 1;
+    loop->size = in->ndim == 0 ? 1 : in->shape[dim];
+    loop->inner = 1;
+    for (long d = 0; d < in->ndim; d++)
+    {
+        if (d < dim)
+        {
+            outer *= in->shape[d];
+        }
+        else if (d > dim)
+        {
+            loop->inner *= in->shape[d];
+        }
+    }
+    loop->tiles = (loop->inner + SOFTMAX_TILE - 1) / SOFTMAX_TILE;
+    loop->status = TB_OK;
+    *lines = loop->size == 0 ? 0 : outer * loop->tiles;
+    return TB_OK;
+}
+
+static void run_softmax_lines(SoftmaxLoop *loop, long lines, DType dtype, ParallelForBody float32_body, ParallelForBody float64_body)
+{
+    long line_elements = loop->size * min_long(loop->inner, SOFTMAX_TILE);
+    TensorBase_parallel_for(lines, max_long(1, PARALLEL_GRAIN_ELEMENTS / max_long(line_elements, 1)),
+                            dtype == TB_FLOAT32 ? float32_body : float64_body, loop);
+}
+
+StatusCode TensorBase_softmax(TensorBase *in, long dim, bool log, TensorBase *out)
+{
+    if (in == NULL || out == NULL)
+    {
+        return TB_NULL_INPUT_ERROR;
+    }
+
+    SoftmaxLoop loop;
+    long lines;
+    RETURN_IF_ERROR(softmax_layout(in, dim, &loop, &lines));
+
+    TensorBase contiguous_in;
+    RETURN_IF_ERROR(TensorBase_contiguous(in, &contiguous_in));
+    StatusCode status = TensorBase_create_empty_like(&contiguous_in, out);
+    if (status == TB_OK)
+    {
+        loop.in = TensorBase_data_ptr(&contiguous_in);
+        loop.grad = NULL;
+        loop.out = TensorBase_data_ptr(out);
+        loop.log = log;
+        loop.exp = TensorBase_get_unary_kernel(SCALAR_EXP, in->dtype);
+        run_softmax_lines(&loop, lines, in->dtype, softmax_lines_float32, softmax_lines_float64);
+        status = loop.status;
+        if (status != TB_OK)
+        {
+            TensorBase_dealloc(out);
+        }
+    }
+    TensorBase_dealloc(&contiguous_in);
+    return status;
+}
+
+StatusCode TensorBase_softmax_backward(TensorBase *output, TensorBase *grad, long dim, bool log, TensorBase *out)
+{
+    if (output == NULL || grad == NULL || out == NULL)
+    {
+        return TB_NULL_INPUT_ERROR;
+    }
+    if (grad->dtype != output->dtype)
+    {
+        return TB_UNSUPPORTED_DTYPE_ERROR;
+    }
+    if (grad->ndim != output->ndim || !TensorBase_same_shape(grad->shape, output->shape))
+    {
+        return TB_SHAPE_MISMATCH_ERROR;
+    }
+
+    SoftmaxLoop loop;
+    long lines;
+    RETURN_IF_ERROR(softmax_layout(output, dim, &loop, &lines));
+
+    TensorBase contiguous_output, contiguous_grad;
+    RETURN_IF_ERROR(TensorBase_contiguous(output, &contiguous_output));
+    StatusCode status = TensorBase_contiguous(grad, &contiguous_grad);
+    if (status != TB_OK)
+    {
+        TensorBase_dealloc(&contiguous_output);
+        return status;
+    }
+    status = TensorBase_create_empty_like(&contiguous_output, out);
+    if (status == TB_OK)
+    {
+        loop.in = TensorBase_data_ptr(&contiguous_output);
+        loop.grad = TensorBase_data_ptr(&contiguous_grad);
+        loop.out = TensorBase_data_ptr(out);
+        loop.log = log;
+        loop.exp = TensorBase_get_unary_kernel(SCALAR_EXP, output->dtype);
+        run_softmax_lines(&loop, lines, output->dtype, softmax_backward_lines_float32, softmax_backward_lines_float64);
+    }
+    TensorBase_dealloc(&contiguous_output);
+    TensorBase_dealloc(&contiguous_grad);
+    return status;
+}
+
+static StatusCode cross_entropy_setup(TensorBase *logits, TensorBase *target, long ignore_index, CrossEntropyLoop *loop,
+                                      TensorBase *contiguous_logits, TensorBase *contiguous_target, long *rows, long *count)
+{
+    // Validates the operands, and fills the loop with contiguous copies of them. count is the number of rows that
+    // are not ignored, which a mean divides by.
+    if (logits == NULL || target == NULL)
+    {
+        return TB_NULL_INPUT_ERROR;
+    }
+    if (logits->dtype != TB_FLOAT32 && logits->dtype != TB_FLOAT64)
+    {
+        return TB_UNSUPPORTED_DTYPE_ERROR;
+    }
+    if (logits->ndim != 1 && logits->ndim != 2)
+    {
+        return TB_INVALID_NDIM_ERROR;
+    }
+    *rows = logits->ndim == 2 ? logits->shape[0] : 1;
+    long classes = logits->shape[logits->ndim - 1];
+
+    bool is_index_target = target->dtype == TB_INT64;
+    if (is_index_target)
+    {
+        if (target->ndim != logits->ndim - 1 || (logits->ndim == 2 && target->shape[0] != *rows))
+        {
+            return TB_SHAPE_MISMATCH_ERROR;
+        }
+    }
+    else if (target->dtype != logits->dtype)
+    {
+        return TB_UNSUPPORTED_DTYPE_ERROR;
+    }
+    else if (target->ndim != logits->ndim || !TensorBase_same_shape(target->shape, logits->shape))
+    {
+        return TB_SHAPE_MISMATCH_ERROR;
+    }
+
+    RETURN_IF_ERROR(TensorBase_contiguous(logits, contiguous_logits));
+    StatusCode status = TensorBase_contiguous(target, contiguous_target);
+    if (status != TB_OK)
+    {
+        TensorBase_dealloc(contiguous_logits);
+        return status;
+    }
+
+    memset(loop, 0, sizeof(CrossEntropyLoop));
+    loop->softmax.in = TensorBase_data_ptr(contiguous_logits);
+    loop->softmax.size = classes;
+    loop->softmax.inner = 1;
+    loop->softmax.exp = TensorBase_get_unary_kernel(SCALAR_EXP, logits->dtype);
+    loop->ignore_index = ignore_index;
+    *count = *rows;
+    if (is_index_target)
+    {
+        loop->indices = (const int64_t *)TensorBase_data_ptr(contiguous_target);
+        for (long row = 0; row < *rows; row++)
+        {
+            int64_t index = loop->indices[row];
+            if (index == ignore_index)
+            {
+                (*count)--;
+            }
+            else if (index < 0 || index >= classes)
+            {
+                TensorBase_dealloc(contiguous_logits);
+                TensorBase_dealloc(contiguous_target);
+                return TB_INDEX_OUT_OF_BOUNDS_ERROR;
+            }
+        }
+    }
+    else
+    {
+        loop->probabilities = TensorBase_data_ptr(contiguous_target);
+    }
+    return TB_OK;
+}
+
+static void run_cross_entropy_rows(CrossEntropyLoop *loop, long rows, DType dtype, ParallelForBody float32_body, ParallelForBody float64_body)
+{
+    TensorBase_parallel_for(rows, max_long(1, PARALLEL_GRAIN_ELEMENTS / max_long(loop->softmax.size, 1)),
+                            dtype == TB_FLOAT32 ? float32_body : float64_body, loop);
+}
+
+StatusCode TensorBase_cross_entropy(TensorBase *logits, TensorBase *target, long ignore_index, LossReduction reduction,
+                                    TensorBase *loss, TensorBase *lse)
+{
+    if (loss == NULL || lse == NULL)
+    {
+        return TB_NULL_INPUT_ERROR;
+    }
+
+    CrossEntropyLoop loop;
+    TensorBase contiguous_logits, contiguous_target;
+    long rows, count;
+    RETURN_IF_ERROR(cross_entropy_setup(logits, target, ignore_index, &loop, &contiguous_logits, &contiguous_target, &rows, &count));
+
+    ShapeArray shape = {rows};
+    size_t losses_size = max_long(rows, 1) * sizeof(double);
+    loop.losses = (double *)TensorBase_cache_malloc(losses_size);
+    StatusCode status = loop.losses == NULL ? TB_MALLOC_ERROR : TensorBase_init(lse, shape, 1, logits->dtype);
+    if (status == TB_OK)
+    {
+        loop.lse = lse->data;
+        run_cross_entropy_rows(&loop, rows, logits->dtype, cross_entropy_rows_float32, cross_entropy_rows_float64);
+
+        if (reduction == TB_REDUCTION_NONE)
+        {
+            // One loss per row, or a singleton for a single row of logits.
+            status = TensorBase_init(loss, shape, logits->ndim - 1, logits->dtype);
+            for (long row = 0; status == TB_OK && row < rows; row++)
+            {
+                if (logits->ndim == 1)
+                {
+                    TensorBase_set_singleton_value(loss, loop.losses[row]);
+                }
+                else
+                {
+                    store_element(logits->dtype, loss->data, row, loop.losses[row]);
+                }
+            }
+        }
+        else
+        {
+            // The rows are summed in order, so the result does not depend on the number of threads.
+            double total = 0;
+            for (long row = 0; row < rows; row++)
+            {
+                total += loop.losses[row];
+            }
+            status = TensorBase_init(loss, shape, 0, logits->dtype);
+            if (status == TB_OK)
+            {
+                TensorBase_set_singleton_value(loss, reduction == TB_REDUCTION_MEAN ? total / count : total);
+            }
+        }
+        if (status != TB_OK)
+        {
+            TensorBase_dealloc(lse);
+        }
+    }
+
+    TensorBase_cache_free(loop.losses, losses_size);
+    TensorBase_dealloc(&contiguous_logits);
+    TensorBase_dealloc(&contiguous_target);
+    return status;
+}
+
+StatusCode TensorBase_cross_entropy_backward(TensorBase *logits, TensorBase *target, TensorBase *lse, TensorBase *grad_loss,
+                                             long ignore_index, LossReduction reduction, TensorBase *out)
+{
+    if (lse == NULL || grad_loss == NULL || out == NULL)
+    {
+        return TB_NULL_INPUT_ERROR;
+    }
+
+    CrossEntropyLoop loop;
+    TensorBase contiguous_logits, contiguous_target;
+    long rows, count;
+    RETURN_IF_ERROR(cross_entropy_setup(logits, target, ignore_index, &loop, &contiguous_logits, &contiguous_target, &rows, &count));
+
+    // The gradient of the loss holds one element per row, or a single one if the loss was reduced.
+    StatusCode status = TB_OK;
+    if (lse->dtype != logits->dtype || grad_loss->dtype != logits->dtype)
+    {
+        status = TB_UNSUPPORTED_DTYPE_ERROR;
+    }
+    else if (lse->numel != rows || lse->ndim != 1 || grad_loss->numel != (reduction == TB_REDUCTION_NONE ? rows : 1))
+    {
+        status = TB_SHAPE_MISMATCH_ERROR;
+    }
+
+    TensorBase grad_losses;
+    if (status == TB_OK)
+    {
+        status = TensorBase_to_dtype(grad_loss, TB_FLOAT64, &grad_losses);
+    }
+    if (status == TB_OK)
+    {
+        TensorBase contiguous_grad_losses;
+        status = TensorBase_contiguous(&grad_losses, &contiguous_grad_losses);
+        TensorBase_dealloc(&grad_losses);
+        if (status == TB_OK)
+        {
+            status = TensorBase_create_empty_like(&contiguous_logits, out);
+            if (status == TB_OK)
+            {
+                loop.softmax.out = TensorBase_data_ptr(out);
+                loop.lse = TensorBase_data_ptr(lse);
+                loop.grad_losses = (const double *)TensorBase_data_ptr(&contiguous_grad_losses);
+                loop.grad_losses_step = reduction == TB_REDUCTION_NONE ? 1 : 0;
+                loop.grad_scale = reduction == TB_REDUCTION_MEAN ? 1.0 / count : 1.0;
+                run_cross_entropy_rows(&loop, rows, logits->dtype, cross_entropy_backward_rows_float32, cross_entropy_backward_rows_float64);
+            }
+            TensorBase_dealloc(&contiguous_grad_losses);
+        }
+    }
+
+    TensorBase_dealloc(&contiguous_logits);
+    TensorBase_dealloc(&contiguous_target);
+    return status;
+}
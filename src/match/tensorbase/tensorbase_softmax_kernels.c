@@ -0,0 +1,408 @@
+// Softmax kernel template.
+// This file is included once per dtype by tensorbase_softmax.c, with the following macros defined:
+// * SOFTMAX_DTYPE: A suffix that makes the names of the generated kernels unique (e.g., float32).
+// * SOFTMAX_SCALAR: The C type of the elements (e.g., float).
+// * SOFTMAX_MATH_SUFFIX: The suffix of the libm functions for SOFTMAX_SCALAR (f for float, empty for double).
+// Every kernel processes lines of SoftmaxLoop: up to SOFTMAX_TILE adjacent columns of the (outer, size, inner) view
+// of the operands, reduced along size. Exponentials are computed by the dispatched (vectorized) exp kernel, and the
+// remaining loops are branch free, so the compiler vectorizes them.
+
+#define SOFTMAX_NAME_(name, dtype) name##_##dtype
+#define SOFTMAX_NAME(name, dtype) SOFTMAX_NAME_(name, dtype)
+#define SOFTMAX(name) SOFTMAX_NAME(name, SOFTMAX_DTYPE)
+#define SOFTMAX_MATH_(function, suffix) function##suffix
+#define SOFTMAX_MATH(function, suffix) SOFTMAX_MATH_(function, suffix)
+#define SOFTMAX_LIBM(function) SOFTMAX_MATH(function, SOFTMAX_MATH_SUFFIX)
+
+static void SOFTMAX(softmax_row)(const SoftmaxLoop *loop, const SOFTMAX_SCALAR *in, SOFTMAX_SCALAR *out, SOFTMAX_SCALAR *chunk_max)
+{
+    // Softmax of a contiguous row, in one pass over the input. Each chunk of SOFTMAX_CHUNK elements is written to out
+    // as exp(in - m), with m the running max after the chunk, and the running sum is rescaled whenever m grows. The
+    // normalization pass then scales every chunk by exp(m_chunk - m_row) / sum, without recomputing exponentials.
+    long size = loop->size;
+    SOFTMAX_SCALAR max = -INFINITY;
+    SOFTMAX_SCALAR sum = 0;
+    SOFTMAX_SCALAR exps[SOFTMAX_CHUNK];
+    for (long start = 0, c = 0; start < size; start += SOFTMAX_CHUNK, c++)
+    {
+        long n = min_long(SOFTMAX_CHUNK, size - start);
+        const SOFTMAX_SCALAR *x = in + start;
+        SOFTMAX_SCALAR block_max = -INFINITY;
+        for (long i = 0; i < n; i++)
+        {
+            block_max = SOFTMAX_LIBM(fmax)(block_max, x[i]);
+        }
+        if (block_max > max)
+        {
+            sum *= SOFTMAX_LIBM(exp)(max - block_max);
+            max = block_max;
+        }
+        chunk_max[c] = max;
+        if (max == -INFINITY)
+        {
+            // Every element so far is -inf (e.g., masked out), and contributes nothing.
+            for (long i = 0; i < n; i++)
+            {
+                out[start + i] = 0;
+            }
+            continue;
+        }
+
+        // log_softmax only needs the sum, so the exponentials go to scratch and out keeps in - m.
+        SOFTMAX_SCALAR *e = loop->log ? exps : out + start;
+        for (long i = 0; i < n; i++)
+        {
+            e[i] = x[i] - max;
+        }
+        if (loop->log)
+        {
+            memcpy(out + start, e, n * sizeof(SOFTMAX_SCALAR));
+        }
+        loop->exp(e, e, n);
+        SOFTMAX_SCALAR block_sum = 0;
+        for (long i = 0; i < n; i++)
+        {
+            block_sum += e[i];
+        }
+        sum += block_sum;
+    }
+
+    for (long start = 0, c = 0; start < size; start += SOFTMAX_CHUNK, c++)
+    {
+        long n = min_long(SOFTMAX_CHUNK, size - start);
+        SOFTMAX_SCALAR *y = out + start;
+        if (loop->log)
+        {
+            // in - m_row - log(sum) = (in - m_chunk) + m_chunk - m_row - log(sum).
+            SOFTMAX_SCALAR shift = chunk_max[c] == -INFINITY ? -INFINITY : chunk_max[c] - max - SOFTMAX_LIBM(log)(sum);
+            for (long i = 0; i < n; i++)
+            {
+                y[i] += shift;
+            }
+        }
+        else
+        {
+            SOFTMAX_SCALAR scale = SOFTMAX_LIBM(exp)(chunk_max[c] - max) / sum;
+            for (long i = 0; i < n; i++)
+            {
+                y[i] *= scale;
+            }
+        }
+    }
+}
+
+static void SOFTMAX(softmax_tile)(const SoftmaxLoop *loop, const SOFTMAX_SCALAR *in, SOFTMAX_SCALAR *out, long width)
+{
+    // Softmax of `width` adjacent columns, inner elements apart along size. A tile spans at most SOFTMAX_TILE columns,
+    // so it stays in cache between the max pass over the input and the exponential and normalization passes.
+    long size = loop->size;
+    long inner = loop->inner;
+    SOFTMAX_SCALAR max[SOFTMAX_TILE];
+    SOFTMAX_SCALAR sum[SOFTMAX_TILE];
+    SOFTMAX_SCALAR exps[SOFTMAX_TILE];
+
+    for (long j = 0; j < width; j++)
+    {
+        max[j] = -INFINITY;
+        sum[j] = 0;
+    }
+    for (long k = 0; k < size; k++)
+    {
+        const SOFTMAX_SCALAR *x = in + k * inner;
+        for (long j = 0; j < width; j++)
+        {
+            max[j] = SOFTMAX_LIBM(fmax)(max[j], x[j]);
+        }
+    }
+    for (long k = 0; k < size; k++)
+    {
+        const SOFTMAX_SCALAR *x = in + k * inner;
+        SOFTMAX_SCALAR *y = out + k * inner;
+        SOFTMAX_SCALAR *e = loop->log ? exps : y;
+        for (long j = 0; j < width; j++)
+        {
+            e[j] = x[j] - max[j];
+        }
+        if (loop->log)
+        {
+            memcpy(y, e, width * sizeof(SOFTMAX_SCALAR));
+        }
+        loop->exp(e, e, width);
+        for (long j = 0; j < width; j++)
+        {
+            sum[j] += e[j];
+        }
+    }
+
+    for (long j = 0; j < width; j++)
+    {
+        sum[j] = loop->log ? SOFTMAX_LIBM(log)(sum[j]) : 1 / sum[j];
+    }
+    for (long k = 0; k < size; k++)
+    {
+        SOFTMAX_SCALAR *y = out + k * inner;
+        if (loop->log)
+        {
+            for (long j = 0; j < width; j++)
+            {
+                y[j] -= sum[j];
+            }
+        }
+        else
+        {
+            for (long j = 0; j < width; j++)
+            {
+                y[j] *= sum[j];
+            }
+        }
+    }
+}
+
+static void SOFTMAX(softmax_lines)(void *context, long begin, long end)
+{
+    // out = exp(in - max) / sum(exp(in - max)), or its logarithm, in - max - log(sum(exp(in - max))).
+    SoftmaxLoop *loop = (SoftmaxLoop *)context;
+    long size = loop->size;
+    long inner = loop->inner;
+    SOFTMAX_SCALAR *chunk_max = NULL;
+    size_t chunk_max_size = ((size + SOFTMAX_CHUNK - 1) / SOFTMAX_CHUNK) * sizeof(SOFTMAX_SCALAR);
+    if (inner == 1)
+    {
+        chunk_max = (SOFTMAX_SCALAR *)TensorBase_cache_malloc(chunk_max_size);
+        if (chunk_max == NULL)
+        {
+            __atomic_store_n(&loop->status, TB_MALLOC_ERROR, __ATOMIC_RELAXED);
+            return;
+        }
+    }
+
+    for (long line = begin; line < end; line++)
+    {
+        long first = (line % loop->tiles) * SOFTMAX_TILE;
+        long offset = (line / loop->tiles) * size * inner + first;
+        const SOFTMAX_SCALAR *in = (const SOFTMAX_SCALAR *)loop->in + offset;
+        SOFTMAX_SCALAR *out = (SOFTMAX_SCALAR *)loop->out + offset;
+        if (inner == 1)
+        {
+            SOFTMAX(softmax_row)(loop, in, out, chunk_max);
+        }
+        else
+        {
+            SOFTMAX(softmax_tile)(loop, in, out, min_long(SOFTMAX_TILE, inner - first));
+        }
+    }
+    TensorBase_cache_free(chunk_max, chunk_max_size);
+}
+
+static void SOFTMAX(softmax_backward_lines)(void *context, long begin, long end)
+{
+    // With y = softmax(x) and the gradient g of y, the gradient of x is y * (g - sum(g * y)).
+    // With y = log_softmax(x), it is g - exp(y) * sum(g).
+    const SoftmaxLoop *loop = (const SoftmaxLoop *)context;
+    long size = loop->size;
+    long inner = loop->inner;
+    SOFTMAX_SCALAR total[SOFTMAX_TILE];
+
+    for (long line = begin; line < end; line++)
+    {
+        long first = (line % loop->tiles) * SOFTMAX_TILE;
+        long offset = (line / loop->tiles) * size * inner + first;
+        const SOFTMAX_SCALAR *y = (const SOFTMAX_SCALAR *)loop->in + offset;
+        const SOFTMAX_SCALAR *grad = (const SOFTMAX_SCALAR *)loop->grad + offset;
+        SOFTMAX_SCALAR *out = (SOFTMAX_SCALAR *)loop->out + offset;
+        // A line of a single column is a contiguous row, which is processed as one run of size elements.
+        long width = inner == 1 ? size : min_long(SOFTMAX_TILE, inner - first);
+        long rows = inner == 1 ? 1 : size;
+
+        for (long j = 0; j < min_long(width, SOFTMAX_TILE); j++)
+        {
+            total[j] = 0;
+        }
+        for (long k = 0; k < rows; k++)
+        {
+            const SOFTMAX_SCALAR *y_row = y + k * inner;
+            const SOFTMAX_SCALAR *grad_row = grad + k * inner;
+            if (inner == 1)
+            {
+                SOFTMAX_SCALAR row_total = 0;
+                for (long j = 0; j < width; j++)
+                {
+                    row_total += loop->log ? grad_row[j] : grad_row[j] * y_row[j];
+                }
+                total[0] = row_total;
+            }
+            else if (loop->log)
+            {
+                for (long j = 0; j < width; j++)
+                {
+                    total[j] += grad_row[j];
+                }
+            }
+            else
+            {
+                for (long j = 0; j < width; j++)
+                {
+                    total[j] += grad_row[j] * y_row[j];
+                }
+            }
+        }
+
+        for (long k = 0; k < rows; k++)
+        {
+            const SOFTMAX_SCALAR *y_row = y + k * inner;
+            const SOFTMAX_SCALAR *grad_row = grad + k * inner;
+            SOFTMAX_SCALAR *out_row = out + k * inner;
+            // The total of a row applies to all of its elements, and that of a column to one element of each row.
+            long total_step = inner == 1 ? 0 : 1;
+            if (loop->log)
+            {
+                loop->exp(y_row, out_row, width);
+                for (long j = 0; j < width; j++)
+                {
+                    out_row[j] = grad_row[j] - out_row[j] * total[j * total_step];
+                }
+            }
+            else
+            {
+                for (long j = 0; j < width; j++)
+                {
+                    out_row[j] = y_row[j] * (grad_row[j] - total[j * total_step]);
+                }
+            }
+        }
+    }
+}
+
+static SOFTMAX_SCALAR SOFTMAX(row_logsumexp)(const SoftmaxLoop *loop, const SOFTMAX_SCALAR *in, long size)
+{
+    // log(sum(exp(in))) of a contiguous row, in one pass: chunk by chunk, with the sum rescaled whenever the max grows.
+    SOFTMAX_SCALAR max = -INFINITY;
+    SOFTMAX_SCALAR sum = 0;
+    SOFTMAX_SCALAR exps[SOFTMAX_CHUNK];
+    for (long start = 0; start < size; start += SOFTMAX_CHUNK)
+    {
+        long n = min_long(SOFTMAX_CHUNK, size - start);
+        const SOFTMAX_SCALAR *x = in + start;
+        SOFTMAX_SCALAR block_max = -INFINITY;
+        for (long i = 0; i < n; i++)
+        {
+            block_max = SOFTMAX_LIBM(fmax)(block_max, x[i]);
+        }
+        if (block_max == -INFINITY)
+        {
+            continue;
+        }
+        if (block_max > max)
+        {
+            sum *= SOFTMAX_LIBM(exp)(max - block_max);
+            max = block_max;
+        }
+        for (long i = 0; i < n; i++)
+        {
+            exps[i] = x[i] - max;
+        }
+        loop->exp(exps, exps, n);
+        SOFTMAX_SCALAR block_sum = 0;
+        for (long i = 0; i < n; i++)
+        {
+            block_sum += exps[i];
+        }
+        sum += block_sum;
+    }
+    return max + SOFTMAX_LIBM(log)(sum);
+}
+
+static void SOFTMAX(cross_entropy_rows)(void *context, long begin, long end)
+{
+    // For every row of logits x: lse = log(sum(exp(x))), and the loss is lse - x[target] for a class index target, or
+    // sum(target * (lse - x)) for a target of class probabilities. Rows with an ignored class index have a loss of 0.
+    const CrossEntropyLoop *loop = (const CrossEntropyLoop *)context;
+    long classes = loop->softmax.size;
+    for (long row = begin; row < end; row++)
+    {
+        const SOFTMAX_SCALAR *x = (const SOFTMAX_SCALAR *)loop->softmax.in + row * classes;
+        double loss = 0;
+        if (loop->indices != NULL)
+        {
+            int64_t target = loop->indices[row];
+            if (target == loop->ignore_index)
+            {
+                ((SOFTMAX_SCALAR *)loop->lse)[row] = 0;
+                loop->losses[row] = 0;
+                continue;
+            }
+            SOFTMAX_SCALAR lse = SOFTMAX(row_logsumexp)(&loop->softmax, x, classes);
+            ((SOFTMAX_SCALAR *)loop->lse)[row] = lse;
+            loss = lse - x[target];
+        }
+        else
+        {
+            const SOFTMAX_SCALAR *target = (const SOFTMAX_SCALAR *)loop->probabilities + row * classes;
+            SOFTMAX_SCALAR lse = SOFTMAX(row_logsumexp)(&loop->softmax, x, classes);
+            ((SOFTMAX_SCALAR *)loop->lse)[row] = lse;
+            SOFTMAX_SCALAR total = 0;
+            for (long c = 0; c < classes; c++)
+            {
+                // Classes with no probability contribute nothing, even if their logit is -inf.
+                total += target[c] == 0 ? 0 : target[c] * (lse - x[c]);
+            }
+            loss = total;
+        }
+        loop->losses[row] = loss;
+    }
+}
+
+static void SOFTMAX(cross_entropy_backward_rows)(void *context, long begin, long end)
+{
+    // The gradient of a row's loss is scale * (softmax(x) * sum(target) - target), where softmax(x) = exp(x - lse),
+    // and a class index target is one-hot. scale is the gradient of the row's loss.
+    const CrossEntropyLoop *loop = (const CrossEntropyLoop *)context;
+    long classes = loop->softmax.size;
+    for (long row = begin; row < end; row++)
+    {
+        const SOFTMAX_SCALAR *x = (const SOFTMAX_SCALAR *)loop->softmax.in + row * classes;
+        SOFTMAX_SCALAR *grad = (SOFTMAX_SCALAR *)loop->softmax.out + row * classes;
+        SOFTMAX_SCALAR lse = ((const SOFTMAX_SCALAR *)loop->lse)[row];
+        SOFTMAX_SCALAR scale = (SOFTMAX_SCALAR)(loop->grad_losses[row * loop->grad_losses_step] * loop->grad_scale);
+
+        if (loop->indices != NULL && loop->indices[row] == loop->ignore_index)
+        {
+            memset(grad, 0, classes * sizeof(SOFTMAX_SCALAR));
+            continue;
+        }
+        for (long c = 0; c < classes; c++)
+        {
+            grad[c] = x[c] - lse;
+        }
+        loop->softmax.exp(grad, grad, classes);
+
+        if (loop->indices != NULL)
+        {
+            for (long c = 0; c < classes; c++)
+            {
+                grad[c] *= scale;
+            }
+            grad[loop->indices[row]] -= scale;
+        }
+        else
+        {
+            const SOFTMAX_SCALAR *target = (const SOFTMAX_SCALAR *)loop->probabilities + row * classes;
+            SOFTMAX_SCALAR target_sum = 0;
+            for (long c = 0; c < classes; c++)
+            {
+                target_sum += target[c];
+            }
+            for (long c = 0; c < classes; c++)
+            {
+                grad[c] = scale * (grad[c] * target_sum - target[c]);
+            }
+        }
+    }
+}
+
+#undef SOFTMAX_NAME_
+#undef SOFTMAX_NAME
+#undef SOFTMAX
+#undef SOFTMAX_MATH_
+#undef SOFTMAX_MATH
+#undef SOFTMAX_LIBM
@@ -1,6 +1,23 @@
 #include "tensorbase.h"
 #include "tensorbase_util.c"
 
+static void pretty_print_element(DType dtype, scalar value)
+{
+    // Integers and bools are printed exactly, floating point elements with two decimals.
+    switch (dtype)
+    {
+    case TB_INT64:
+        printf("%lld", (long long)value);
+        break;
+    case TB_BOOL:
+        printf(value != 0 ? "True" : "False");
+        break;
+    default:
+        printf("%.2f", value);
+        break;
+    }
+}
+
 static void pretty_print_tensor_data_array(TensorBase *tb, long curr_dim, long data_index, long *offset, bool was_previous_char_newline)
 {
     if (was_previous_char_newline)
@@ -16,7 +33,7 @@ static void pretty_print_tensor_data_array(TensorBase *tb, long curr_dim, long d
         printf("[");
         for (long i = 0; i < dimension_size; i++)
         {
-            printf("%.2f", tb->data[data_index + i]);
+            pretty_print_element(tb->dtype, load_element(tb->dtype, tb->data, data_index + i * tb->strides[curr_dim]));
             if (i < dimension_size - 1)
             {
                 printf(",");
@@ -68,9 +85,9 @@ void TensorBase_to_string(TensorBase *tb)
     // Print the tensor contents.
     if (TensorBase_is_singleton(tb))
     {
-        scalar value;
-        memcpy(&value, &(tb->data), sizeof(scalar));
-        printf("Tensor(%.2f) ", value);
+        printf("Tensor(");
+        pretty_print_element(tb->dtype, TensorBase_get_singleton_value(tb));
+        printf(") ");
     }
     else
     {
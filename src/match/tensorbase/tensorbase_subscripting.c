@@ -143,36 +143,31 @@ StatusCode TensorBase_get(TensorBase *in, SubscriptArray subscripts, long num_su
     ShapeArray subtensor_shape;
     RETURN_IF_ERROR(process_subscripts_for_indexing(subscripts, num_subscripts, in->shape));
     RETURN_IF_ERROR(calculate_shape_from_subscrtips(subscripts, in->ndim, in->shape, subtensor_shape, &subtensor_ndim));
-    RETURN_IF_ERROR(TensorBase_init(subtensor, subtensor_shape, subtensor_ndim));
 
-    num_subscripts = in->ndim;
-
-    IndexArray curr_index;
-    memset(curr_index, 0, MAX_RANK * sizeof(long));
-    for (long i = 0; i < in->ndim; i++)
+    // The subtensor is a view: it starts at the element the subscripts start at, and steps through the sliced
+    // dimensions with the input's strides scaled by the slices' steps. Indexed dimensions are dropped.
+    long offset = 0;
+    long subtensor_dim = 0;
+    StrideArray subtensor_strides;
+    for (long dim = 0; dim < in->ndim; dim++)
     {
-        curr_index[i] = subscripts[i].start;
+        offset += subscripts[dim].start * in->strides[dim];
+        if (subscripts[dim].type == SLICE)
+        {
+            subtensor_strides[subtensor_dim] = subscripts[dim].step * in->strides[dim];
+            subtensor_dim++;
+        }
     }
 
-    if (TensorBase_is_singleton(subtensor))
+    if (subtensor_ndim == 0)
     {
-        long in_data_index;
-        RETURN_IF_ERROR(TensorBase_convert_indices_to_data_index(in, curr_index, &in_data_index));
-        memcpy(&subtensor->data, in->data + in_data_index, sizeof(scalar));
+        // Singletons cannot be views, so the element is copied.
+        RETURN_IF_ERROR(TensorBase_init(subtensor, subtensor_shape, subtensor_ndim, in->dtype));
+        TensorBase_set_singleton_value(subtensor, load_element(in->dtype, in->data, offset));
         return TB_OK;
     }
 
-    long curr_dim = in->ndim - 1;
-    long subtensor_numel = subtensor->numel;
-    scalar *subtensor_data = subtensor->data;
-    for (long subtensor_data_index = 0; subtensor_data_index < subtensor_numel; subtensor_data_index++)
-    {
-        long in_data_index;
-        RETURN_IF_ERROR(TensorBase_convert_indices_to_data_index(in, curr_index, &in_data_index));
-        subtensor_data[subtensor_data_index] = in->data[in_data_index];
-        get_next_coordinate(subscripts, num_subscripts, curr_index);
-    }
-
+    TensorBase_init_view(in, data_at(in->dtype, in->data, offset), subtensor_shape, subtensor_strides, subtensor_ndim, subtensor);
     return TB_OK;
 }
 
@@ -185,7 +180,7 @@ StatusCode TensorBase_set_scalar(TensorBase *in, SubscriptArray subscripts, long
 
     if (TensorBase_is_singleton(in))
     {
-        memcpy(&in->data, &s, sizeof(scalar));
+        TensorBase_set_singleton_value(in, s);
         return TB_OK;
     }
 
@@ -210,12 +205,11 @@ StatusCode TensorBase_set_scalar(TensorBase *in, SubscriptArray subscripts, long
     }
 
     long curr_dim = num_subscripts - 1;
-    scalar *data = in->data;
     for (long i = 0; i < subtensor_numel; i++)
     {
         long in_data_index;
         RETURN_IF_ERROR(TensorBase_convert_indices_to_data_index(in, curr_index, &in_data_index));
-        data[in_data_index] = s;
+        store_element(in->dtype, in->data, in_data_index, s);
         get_next_coordinate(subscripts, num_subscripts, curr_index);
     }
 
@@ -237,6 +231,27 @@ StatusCode TensorBase_set_tensorbase(TensorBase *in, SubscriptArray subscripts,
     num_subscripts = in->ndim;
     long subtensor_numel = subtensor->numel;
 
+    // The elements are copied bit for bit, so a subtensor of another dtype is converted first.
+    if (subtensor->dtype != in->dtype)
+    {
+        TensorBase converted;
+        RETURN_IF_ERROR(TensorBase_to_dtype(subtensor, in->dtype, &converted));
+        StatusCode status = TensorBase_set_tensorbase(in, subscripts, num_subscripts, &converted);
+        TensorBase_dealloc(&converted);
+        return status;
+    }
+
+    // The loop below reads the subtensor in row-major order, and must not read elements it has already overwritten
+    // (e.g., `t[1:] = t[:-1]`). So views, which may share storage with `in`, are copied first.
+    if (!TensorBase_is_singleton(subtensor) && (!TensorBase_is_contiguous(subtensor) || subtensor->storage == in->storage))
+    {
+        TensorBase copy;
+        RETURN_IF_ERROR(TensorBase_deepcopy(subtensor, &copy));
+        StatusCode status = TensorBase_set_tensorbase(in, subscripts, num_subscripts, &copy);
+        TensorBase_dealloc(&copy);
+        return status;
+    }
+
     IndexArray curr_index;
     memset(curr_index, 0, MAX_RANK * sizeof(long));
     for (long i = 0; i < in->ndim; i++)
@@ -248,18 +263,17 @@ StatusCode TensorBase_set_tensorbase(TensorBase *in, SubscriptArray subscripts,
     {
         long in_data_index;
         RETURN_IF_ERROR(TensorBase_convert_indices_to_data_index(in, curr_index, &in_data_index));
-        memcpy(in->data + in_data_index, &subtensor->data, sizeof(scalar));
+        memcpy(data_at(in->dtype, in->data, in_data_index), &subtensor->data, TensorBase_dtype_size(in->dtype));
         return TB_OK;
     }
 
     long curr_dim = num_subscripts - 1;
-    scalar *in_data = in->data;
-    scalar *subtensor_data = subtensor->data;
+    size_t element_size = TensorBase_dtype_size(in->dtype);
     for (long subtensor_data_index = 0; subtensor_data_index < subtensor_numel; subtensor_data_index++)
     {
         long in_data_index;
         RETURN_IF_ERROR(TensorBase_convert_indices_to_data_index(in, curr_index, &in_data_index));
-        in_data[in_data_index] = subtensor_data[subtensor_data_index];
+        memcpy(data_at(in->dtype, in->data, in_data_index), data_at(in->dtype, subtensor->data, subtensor_data_index), element_size);
         get_next_coordinate(subscripts, num_subscripts, curr_index);
     }
 
@@ -38,44 +38,183 @@ StatusCode TensorBase_permute(TensorBase *in, IndexArray permutation, long ndim,
         permuted_shape[i] = in->shape[dim];
     }
 
-    RETURN_IF_ERROR(TensorBase_init(out, permuted_shape, ndim));
+    // The permuted tensor is a view: the same elements, with the strides permuted along with the shape.
+    StrideArray permuted_strides;
+    for (long i = 0; i < ndim; i++)
+    {
+        permuted_strides[i] = in->strides[permutation[i]];
+    }
+    TensorBase_init_view(in, in->data, permuted_shape, permuted_strides, ndim, out);
+
+    return TB_OK;
+}
 
-    for (long in_data_index = 0; in_data_index < in->numel; in_data_index++)
+bool TensorBase_is_contiguous(TensorBase *in)
+{
+    if (TensorBase_is_singleton(in) || in->numel == 0)
     {
-        // Map each input element to its output location, applying the permutation.
-        // Example: [3,4,5] with permutation (1,0,2) swaps the first two dimensions, e.g., (x,y,z) -> (y,x,z).
+        return true;
+    }
 
-        // Decompose the flat `in_data_index` into its corresponding multi-dimensional index into the `in` tensor.
-        IndexArray in_coord;
-        for (long dim = in->ndim - 1, temp = in_data_index; dim >= 0; dim--)
+    // The stride of every dimension must be the number of elements in the dimensions after it.
+    // Dimensions of size 1 are never stepped over, so their stride does not matter.
+    long expected_stride = 1;
+    for (long dim = in->ndim - 1; dim >= 0; dim--)
+    {
+        if (in->shape[dim] != 1 && in->strides[dim] != expected_stride)
         {
-            in_coord[dim] = temp % in->shape[dim];
-            temp /= in->shape[dim];
+            return false;
         }
+        expected_stride *= in->shape[dim];
+    }
+    return true;
+}
+
+StatusCode TensorBase_view(TensorBase *in, TensorBase *out)
+{
+    if (in == NULL || out == NULL)
+    {
+        return TB_NULL_INPUT_ERROR;
+    }
+
+    if (TensorBase_is_singleton(in))
+    {
+        memcpy(out, in, sizeof(TensorBase));
+        return TB_OK;
+    }
+    TensorBase_init_view(in, in->data, in->shape, in->strides, in->ndim, out);
+    return TB_OK;
+}
+
+size_t TensorBase_element_size(DType dtype)
+{
+    return TensorBase_dtype_size(dtype);
+}
+
+void *TensorBase_data_ptr(TensorBase *in)
+{
+    return TensorBase_is_singleton(in) ? (void *)&in->data : in->data;
+}
+
+StatusCode TensorBase_contiguous(TensorBase *in, TensorBase *out)
+{
+    if (in == NULL || out == NULL)
+    {
+        return TB_NULL_INPUT_ERROR;
+    }
 
-        // Shift the dimensions of the input coordinate to obtain the permuted coordinate in the out tensor.
-        IndexArray out_coord;
-        for (long out_dim = 0; out_dim < out->ndim; out_dim++)
+    if (TensorBase_is_singleton(in) || !TensorBase_is_contiguous(in))
+    {
+        return TensorBase_deepcopy(in, out);
+    }
+
+    TensorBase_init_view(in, in->data, in->shape, in->strides, in->ndim, out);
+    return TB_OK;
+}
+
+typedef struct
+{
+    const void *in;
+    DType in_dtype;
+    void *out;
+    DType out_dtype;
+} ConvertLoop;
+
+// Converts the elements [begin, end) between arrays of in_type and out_type. Casts to bool map every nonzero to true.
+#define CONVERT_RUN(in_type, out_type)                         \
+    {                                                          \
+        const in_type *in = (const in_type *)loop->in;         \
+        out_type *out = (out_type *)loop->out;                 \
+        for (long i = begin; i < end; i++)                     \
+        {                                                      \
+            out[i] = (out_type)in[i];                          \
+        }                                                      \
+    }
+
+// Converts from in_type to the output's dtype.
+#define CONVERT_FROM(in_type)                                  \
+    switch (loop->out_dtype)                                   \
+    {                                                          \
+    case TB_FLOAT32:                                           \
+        CONVERT_RUN(in_type, float)                            \
+        break;                                                 \
+    case TB_INT64:                                             \
+        CONVERT_RUN(in_type, int64_t)                          \
+        break;                                                 \
+    case TB_BOOL:                                              \
+        CONVERT_RUN(in_type, bool)                             \
+        break;                                                 \
+    default:                                                   \
+        CONVERT_RUN(in_type, double)                           \
+        break;                                                 \
+    }
+
+static void convert_range(void *context, long begin, long end)
+{
+    // out[i] = in[i] for i in [begin, end), converted from the input's dtype to the output's.
+    ConvertLoop *loop = (ConvertLoop *)context;
+    switch (loop->in_dtype)
+    {
+    case TB_FLOAT32:
+        CONVERT_FROM(float)
+        break;
+    case TB_INT64:
+        CONVERT_FROM(int64_t)
+        break;
+    case TB_BOOL:
+        CONVERT_FROM(bool)
+        break;
+    default:
+        CONVERT_FROM(double)
+        break;
+    }
+}
+
+#undef CONVERT_FROM
+#undef CONVERT_RUN
+
+StatusCode TensorBase_to_dtype(TensorBase *in, DType dtype, TensorBase *out)
+{
+    if (in == NULL || out == NULL)
+    {
+        return TB_NULL_INPUT_ERROR;
+    }
+
+    if (in->dtype == dtype)
+    {
+        if (TensorBase_is_singleton(in))
         {
-            out_coord[out_dim] = in_coord[permutation[out_dim]];
+            memcpy(out, in, sizeof(TensorBase));
         }
-
-        long out_data_index = 0;
-        for (long out_dim = 0; out_dim < out->ndim; out_dim++)
+        else
         {
-            out_data_index += out->strides[out_dim] * out_coord[out_dim];
+            TensorBase_init_view(in, in->data, in->shape, in->strides, in->ndim, out);
         }
+        return TB_OK;
+    }
+
+    // The elements are converted in row-major order, so views are converted from a contiguous copy.
+    if (!TensorBase_is_contiguous(in))
+    {
+        TensorBase contiguous_in;
+        RETURN_IF_ERROR(TensorBase_contiguous(in, &contiguous_in));
+        StatusCode status = TensorBase_to_dtype(&contiguous_in, dtype, out);
+        TensorBase_dealloc(&contiguous_in);
+        return status;
+    }
 
-        // Or...just this. I leave this to the reader to figure out how this works.
-        // long out_data_index = 0;
-        // for (long out_dim = 0; out_dim < out->ndim; out_dim++)
-        // {
-        //     out_data_index += out->strides[out_dim] * in_coord[permutation[out_dim]];
-        // }
+    ShapeArray shape;
+    memcpy(shape, in->shape, MAX_RANK * sizeof(long));
+    RETURN_IF_ERROR(TensorBase_init(out, shape, in->ndim, dtype));
 
-        out->data[out_data_index] = in->data[in_data_index];
+    if (TensorBase_is_singleton(in))
+    {
+        TensorBase_set_singleton_value(out, TensorBase_get_singleton_value(in));
+        return TB_OK;
     }
 
+    ConvertLoop loop = {in->data, in->dtype, out->data, dtype};
+    TensorBase_parallel_for(in->numel, PARALLEL_GRAIN_ELEMENTS, convert_range, &loop);
     return TB_OK;
 }
 
@@ -125,6 +264,15 @@ StatusCode TensorBase_reshape_inplace(TensorBase *in, ShapeArray shape, long ndi
         return TB_SHAPE_MISMATCH_ERROR;
     }
 
+    // The new strides describe a row-major layout, so a non-contiguous view is replaced by a contiguous copy first.
+    if (!TensorBase_is_contiguous(in))
+    {
+        TensorBase copy;
+        RETURN_IF_ERROR(TensorBase_deepcopy(in, &copy));
+        TensorBase_dealloc(in);
+        memcpy(in, &copy, sizeof(TensorBase));
+    }
+
     // Calculate Strides of the tensor.
     StrideArray strides;
     RETURN_IF_ERROR(calculate_strides_from_shape(shape, ndim, strides));
@@ -137,15 +285,13 @@ StatusCode TensorBase_reshape_inplace(TensorBase *in, ShapeArray shape, long ndi
         if (ndim > 0)
         {
             // Allocate the new memory.
-            scalar *new_data_region = (scalar *)malloc(1 * sizeof(scalar));
-            if (new_data_region == NULL)
-            {
-                return TB_MALLOC_ERROR;
-            }
-            // Copy the bits of the original scalar into the first position of the new_data_region.
-            memcpy(new_data_region, &(in->data), sizeof(scalar));
+            TensorBaseStorage *storage;
+            RETURN_IF_ERROR(TensorBaseStorage_alloc(1, in->dtype, &storage));
+            // Copy the bits of the original element into the first position of the new storage.
+            memcpy(storage->data, &(in->data), TensorBase_dtype_size(in->dtype));
             // Assign the data point the new region in memory.
-            in->data = new_data_region;
+            in->storage = storage;
+            in->data = storage->data;
         }
     }
     else
@@ -155,11 +301,12 @@ StatusCode TensorBase_reshape_inplace(TensorBase *in, ShapeArray shape, long ndi
         if (ndim == 0)
         {
             // Get the single value from the n-dimensional tensor.
-            scalar value = *in->data;
-            // Free the memory.
-            free(in->data);
-            // Copy the memory bits from the scalar into the in->data pointer/
-            memcpy(&(in->data), &value, sizeof(scalar));
+            scalar value = load_element(in->dtype, in->data, 0);
+            // Release the storage (other views may still reference it).
+            TensorBaseStorage_release(in->storage);
+            in->storage = NULL;
+            // Store the value in the bits of the in->data pointer.
+            TensorBase_set_singleton_value(in, value);
         }
     }
 
@@ -183,17 +330,50 @@ StatusCode TensorBase_reshape(TensorBase *in, TensorBase *out, ShapeArray shape,
         return TB_INVALID_NDIM_ERROR;
     }
 
-    RETURN_IF_ERROR(TensorBase_create_empty_like(in, out));
+    // Reshaping a contiguous tensor returns a view. Otherwise, the elements are copied into row-major order first.
+    RETURN_IF_ERROR(TensorBase_contiguous(in, out));
 
-    // must also copy the data over if not a single object.
-    if (!TensorBase_is_singleton(in))
+    StatusCode status = TensorBase_reshape_inplace(out, shape, ndim);
+    if (status != TB_OK)
     {
-        memcpy(out->data, in->data, out->numel * sizeof(scalar));
+        TensorBase_dealloc(out);
+    }
+    return status;
+}
+
+// Sets n elements of type `type`, `step` elements apart, to fill_value.
+#define FILL_RUN(type)                                        \
+    {                                                         \
+        type *elements = (type *)run;                         \
+        type value = (type)fill_value;                        \
+        for (long i = 0; i < n; i++)                          \
+        {                                                     \
+            elements[i * step] = value;                       \
+        }                                                     \
     }
 
-    return TensorBase_reshape_inplace(out, shape, ndim);
+static void fill_run(DType dtype, void *run, long step, long n, scalar fill_value)
+{
+    // run[i * step] = fill_value for i < n, where `run` is an array of `dtype`.
+    switch (dtype)
+    {
+    case TB_FLOAT32:
+        FILL_RUN(float)
+        break;
+    case TB_INT64:
+        FILL_RUN(int64_t)
+        break;
+    case TB_BOOL:
+        FILL_RUN(bool)
+        break;
+    default:
+        FILL_RUN(double)
+        break;
+    }
 }
 
+#undef FILL_RUN
+
 StatusCode TensorBase_fill_(TensorBase *in, scalar fill_value)
 {
     if (in == NULL)
@@ -203,7 +383,7 @@ StatusCode TensorBase_fill_(TensorBase *in, scalar fill_value)
 
     if (TensorBase_is_singleton(in))
     {
-        memcpy(&(in->data), &fill_value, sizeof(scalar));
+        TensorBase_set_singleton_value(in, fill_value);
         return TB_OK;
     }
 
@@ -212,9 +392,22 @@ StatusCode TensorBase_fill_(TensorBase *in, scalar fill_value)
         return TB_NULL_INPUT_ERROR;
     }
 
-    for (long i = 0; i < in->numel; i++)
+    if (TensorBase_is_contiguous(in))
     {
-        in->data[i] = fill_value;
+        fill_run(in->dtype, in->data, 1, in->numel, fill_value);
+        return TB_OK;
+    }
+
+    // Fill a view one run of its innermost (merged) dimension at a time.
+    BroadcastIterator it;
+    BroadcastIterator_init(&it, in->shape, in->strides, in->ndim, in->shape, in->strides, 0, in->shape, in->ndim);
+    long inner_dim = it.ndim - 1;
+    long run_length = it.shape[inner_dim];
+    long step = it.a_strides[inner_dim];
+    for (long run_start = 0; run_start < in->numel; run_start += run_length)
+    {
+        fill_run(in->dtype, data_at(in->dtype, in->data, it.a_data_index), step, run_length, fill_value);
+        BroadcastIterator_next(&it, inner_dim);
     }
 
     return TB_OK;
@@ -230,18 +423,31 @@ StatusCode TensorBase_randn_(TensorBase *in, scalar mu, scalar sigma)
     if (TensorBase_is_singleton(in))
     {
         randn_pair pair = randn(mu, sigma);
-        memcpy(&in->data, &pair.a, sizeof(scalar));
+        TensorBase_set_singleton_value(in, pair.a);
         return TB_OK;
     }
+    if (!TensorBase_is_contiguous(in))
+    {
+        // Generate the values for a view in a contiguous buffer, and then copy them into the view's elements.
+        TensorBase values;
+        RETURN_IF_ERROR(TensorBase_create_empty_like(in, &values));
+        StatusCode status = TensorBase_randn_(&values, mu, sigma);
+        if (status == TB_OK)
+        {
+            copy_strided(in->dtype, values.data, values.strides, in->data, in->strides, in->shape, in->ndim);
+        }
+        TensorBase_dealloc(&values);
+        return status;
+    }
+
     // Assumes tensor is already initialized with a valid `data` pointer.
-    scalar *data = in->data;
     for (long index = 0; index < in->numel; index += 2)
     {
         randn_pair pair = randn(mu, sigma);
-        data[index] = pair.a;
+        store_element(in->dtype, in->data, index, pair.a);
         if (index + 1 < in->numel)
         {
-            data[index + 1] = pair.b;
+            store_element(in->dtype, in->data, index + 1, pair.b);
         }
     }
 
@@ -257,12 +463,310 @@ StatusCode TensorBase_item(TensorBase *t, scalar *item)
 
     if (TensorBase_is_singleton(t))
     {
-        memcpy(item, &(t->data), sizeof(scalar));
+        *item = TensorBase_get_singleton_value(t);
     }
     else
     {
-        *item = *(t->data);
+        *item = load_element(t->dtype, t->data, 0);
+    }
+
+    return TB_OK;
+}
+typedef struct
+{
+    long count;
+    char **pieces;                 // First element of each (contiguous) piece.
+    const size_t *piece_row_bytes; // Bytes of each piece per row of the whole.
+    char *whole;
+    size_t whole_row_bytes;
+    bool split; // Copy the whole into the pieces, instead of the pieces into the whole.
+} BlockCopyLoop;
+
+static void block_copy_rows(void *context, long begin, long end)
+{
+    // Row r of the whole is row r of every piece, one after the other. The rows are the (flattened) dimensions
+    // before the concatenated one, so each is a single contiguous run in the pieces and in the whole.
+    BlockCopyLoop *loop = (BlockCopyLoop *)context;
+    for (long row = begin; row < end; row++)
+    {
+        char *whole_row = loop->whole + row * loop->whole_row_bytes;
+        for (long i = 0; i < loop->count; i++)
+        {
+            size_t bytes = loop->piece_row_bytes[i];
+            if (bytes > 0)
+            {
+                char *piece_row = loop->pieces[i] + row * bytes;
+                if (loop->split)
+                {
+                    memcpy(piece_row, whole_row, bytes);
+                }
+                else
+                {
+                    memcpy(whole_row, piece_row, bytes);
+                }
+            }
+            whole_row += bytes;
+        }
+    }
+}
+
+static StatusCode block_copy(TensorBase **pieces, long count, TensorBase *whole, long rows, bool split)
+{
+    // Copies between the pieces and the whole, which are split into `rows` equal runs each (see block_copy_rows).
+    // Views are copied through contiguous copies (of the pieces when joining, of the whole when splitting).
+    if (rows == 0 || whole->numel == 0)
+    {
+        return TB_OK;
+    }
+
+    size_t element_size = TensorBase_element_size(whole->dtype);
+    size_t state_size = count * (sizeof(TensorBase) + sizeof(char *) + sizeof(size_t));
+    TensorBase *contiguous_pieces = (TensorBase *)TensorBase_cache_malloc(state_size);
+    if (contiguous_pieces == NULL)
+    {
+        return TB_MALLOC_ERROR;
+    }
+    char **piece_data = (char **)(contiguous_pieces + count);
+    size_t *piece_row_bytes = (size_t *)(piece_data + count);
+
+    StatusCode status = TB_OK;
+    long converted = 0;
+    for (; converted < count && !split; converted++)
+    {
+        status = TensorBase_contiguous(pieces[converted], &contiguous_pieces[converted]);
+        if (status != TB_OK)
+        {
+            break;
+        }
+    }
+    TensorBase contiguous_whole;
+    if (status == TB_OK && split)
+    {
+        status = TensorBase_contiguous(whole, &contiguous_whole);
     }
 
+    if (status == TB_OK)
+    {
+        for (long i = 0; i < count; i++)
+        {
+            TensorBase *piece = split ? pieces[i] : &contiguous_pieces[i];
+            piece_data[i] = (char *)TensorBase_data_ptr(piece);
+            piece_row_bytes[i] = piece->numel / rows * element_size;
+        }
+        long row_elements = whole->numel / rows;
+        BlockCopyLoop loop = {count, piece_data, piece_row_bytes, (char *)TensorBase_data_ptr(split ? &contiguous_whole : whole),
+                              row_elements * element_size, split};
+        TensorBase_parallel_for(rows, max_long(1, PARALLEL_GRAIN_ELEMENTS / row_elements), block_copy_rows, &loop);
+        if (split)
+        {
+            TensorBase_dealloc(&contiguous_whole);
+        }
+    }
+
+    for (long i = 0; i < converted; i++)
+    {
+        TensorBase_dealloc(&contiguous_pieces[i]);
+    }
+    TensorBase_cache_free(contiguous_pieces, state_size);
+    return status;
+}
+
+static StatusCode check_pieces(TensorBase **ins, long count)
+{
+    if (ins == NULL || count < 1)
+    {
+        return TB_NULL_INPUT_ERROR;
+    }
+    for (long i = 0; i < count; i++)
+    {
+        if (ins[i] == NULL)
+        {
+            return TB_NULL_INPUT_ERROR;
+        }
+        if (ins[i]->dtype != ins[0]->dtype)
+        {
+            return TB_UNSUPPORTED_DTYPE_ERROR;
+        }
+        if (ins[i]->ndim != ins[0]->ndim)
+        {
+            return TB_SHAPE_MISMATCH_ERROR;
+        }
+    }
     return TB_OK;
-}
\ No newline at end of file
+}
+
+StatusCode TensorBase_concatenate(TensorBase **ins, long count, long dim, TensorBase *out)
+{
+    if (out == NULL)
+    {
+        return TB_NULL_INPUT_ERROR;
+    }
+    RETURN_IF_ERROR(check_pieces(ins, count));
+
+    long ndim = ins[0]->ndim;
+    if (ndim == 0)
+    {
+        return TB_INVALID_NDIM_ERROR;
+    }
+    if (dim < 0)
+    {
+        dim += ndim;
+    }
+    if (dim < 0 || dim >= ndim)
+    {
+        return TB_DIMENSION_OUT_OF_BOUNDS_ERROR;
+    }
+
+    // Every input has the shape of the first, except along dim, where the output has the sum of their sizes.
+    ShapeArray shape;
+    memcpy(shape, ins[0]->shape, MAX_RANK * sizeof(long));
+    shape[dim] = 0;
+    for (long i = 0; i < count; i++)
+    {
+        for (long d = 0; d < ndim; d++)
+        {
+            if (d != dim && ins[i]->shape[d] != shape[d])
+            {
+                return TB_SHAPE_MISMATCH_ERROR;
+            }
+        }
+        shape[dim] += ins[i]->shape[dim];
+    }
+
+    long rows = 1;
+    for (long d = 0; d < dim; d++)
+    {
+        rows *= shape[d];
+    }
+    RETURN_IF_ERROR(TensorBase_init(out, shape, ndim, ins[0]->dtype));
+    StatusCode status = block_copy(ins, count, out, rows, false);
+    if (status != TB_OK)
+    {
+        TensorBase_dealloc(out);
+    }
+    return status;
+}
+
+StatusCode TensorBase_stack(TensorBase **ins, long count, long dim, TensorBase *out)
+{
+    if (out == NULL)
+    {
+        return TB_NULL_INPUT_ERROR;
+    }
+    RETURN_IF_ERROR(check_pieces(ins, count));
+
+    long ndim = ins[0]->ndim;
+    if (ndim + 1 > MAX_RANK)
+    {
+        return TB_INVALID_NDIM_ERROR;
+    }
+    if (dim < 0)
+    {
+        dim += ndim + 1;
+    }
+    if (dim < 0 || dim > ndim)
+    {
+        return TB_DIMENSION_OUT_OF_BOUNDS_ERROR;
+    }
+    for (long i = 0; i < count; i++)
+    {
+        if (!TensorBase_same_shape(ins[i]->shape, ins[0]->shape))
+        {
+            return TB_SHAPE_MISMATCH_ERROR;
+        }
+    }
+
+    // The output has a new dimension of size count at dim, so each input is a run of every row of the output.
+    ShapeArray shape;
+    long rows = 1;
+    for (long d = 0; d < ndim + 1; d++)
+    {
+        shape[d] = d < dim ? ins[0]->shape[d] : d == dim ? count : ins[0]->shape[d - 1];
+        rows *= d < dim ? shape[d] : 1;
+    }
+    for (long d = ndim + 1; d < MAX_RANK; d++)
+    {
+        shape[d] = -1;
+    }
+    RETURN_IF_ERROR(TensorBase_init(out, shape, ndim + 1, ins[0]->dtype));
+    StatusCode status = block_copy(ins, count, out, rows, false);
+    if (status != TB_OK)
+    {
+        TensorBase_dealloc(out);
+    }
+    return status;
+}
+
+StatusCode TensorBase_split(TensorBase *in, const long *sizes, long count, long dim, TensorBase *outs)
+{
+    if (in == NULL || sizes == NULL || outs == NULL || count < 1)
+    {
+        return TB_NULL_INPUT_ERROR;
+    }
+    if (in->ndim == 0)
+    {
+        return TB_INVALID_NDIM_ERROR;
+    }
+    if (dim < 0)
+    {
+        dim += in->ndim;
+    }
+    if (dim < 0 || dim >= in->ndim)
+    {
+        return TB_DIMENSION_OUT_OF_BOUNDS_ERROR;
+    }
+
+    long total = 0;
+    for (long i = 0; i < count; i++)
+    {
+        if (sizes[i] < 0)
+        {
+            return TB_INVALID_DIMENSION_SIZE_ERROR;
+        }
+        total += sizes[i];
+    }
+    if (total != in->shape[dim])
+    {
+        return TB_SHAPE_MISMATCH_ERROR;
+    }
+
+    long rows = 1;
+    for (long d = 0; d < dim; d++)
+    {
+        rows *= in->shape[d];
+    }
+
+    size_t pieces_size = count * sizeof(TensorBase *);
+    TensorBase **pieces = (TensorBase **)TensorBase_cache_malloc(pieces_size);
+    if (pieces == NULL)
+    {
+        return TB_MALLOC_ERROR;
+    }
+    StatusCode status = TB_OK;
+    long created = 0;
+    for (; created < count; created++)
+    {
+        ShapeArray shape;
+        memcpy(shape, in->shape, MAX_RANK * sizeof(long));
+        shape[dim] = sizes[created];
+        status = TensorBase_init(&outs[created], shape, in->ndim, in->dtype);
+        if (status != TB_OK)
+        {
+            break;
+        }
+        pieces[created] = &outs[created];
+    }
+    if (status == TB_OK)
+    {
+        status = block_copy(pieces, count, in, rows, true);
+    }
+    if (status != TB_OK)
+    {
+        for (long i = 0; i < created; i++)
+        {
+            TensorBase_dealloc(&outs[i]);
+        }
+    }
+    TensorBase_cache_free(pieces, pieces_size);
+    return status;
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "tensorbase.h"
+#include <stdint.h>
 
 // C macro do{}while(0).
 #define RETURN_IF_ERROR(x) ({ StatusCode _status = x; if (_status != TB_OK) { return _status; } })
@@ -25,26 +26,230 @@ static inline int TensorBase_same_shape(ShapeArray a_shape, ShapeArray b_shape)
     return memcmp(a_shape, b_shape, MAX_RANK * sizeof(long)) == 0;
 }
 
+static inline bool TensorBase_shares_storage(TensorBase *a, TensorBase *b)
+{
+    // Whether writing to the elements of one tensor may change the elements of the other.
+    return !TensorBase_is_singleton(a) && !TensorBase_is_singleton(b) && a->storage == b->storage;
+}
+
+static inline bool TensorBase_same_layout(TensorBase *a, TensorBase *b)
+{
+    // Whether the tensors are views of the same elements, in the same order.
+    return a->data == b->data && a->ndim == b->ndim && TensorBase_same_shape(a->shape, b->shape) &&
+           memcmp(a->strides, b->strides, a->ndim * sizeof(long)) == 0;
+}
+
+static inline size_t TensorBase_dtype_size(DType dtype)
+{
+    switch (dtype)
+    {
+    case TB_FLOAT32:
+        return sizeof(float);
+    case TB_INT64:
+        return sizeof(int64_t);
+    case TB_BOOL:
+        return sizeof(bool);
+    default:
+        return sizeof(double);
+    }
+}
+
+static inline bool TensorBase_is_floating_dtype(DType dtype)
+{
+    return dtype == TB_FLOAT64 || dtype == TB_FLOAT32;
+}
+
+static inline void *data_at(DType dtype, const void *data, long index)
+{
+    // The address of data[index] in an array of `dtype`.
+    return (char *)data + index * (long)TensorBase_dtype_size(dtype);
+}
+
+static inline scalar load_element(DType dtype, const void *data, long index)
+{
+    // Reads data[index] from an array of `dtype` as a scalar. Meant for single elements, not for loops over tensors.
+    switch (dtype)
+    {
+    case TB_FLOAT32:
+    {
+        float value;
+        memcpy(&value, data_at(dtype, data, index), sizeof(float));
+        return value;
+    }
+    case TB_INT64:
+    {
+        int64_t value;
+        memcpy(&value, data_at(dtype, data, index), sizeof(int64_t));
+        return (scalar)value;
+    }
+    case TB_BOOL:
+        return *(const bool *)data_at(dtype, data, index);
+    default:
+    {
+        double value;
+        memcpy(&value, data_at(dtype, data, index), sizeof(double));
+        return value;
+    }
+    }
+}
+
+static inline void store_element(DType dtype, void *data, long index, scalar value)
+{
+    // Writes a scalar into data[index] of an array of `dtype`, rounding it to the dtype.
+    switch (dtype)
+    {
+    case TB_FLOAT32:
+    {
+        float element = (float)value;
+        memcpy(data_at(dtype, data, index), &element, sizeof(float));
+        break;
+    }
+    case TB_INT64:
+    {
+        int64_t element = (int64_t)value;
+        memcpy(data_at(dtype, data, index), &element, sizeof(int64_t));
+        break;
+    }
+    case TB_BOOL:
+        *(bool *)data_at(dtype, data, index) = value != 0;
+        break;
+    default:
+        memcpy(data_at(dtype, data, index), &value, sizeof(double));
+        break;
+    }
+}
+
+static inline DType promote_dtypes(DType a, DType b)
+{
+    // The floating point dtype both operands of an operation are computed in: float32 if both of them are float32, or
+    // one is float32 and the other is an integer or bool (e.g., a mask), and float64 otherwise.
+    bool a_is_float32 = a == TB_FLOAT32;
+    bool b_is_float32 = b == TB_FLOAT32;
+    if ((a_is_float32 && b_is_float32) ||
+        (a_is_float32 && !TensorBase_is_floating_dtype(b)) ||
+        (b_is_float32 && !TensorBase_is_floating_dtype(a)))
+    {
+        return TB_FLOAT32;
+    }
+    return TB_FLOAT64;
+}
+
+static inline bool is_comparison(BinaryScalarOperation binop)
+{
+    return binop == SCALAR_EQ || binop == SCALAR_LT || binop == SCALAR_GT ||
+           binop == SCALAR_NEQ || binop == SCALAR_LEQ || binop == SCALAR_GEQ;
+}
+
+static inline scalar TensorBase_get_singleton_value(TensorBase *t)
+{
+    // Singletons store their value in the bits of the data pointer.
+    return load_element(t->dtype, &t->data, 0);
+}
+
+static inline void TensorBase_set_singleton_value(TensorBase *t, scalar value)
+{
+    // Clear the pointer first, so the bits a narrower dtype leaves unused are always zero.
+    t->data = NULL;
+    store_element(t->dtype, &t->data, 0, value);
+}
+
+// The storage header is padded to TB_ALIGNMENT bytes, so the buffer after it is aligned as well.
+#define STORAGE_HEADER_SIZE ((sizeof(TensorBaseStorage) + TB_ALIGNMENT - 1) / TB_ALIGNMENT * TB_ALIGNMENT)
+
+static StatusCode TensorBaseStorage_alloc(long numel, DType dtype, TensorBaseStorage **storage)
+{
+    // The header and the buffer share one allocation from the caching allocator, with the buffer after the header.
+    size_t size = STORAGE_HEADER_SIZE + numel * TensorBase_dtype_size(dtype);
+    TensorBaseStorage *new_storage = (TensorBaseStorage *)TensorBase_cache_malloc(size);
+    if (new_storage == NULL)
+    {
+        return TB_MALLOC_ERROR;
+    }
+    new_storage->ref_count = 1;
+    new_storage->numel = numel;
+    new_storage->size = size;
+    new_storage->data = (char *)new_storage + STORAGE_HEADER_SIZE;
+    *storage = new_storage;
+    return TB_OK;
+}
+
+static void TensorBaseStorage_release(TensorBaseStorage *storage)
+{
+    if (storage == NULL)
+    {
+        return;
+    }
+    storage->ref_count--;
+    if (storage->ref_count == 0)
+    {
+        TensorBase_cache_free(storage, storage->size);
+    }
+}
+
 static StatusCode TensorBase_create_empty_like(TensorBase *in, TensorBase *out)
 {
     // Assumes out->data doesn't point to any alocated memory.
+    // The output is contiguous and has its own storage, even if `in` is a view.
     if (in == NULL || out == NULL)
     {
         return TB_NULL_INPUT_ERROR; // Invalid input or output tensor
     }
 
-    memcpy(out, in, sizeof(TensorBase));
+    if (TensorBase_is_singleton(in))
+    {
+        // Singletons hold their value in the data pointer, so it is copied along.
+        memcpy(out, in, sizeof(TensorBase));
+        return TB_OK;
+    }
 
-    if (!TensorBase_is_singleton(in))
+    ShapeArray shape;
+    memcpy(shape, in->shape, MAX_RANK * sizeof(long));
+    return TensorBase_init(out, shape, in->ndim, in->dtype);
+}
+
+static StatusCode TensorBase_create_empty_with_dtype(TensorBase *in, DType dtype, TensorBase *out)
+{
+    // Like TensorBase_create_empty_like, but the output has `dtype` (e.g., the bool result of a comparison).
+    // A singleton output holds zero.
+    if (in == NULL || out == NULL)
     {
-        out->data = (scalar *)malloc(in->numel * sizeof(scalar));
-        if (out->data == NULL)
-        {
-            return TB_MALLOC_ERROR;
-        }
+        return TB_NULL_INPUT_ERROR;
     }
 
-    return TB_OK;
+    if (TensorBase_is_singleton(in))
+    {
+        memcpy(out, in, sizeof(TensorBase));
+        out->dtype = dtype;
+        TensorBase_set_singleton_value(out, 0);
+        return TB_OK;
+    }
+
+    ShapeArray shape;
+    memcpy(shape, in->shape, MAX_RANK * sizeof(long));
+    return TensorBase_init(out, shape, in->ndim, dtype);
+}
+
+static void TensorBase_init_view(TensorBase *in, void *data, ShapeArray shape, StrideArray strides, long ndim, TensorBase *out)
+{
+    // Makes `out` a view of (a subset of) the elements in the storage of `in`, starting at `data`.
+    // Assumes `in` is not a singleton, and that the shape and strides address elements inside the storage.
+    long numel = 1;
+    for (long dim = 0; dim < ndim; dim++)
+    {
+        numel *= shape[dim];
+    }
+
+    out->storage = in->storage;
+    out->storage->ref_count++;
+    out->numel = numel;
+    out->ndim = ndim;
+    for (long dim = 0; dim < MAX_RANK; dim++)
+    {
+        out->shape[dim] = dim < ndim ? shape[dim] : -1;
+        out->strides[dim] = dim < ndim ? strides[dim] : 0;
+    }
+    out->dtype = in->dtype;
+    out->data = data;
 }
 
 static StatusCode TensorBase_convert_indices_to_data_index(TensorBase *in, IndexArray coord, long *data_index)
@@ -114,25 +319,17 @@ static StatusCode TensorBase_get_broadcast_shape(ShapeArray a_shape, long a_ndim
 
     while (out_dim >= 0)
     {
-        bool a_dimension_is_one = (a_dim >= 0 && a_shape[a_dim] == 1);
-        bool a_dimension_out_of_bounds = (a_dim < 0 && b_dim >= 0);
-
-        bool b_dimension_is_one = (b_dim >= 0 && b_shape[b_dim] == 1);
-        bool b_dimension_out_of_bounds = (b_dim < 0 && a_dim >= 0);
-
-        bool dimensions_match = (a_dim >= 0 && b_dim >= 0) && (a_shape[a_dim] == b_shape[b_dim]);
+        // A missing (leading) dimension behaves like a dimension of size 1.
+        long a_size = a_dim >= 0 ? a_shape[a_dim] : 1;
+        long b_size = b_dim >= 0 ? b_shape[b_dim] : 1;
 
-        if (a_dimension_is_one || a_dimension_out_of_bounds)
+        if (a_size == b_size || b_size == 1)
         {
-            broadcasted_shape[out_dim] = b_shape[b_dim];
+            broadcasted_shape[out_dim] = a_size;
         }
-        else if (b_dimension_is_one || b_dimension_out_of_bounds)
+        else if (a_size == 1)
         {
-            broadcasted_shape[out_dim] = a_shape[a_dim];
-        }
-        else if (dimensions_match)
-        {
-            broadcasted_shape[out_dim] = a_shape[a_dim]; // Equivalently, broadcasted_shape[out_dim] = b_shape[b_dim];
+            broadcasted_shape[out_dim] = b_size;
         }
         else
         {
@@ -147,7 +344,33 @@ static StatusCode TensorBase_get_broadcast_shape(ShapeArray a_shape, long a_ndim
     return TB_OK;
 }
 
-static void TensorBase_get_translated_data_indices_from_broadcasted_index(
+// Minimum number of elements each thread processes in a parallel elementwise loop (or copy). Below this, waking the
+// thread pool costs more than the loop itself.
+#define PARALLEL_GRAIN_ELEMENTS 32768
+
+// Walks the elements of a broadcasted shape while tracking the corresponding data index of each of two operands.
+// Instead of recomputing every coordinate with `%` and `/`, the iterator advances like an odometer: each step adds the
+// operands' stride deltas to their data indices, and only a carry into the next dimension touches more than one counter.
+// Adjacent dimensions that are contiguous in both operands (or broadcast in both) are merged when the iterator is
+// initialized, so e.g. a row-vector bias add over (n, m) becomes a single run of n * m elements when the operands
+// match, and a column-vector broadcast runs m elements at a time with the column operand held fixed.
+typedef struct
+{
+    // Number of dimensions after merging (at least 1).
+    long ndim;
+    // The merged broadcasted shape.
+    ShapeArray shape;
+    // The operands' strides over the merged shape. Broadcasted dimensions have a stride of 0.
+    StrideArray a_strides;
+    StrideArray b_strides;
+    // The current coordinate in the merged shape, and the corresponding data index in each operand.
+    IndexArray coordinate;
+    long a_data_index;
+    long b_data_index;
+} BroadcastIterator;
+
+static void BroadcastIterator_init(
+    BroadcastIterator *it,
     ShapeArray a_shape,
     StrideArray a_strides,
     long a_ndim,
@@ -155,168 +378,105 @@ static void TensorBase_get_translated_data_indices_from_broadcasted_index(
     StrideArray b_strides,
     long b_ndim,
     ShapeArray broadcasted_shape,
-    long broadcasted_ndim,
-    long broadcasted_data_index,
-    long *a_data_index,
-    long *b_data_index)
+    long broadcasted_ndim)
 {
     // Assumes a_shape, b_shape are broadcastable and the broadcasted shape is broadcasted_shape.
-    // Calculate the corresponding data index in each of the input tensors data array.
-
-    long a_dim = a_ndim - 1;
-    long b_dim = b_ndim - 1;
-    long broadcast_dim = broadcasted_ndim - 1;
-
-    long a_data_index_local_ = 0;
-    long b_data_index_local_ = 0;
-    while (broadcast_dim >= 0)
+    it->ndim = 0;
+    for (long broadcast_dim = 0; broadcast_dim < broadcasted_ndim; broadcast_dim++)
     {
-        long broadcast_coordinate_at_curr_dim = broadcasted_data_index % broadcasted_shape[broadcast_dim];
-        broadcasted_data_index /= broadcasted_shape[broadcast_dim];
-
-        // Maps the broadcasted coordinate back to the input tensor's coordinate.
-        // If the input tensor's dimension size is 1, any coordinate in the corresponding broadcasted dimension maps to 0 in the input tensor.
-        // Otherwise, if the input tensor's dimension size is greater than 1, the broadcasted coordinate is directly used as the input tensor's coordinate.
-
-        // Check if dimension 'a_dim' contributes to the broadcasted tensor.
-        bool a_dimension_is_included = (a_dim >= 0 && a_shape[a_dim] > 1);
-        // Translate the broadcasted coordinate to the corresponding coordinate in 'a'.
-        long a_translated_coordinate = a_dimension_is_included ? broadcast_coordinate_at_curr_dim : 0;
-
-        // Check if dimension 'b_dim' contributes to the broadcasted tensor.
-        bool b_dimension_is_included = (b_dim >= 0 && b_shape[b_dim] > 1);
-        // Translate the broadcasted coordinate to the corresponding coordinate in 'b'.
-        long b_translated_coordinate = b_dimension_is_included ? broadcast_coordinate_at_curr_dim : 0;
+        long size = broadcasted_shape[broadcast_dim];
+        if (size == 1)
+        {
+            // Dimensions of size 1 never move the data indices.
+            continue;
+        }
 
-        a_data_index_local_ += a_translated_coordinate * a_strides[a_dim];
-        b_data_index_local_ += b_translated_coordinate * b_strides[b_dim];
+        // Align the operands' dimensions to the right of the broadcasted shape.
+        // An operand dimension of size 1 (or a missing leading dimension) is broadcasted and gets a stride of 0.
+        long a_dim = a_ndim - broadcasted_ndim + broadcast_dim;
+        long b_dim = b_ndim - broadcasted_ndim + broadcast_dim;
+        long a_stride = (a_dim >= 0 && a_shape[a_dim] > 1) ? a_strides[a_dim] : 0;
+        long b_stride = (b_dim >= 0 && b_shape[b_dim] > 1) ? b_strides[b_dim] : 0;
+
+        // Merge with the previous dimension if stepping through this dimension once more is the same as taking one step
+        // in the previous dimension, for both operands.
+        long previous = it->ndim - 1;
+        if (previous >= 0 &&
+            it->a_strides[previous] == a_stride * size &&
+            it->b_strides[previous] == b_stride * size)
+        {
+            it->shape[previous] *= size;
+            it->a_strides[previous] = a_stride;
+            it->b_strides[previous] = b_stride;
+            continue;
+        }
 
-        broadcast_dim--;
-        a_dim--;
-        b_dim--;
+        it->shape[it->ndim] = size;
+        it->a_strides[it->ndim] = a_stride;
+        it->b_strides[it->ndim] = b_stride;
+        it->ndim++;
     }
 
-    *a_data_index = a_data_index_local_;
-    *b_data_index = b_data_index_local_;
-}
-
-static void matrix_multiply_2d(scalar *A, scalar *B, long n, long l, long m, scalar *out)
-{
-    // Assumes A is a n x l matrix
-    // Assumes B is a l x m matrix
-    // out = A@B will be a n x m matrix
-    // Assumes out is already allocated
-    for (long i = 0; i < n; i++)
+    if (it->ndim == 0)
     {
-        for (long j = 0; j < m; j++)
-        {
-            scalar sum = 0;
-            for (long k = 0; k < l; k++)
-            {
-                sum += A[i * l + k] * B[k * m + j];
-            }
-            out[i * m + j] = sum;
-        }
+        // Every dimension had size 1: a single element.
+        it->shape[0] = 1;
+        it->a_strides[0] = 0;
+        it->b_strides[0] = 0;
+        it->ndim = 1;
     }
-}
 
-static inline void apply_binop(BinaryScalarOperation binop, scalar a, scalar b, scalar *result)
-{
-    switch (binop)
+    for (long dim = 0; dim < MAX_RANK; dim++)
     {
-    case SCALAR_ADD:
-        *result = a + b;
-        break;
-    case SCALAR_SUB:
-        *result = a - b;
-        break;
-    case SCALAR_MULT:
-        *result = a * b;
-        break;
-    case SCALAR_FLOORDIV:
-        *result = floor(a / b);
-        break;
-    case SCALAR_TRUEDIV:
-        *result = a / b;
-        break;
-    case SCALAR_POWER:
-        *result = pow(a, b);
-        break;
-    case SCALAR_EQ:
-        *result = (a == b);
-        break;
-    case SCALAR_LT:
-        *result = (a < b);
-        break;
-    case SCALAR_GT:
-        *result = (a > b);
-        break;
-    case SCALAR_NEQ:
-        *result = (a != b);
-        break;
-    case SCALAR_LEQ:
-        *result = (a <= b);
-        break;
-    case SCALAR_GEQ:
-        *result = (a >= b);
-        break;
-    default:
-        break;
+        it->coordinate[dim] = 0;
     }
+    it->a_data_index = 0;
+    it->b_data_index = 0;
 }
 
-static inline void apply_uop(UnaryScalarOperation uop, scalar a, scalar *result)
+static inline void BroadcastIterator_seek(BroadcastIterator *it, long ndim, long index)
 {
-    switch (uop)
+    // Moves to the `index`-th coordinate (in row-major order) of the first `ndim` merged dimensions, e.g., to start
+    // the share of a parallel loop that begins there.
+    it->a_data_index = 0;
+    it->b_data_index = 0;
+    for (long dim = ndim - 1; dim >= 0; dim--)
     {
-    case SCALAR_NEGATIVE:
-        *result = -a;
-        break;
-    case SCALAR_ABSOLUTE:
-        *result = fabs(a);
-        break;
-    case SCALAR_COS:
-        *result = cos(a);
-        break;
-    case SCALAR_SIN:
-        *result = sin(a);
-        break;
-    case SCALAR_TAN:
-        *result = tan(a);
-        break;
-    case SCALAR_TANH:
-        *result = tanh(a);
-        break;
-    case SCALAR_LOG:
-        *result = log(a);
-        break;
-    case SCALAR_EXP:
-        *result = exp(a);
-        break;
-    case SCALAR_SIGMOID:
-        *result = 1.0 / (1.0 + exp(-a));
-        break;
-    case SCALAR_RELU:
-        *result = fmax(0, a);
-        break;
-    default:
-        break;
+        it->coordinate[dim] = index % it->shape[dim];
+        index /= it->shape[dim];
+        it->a_data_index += it->coordinate[dim] * it->a_strides[dim];
+        it->b_data_index += it->coordinate[dim] * it->b_strides[dim];
     }
 }
 
-static StatusCode TensorBase_initialize_for_matrix_multiplication(TensorBase *a, TensorBase *b, TensorBase *out)
+static inline void BroadcastIterator_next(BroadcastIterator *it, long ndim)
 {
-    if (a == NULL || b == NULL || out == NULL)
+    // Moves to the next coordinate of the first `ndim` merged dimensions, i.e., skips over the remaining (inner)
+    // dimensions, which the caller processes as one run. Wraps around to the origin after the last coordinate.
+    for (long dim = ndim - 1; dim >= 0; dim--)
     {
-        return TB_NULL_INPUT_ERROR;
+        it->coordinate[dim]++;
+        it->a_data_index += it->a_strides[dim];
+        it->b_data_index += it->b_strides[dim];
+        if (it->coordinate[dim] < it->shape[dim])
+        {
+            return;
+        }
+        // Carry into the next dimension.
+        it->coordinate[dim] = 0;
+        it->a_data_index -= it->a_strides[dim] * it->shape[dim];
+        it->b_data_index -= it->b_strides[dim] * it->shape[dim];
     }
+}
 
+static StatusCode matrix_multiplication_shape(TensorBase *a, TensorBase *b, ShapeArray shape, long *out_ndim)
+{
+    // The shape of a @ b, with the batch dimensions broadcasted.
     if (TensorBase_is_singleton(a) || TensorBase_is_singleton(b))
     {
         return TB_MATMUL_WITH_SINGLETON_OPERAND_ERROR;
     }
 
-    ShapeArray shape;
     long ndim;
 
     if (a->ndim == 1 && b->ndim == 1)
@@ -410,7 +570,21 @@ static StatusCode TensorBase_initialize_for_matrix_multiplication(TensorBase *a,
         shape[i] = -1;
     }
 
-    return TensorBase_init(out, shape, ndim);
+    *out_ndim = ndim;
+    return TB_OK;
+}
+
+static StatusCode TensorBase_initialize_for_matrix_multiplication(TensorBase *a, TensorBase *b, TensorBase *out)
+{
+    if (a == NULL || b == NULL || out == NULL)
+    {
+        return TB_NULL_INPUT_ERROR;
+    }
+
+    ShapeArray shape;
+    long ndim;
+    RETURN_IF_ERROR(matrix_multiplication_shape(a, b, shape, &ndim));
+    return TensorBase_init(out, shape, ndim, a->dtype);
 }
 
 static StatusCode calculate_strides_from_shape(ShapeArray shape, long ndim, StrideArray strides)
@@ -483,8 +657,265 @@ static randn_pair randn(scalar mu, scalar sigma)
     return result;
 }
 
+// Blocks with both sides at most this long are transposed directly. A 32 x 32 block of the input and of the output
+// (2 x 8KB) stay resident in the L1 cache, so both the reads and the writes are consumed a full cache line at a time.
+#define TRANSPOSE_TILE 32
+
+// Defines transpose_2d_tiled_<type>, which transposes a matrix of elements of `type`.
+// Copies only move bits, so there is one variant per element size rather than per dtype.
+#define DEFINE_TRANSPOSE_2D_TILED(type)                                                                                          \
+    static void transpose_2d_tiled_##type(const type *in, long in_row_stride, type *out, long out_row_stride, long rows, long cols) \
+    {                                                                                                                            \
+        /* out[j, i] = in[i, j] for a rows x cols input, where both matrices have unit column stride.                         */ \
+        /* The longer side is halved recursively (cache-oblivious), so the blocks fit every level of the cache hierarchy     */ \
+        /* without tuning a tile size per level.                                                                              */ \
+        if (rows > TRANSPOSE_TILE && rows >= cols)                                                                               \
+        {                                                                                                                        \
+            long half = rows / 2;                                                                                                \
+            transpose_2d_tiled_##type(in, in_row_stride, out, out_row_stride, half, cols);                                       \
+            transpose_2d_tiled_##type(in + half * in_row_stride, in_row_stride, out + half, out_row_stride, rows - half, cols);  \
+            return;                                                                                                              \
+        }                                                                                                                        \
+        if (cols > TRANSPOSE_TILE)                                                                                               \
+        {                                                                                                                        \
+            long half = cols / 2;                                                                                                \
+            transpose_2d_tiled_##type(in, in_row_stride, out, out_row_stride, rows, half);                                       \
+            transpose_2d_tiled_##type(in + half, in_row_stride, out + half * out_row_stride, out_row_stride, rows, cols - half); \
+            return;                                                                                                              \
+        }                                                                                                                        \
+                                                                                                                                 \
+        for (long j = 0; j < cols; j++)                                                                                          \
+        {                                                                                                                        \
+            type *out_row = out + j * out_row_stride;                                                                            \
+            for (long i = 0; i < rows; i++)                                                                                      \
+            {                                                                                                                    \
+                out_row[i] = in[i * in_row_stride + j];                                                                          \
+            }                                                                                                                    \
+        }                                                                                                                        \
+    }
+
+// Defines copy_run_<type>, which copies n elements of `type` between two strided runs.
+#define DEFINE_COPY_RUN(type)                                                                           \
+    static void copy_run_##type(const type *in, long in_step, type *out, long out_step, long n)         \
+    {                                                                                                   \
+        for (long i = 0; i < n; i++)                                                                    \
+        {                                                                                               \
+            out[i * out_step] = in[i * in_step];                                                        \
+        }                                                                                               \
+    }
+
+DEFINE_TRANSPOSE_2D_TILED(uint8_t)
+DEFINE_TRANSPOSE_2D_TILED(uint32_t)
+DEFINE_TRANSPOSE_2D_TILED(uint64_t)
+DEFINE_COPY_RUN(uint8_t)
+DEFINE_COPY_RUN(uint32_t)
+DEFINE_COPY_RUN(uint64_t)
+
+static void transpose_2d_tiled(size_t element_size, const void *in, long in_row_stride, void *out, long out_row_stride, long rows, long cols)
+{
+    if (element_size == sizeof(uint8_t))
+    {
+        transpose_2d_tiled_uint8_t((const uint8_t *)in, in_row_stride, (uint8_t *)out, out_row_stride, rows, cols);
+    }
+    else if (element_size == sizeof(uint32_t))
+    {
+        transpose_2d_tiled_uint32_t((const uint32_t *)in, in_row_stride, (uint32_t *)out, out_row_stride, rows, cols);
+    }
+    else
+    {
+        transpose_2d_tiled_uint64_t((const uint64_t *)in, in_row_stride, (uint64_t *)out, out_row_stride, rows, cols);
+    }
+}
+
+static void copy_run(size_t element_size, const void *in, long in_step, void *out, long out_step, long n)
+{
+    if (in_step == 1 && out_step == 1)
+    {
+        memcpy(out, in, n * element_size);
+    }
+    else if (element_size == sizeof(uint8_t))
+    {
+        copy_run_uint8_t((const uint8_t *)in, in_step, (uint8_t *)out, out_step, n);
+    }
+    else if (element_size == sizeof(uint32_t))
+    {
+        copy_run_uint32_t((const uint32_t *)in, in_step, (uint32_t *)out, out_step, n);
+    }
+    else
+    {
+        copy_run_uint64_t((const uint64_t *)in, in_step, (uint64_t *)out, out_step, n);
+    }
+}
+
+typedef struct
+{
+    const char *in;
+    char *out;
+    size_t element_size;
+    long ndim;
+    ShapeArray shape;
+    StrideArray in_strides;
+    StrideArray out_strides;
+    long out_inner_dim;
+    long in_inner_dim;
+    long strip_length; // Length of the strips the output's innermost dimension is split into.
+    long strip_count;  // Number of strips per row (or 2-D block).
+} CopyStridedLoop;
+
+static void copy_strided_strips(void *context, long begin, long end)
+{
+    // Copies the strips [begin, end) of a strided copy. A strip is a segment of a row of the output's innermost
+    // dimension, or of a 2-D block spanned by the innermost dimensions of the output and the input (a transpose).
+    CopyStridedLoop *loop = (CopyStridedLoop *)context;
+    long out_inner_dim = loop->out_inner_dim;
+    long in_inner_dim = loop->in_inner_dim;
+
+    // Every other dimension is walked by an odometer, starting from the coordinate of the first strip.
+    IndexArray coordinate = {0};
+    long in_offset = 0;
+    long out_offset = 0;
+    long remainder = begin / loop->strip_count;
+    for (long dim = loop->ndim - 1; dim >= 0; dim--)
+    {
+        if (dim == out_inner_dim || dim == in_inner_dim)
+        {
+            continue;
+        }
+        coordinate[dim] = remainder % loop->shape[dim];
+        remainder /= loop->shape[dim];
+        in_offset += coordinate[dim] * loop->in_strides[dim];
+        out_offset += coordinate[dim] * loop->out_strides[dim];
+    }
+
+    long strip = begin % loop->strip_count;
+    for (long strip_index = begin; strip_index < end; strip_index++)
+    {
+        long strip_start = strip * loop->strip_length;
+        long strip_length = min_long(loop->strip_length, loop->shape[out_inner_dim] - strip_start);
+        size_t element_size = loop->element_size;
+        const char *in = loop->in + (in_offset + strip_start * loop->in_strides[out_inner_dim]) * (long)element_size;
+        char *out = loop->out + (out_offset + strip_start * loop->out_strides[out_inner_dim]) * (long)element_size;
+
+        if (in_inner_dim != out_inner_dim)
+        {
+            // Transpose the strip of the 2-D block spanned by the two innermost dimensions, in tiles.
+            // Rows of the block follow the output's innermost dimension, columns follow the input's.
+            transpose_2d_tiled(element_size, in, loop->in_strides[out_inner_dim], out, loop->out_strides[in_inner_dim],
+                               strip_length, loop->shape[in_inner_dim]);
+        }
+        else
+        {
+            copy_run(element_size, in, loop->in_strides[out_inner_dim], out, loop->out_strides[out_inner_dim], strip_length);
+        }
+
+        strip++;
+        if (strip < loop->strip_count)
+        {
+            continue;
+        }
+        strip = 0;
+        for (long dim = loop->ndim - 1; dim >= 0; dim--)
+        {
+            if (dim == out_inner_dim || dim == in_inner_dim)
+            {
+                continue;
+            }
+            coordinate[dim]++;
+            in_offset += loop->in_strides[dim];
+            out_offset += loop->out_strides[dim];
+            if (coordinate[dim] < loop->shape[dim])
+            {
+                break;
+            }
+            coordinate[dim] = 0;
+            in_offset -= loop->in_strides[dim] * loop->shape[dim];
+            out_offset -= loop->out_strides[dim] * loop->shape[dim];
+        }
+    }
+}
+
+static void copy_strided(DType dtype, const void *in, StrideArray in_strides, void *out, StrideArray out_strides, ShapeArray shape, long ndim)
+{
+    // out[c] = in[c] for every coordinate c of `shape`, where both tensors are arrays of `dtype` with arbitrary strides.
+    // Dimensions of size 1 are dropped, and adjacent dimensions that are contiguous in both tensors are merged, so e.g.
+    // a permutation that keeps the last two dimensions together copies whole rows.
+    long numel = 1;
+    long copy_ndim = 0;
+    ShapeArray copy_shape;
+    StrideArray copy_in_strides;
+    StrideArray copy_out_strides;
+    for (long dim = 0; dim < ndim; dim++)
+    {
+        long size = shape[dim];
+        numel *= size;
+        if (size == 1)
+        {
+            continue;
+        }
+        long previous = copy_ndim - 1;
+        if (previous >= 0 &&
+            copy_in_strides[previous] == in_strides[dim] * size &&
+            copy_out_strides[previous] == out_strides[dim] * size)
+        {
+            copy_shape[previous] *= size;
+            copy_in_strides[previous] = in_strides[dim];
+            copy_out_strides[previous] = out_strides[dim];
+            continue;
+        }
+        copy_shape[copy_ndim] = size;
+        copy_in_strides[copy_ndim] = in_strides[dim];
+        copy_out_strides[copy_ndim] = out_strides[dim];
+        copy_ndim++;
+    }
+
+    if (numel == 0)
+    {
+        return;
+    }
+    if (copy_ndim == 0)
+    {
+        memcpy(out, in, TensorBase_dtype_size(dtype));
+        return;
+    }
+
+    // Rows follow the output's innermost dimension. If another dimension is contiguous in the input (e.g., a
+    // transpose), the 2-D blocks spanned by the two dimensions are transposed in tiles instead of copied row by row.
+    long out_inner_dim = copy_ndim - 1;
+    long in_inner_dim = out_inner_dim;
+    if (copy_out_strides[out_inner_dim] == 1 && copy_in_strides[out_inner_dim] != 1)
+    {
+        for (long dim = 0; dim < copy_ndim; dim++)
+        {
+            if (copy_in_strides[dim] == 1)
+            {
+                in_inner_dim = dim;
+            }
+        }
+    }
+
+    CopyStridedLoop loop = {in, out, TensorBase_dtype_size(dtype), copy_ndim, {0}, {0}, {0}, out_inner_dim, in_inner_dim};
+    memcpy(loop.shape, copy_shape, MAX_RANK * sizeof(long));
+    memcpy(loop.in_strides, copy_in_strides, MAX_RANK * sizeof(long));
+    memcpy(loop.out_strides, copy_out_strides, MAX_RANK * sizeof(long));
+
+    // Long rows (and tall 2-D blocks) are split into strips of about PARALLEL_GRAIN_ELEMENTS elements, so that even a
+    // single 2-D transpose is shared between threads.
+    long row_count = numel / copy_shape[out_inner_dim];
+    long elements_per_row = 1;
+    if (in_inner_dim != out_inner_dim)
+    {
+        row_count /= copy_shape[in_inner_dim];
+        elements_per_row = copy_shape[in_inner_dim];
+    }
+    loop.strip_length = max_long(TRANSPOSE_TILE, PARALLEL_GRAIN_ELEMENTS / elements_per_row);
+    loop.strip_count = (copy_shape[out_inner_dim] + loop.strip_length - 1) / loop.strip_length;
+    long elements_per_strip = min_long(loop.strip_length, copy_shape[out_inner_dim]) * elements_per_row;
+    TensorBase_parallel_for(row_count * loop.strip_count, max_long(1, PARALLEL_GRAIN_ELEMENTS / elements_per_strip), copy_strided_strips, &loop);
+}
+
 static StatusCode TensorBase_deepcopy(TensorBase *in, TensorBase *out)
 {
+    // Copies `in` into a new, contiguous tensor with its own storage.
     if (in == NULL || out == NULL)
     {
         return TB_NULL_INPUT_ERROR;
@@ -494,7 +925,7 @@ static StatusCode TensorBase_deepcopy(TensorBase *in, TensorBase *out)
 
     if (!TensorBase_is_singleton(in))
     {
-        memcpy(out->data, in->data, in->numel * sizeof(scalar));
+        copy_strided(in->dtype, in->data, in->strides, out->data, out->strides, in->shape, in->ndim);
     }
 
     return TB_OK;
@@ -50,6 +50,12 @@ static PyObject *PyTensorBase_nb_power(PyObject *a, PyObject *b, PyObject *c);
 static PyObject *PyTensorBase_nb_negative(PyObject *a);
 static PyObject *PyTensorBase_nb_absolute(PyObject *a);
 
+static PyObject *PyTensorBase_nb_inplace_add(PyObject *a, PyObject *b);
+static PyObject *PyTensorBase_nb_inplace_subtract(PyObject *a, PyObject *b);
+static PyObject *PyTensorBase_nb_inplace_multiply(PyObject *a, PyObject *b);
+static PyObject *PyTensorBase_nb_inplace_floor_divide(PyObject *a, PyObject *b);
+static PyObject *PyTensorBase_nb_inplace_true_divide(PyObject *a, PyObject *b);
+
 // https://docs.python.org/3/c-api/typeobj.html#number-object-structures
 static PyNumberMethods PyTensorBase_as_number = {
     .nb_add = (binaryfunc)PyTensorBase_nb_add,
@@ -73,11 +79,11 @@ static PyNumberMethods PyTensorBase_as_number = {
     // .nb_or = 0,
     // .nb_int = 0,
     // .nb_float = 0,
-    // .nb_inplace_add = 0,
-    // .nb_inplace_subtract = 0,
-    // .nb_inplace_multiply = 0,
-    // .nb_inplace_floor_divide = 0,
-    // .nb_inplace_true_divide = 0,
+    .nb_inplace_add = (binaryfunc)PyTensorBase_nb_inplace_add,
+    .nb_inplace_subtract = (binaryfunc)PyTensorBase_nb_inplace_subtract,
+    .nb_inplace_multiply = (binaryfunc)PyTensorBase_nb_inplace_multiply,
+    .nb_inplace_floor_divide = (binaryfunc)PyTensorBase_nb_inplace_floor_divide,
+    .nb_inplace_true_divide = (binaryfunc)PyTensorBase_nb_inplace_true_divide,
     // .nb_inplace_remainder = 0,
     // .nb_inplace_matrix_multiply = 0,
     // .nb_inplace_power = 0,
@@ -131,6 +137,19 @@ static PyMappingMethods PyTensorBase_mapping_methods = {
     .mp_ass_subscript = (objobjargproc)PyTensorBase_setitem, // __setitem__
 };
 
+/*********************************************************
+ *                   Buffer Protocol                     *
+ *********************************************************/
+
+// https://docs.python.org/3/c-api/typeobj.html#buffer-object-structures
+static int PyTensorBase_getbuffer(PyTensorBase *self, Py_buffer *view, int flags);
+static void PyTensorBase_releasebuffer(PyTensorBase *self, Py_buffer *view);
+
+static PyBufferProcs PyTensorBase_as_buffer = {
+    .bf_getbuffer = (getbufferproc)PyTensorBase_getbuffer,
+    .bf_releasebuffer = (releasebufferproc)PyTensorBase_releasebuffer,
+};
+
 /*********************************************************
  *                   Instance Methods                    *
  *********************************************************/
@@ -184,9 +203,47 @@ static PyObject *PyTensorBase_argmin(PyObject *self, PyObject *const *args, Py_s
 
 static PyObject *PyTensorBase_unbroadcast(PyObject *self, PyObject *args);
 static PyObject *PyTensorBase_permute(PyObject *self, PyObject *args);
+static PyObject *PyTensorBase_im2col(PyObject *self, PyObject *args, PyObject *kwds);
+static PyObject *PyTensorBase_col2im(PyObject *self, PyObject *args, PyObject *kwds);
+static PyObject *PyTensorBase_conv2d(PyObject *self, PyObject *args, PyObject *kwds);
 static PyObject *PyTensorBase_transpose(PyObject *self, PyObject *args);
+static PyObject *PyTensorBase_is_contiguous(PyObject *self, PyObject *args);
+static PyObject *PyTensorBase_contiguous(PyObject *self, PyObject *args);
+static PyObject *PyTensorBase_deepcopy(PyObject *self, PyObject *memo);
+static PyObject *PyTensorBase_to(PyObject *self, PyObject *dtype);
+
+static PyObject *PyTensorBase_add(PyObject *self, PyObject *args, PyObject *kwds);
+static PyObject *PyTensorBase_sub(PyObject *self, PyObject *args, PyObject *kwds);
+static PyObject *PyTensorBase_mul(PyObject *self, PyObject *args, PyObject *kwds);
+static PyObject *PyTensorBase_div(PyObject *self, PyObject *args, PyObject *kwds);
+static PyObject *PyTensorBase_matmul(PyObject *self, PyObject *args, PyObject *kwds);
+
+static PyObject *PyTensorBase_frombuffer(PyObject *cls, PyObject *args, PyObject *kwds);
+static PyObject *PyTensorBase_from_sequence(PyObject *cls, PyObject *args, PyObject *kwds);
+static PyObject *PyTensorBase_concatenate(PyObject *Py_UNUSED(cls), PyObject *args, PyObject *kwds);
+static PyObject *PyTensorBase_stack(PyObject *Py_UNUSED(cls), PyObject *args, PyObject *kwds);
+static PyObject *PyTensorBase_split(PyObject *self, PyObject *args, PyObject *kwds);
+static PyObject *PyTensorBase_softmax(PyObject *self, PyObject *args, PyObject *kwds);
+static PyObject *PyTensorBase_log_softmax(PyObject *self, PyObject *args, PyObject *kwds);
+static PyObject *PyTensorBase_softmax_backward(PyObject *self, PyObject *args, PyObject *kwds);
+static PyObject *PyTensorBase_log_softmax_backward(PyObject *self, PyObject *args, PyObject *kwds);
+static PyObject *PyTensorBase_cross_entropy(PyObject *self, PyObject *args, PyObject *kwds);
+static PyObject *PyTensorBase_cross_entropy_backward(PyObject *self, PyObject *args, PyObject *kwds);
+static PyObject *PyTensorBase_layer_norm(PyObject *self, PyObject *args, PyObject *kwds);
+static PyObject *PyTensorBase_layer_norm_backward(PyObject *self, PyObject *args, PyObject *kwds);
+static PyObject *PyTensorBase_scaled_dot_product_attention(PyObject *self, PyObject *args, PyObject *kwds);
+static PyObject *PyTensorBase_scaled_dot_product_attention_backward(PyObject *self, PyObject *args, PyObject *kwds);
+static PyObject *PyTensorBase_kv_cache_write_(PyObject *self, PyObject *args, PyObject *kwds);
+static PyObject *PyTensorBase_linear(PyObject *self, PyObject *args, PyObject *kwds);
+static PyObject *PyTensorBase_linear_backward(PyObject *self, PyObject *args, PyObject *kwds);
 
 static PyMethodDef PyTensorBase_instance_methods[] = {
+    // Constructors.
+    {"frombuffer", (PyCFunction)PyTensorBase_frombuffer, METH_VARARGS | METH_KEYWORDS | METH_CLASS, "1D tensor copied from the bytes of a buffer, read as elements of dtype."},
+    {"from_sequence", (PyCFunction)PyTensorBase_from_sequence, METH_VARARGS | METH_KEYWORDS | METH_CLASS, "Tensor copied from (nested sequences of) numbers or a buffer, converted to dtype."},
+    {"concatenate", (PyCFunction)PyTensorBase_concatenate, METH_VARARGS | METH_KEYWORDS | METH_STATIC, "Join a sequence of tensors along an existing dimension dim."},
+    {"stack", (PyCFunction)PyTensorBase_stack, METH_VARARGS | METH_KEYWORDS | METH_STATIC, "Join a sequence of tensors of one shape along a new dimension dim."},
+
     // Methods with no arguments.
     {"abs_", (PyCFunction)PyTensorBase_abs_, METH_NOARGS, "In-place absolute value."},
     {"abs", (PyCFunction)PyTensorBase_abs, METH_NOARGS, "Out-of-place absolute value."},
@@ -221,6 +278,10 @@ static PyMethodDef PyTensorBase_instance_methods[] = {
 
     {"transpose", (PyCFunction)PyTensorBase_transpose, METH_NOARGS, "Transpose the tensor."},
 
+    {"is_contiguous", (PyCFunction)PyTensorBase_is_contiguous, METH_NOARGS, "Whether the elements are laid out in row-major order without gaps."},
+    {"contiguous", (PyCFunction)PyTensorBase_contiguous, METH_NOARGS, "The tensor itself if contiguous, otherwise a contiguous copy."},
+    {"__deepcopy__", (PyCFunction)PyTensorBase_deepcopy, METH_O, "A contiguous copy of the tensor that does not share its storage (for copy.deepcopy)."},
+
     // Methods with arguments.
     {"reshape_", (PyCFunction)PyTensorBase_reshape_, METH_O, "In-place reshape."},
     {"reshape", (PyCFunction)PyTensorBase_reshape, METH_O, "Out-of-place reshape."},
@@ -229,6 +290,12 @@ static PyMethodDef PyTensorBase_instance_methods[] = {
 
     {"randn_", (PyCFunctionFast)PyTensorBase_randn_, METH_FASTCALL, "In-place randn."},
 
+    {"add", (PyCFunction)PyTensorBase_add, METH_VARARGS | METH_KEYWORDS, "Addition, optionally written to the existing tensor `out`."},
+    {"sub", (PyCFunction)PyTensorBase_sub, METH_VARARGS | METH_KEYWORDS, "Subtraction, optionally written to the existing tensor `out`."},
+    {"mul", (PyCFunction)PyTensorBase_mul, METH_VARARGS | METH_KEYWORDS, "Multiplication, optionally written to the existing tensor `out`."},
+    {"div", (PyCFunction)PyTensorBase_div, METH_VARARGS | METH_KEYWORDS, "True division, optionally written to the existing tensor `out`."},
+    {"matmul", (PyCFunction)PyTensorBase_matmul, METH_VARARGS | METH_KEYWORDS, "Matrix multiplication, optionally written to the existing tensor `out`."},
+
     {"max", (PyCFunctionFast)PyTensorBase_max, METH_FASTCALL, "Compute the maximum value."},
     {"min", (PyCFunctionFast)PyTensorBase_min, METH_FASTCALL, "Compute the minimum value."},
 
@@ -241,6 +308,26 @@ static PyMethodDef PyTensorBase_instance_methods[] = {
     {"unbroadcast", (PyCFunction)PyTensorBase_unbroadcast, METH_O, "Unbroadcast TensorBase."},
 
     {"permute", (PyCFunction)PyTensorBase_permute, METH_O, "Permute the dimensions of the array."},
+
+    {"im2col", (PyCFunction)PyTensorBase_im2col, METH_VARARGS | METH_KEYWORDS, "Columns of the sliding kernel windows over an (N, C, H, W) or (C, H, W) tensor."},
+    {"col2im", (PyCFunction)PyTensorBase_col2im, METH_VARARGS | METH_KEYWORDS, "Sum of im2col columns back into an (N, C, H, W) or (C, H, W) tensor of the given output_size."},
+    {"conv2d", (PyCFunction)PyTensorBase_conv2d, METH_VARARGS | METH_KEYWORDS, "2D cross-correlation of an (N, C, H, W) or (C, H, W) tensor with an (O, C * kh * kw) weight of the given kernel_size, by the given algorithm."},
+    {"linear", (PyCFunction)PyTensorBase_linear, METH_VARARGS | METH_KEYWORDS, "activation(self @ weight^T + bias) of a (..., in) tensor and an (out, in) weight, with the bias and activation ('relu', 'sigmoid', 'tanh' or None) applied in the GEMM's epilogue."},
+    {"linear_backward", (PyCFunction)PyTensorBase_linear_backward, METH_VARARGS | METH_KEYWORDS, "Gradients of linear, called on its input with its weight, output and the gradient of the output. Returns (input gradient, weight gradient, bias gradient or None)."},
+
+    {"softmax", (PyCFunction)PyTensorBase_softmax, METH_VARARGS | METH_KEYWORDS, "Softmax along dim, computed with the max subtracted."},
+    {"log_softmax", (PyCFunction)PyTensorBase_log_softmax, METH_VARARGS | METH_KEYWORDS, "Logarithm of the softmax along dim, computed with the max subtracted."},
+    {"softmax_backward", (PyCFunction)PyTensorBase_softmax_backward, METH_VARARGS | METH_KEYWORDS, "Gradient of softmax's input, called on softmax's output with the gradient of the output."},
+    {"log_softmax_backward", (PyCFunction)PyTensorBase_log_softmax_backward, METH_VARARGS | METH_KEYWORDS, "Gradient of log_softmax's input, called on log_softmax's output with the gradient of the output."},
+    {"cross_entropy", (PyCFunction)PyTensorBase_cross_entropy, METH_VARARGS | METH_KEYWORDS, "Cross-entropy loss of (N, C) or (C) logits against class indices or class probabilities, and the log-sum-exp of every row."},
+    {"cross_entropy_backward", (PyCFunction)PyTensorBase_cross_entropy_backward, METH_VARARGS | METH_KEYWORDS, "Gradient of cross_entropy's logits, called on the logits with the target, the log-sum-exps and the gradient of the loss."},
+    {"layer_norm", (PyCFunction)PyTensorBase_layer_norm, METH_VARARGS | METH_KEYWORDS, "Layer normalization over the last normalized_ndim dimensions, of the tensor plus an optional residual. Returns (output, normalized input, mean, rstd)."},
+    {"layer_norm_backward", (PyCFunction)PyTensorBase_layer_norm_backward, METH_VARARGS | METH_KEYWORDS, "Gradients of layer_norm, called on its normalized input. Returns (input gradient, weight gradient or None, bias gradient or None)."},
+    {"scaled_dot_product_attention", (PyCFunction)PyTensorBase_scaled_dot_product_attention, METH_VARARGS | METH_KEYWORDS, "Attention of these queries over key and value, computed tile by tile without storing the scores. Returns (output, lse)."},
+    {"scaled_dot_product_attention_backward", (PyCFunction)PyTensorBase_scaled_dot_product_attention_backward, METH_VARARGS | METH_KEYWORDS, "Gradients of scaled_dot_product_attention, called on the queries. Returns (query gradient, key gradient, value gradient)."},
+    {"kv_cache_write_", (PyCFunction)PyTensorBase_kv_cache_write_, METH_VARARGS | METH_KEYWORDS, "In-place write of (N, ..., T, D) rows into this (N, ..., L, D) key/value cache, at the int64 positions of every batch entry."},
+    {"split", (PyCFunction)PyTensorBase_split, METH_VARARGS | METH_KEYWORDS, "List of contiguous pieces along dim, of the given sizes or of split_size elements each (the last may be smaller)."},
+    {"to", (PyCFunction)PyTensorBase_to, METH_O, "The tensor itself if it has the dtype ('float32', 'float64', 'int64' or 'bool'), otherwise a converted copy."},
     {NULL} /* Sentinel */
 };
 
@@ -262,6 +349,8 @@ static PyObject *PyTensorBase_get_size(PyTensorBase *self, PyObject *Py_UNUSED(i
 static PyObject *PyTensorBase_get_numel(PyTensorBase *self, PyObject *Py_UNUSED(ignored));
 static PyObject *PyTensorBase_get_stride(PyTensorBase *self, PyObject *Py_UNUSED(ignored));
 static PyObject *PyTensorBase_get_raw_data(PyTensorBase *self, PyObject *Py_UNUSED(ignored));
+static PyObject *PyTensorBase_get_dtype(PyTensorBase *self, PyObject *Py_UNUSED(ignored));
+static PyObject *PyTensorBase_get_array_interface(PyTensorBase *self, PyObject *Py_UNUSED(ignored));
 
 static PyGetSetDef PyTensorBase_getset[] = {
     {"dim", (getter)PyTensorBase_get_dim, NULL, "Gets tensor rank", NULL},
@@ -269,6 +358,8 @@ static PyGetSetDef PyTensorBase_getset[] = {
     {"numel", (getter)PyTensorBase_get_numel, NULL, "Number of elements in Tensor", NULL},
     {"stride", (getter)PyTensorBase_get_stride, NULL, "Strides of tensor", NULL},
     {"_raw_data", (getter)PyTensorBase_get_raw_data, NULL, "The raw data of the tensorbase.", NULL},
+    {"dtype", (getter)PyTensorBase_get_dtype, NULL, "Element type of the tensor ('float32', 'float64', 'int64' or 'bool').", NULL},
+    {"__array_interface__", (getter)PyTensorBase_get_array_interface, NULL, "NumPy array interface sharing the tensor's memory.", NULL},
     {NULL} /* Sentinel */
 };
 
@@ -278,6 +369,37 @@ static PyGetSetDef PyTensorBase_getset[] = {
 
 static PyObject *PyTensorBase_str(PyTensorBase *obj);
 
+/*********************************************************
+ *                    Module Methods                     *
+ *********************************************************/
+
+static PyObject *TensorBaseModule_instruction_set(PyObject *module, PyObject *Py_UNUSED(args));
+static PyObject *TensorBaseModule_set_fast_math(PyObject *module, PyObject *enabled);
+static PyObject *TensorBaseModule_get_fast_math(PyObject *module, PyObject *Py_UNUSED(args));
+static PyObject *TensorBaseModule_set_num_threads(PyObject *module, PyObject *num_threads);
+static PyObject *TensorBaseModule_get_num_threads(PyObject *module, PyObject *Py_UNUSED(args));
+static PyObject *TensorBaseModule_empty_cache(PyObject *module, PyObject *Py_UNUSED(args));
+static PyObject *TensorBaseModule_memory_stats(PyObject *module, PyObject *Py_UNUSED(args));
+static PyObject *TensorBaseModule_sgd_step(PyObject *module, PyObject *args, PyObject *kwds);
+static PyObject *TensorBaseModule_adam_step(PyObject *module, PyObject *args, PyObject *kwds);
+static PyObject *TensorBaseModule_set_conv2d_benchmark(PyObject *module, PyObject *enabled);
+static PyObject *TensorBaseModule_get_conv2d_benchmark(PyObject *module, PyObject *Py_UNUSED(args));
+
+static PyMethodDef TensorBaseModule_methods[] = {
+    {"instruction_set", (PyCFunction)TensorBaseModule_instruction_set, METH_NOARGS, "Name of the instruction set the elementwise kernels were dispatched to."},
+    {"set_fast_math", (PyCFunction)TensorBaseModule_set_fast_math, METH_O, "Enable or disable the faster, less accurate tier of exp, log, tanh, sigmoid and pow."},
+    {"get_fast_math", (PyCFunction)TensorBaseModule_get_fast_math, METH_NOARGS, "Whether the fast-math tier of exp, log, tanh, sigmoid and pow is enabled."},
+    {"set_num_threads", (PyCFunction)TensorBaseModule_set_num_threads, METH_O, "Set the number of threads the tensor kernels run on."},
+    {"get_num_threads", (PyCFunction)TensorBaseModule_get_num_threads, METH_NOARGS, "Number of threads the tensor kernels run on."},
+    {"empty_cache", (PyCFunction)TensorBaseModule_empty_cache, METH_NOARGS, "Return the buffers cached by the tensor allocator to the system."},
+    {"memory_stats", (PyCFunction)TensorBaseModule_memory_stats, METH_NOARGS, "Dictionary of the tensor allocator's statistics."},
+    {"sgd_step", (PyCFunction)TensorBaseModule_sgd_step, METH_VARARGS | METH_KEYWORDS, "Fused in-place SGD (with momentum) step over lists of parameters, gradients and momentum buffers."},
+    {"adam_step", (PyCFunction)TensorBaseModule_adam_step, METH_VARARGS | METH_KEYWORDS, "Fused in-place Adam or AdamW step over lists of parameters, gradients and moment estimates."},
+    {"set_conv2d_benchmark", (PyCFunction)TensorBaseModule_set_conv2d_benchmark, METH_O, "Select conv2d algorithms by timing them instead of by their estimated cost, and forget the cached selections."},
+    {"get_conv2d_benchmark", (PyCFunction)TensorBaseModule_get_conv2d_benchmark, METH_NOARGS, "Whether conv2d algorithms are selected by timing them."},
+    {NULL} /* Sentinel */
+};
+
 /*********************************************************
  *                   Module Definition                   *
  *********************************************************/
@@ -309,7 +431,7 @@ static PyTypeObject PyTensorBaseType = {
     // .tp_setattro = 0,
 
     /* Functions to access object as input/output buffer */
-    // .tp_as_buffer = 0,
+    .tp_as_buffer = &PyTensorBase_as_buffer,
 
     /* Flags to define presence of optional/expanded features */
     .tp_flags = Py_TPFLAGS_DEFAULT,
@@ -371,7 +493,7 @@ static PyModuleDef TensorBaseModule = {
     .m_name = "tensorbase",
     .m_doc = PyDoc_STR("TODO: docs"),
     .m_size = -1,
-    .m_methods = 0,
+    .m_methods = TensorBaseModule_methods,
 };
 
 PyMODINIT_FUNC
@@ -380,6 +502,9 @@ PyInit_tensorbase(void)
     if (PyType_Ready(&PyTensorBaseType) < 0)
         return NULL;
 
+    // Select the elementwise kernels for this CPU once, before any tensor operation runs.
+    TensorBase_init_kernels();
+
     PyObject *m = PyModule_Create(&TensorBaseModule);
     if (m == NULL)
         return NULL;
@@ -421,6 +546,42 @@ static scalar PyFloatOrLong_asDouble(PyObject *obj)
     }
     return PyFloat_AsDouble(obj);
 }
+
+static const char *DType_name(DType dtype)
+{
+    switch (dtype)
+    {
+    case TB_FLOAT32:
+        return "float32";
+    case TB_INT64:
+        return "int64";
+    case TB_BOOL:
+        return "bool";
+    default:
+        return "float64";
+    }
+}
+
+static int PyDType_Converter(PyObject *obj, DType *dtype)
+{
+    // Parses a dtype name. Returns 1 on success and 0 (with an exception set) otherwise.
+    if (!PyUnicode_Check(obj))
+    {
+        PyErr_SetString(PyExc_TypeError, "dtype must be a string ('float32', 'float64', 'int64' or 'bool').");
+        return 0;
+    }
+    for (DType candidate = 0; candidate < NUM_DTYPES; candidate++)
+    {
+        if (PyUnicode_CompareWithASCIIString(obj, DType_name(candidate)) == 0)
+        {
+            *dtype = candidate;
+            return 1;
+        }
+    }
+    PyErr_SetString(PyExc_ValueError, "Unsupported dtype, expected 'float32', 'float64', 'int64' or 'bool'.");
+    return 0;
+}
+
 static long arg_to_shape(PyObject *arg, ShapeArray tb_shape)
 {
     PyObject *shape_array = arg;
@@ -574,6 +735,9 @@ static PyObject *PyTensorBase_nb_unary_operation_inplace(PyObject *a, UnaryScala
     {
     case TB_OK:
         break;
+    case TB_UNSUPPORTED_DTYPE_ERROR:
+        PyErr_SetString(PyExc_TypeError, "In-place operations require a floating point tensor.");
+        return NULL;
     case TB_NULL_INPUT_ERROR:
         PyErr_SetString(PyExc_RuntimeError, "Null pointer provided to binary operation");
         return NULL;
@@ -588,6 +752,109 @@ static PyObject *PyTensorBase_nb_unary_operation_inplace(PyObject *a, UnaryScala
     Py_RETURN_NONE;
 }
 
+static PyObject *PyTensorBase_nb_inplace_binary_operation(PyObject *a, PyObject *b, BinaryScalarOperation binop)
+{
+    // `a op= b` updates the elements of a. Returning NotImplemented makes Python fall back to `a = a op b`, which is
+    // done when the result does not fit in a: for integer and bool tensors, and for a b that does not broadcast to the
+    // shape of a.
+    TensorBase *lhs = &(((PyTensorBase *)a)->tb);
+    StatusCode status;
+    if (PyFloatOrLong_Check(b))
+    {
+        status = TensorBase_binary_op_inplace_scalar(lhs, PyFloatOrLong_asDouble(b), binop);
+    }
+    else if (PyTensorBase_Check(b))
+    {
+        status = TensorBase_binary_op_inplace(lhs, &(((PyTensorBase *)b)->tb), binop);
+    }
+    else
+    {
+        Py_RETURN_NOTIMPLEMENTED;
+    }
+
+    switch (status)
+    {
+    case TB_OK:
+        break;
+    case TB_UNSUPPORTED_DTYPE_ERROR:
+    case TB_INCOMPATABLE_BROASCAST_SHAPES_ERROR:
+        Py_RETURN_NOTIMPLEMENTED;
+    case TB_NULL_INPUT_ERROR:
+        PyErr_SetString(PyExc_RuntimeError, "Null pointer provided to binary operation");
+        return NULL;
+    case TB_MALLOC_ERROR:
+        PyErr_SetString(PyExc_RuntimeError, "Unable to allocate memory for new tensorbase object.");
+        return NULL;
+    default:
+        PyErr_SetString(PyExc_RuntimeError, "Unknown Error Occured.");
+        return NULL;
+    }
+
+    return Py_NewRef(a);
+}
+
+static PyObject *PyTensorBase_binary_operation_out(PyObject *self, PyObject *args, PyObject *kwds, BinaryScalarOperation binop)
+{
+    // self `op` other, as a new tensor, or written to `out` (which is returned) if given.
+    static char *kwlist[] = {"other", "out", NULL};
+    PyObject *other;
+    PyObject *out = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|$O", kwlist, &other, &out))
+    {
+        return NULL;
+    }
+    if (out == Py_None)
+    {
+        return PyTensorBase_nb_binary_operation(self, other, binop);
+    }
+    if (!PyTensorBase_Check(out))
+    {
+        PyErr_SetString(PyExc_TypeError, "out must be a TensorBase.");
+        return NULL;
+    }
+
+    TensorBase *lhs = &(((PyTensorBase *)self)->tb);
+    TensorBase scalar_rhs;
+    TensorBase *rhs = &scalar_rhs;
+    if (PyTensorBase_Check(other))
+    {
+        rhs = &(((PyTensorBase *)other)->tb);
+    }
+    else if (PyFloatOrLong_Check(other))
+    {
+        // A number is a singleton of the tensor's dtype, as in the operators.
+        ShapeArray shape;
+        TensorBase_init(&scalar_rhs, shape, 0, lhs->dtype == TB_FLOAT32 ? TB_FLOAT32 : TB_FLOAT64);
+        TensorBase_fill_(&scalar_rhs, PyFloatOrLong_asDouble(other));
+    }
+    else
+    {
+        PyErr_SetString(PyExc_ValueError, "Invalid types for binary operation. The operand must be a Tensor, Float, or Integer.");
+        return NULL;
+    }
+
+    StatusCode status = TensorBase_binary_op_out(lhs, rhs, &(((PyTensorBase *)out)->tb), binop);
+    switch (status)
+    {
+    case TB_OK:
+        break;
+    case TB_SHAPE_MISMATCH_ERROR:
+        PyErr_SetString(PyExc_ValueError, "out does not have the broadcasted shape of the operands.");
+        return NULL;
+    case TB_INCOMPATABLE_BROASCAST_SHAPES_ERROR:
+        PyErr_SetString(PyExc_RuntimeError, "Incompatable shapes to broadcast for binary operation.");
+        return NULL;
+    case TB_MALLOC_ERROR:
+        PyErr_SetString(PyExc_RuntimeError, "Unable to allocate memory for new tensorbase object.");
+        return NULL;
+    default:
+        PyErr_SetString(PyExc_RuntimeError, "Unknown Error Occured.");
+        return NULL;
+    }
+
+    return Py_NewRef(out);
+}
+
 static PyObject *PyTensorBase_nb_add(PyObject *a, PyObject *b) { return PyTensorBase_nb_binary_operation(a, b, SCALAR_ADD); }
 static PyObject *PyTensorBase_nb_subtract(PyObject *a, PyObject *b) { return PyTensorBase_nb_binary_operation(a, b, SCALAR_SUB); }
 static PyObject *PyTensorBase_nb_multiply(PyObject *a, PyObject *b) { return PyTensorBase_nb_binary_operation(a, b, SCALAR_MULT); }
@@ -596,6 +863,15 @@ static PyObject *PyTensorBase_nb_true_divide(PyObject *a, PyObject *b) { return
 static PyObject *PyTensorBase_nb_power(PyObject *a, PyObject *b, PyObject *Py_UNUSED(ignored)) { return PyTensorBase_nb_binary_operation(a, b, SCALAR_POWER); }
 static PyObject *PyTensorBase_nb_negative(PyObject *a) { return PyTensorBase_nb_unary_operation(a, SCALAR_NEGATIVE); }
 static PyObject *PyTensorBase_nb_absolute(PyObject *a) { return PyTensorBase_nb_unary_operation(a, SCALAR_ABSOLUTE); }
+static PyObject *PyTensorBase_nb_inplace_add(PyObject *a, PyObject *b) { return PyTensorBase_nb_inplace_binary_operation(a, b, SCALAR_ADD); }
+static PyObject *PyTensorBase_nb_inplace_subtract(PyObject *a, PyObject *b) { return PyTensorBase_nb_inplace_binary_operation(a, b, SCALAR_SUB); }
+static PyObject *PyTensorBase_nb_inplace_multiply(PyObject *a, PyObject *b) { return PyTensorBase_nb_inplace_binary_operation(a, b, SCALAR_MULT); }
+static PyObject *PyTensorBase_nb_inplace_floor_divide(PyObject *a, PyObject *b) { return PyTensorBase_nb_inplace_binary_operation(a, b, SCALAR_FLOORDIV); }
+static PyObject *PyTensorBase_nb_inplace_true_divide(PyObject *a, PyObject *b) { return PyTensorBase_nb_inplace_binary_operation(a, b, SCALAR_TRUEDIV); }
+static PyObject *PyTensorBase_add(PyObject *self, PyObject *args, PyObject *kwds) { return PyTensorBase_binary_operation_out(self, args, kwds, SCALAR_ADD); }
+static PyObject *PyTensorBase_sub(PyObject *self, PyObject *args, PyObject *kwds) { return PyTensorBase_binary_operation_out(self, args, kwds, SCALAR_SUB); }
+static PyObject *PyTensorBase_mul(PyObject *self, PyObject *args, PyObject *kwds) { return PyTensorBase_binary_operation_out(self, args, kwds, SCALAR_MULT); }
+static PyObject *PyTensorBase_div(PyObject *self, PyObject *args, PyObject *kwds) { return PyTensorBase_binary_operation_out(self, args, kwds, SCALAR_TRUEDIV); }
 static PyObject *PyTensorBase_matrix_multiply(PyObject *a, PyObject *b)
 {
     // Both a and b must be of type TensorBase.
@@ -640,6 +916,56 @@ static PyObject *PyTensorBase_matrix_multiply(PyObject *a, PyObject *b)
     return (PyObject *)result;
 }
 
+static PyObject *PyTensorBase_matmul(PyObject *self, PyObject *args, PyObject *kwds)
+{
+    // self @ other, as a new tensor, or written to `out` (which is returned) if given.
+    static char *kwlist[] = {"other", "out", NULL};
+    PyObject *other;
+    PyObject *out = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!|$O", kwlist, &PyTensorBaseType, &other, &out))
+    {
+        return NULL;
+    }
+    if (out == Py_None)
+    {
+        return PyTensorBase_matrix_multiply(self, other);
+    }
+    if (!PyTensorBase_Check(out))
+    {
+        PyErr_SetString(PyExc_TypeError, "out must be a TensorBase.");
+        return NULL;
+    }
+
+    TensorBase *l = &(((PyTensorBase *)self)->tb);
+    TensorBase *r = &(((PyTensorBase *)other)->tb);
+    StatusCode status = TensorBase_matrix_multiply_out(l, r, &(((PyTensorBase *)out)->tb));
+    switch (status)
+    {
+    case TB_OK:
+        break;
+    case TB_SHAPE_MISMATCH_ERROR:
+        PyErr_SetString(PyExc_ValueError, "out does not have the shape of the matrix product.");
+        return NULL;
+    case TB_MATMUL_WITH_SINGLETON_OPERAND_ERROR:
+        PyErr_SetString(PyExc_RuntimeError, "Matrix multiplication is not supported for singleton (ndim = 0) operands. Both operands must be at least 1 dimensional.");
+        return NULL;
+    case TB_MATMUL_INCOMPATABLE_SHAPES_ERROR:
+        PyErr_SetString(PyExc_RuntimeError, "Incompatable shapes for matrix multiplication.");
+        return NULL;
+    case TB_INCOMPATABLE_BROASCAST_SHAPES_ERROR:
+        PyErr_SetString(PyExc_RuntimeError, "Unbroadcastable shapes for matrix multiplication.");
+        return NULL;
+    case TB_MALLOC_ERROR:
+        PyErr_SetString(PyExc_RuntimeError, "Unable to allocate memory for new tensorbase object.");
+        return NULL;
+    default:
+        PyErr_SetString(PyExc_RuntimeError, "Unknown error occured in matrix multiplication.");
+        return NULL;
+    }
+
+    return Py_NewRef(out);
+}
+
 static PyObject *PyTensorBase_relu_(PyObject *self, PyObject *Py_UNUSED(args)) { return PyTensorBase_nb_unary_operation_inplace(self, SCALAR_RELU); }
 static PyObject *PyTensorBase_relu(PyObject *self, PyObject *Py_UNUSED(args)) { return PyTensorBase_nb_unary_operation(self, SCALAR_RELU); }
 
@@ -1035,6 +1361,166 @@ static PyObject *PyTensorBase_permute(PyObject *self, PyObject *args)
     return (PyObject *)result;
 }
 
+static int parse_window_pair(PyObject *obj, long pair[2], const char *name)
+{
+    // An int applies to both the height and the width, a tuple of two ints to each of them.
+    if (PyLong_Check(obj))
+    {
+        pair[0] = pair[1] = PyLong_AsLong(obj);
+        return PyErr_Occurred() ? -1 : 0;
+    }
+    if (!PyTuple_Check(obj) || PyTuple_Size(obj) != 2)
+    {
+        PyErr_Format(PyExc_TypeError, "%s must be an int or a tuple of two ints.", name);
+        return -1;
+    }
+    for (long dim = 0; dim < 2; dim++)
+    {
+        pair[dim] = PyLong_AsLong(PyTuple_GET_ITEM(obj, dim));
+        if (pair[dim] == -1 && PyErr_Occurred())
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int parse_conv2d_window(PyObject *kernel_size, PyObject *stride, PyObject *padding, PyObject *dilation, TensorBaseConv2dWindow *window)
+{
+    window->stride[0] = window->stride[1] = 1;
+    window->padding[0] = window->padding[1] = 0;
+    window->dilation[0] = window->dilation[1] = 1;
+    if (parse_window_pair(kernel_size, window->kernel_size, "kernel_size") < 0 ||
+        (stride != NULL && parse_window_pair(stride, window->stride, "stride") < 0) ||
+        (padding != NULL && parse_window_pair(padding, window->padding, "padding") < 0) ||
+        (dilation != NULL && parse_window_pair(dilation, window->dilation, "dilation") < 0))
+    {
+        return -1;
+    }
+    return 0;
+}
+
+static PyObject *conv2d_window_result(StatusCode status, PyTensorBase *result, const char *function)
+{
+    switch (status)
+    {
+    case TB_OK:
+        return (PyObject *)result;
+    case TB_INVALID_NDIM_ERROR:
+        PyErr_Format(PyExc_ValueError, "Incorrect shape for %s: Either (N, C, H, W) images or (N, C * kh * kw, L) columns, optionally without the batch dimension.", function);
+        return NULL;
+    case TB_INVALID_DIMENSION_SIZE_ERROR:
+        PyErr_Format(PyExc_ValueError, "Invalid window for %s: kernel_size, stride and dilation must be positive, padding non negative, and the padded input at least as large as the dilated kernel.", function);
+        return NULL;
+    case TB_SHAPE_MISMATCH_ERROR:
+        PyErr_Format(PyExc_ValueError, "The columns given to %s do not match the window and output_size.", function);
+        return NULL;
+    case TB_UNSUPPORTED_DTYPE_ERROR:
+        PyErr_Format(PyExc_TypeError, "%s is only supported for float32 and float64 tensors.", function);
+        return NULL;
+    case TB_MALLOC_ERROR:
+        PyErr_SetString(PyExc_RuntimeError, "Memory allocation error, unable to allocate enough memory for new tensorbase object.");
+        return NULL;
+    default:
+        PyErr_Format(PyExc_RuntimeError, "Unknown Error in %s.", function);
+        return NULL;
+    }
+}
+
+static PyObject *PyTensorBase_im2col(PyObject *self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"kernel_size", "stride", "padding", "dilation", NULL};
+    PyObject *kernel_size, *stride = NULL, *padding = NULL, *dilation = NULL;
+    TensorBaseConv2dWindow window;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|OOO", kwlist, &kernel_size, &stride, &padding, &dilation) ||
+        parse_conv2d_window(kernel_size, stride, padding, dilation, &window) < 0)
+    {
+        return NULL;
+    }
+
+    PyTensorBase *result = (PyTensorBase *)PyObject_New(PyTensorBase, &PyTensorBaseType);
+    if (result == NULL)
+    {
+        PyErr_SetString(PyExc_RuntimeError, "Failed to create new TensorBase object.");
+        return NULL;
+    }
+    return conv2d_window_result(TensorBase_im2col(&((PyTensorBase *)self)->tb, &window, &result->tb), result, "im2col");
+}
+
+static PyObject *PyTensorBase_col2im(PyObject *self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"output_size", "kernel_size", "stride", "padding", "dilation", NULL};
+    PyObject *output_size, *kernel_size, *stride = NULL, *padding = NULL, *dilation = NULL;
+    long size[2];
+    TensorBaseConv2dWindow window;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "OO|OOO", kwlist, &output_size, &kernel_size, &stride, &padding, &dilation) ||
+        parse_window_pair(output_size, size, "output_size") < 0 ||
+        parse_conv2d_window(kernel_size, stride, padding, dilation, &window) < 0)
+    {
+        return NULL;
+    }
+
+    PyTensorBase *result = (PyTensorBase *)PyObject_New(PyTensorBase, &PyTensorBaseType);
+    if (result == NULL)
+    {
+        PyErr_SetString(PyExc_RuntimeError, "Failed to create new TensorBase object.");
+        return NULL;
+    }
+    return conv2d_window_result(TensorBase_col2im(&((PyTensorBase *)self)->tb, &window, size[0], size[1], &result->tb), result, "col2im");
+}
+
+static PyObject *PyTensorBase_conv2d(PyObject *self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"weight", "kernel_size", "bias", "stride", "padding", "dilation", "algorithm", NULL};
+    static const char *algorithm_names[NUM_CONV2D_ALGORITHMS] = {"auto", "im2col", "winograd_2x3", "winograd_4x3", "fft"};
+    PyObject *weight, *kernel_size, *bias = Py_None, *stride = NULL, *padding = NULL, *dilation = NULL;
+    const char *algorithm_name = "auto";
+    TensorBaseConv2dWindow window;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "OO|OOOOs", kwlist, &weight, &kernel_size, &bias, &stride, &padding, &dilation, &algorithm_name) ||
+        parse_conv2d_window(kernel_size, stride, padding, dilation, &window) < 0)
+    {
+        return NULL;
+    }
+    if (!PyTensorBase_Check(weight) || (bias != Py_None && !PyTensorBase_Check(bias)))
+    {
+        PyErr_SetString(PyExc_TypeError, "weight and bias must be TensorBase objects.");
+        return NULL;
+    }
+
+    Conv2dAlgorithm algorithm = NUM_CONV2D_ALGORITHMS;
+    for (long i = 0; i < NUM_CONV2D_ALGORITHMS; i++)
+    {
+        if (strcmp(algorithm_name, algorithm_names[i]) == 0)
+        {
+            algorithm = (Conv2dAlgorithm)i;
+        }
+    }
+    if (algorithm == NUM_CONV2D_ALGORITHMS)
+    {
+        PyErr_Format(PyExc_ValueError, "Unknown conv2d algorithm '%s'. Choose one of auto, im2col, winograd_2x3, winograd_4x3 or fft.", algorithm_name);
+        return NULL;
+    }
+
+    PyTensorBase *result = (PyTensorBase *)PyObject_New(PyTensorBase, &PyTensorBaseType);
+    if (result == NULL)
+    {
+        PyErr_SetString(PyExc_RuntimeError, "Failed to create new TensorBase object.");
+        return NULL;
+    }
+    StatusCode status = TensorBase_conv2d(&((PyTensorBase *)self)->tb, &((PyTensorBase *)weight)->tb, bias == Py_None ? NULL : &(((PyTensorBase *)bias)->tb), &window, algorithm, &result->tb);
+    switch (status)
+    {
+    case TB_SHAPE_MISMATCH_ERROR:
+        PyErr_SetString(PyExc_ValueError, "conv2d expects an (O, C * kh * kw) weight for a (N, C, H, W) or (C, H, W) input, and an (O) bias.");
+        return NULL;
+    case TB_NOT_IMPLEMENTED_ERROR:
+        PyErr_Format(PyExc_ValueError, "The %s conv2d algorithm does not support this window. Winograd requires a 3x3 kernel with unit stride and dilation.", algorithm_name);
+        return NULL;
+    default:
+        return conv2d_window_result(status, result, "conv2d");
+    }
+}
+
 static PyObject *PyTensorBase_transpose(PyObject *self, PyObject *Py_UNUSED(args))
 {
     PyTensorBase *result = (PyTensorBase *)PyObject_New(PyTensorBase, &PyTensorBaseType);
@@ -1079,25 +1565,128 @@ static PyObject *PyTensorBase_transpose(PyObject *self, PyObject *Py_UNUSED(args
     return (PyObject *)result;
 }
 
-static PyObject *PyTensorBase_get_dim(PyTensorBase *self, PyObject *Py_UNUSED(ignored))
+static PyObject *PyTensorBase_is_contiguous(PyObject *self, PyObject *Py_UNUSED(args))
 {
-    return PyLong_FromLong(self->tb.ndim);
+    return PyBool_FromLong(TensorBase_is_contiguous(&((PyTensorBase *)self)->tb));
 }
 
-static PyObject *PyTensorBase_get_size(PyTensorBase *self, PyObject *Py_UNUSED(ignored))
+static PyObject *PyTensorBase_deepcopy(PyObject *self, PyObject *Py_UNUSED(memo))
 {
-    PyObject *shape = PyTuple_New(self->tb.ndim);
-
-    for (long i = 0; i < self->tb.ndim; i++)
+    TensorBase *in = &(((PyTensorBase *)self)->tb);
+    PyTensorBase *result = (PyTensorBase *)PyObject_New(PyTensorBase, &PyTensorBaseType);
+    if (result == NULL)
     {
-        if (PyTuple_SetItem(shape, i, PyLong_FromLong(self->tb.shape[i])))
-        {
-            PyErr_SetString(PyExc_RuntimeError, "Failed to set shape item.");
-            return NULL;
-        }
+        PyErr_SetString(PyExc_RuntimeError, "Failed to create new TensorBase object.");
+        return NULL;
     }
 
-    return shape;
+    // A singleton holds its value in the tensor itself, so any copy of it is deep. Otherwise, concatenating the tensor
+    // alone copies it into new storage.
+    StatusCode status = in->ndim == 0 ? TensorBase_contiguous(in, &result->tb) : TensorBase_concatenate(&in, 1, 0, &result->tb);
+    if (status != TB_OK)
+    {
+        PyErr_SetString(status == TB_MALLOC_ERROR ? PyExc_MemoryError : PyExc_RuntimeError, "Failed to copy the tensor.");
+        return NULL;
+    }
+    return (PyObject *)result;
+}
+
+static PyObject *PyTensorBase_contiguous(PyObject *self, PyObject *Py_UNUSED(args))
+{
+    TensorBase *in = &(((PyTensorBase *)self)->tb);
+    if (TensorBase_is_contiguous(in))
+    {
+        Py_INCREF(self);
+        return self;
+    }
+
+    PyTensorBase *result = (PyTensorBase *)PyObject_New(PyTensorBase, &PyTensorBaseType);
+    if (result == NULL)
+    {
+        PyErr_SetString(PyExc_RuntimeError, "Failed to create new TensorBase object.");
+        return NULL;
+    }
+
+    TensorBase *out = &(((PyTensorBase *)result)->tb);
+    StatusCode status = TensorBase_contiguous(in, out);
+    switch (status)
+    {
+    case TB_OK:
+        break;
+    case TB_NULL_INPUT_ERROR:
+        PyErr_SetString(PyExc_RuntimeError, "Null tensorbase objects provided to contiguous.");
+        return NULL;
+    case TB_MALLOC_ERROR:
+        PyErr_SetString(PyExc_RuntimeError, "Memory allocation error, unable to allocate enough memory for new tensorbase object.");
+        return NULL;
+    default:
+        PyErr_SetString(PyExc_RuntimeError, "Unknown Error.");
+        return NULL;
+    }
+
+    return (PyObject *)result;
+}
+
+static PyObject *PyTensorBase_to(PyObject *self, PyObject *dtype_arg)
+{
+    DType dtype;
+    if (!PyDType_Converter(dtype_arg, &dtype))
+    {
+        return NULL;
+    }
+
+    TensorBase *in = &(((PyTensorBase *)self)->tb);
+    if (in->dtype == dtype)
+    {
+        Py_INCREF(self);
+        return self;
+    }
+
+    PyTensorBase *result = (PyTensorBase *)PyObject_New(PyTensorBase, &PyTensorBaseType);
+    if (result == NULL)
+    {
+        PyErr_SetString(PyExc_RuntimeError, "Failed to create new TensorBase object.");
+        return NULL;
+    }
+
+    StatusCode status = TensorBase_to_dtype(in, dtype, &result->tb);
+    switch (status)
+    {
+    case TB_OK:
+        break;
+    case TB_NULL_INPUT_ERROR:
+        PyErr_SetString(PyExc_RuntimeError, "Null tensorbase objects provided to to.");
+        return NULL;
+    case TB_MALLOC_ERROR:
+        PyErr_SetString(PyExc_RuntimeError, "Memory allocation error, unable to allocate enough memory for new tensorbase object.");
+        return NULL;
+    default:
+        PyErr_SetString(PyExc_RuntimeError, "Unknown Error.");
+        return NULL;
+    }
+
+    return (PyObject *)result;
+}
+
+static PyObject *PyTensorBase_get_dim(PyTensorBase *self, PyObject *Py_UNUSED(ignored))
+{
+    return PyLong_FromLong(self->tb.ndim);
+}
+
+static PyObject *PyTensorBase_get_size(PyTensorBase *self, PyObject *Py_UNUSED(ignored))
+{
+    PyObject *shape = PyTuple_New(self->tb.ndim);
+
+    for (long i = 0; i < self->tb.ndim; i++)
+    {
+        if (PyTuple_SetItem(shape, i, PyLong_FromLong(self->tb.shape[i])))
+        {
+            PyErr_SetString(PyExc_RuntimeError, "Failed to set shape item.");
+            return NULL;
+        }
+    }
+
+    return shape;
 }
 
 static PyObject *PyTensorBase_get_numel(PyTensorBase *self, PyObject *Py_UNUSED(ignored))
@@ -1126,24 +1715,193 @@ static PyObject *PyTensorBase_get_raw_data(PyTensorBase *self, PyObject *Py_UNUS
     if (self->tb.ndim == 0)
     {
         scalar value;
-        memcpy(&value, &self->tb.data, sizeof(scalar));
+        TensorBase_item(&self->tb, &value);
         return PyFloat_FromDouble(value);
     }
 
-    PyObject *raw_data = PyList_New(self->tb.numel);
+    // The elements of a view are listed in row-major order, as if it were contiguous, and as float64.
+    TensorBase contiguous;
+    if (TensorBase_contiguous(&self->tb, &contiguous) != TB_OK)
+    {
+        PyErr_SetString(PyExc_RuntimeError, "Memory allocation error, unable to allocate enough memory for new tensorbase object.");
+        return NULL;
+    }
+    if (contiguous.dtype != TB_FLOAT64)
+    {
+        TensorBase converted;
+        StatusCode status = TensorBase_to_dtype(&contiguous, TB_FLOAT64, &converted);
+        TensorBase_dealloc(&contiguous);
+        if (status != TB_OK)
+        {
+            PyErr_SetString(PyExc_RuntimeError, "Memory allocation error, unable to allocate enough memory for new tensorbase object.");
+            return NULL;
+        }
+        contiguous = converted;
+    }
+
+    PyObject *raw_data = PyList_New(contiguous.numel);
+    const double *data = (const double *)contiguous.data;
 
-    for (long i = 0; i < self->tb.numel; i++)
+    for (long i = 0; i < contiguous.numel; i++)
     {
-        if (PyList_SetItem(raw_data, i, PyFloat_FromDouble(self->tb.data[i])))
+        if (PyList_SetItem(raw_data, i, PyFloat_FromDouble(data[i])))
         {
+            TensorBase_dealloc(&contiguous);
             PyErr_SetString(PyExc_RuntimeError, "Failed to set stride item.");
             return NULL;
         }
     }
 
+    TensorBase_dealloc(&contiguous);
     return raw_data;
 }
 
+static PyObject *PyTensorBase_get_dtype(PyTensorBase *self, PyObject *Py_UNUSED(ignored))
+{
+    return PyUnicode_FromString(DType_name(self->tb.dtype));
+}
+
+// Struct module format and NumPy type string of each dtype.
+static const char *DType_buffer_format(DType dtype)
+{
+    switch (dtype)
+    {
+    case TB_FLOAT32:
+        return "f";
+    case TB_INT64:
+        return "q";
+    case TB_BOOL:
+        return "?";
+    default:
+        return "d";
+    }
+}
+
+static const char *DType_typestr(DType dtype)
+{
+#if PY_LITTLE_ENDIAN
+    const bool little_endian = true;
+#else
+    const bool little_endian = false;
+#endif
+    switch (dtype)
+    {
+    case TB_FLOAT32:
+        return little_endian ? "<f4" : ">f4";
+    case TB_INT64:
+        return little_endian ? "<i8" : ">i8";
+    case TB_BOOL:
+        return "|b1";
+    default:
+        return little_endian ? "<f8" : ">f8";
+    }
+}
+
+static PyObject *PyTensorBase_get_array_interface(PyTensorBase *self, PyObject *Py_UNUSED(ignored))
+{
+    // The consumer keeps a reference to the tensor, which keeps the data alive. Singletons expose the value held in
+    // their data pointer.
+    TensorBase *tb = &self->tb;
+    Py_ssize_t itemsize = (Py_ssize_t)TensorBase_element_size(tb->dtype);
+    void *data = TensorBase_data_ptr(tb);
+
+    PyObject *shape = PyTuple_New(tb->ndim);
+    PyObject *strides = TensorBase_is_contiguous(tb) ? Py_NewRef(Py_None) : PyTuple_New(tb->ndim);
+    if (shape == NULL || strides == NULL)
+    {
+        Py_XDECREF(shape);
+        Py_XDECREF(strides);
+        return NULL;
+    }
+    for (long dim = 0; dim < tb->ndim; dim++)
+    {
+        PyTuple_SET_ITEM(shape, dim, PyLong_FromLong(tb->shape[dim]));
+        if (strides != Py_None)
+        {
+            PyTuple_SET_ITEM(strides, dim, PyLong_FromSsize_t(tb->strides[dim] * itemsize));
+        }
+    }
+
+    return Py_BuildValue("{s:N,s:s,s:(N,O),s:N,s:i}",
+                         "shape", shape,
+                         "typestr", DType_typestr(tb->dtype),
+                         "data", PyLong_FromVoidPtr(data), Py_False,
+                         "strides", strides,
+                         "version", 3);
+}
+
+/*********************************************************
+ *                   Buffer Protocol                     *
+ *********************************************************/
+
+// Shape and strides handed out with a buffer, which must stay valid until it is released.
+typedef struct
+{
+    TensorBase view; // Keeps the storage alive while the buffer is exported, even if the tensor's data is replaced.
+    Py_ssize_t shape[MAX_RANK];
+    Py_ssize_t strides[MAX_RANK]; // In bytes
+} PyTensorBaseBufferInfo;
+
+static int PyTensorBase_getbuffer(PyTensorBase *self, Py_buffer *view, int flags)
+{
+    // The buffer shares the tensor's memory. Views are exported with their strides, so consumers that ask for a
+    // contiguous buffer (or for no strides at all) are only served by contiguous tensors.
+    TensorBase *tb = &self->tb;
+    bool contiguous = TensorBase_is_contiguous(tb);
+    bool wants_strides = (flags & PyBUF_STRIDES) == PyBUF_STRIDES;
+    bool wants_c_contiguous = (flags & PyBUF_C_CONTIGUOUS) == PyBUF_C_CONTIGUOUS ||
+                              (flags & PyBUF_ANY_CONTIGUOUS) == PyBUF_ANY_CONTIGUOUS;
+    bool wants_f_contiguous = (flags & PyBUF_F_CONTIGUOUS) == PyBUF_F_CONTIGUOUS;
+
+    if (!contiguous && (!wants_strides || wants_c_contiguous || wants_f_contiguous))
+    {
+        PyErr_SetString(PyExc_BufferError, "TensorBase is not contiguous.");
+        view->obj = NULL;
+        return -1;
+    }
+    if (wants_f_contiguous && !wants_c_contiguous && tb->ndim > 1)
+    {
+        PyErr_SetString(PyExc_BufferError, "TensorBase is not Fortran contiguous.");
+        view->obj = NULL;
+        return -1;
+    }
+
+    PyTensorBaseBufferInfo *info = (PyTensorBaseBufferInfo *)PyMem_Malloc(sizeof(PyTensorBaseBufferInfo));
+    if (info == NULL)
+    {
+        PyErr_NoMemory();
+        view->obj = NULL;
+        return -1;
+    }
+    Py_ssize_t itemsize = (Py_ssize_t)TensorBase_element_size(tb->dtype);
+    TensorBase_view(tb, &info->view);
+    for (long dim = 0; dim < tb->ndim; dim++)
+    {
+        info->shape[dim] = tb->shape[dim];
+        info->strides[dim] = tb->strides[dim] * itemsize;
+    }
+
+    view->buf = TensorBase_data_ptr(tb);
+    view->obj = Py_NewRef((PyObject *)self);
+    view->len = tb->numel * itemsize;
+    view->readonly = 0;
+    view->itemsize = itemsize;
+    view->format = (flags & PyBUF_FORMAT) == PyBUF_FORMAT ? (char *)DType_buffer_format(tb->dtype) : NULL;
+    view->ndim = (int)tb->ndim;
+    view->shape = (flags & PyBUF_ND) == PyBUF_ND ? info->shape : NULL;
+    view->strides = wants_strides ? info->strides : NULL;
+    view->suboffsets = NULL;
+    view->internal = info;
+    return 0;
+}
+
+static void PyTensorBase_releasebuffer(PyTensorBase *self, Py_buffer *view)
+{
+    PyTensorBaseBufferInfo *info = (PyTensorBaseBufferInfo *)view->internal;
+    TensorBase_dealloc(&info->view);
+    PyMem_Free(info);
+}
+
 static PyObject *PyTensorBase_randn_(PyObject *self, PyObject *const *args, Py_ssize_t nargs)
 {
     if (nargs != 2)
@@ -1184,32 +1942,126 @@ static PyObject *PyTensorBase_randn_(PyObject *self, PyObject *const *args, Py_s
     Py_RETURN_NONE;
 }
 
-static int PyTensorBase_init(PyTensorBase *self, PyObject *args, PyObject *kwds)
+/*********************************************************
+ *                  Bulk Construction                    *
+ *********************************************************/
+
+// Element types a buffer may hold, by struct module format character.
+#define FOR_EACH_BUFFER_FORMAT(X) \
+    X('d', double)                \
+    X('f', float)                 \
+    X('q', long long)             \
+    X('Q', unsigned long long)    \
+    X('l', long)                  \
+    X('L', unsigned long)         \
+    X('n', Py_ssize_t)            \
+    X('N', size_t)                \
+    X('i', int)                   \
+    X('I', unsigned int)          \
+    X('h', short)                 \
+    X('H', unsigned short)        \
+    X('b', signed char)           \
+    X('B', unsigned char)         \
+    X('?', bool)
+
+static int buffer_element_format(Py_buffer *view, char *format)
 {
-    if (kwds && PyDict_Size(kwds) > 0)
+    // Reads the element type of a buffer. Returns 0 on success and -1 (with an exception set) if the elements are not
+    // single native numbers.
+    const char *fmt = view->format == NULL ? "B" : view->format;
+    if (*fmt == '@')
     {
-        PyErr_SetString(PyExc_TypeError, "Tensor initialization does not accept keyword arguments.");
-        return -1;
+        fmt++;
+    }
+#if PY_LITTLE_ENDIAN
+    else if (*fmt == '<' || *fmt == '=')
+#else
+    else if (*fmt == '>' || *fmt == '!' || *fmt == '=')
+#endif
+    {
+        // Standard sizes: accepted when they match the native size of the element type, which is checked below.
+        fmt++;
     }
 
-    ShapeArray tb_shape;
-    long ndim = args_to_shape(args, tb_shape);
-    if (ndim < 0)
+    size_t size = 0;
+    switch (fmt[0])
+    {
+#define BUFFER_FORMAT_SIZE(fmt_char, type) \
+    case fmt_char:                         \
+        size = sizeof(type);               \
+        break;
+        FOR_EACH_BUFFER_FORMAT(BUFFER_FORMAT_SIZE)
+#undef BUFFER_FORMAT_SIZE
+    default:
+        break;
+    }
+    if (size == 0 || fmt[1] != '\0' || (size_t)view->itemsize != size)
     {
+        PyErr_Format(PyExc_ValueError, "Unsupported buffer format '%s', expected a single native number type.", view->format == NULL ? "B" : view->format);
         return -1;
     }
+    *format = fmt[0];
+    return 0;
+}
 
-    // Initialize the tensor using TensorBase_init
-    StatusCode status = TensorBase_init(&self->tb, tb_shape, ndim);
+static DType buffer_format_dtype(char format)
+{
+    // The dtype a buffer is copied to by default: its own type if it is one of ours, int64 for other integers.
+    switch (format)
+    {
+    case 'd':
+        return TB_FLOAT64;
+    case 'f':
+        return TB_FLOAT32;
+    case '?':
+        return TB_BOOL;
+    default:
+        return TB_INT64;
+    }
+}
+
+static void convert_buffer_row(char format, const char *src, Py_ssize_t src_stride, DType dtype, void *dst, long n)
+{
+    // Converts `n` elements, `src_stride` bytes apart, to the contiguous row `dst` of `dtype`.
+#define CONVERT_BUFFER_ROW(src_type, dst_type)                                            \
+    for (long i = 0; i < n; i++)                                                          \
+    {                                                                                     \
+        ((dst_type *)dst)[i] = (dst_type)(*(const src_type *)(src + i * src_stride));     \
+    }                                                                                     \
+    break;
+#define CONVERT_BUFFER_FORMAT(fmt_char, src_type)       \
+    case fmt_char:                                      \
+        switch (dtype)                                  \
+        {                                               \
+        case TB_FLOAT32:                                \
+            CONVERT_BUFFER_ROW(src_type, float)         \
+        case TB_INT64:                                  \
+            CONVERT_BUFFER_ROW(src_type, int64_t)       \
+        case TB_BOOL:                                   \
+            CONVERT_BUFFER_ROW(src_type, bool)          \
+        default:                                        \
+            CONVERT_BUFFER_ROW(src_type, double)        \
+        }                                               \
+        break;
+
+    switch (format)
+    {
+        FOR_EACH_BUFFER_FORMAT(CONVERT_BUFFER_FORMAT)
+    default:
+        break;
+    }
+#undef CONVERT_BUFFER_FORMAT
+#undef CONVERT_BUFFER_ROW
+}
+
+static int init_from_status(StatusCode status)
+{
     switch (status)
     {
     case TB_OK:
-        break;
-    case TB_NULL_INPUT_ERROR:
-        PyErr_SetString(PyExc_RuntimeError, "Null tensorbase objects provided to init method.");
-        return -1;
+        return 0;
     case TB_INVALID_NDIM_ERROR:
-        PyErr_SetString(PyExc_RuntimeError, "Maximum tensor rank exceeded.");
+        PyErr_SetString(PyExc_ValueError, "Maximum tensor rank exceeded.");
         return -1;
     case TB_MALLOC_ERROR:
         PyErr_SetString(PyExc_RuntimeError, "Memory allocation error, unable to allocate enough memory for new tensorbase object.");
@@ -1218,55 +2070,1393 @@ static int PyTensorBase_init(PyTensorBase *self, PyObject *args, PyObject *kwds)
         PyErr_SetString(PyExc_RuntimeError, "Unknown Error.");
         return -1;
     }
-
-    return 0;
-}
-
-static void PyTensorBase_dealloc(PyTensorBase *self)
-{
-    TensorBase_dealloc(&self->tb);
-    Py_TYPE(self)->tp_free((PyObject *)self);
 }
 
-static PyObject *PyTensorBase_str(PyTensorBase *obj)
+static int copy_from_buffer(Py_buffer *view, char format, DType dtype, TensorBase *out)
 {
-    // TODO: calculate a reasonable buffer size
-    char *str_buffer = malloc(1 * sizeof(char));
-    *str_buffer = ' ';
+    // Initializes `out` as a contiguous tensor of the buffer's shape, and copies the buffer's elements into it in one
+    // pass: a memcpy if the buffer is contiguous and already holds `dtype`, and a conversion row by row otherwise.
+    if (view->ndim > MAX_RANK)
+    {
+        PyErr_SetString(PyExc_ValueError, "Buffer exceeds maximum allowed rank.");
+        return -1;
+    }
+    ShapeArray shape;
+    long ndim = view->ndim;
+    for (long dim = 0; dim < ndim; dim++)
+    {
+        shape[dim] = view->shape == NULL ? (long)(view->len / view->itemsize) : (long)view->shape[dim];
+    }
+    if (init_from_status(TensorBase_init(out, shape, ndim, dtype)) < 0)
+    {
+        return -1;
+    }
+    void *data = TensorBase_data_ptr(out);
 
-    // TensorBase_to_string(&obj->tb, str_buffer, 100 * sizeof(char));
+    if (format == *DType_buffer_format(dtype) && PyBuffer_IsContiguous(view, 'C'))
+    {
+        memcpy(data, view->buf, out->numel * TensorBase_element_size(dtype));
+        return 0;
+    }
+    if (ndim == 0)
+    {
+        convert_buffer_row(format, (const char *)view->buf, 0, dtype, data, 1);
+        return 0;
+    }
 
-    TensorBase_to_string(&obj->tb);
-    return Py_BuildValue("s", str_buffer);
+    // Walks the rows (the innermost dimension) of the buffer in row-major order.
+    long row_length = shape[ndim - 1];
+    if (out->numel == 0)
+    {
+        return 0;
+    }
+    Py_ssize_t row_stride = view->strides == NULL ? view->itemsize : view->strides[ndim - 1];
+    long num_rows = out->numel / row_length;
+    size_t dst_row_size = row_length * TensorBase_element_size(dtype);
+    IndexArray index = {0};
+    const char *src = (const char *)view->buf;
+    for (long row = 0; row < num_rows; row++)
+    {
+        convert_buffer_row(format, src, row_stride, dtype, (char *)data + row * dst_row_size, row_length);
+        for (long dim = ndim - 2; dim >= 0; dim--)
+        {
+            Py_ssize_t stride = view->strides == NULL ? row_length * view->itemsize : view->strides[dim];
+            if (++index[dim] < shape[dim])
+            {
+                src += stride;
+                break;
+            }
+            src -= (shape[dim] - 1) * stride;
+            index[dim] = 0;
+        }
+    }
+    return 0;
 }
 
-static PyObject *PyTensorBase_unbroadcast(PyObject *self, PyObject *args)
+static PyObject *PyTensorBase_frombuffer(PyObject *cls, PyObject *args, PyObject *kwds)
 {
-    PyTensorBase *result = (PyTensorBase *)PyObject_New(PyTensorBase, &PyTensorBaseType);
-
-    TensorBase *in = &((PyTensorBase *)self)->tb;
-    TensorBase *out = &((PyTensorBase *)result)->tb;
-
-    ShapeArray shape;
-    long ndim = arg_to_shape(args, shape);
-    if (ndim < 0)
+    // Interprets the bytes of the buffer as a 1D sequence of dtype elements, like numpy.frombuffer, and copies them.
+    static char *kwlist[] = {"buffer", "dtype", NULL};
+    PyObject *buffer;
+    DType dtype = TB_FLOAT64;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|O&", kwlist, &buffer, PyDType_Converter, &dtype))
     {
         return NULL;
     }
 
-    StatusCode status = TensorBase_unbroadcast(in, shape, ndim, out);
-    switch (status)
+    Py_buffer view;
+    if (PyObject_GetBuffer(buffer, &view, PyBUF_C_CONTIGUOUS) < 0)
     {
-    case TB_OK:
-        break;
-    default:
-        PyErr_SetString(PyExc_RuntimeError, "Unknown Error in unbroadcast.");
+        return NULL;
+    }
+    size_t element_size = TensorBase_element_size(dtype);
+    if (view.len % element_size != 0)
+    {
+        PyErr_Format(PyExc_ValueError, "Buffer size %zd is not a multiple of the %s element size.", view.len, DType_name(dtype));
+        PyBuffer_Release(&view);
         return NULL;
     }
 
+    PyTensorBase *result = (PyTensorBase *)PyObject_New(PyTensorBase, &PyTensorBaseType);
+    if (result == NULL)
+    {
+        PyBuffer_Release(&view);
+        return NULL;
+    }
+    ShapeArray shape = {view.len / (long)element_size};
+    if (init_from_status(TensorBase_init(&result->tb, shape, 1, dtype)) < 0)
+    {
+        PyBuffer_Release(&view);
+        PyObject_Free(result);
+        return NULL;
+    }
+    if (dtype == TB_BOOL)
+    {
+        convert_buffer_row('B', (const char *)view.buf, 1, dtype, result->tb.data, result->tb.numel);
+    }
+    else
+    {
+        memcpy(result->tb.data, view.buf, view.len);
+    }
+    PyBuffer_Release(&view);
     return (PyObject *)result;
 }
 
+static long sequence_shape(PyObject *sequence, ShapeArray shape)
+{
+    // Infers the shape of nested sequences from their first elements. Returns the number of dimensions, or -1.
+    long ndim = 0;
+    PyObject *item = sequence;
+    while (PyList_Check(item) || PyTuple_Check(item))
+    {
+        if (ndim == MAX_RANK)
+        {
+            PyErr_SetString(PyExc_ValueError, "Sequence exceeds maximum allowed rank.");
+            return -1;
+        }
+        shape[ndim++] = (long)PySequence_Fast_GET_SIZE(item);
+        if (PySequence_Fast_GET_SIZE(item) == 0)
+        {
+            break;
+        }
+        item = PySequence_Fast_GET_ITEM(item, 0);
+    }
+    return ndim;
+}
+
+static int copy_from_sequence(PyObject *sequence, ShapeArray shape, long ndim, long dim, DType dtype, char **data)
+{
+    // Writes the numbers in `sequence` (the sub-sequence at depth `dim`) to `data` in row-major order.
+    if (dim == ndim)
+    {
+        if (PyList_Check(sequence) || PyTuple_Check(sequence))
+        {
+            PyErr_SetString(PyExc_ValueError, "Sequence is ragged: elements of the same dimension have different lengths.");
+            return -1;
+        }
+        switch (dtype)
+        {
+        case TB_FLOAT32:
+            *(float *)*data = (float)PyFloat_AsDouble(sequence);
+            break;
+        case TB_INT64:
+            *(int64_t *)*data = PyFloat_Check(sequence) ? (int64_t)PyFloat_AS_DOUBLE(sequence) : (int64_t)PyLong_AsLongLong(sequence);
+            break;
+        case TB_BOOL:
+            *(bool *)*data = PyObject_IsTrue(sequence) > 0;
+            break;
+        default:
+            *(double *)*data = PyFloat_AsDouble(sequence);
+            break;
+        }
+        if (PyErr_Occurred())
+        {
+            return -1;
+        }
+        *data += TensorBase_element_size(dtype);
+        return 0;
+    }
+
+    if (!(PyList_Check(sequence) || PyTuple_Check(sequence)) || PySequence_Fast_GET_SIZE(sequence) != shape[dim])
+    {
+        PyErr_SetString(PyExc_ValueError, "Sequence is ragged: elements of the same dimension have different lengths.");
+        return -1;
+    }
+    for (Py_ssize_t i = 0; i < shape[dim]; i++)
+    {
+        if (copy_from_sequence(PySequence_Fast_GET_ITEM(sequence, i), shape, ndim, dim + 1, dtype, data) < 0)
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static PyObject *PyTensorBase_from_sequence(PyObject *cls, PyObject *args, PyObject *kwds)
+{
+    // Builds a tensor from a number, nested lists or tuples of numbers, or any buffer exporter. Like TensorBase(buffer),
+    // a buffer keeps its element type unless a dtype is given; numbers default to float64.
+    static char *kwlist[] = {"sequence", "dtype", NULL};
+    PyObject *sequence;
+    PyObject *dtype_arg = NULL;
+    DType dtype = TB_FLOAT64;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|O", kwlist, &sequence, &dtype_arg))
+    {
+        return NULL;
+    }
+    if (dtype_arg != NULL && !PyDType_Converter(dtype_arg, &dtype))
+    {
+        return NULL;
+    }
+
+    PyTensorBase *result = (PyTensorBase *)PyObject_New(PyTensorBase, &PyTensorBaseType);
+    if (result == NULL)
+    {
+        return NULL;
+    }
+    memset(&result->tb, 0, sizeof(TensorBase));
+
+    int status;
+    if (PyObject_CheckBuffer(sequence))
+    {
+        Py_buffer view;
+        if (PyObject_GetBuffer(sequence, &view, PyBUF_RECORDS_RO) < 0)
+        {
+            Py_DECREF(result);
+            return NULL;
+        }
+        char format;
+        status = buffer_element_format(&view, &format);
+        if (status == 0)
+        {
+            status = copy_from_buffer(&view, format, dtype_arg != NULL ? dtype : buffer_format_dtype(format), &result->tb);
+        }
+        PyBuffer_Release(&view);
+    }
+    else
+    {
+        ShapeArray shape;
+        long ndim = sequence_shape(sequence, shape);
+        status = ndim < 0 ? -1 : init_from_status(TensorBase_init(&result->tb, shape, ndim, dtype));
+        if (status == 0)
+        {
+            char *data = (char *)TensorBase_data_ptr(&result->tb);
+            status = copy_from_sequence(sequence, shape, ndim, 0, dtype, &data);
+        }
+    }
+
+    if (status < 0)
+    {
+        Py_DECREF(result);
+        return NULL;
+    }
+    return (PyObject *)result;
+}
+
+static int PyTensorBase_init(PyTensorBase *self, PyObject *args, PyObject *kwds)
+{
+    // The only keyword argument is the dtype (float64 by default).
+    DType dtype = TB_FLOAT64;
+    bool has_dtype = false;
+    if (kwds && PyDict_Size(kwds) > 0)
+    {
+        PyObject *dtype_arg = PyDict_GetItemString(kwds, "dtype");
+        if (dtype_arg == NULL || PyDict_Size(kwds) > 1)
+        {
+            PyErr_SetString(PyExc_TypeError, "Tensor initialization only accepts the dtype keyword argument.");
+            return -1;
+        }
+        if (!PyDType_Converter(dtype_arg, &dtype))
+        {
+            return -1;
+        }
+        has_dtype = true;
+    }
+
+    // TensorBase(buffer) copies the elements of any buffer exporter (e.g., a NumPy array), in the buffer's element
+    // type unless a dtype is given.
+    if (PyTuple_Size(args) == 1 && PyObject_CheckBuffer(PyTuple_GetItem(args, 0)))
+    {
+        Py_buffer view;
+        if (PyObject_GetBuffer(PyTuple_GetItem(args, 0), &view, PyBUF_RECORDS_RO) < 0)
+        {
+            return -1;
+        }
+        char format;
+        int result = -1;
+        if (buffer_element_format(&view, &format) == 0)
+        {
+            result = copy_from_buffer(&view, format, has_dtype ? dtype : buffer_format_dtype(format), &self->tb);
+        }
+        PyBuffer_Release(&view);
+        return result;
+    }
+
+    ShapeArray tb_shape;
+    long ndim = args_to_shape(args, tb_shape);
+    if (ndim < 0)
+    {
+        return -1;
+    }
+
+    // Initialize the tensor using TensorBase_init
+    StatusCode status = TensorBase_init(&self->tb, tb_shape, ndim, dtype);
+    switch (status)
+    {
+    case TB_OK:
+        break;
+    case TB_NULL_INPUT_ERROR:
+        PyErr_SetString(PyExc_RuntimeError, "Null tensorbase objects provided to init method.");
+        return -1;
+    case TB_INVALID_NDIM_ERROR:
+        PyErr_SetString(PyExc_RuntimeError, "Maximum tensor rank exceeded.");
+        return -1;
+    case TB_MALLOC_ERROR:
+        PyErr_SetString(PyExc_RuntimeError, "Memory allocation error, unable to allocate enough memory for new tensorbase object.");
+        return -1;
+    default:
+        PyErr_SetString(PyExc_RuntimeError, "Unknown Error.");
+        return -1;
+    }
+
+    return 0;
+}
+
+static void PyTensorBase_dealloc(PyTensorBase *self)
+{
+    TensorBase_dealloc(&self->tb);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static PyObject *PyTensorBase_str(PyTensorBase *obj)
+{
+    // TODO: calculate a reasonable buffer size
+    char *str_buffer = malloc(1 * sizeof(char));
+    *str_buffer = ' ';
+
+    // TensorBase_to_string(&obj->tb, str_buffer, 100 * sizeof(char));
+
+    TensorBase_to_string(&obj->tb);
+    return Py_BuildValue("s", str_buffer);
+}
+
+static PyObject *PyTensorBase_unbroadcast(PyObject *self, PyObject *args)
+{
+    PyTensorBase *result = (PyTensorBase *)PyObject_New(PyTensorBase, &PyTensorBaseType);
+
+    TensorBase *in = &((PyTensorBase *)self)->tb;
+    TensorBase *out = &((PyTensorBase *)result)->tb;
+
+    ShapeArray shape;
+    long ndim = arg_to_shape(args, shape);
+    if (ndim < 0)
+    {
+        return NULL;
+    }
+
+    StatusCode status = TensorBase_unbroadcast(in, shape, ndim, out);
+    switch (status)
+    {
+    case TB_OK:
+        break;
+    default:
+        PyErr_SetString(PyExc_RuntimeError, "Unknown Error in unbroadcast.");
+        return NULL;
+    }
+
+    return (PyObject *)result;
+}
+
+static PyObject *TensorBaseModule_instruction_set(PyObject *module, PyObject *Py_UNUSED(args))
+{
+    switch (TensorBase_get_instruction_set())
+    {
+    case TB_ISA_AVX512:
+        return PyUnicode_FromString("avx512");
+    case TB_ISA_AVX2:
+        return PyUnicode_FromString("avx2");
+    default:
+        return PyUnicode_FromString("baseline");
+    }
+}
+
+static PyObject *TensorBaseModule_set_fast_math(PyObject *module, PyObject *enabled)
+{
+    int is_enabled = PyObject_IsTrue(enabled);
+    if (is_enabled == -1)
+    {
+        return NULL;
+    }
+    TensorBase_set_fast_math(is_enabled);
+    Py_RETURN_NONE;
+}
+
+static PyObject *TensorBaseModule_get_fast_math(PyObject *module, PyObject *Py_UNUSED(args))
+{
+    return PyBool_FromLong(TensorBase_get_fast_math());
+}
+
+static PyObject *TensorBaseModule_set_conv2d_benchmark(PyObject *module, PyObject *enabled)
+{
+    int is_enabled = PyObject_IsTrue(enabled);
+    if (is_enabled == -1)
+    {
+        return NULL;
+    }
+    TensorBase_set_conv2d_benchmark(is_enabled);
+    Py_RETURN_NONE;
+}
+
+static PyObject *TensorBaseModule_get_conv2d_benchmark(PyObject *module, PyObject *Py_UNUSED(args))
+{
+    return PyBool_FromLong(TensorBase_get_conv2d_benchmark());
+}
+
+static PyObject *TensorBaseModule_set_num_threads(PyObject *module, PyObject *num_threads)
+{
+    long count = PyLong_AsLong(num_threads);
+    if (count == -1 && PyErr_Occurred())
+    {
+        return NULL;
+    }
+    if (count < 1)
+    {
+        PyErr_SetString(PyExc_ValueError, "Number of threads must be at least 1.");
+        return NULL;
+    }
+    TensorBase_set_num_threads(count);
+    Py_RETURN_NONE;
+}
+
+static PyObject *TensorBaseModule_get_num_threads(PyObject *module, PyObject *Py_UNUSED(args))
+{
+    return PyLong_FromLong(TensorBase_get_num_threads());
+}
+
+static PyObject *TensorBaseModule_empty_cache(PyObject *module, PyObject *Py_UNUSED(args))
+{
+    TensorBase_empty_cache();
+    Py_RETURN_NONE;
+}
+
+static PyObject *TensorBaseModule_memory_stats(PyObject *module, PyObject *Py_UNUSED(args))
+{
+    TensorBaseMemoryStats stats;
+    TensorBase_get_memory_stats(&stats);
+    return Py_BuildValue("{s:n,s:n,s:n,s:l,s:l,s:l}",
+                         "allocated_bytes", (Py_ssize_t)stats.allocated_bytes,
+                         "peak_allocated_bytes", (Py_ssize_t)stats.peak_allocated_bytes,
+                         "cached_bytes", (Py_ssize_t)stats.cached_bytes,
+                         "allocations", stats.allocations,
+                         "system_allocations", stats.system_allocations,
+                         "system_frees", stats.system_frees);
+}
+
+static TensorBase **tensorbase_array_from_sequence(PyObject *sequence, Py_ssize_t count, const char *name, PyObject **items)
+{
+    // Returns the tensors of a sequence of `count` TensorBase objects in an array allocated with PyMem_Malloc.
+    // `items` receives a new reference to the sequence's items (a new list, if `sequence` is any other iterable, such
+    // as a generator), which keeps the tensors alive. The caller releases it once it is done with the tensors.
+    *items = NULL;
+    PyObject *fast = PySequence_Fast(sequence, name);
+    if (fast == NULL)
+    {
+        return NULL;
+    }
+    if (PySequence_Fast_GET_SIZE(fast) != count)
+    {
+        PyErr_Format(PyExc_ValueError, "Expected %zd tensors in %s, got %zd.", count, name, PySequence_Fast_GET_SIZE(fast));
+        Py_DECREF(fast);
+        return NULL;
+    }
+
+    TensorBase **tensors = (TensorBase **)PyMem_Malloc(Py_MAX(count, 1) * sizeof(TensorBase *));
+    if (tensors == NULL)
+    {
+        Py_DECREF(fast);
+        PyErr_NoMemory();
+        return NULL;
+    }
+    for (Py_ssize_t i = 0; i < count; i++)
+    {
+        PyObject *item = PySequence_Fast_GET_ITEM(fast, i);
+        if (!PyTensorBase_Check(item))
+        {
+            PyErr_Format(PyExc_TypeError, "Every element of %s must be a TensorBase.", name);
+            PyMem_Free(tensors);
+            Py_DECREF(fast);
+            return NULL;
+        }
+        tensors[i] = &((PyTensorBase *)item)->tb;
+    }
+    *items = fast;
+    return tensors;
+}
+
+static PyObject *optimizer_step_result(StatusCode status)
+{
+    switch (status)
+    {
+    case TB_OK:
+        Py_RETURN_NONE;
+    case TB_SHAPE_MISMATCH_ERROR:
+        PyErr_SetString(PyExc_ValueError, "Gradients and optimizer states must have the shape of their parameters.");
+        return NULL;
+    case TB_UNSUPPORTED_DTYPE_ERROR:
+        PyErr_SetString(PyExc_TypeError, "Parameters must be float32 or float64, and their gradients and optimizer states of the same dtype.");
+        return NULL;
+    case TB_NOT_IMPLEMENTED_ERROR:
+        PyErr_SetString(PyExc_ValueError, "Parameters, gradients and optimizer states must be contiguous.");
+        return NULL;
+    case TB_INVALID_DIMENSION_SIZE_ERROR:
+        PyErr_SetString(PyExc_ValueError, "The step count must be at least 1.");
+        return NULL;
+    case TB_MALLOC_ERROR:
+        PyErr_SetString(PyExc_RuntimeError, "Unable to allocate memory for the optimizer step.");
+        return NULL;
+    default:
+        PyErr_SetString(PyExc_RuntimeError, "Unknown Error in optimizer step.");
+        return NULL;
+    }
+}
+
+static PyObject *TensorBaseModule_sgd_step(PyObject *module, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"params", "grads", "momentum_buffers", "lr", "momentum", "dampening", "weight_decay", "nesterov", "first_step", NULL};
+    PyObject *params_sequence, *grads_sequence, *buffers_sequence;
+    TensorBaseSGDOptions options = {0};
+    int nesterov = 0, first_step = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "OOOd|dddpp", kwlist, &params_sequence, &grads_sequence, &buffers_sequence,
+                                     &options.lr, &options.momentum, &options.dampening, &options.weight_decay, &nesterov, &first_step))
+    {
+        return NULL;
+    }
+    options.nesterov = nesterov;
+    options.first_step = first_step;
+
+    Py_ssize_t count = PySequence_Size(params_sequence);
+    if (count < 0)
+    {
+        return NULL;
+    }
+    PyObject *items[3] = {NULL};
+    TensorBase **params = tensorbase_array_from_sequence(params_sequence, count, "params", &items[0]);
+    TensorBase **grads = params == NULL ? NULL : tensorbase_array_from_sequence(grads_sequence, count, "grads", &items[1]);
+    // Without momentum there are no buffers to update, and momentum_buffers may be None.
+    bool has_buffers = options.momentum != 0;
+    TensorBase **buffers = grads == NULL || !has_buffers ? NULL : tensorbase_array_from_sequence(buffers_sequence, count, "momentum_buffers", &items[2]);
+
+    PyObject *result = NULL;
+    if (grads != NULL && (buffers != NULL || !has_buffers))
+    {
+        result = optimizer_step_result(TensorBase_sgd_step(count, params, grads, buffers, &options));
+    }
+    PyMem_Free(params);
+    PyMem_Free(grads);
+    PyMem_Free(buffers);
+    for (int i = 0; i < 3; i++)
+    {
+        Py_XDECREF(items[i]);
+    }
+    return result;
+}
+
+static PyObject *TensorBaseModule_adam_step(PyObject *module, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"params", "grads", "exp_avgs", "exp_avg_sqs", "step", "lr", "beta1", "beta2", "eps", "weight_decay", "decoupled_weight_decay", NULL};
+    PyObject *params_sequence, *grads_sequence, *exp_avgs_sequence, *exp_avg_sqs_sequence;
+    TensorBaseAdamOptions options = {0};
+    int decoupled_weight_decay = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "OOOOldddd|dp", kwlist, &params_sequence, &grads_sequence, &exp_avgs_sequence,
+                                     &exp_avg_sqs_sequence, &options.step, &options.lr, &options.beta1, &options.beta2, &options.eps,
+                                     &options.weight_decay, &decoupled_weight_decay))
+    {
+        return NULL;
+    }
+    options.decoupled_weight_decay = decoupled_weight_decay;
+
+    Py_ssize_t count = PySequence_Size(params_sequence);
+    if (count < 0)
+    {
+        return NULL;
+    }
+    PyObject *items[4] = {NULL};
+    TensorBase **params = tensorbase_array_from_sequence(params_sequence, count, "params", &items[0]);
+    TensorBase **grads = params == NULL ? NULL : tensorbase_array_from_sequence(grads_sequence, count, "grads", &items[1]);
+    TensorBase **exp_avgs = grads == NULL ? NULL : tensorbase_array_from_sequence(exp_avgs_sequence, count, "exp_avgs", &items[2]);
+    TensorBase **exp_avg_sqs = exp_avgs == NULL ? NULL : tensorbase_array_from_sequence(exp_avg_sqs_sequence, count, "exp_avg_sqs", &items[3]);
+
+    PyObject *result = NULL;
+    if (exp_avg_sqs != NULL)
+    {
+        result = optimizer_step_result(TensorBase_adam_step(count, params, grads, exp_avgs, exp_avg_sqs, &options));
+    }
+    PyMem_Free(params);
+    PyMem_Free(grads);
+    PyMem_Free(exp_avgs);
+    PyMem_Free(exp_avg_sqs);
+    for (int i = 0; i < 4; i++)
+    {
+        Py_XDECREF(items[i]);
+    }
+    return result;
+}
+
+static PyObject *join_result(StatusCode status, PyTensorBase *result, const char *function)
+{
+    switch (status)
+    {
+    case TB_OK:
+        return (PyObject *)result;
+    case TB_NULL_INPUT_ERROR:
+        PyErr_Format(PyExc_ValueError, "%s expects a non-empty sequence of tensors.", function);
+        return NULL;
+    case TB_INVALID_NDIM_ERROR:
+        PyErr_Format(PyExc_ValueError, "Invalid number of dimensions for %s: zero-dimensional tensors cannot be concatenated or split, and stack cannot exceed the maximum rank.", function);
+        return NULL;
+    case TB_DIMENSION_OUT_OF_BOUNDS_ERROR:
+        PyErr_Format(PyExc_IndexError, "Dimension out of range in %s.", function);
+        return NULL;
+    case TB_SHAPE_MISMATCH_ERROR:
+        PyErr_Format(PyExc_ValueError, "Incompatible shapes in %s: concatenate requires equal sizes outside of dim, stack equal shapes, and split sizes that sum to the size of dim.", function);
+        return NULL;
+    case TB_INVALID_DIMENSION_SIZE_ERROR:
+        PyErr_Format(PyExc_ValueError, "The sizes given to %s must be non negative.", function);
+        return NULL;
+    case TB_UNSUPPORTED_DTYPE_ERROR:
+        PyErr_Format(PyExc_TypeError, "The tensors given to %s must have the same dtype.", function);
+        return NULL;
+    case TB_MALLOC_ERROR:
+        PyErr_SetString(PyExc_RuntimeError, "Memory allocation error, unable to allocate enough memory for new tensorbase object.");
+        return NULL;
+    default:
+        PyErr_Format(PyExc_RuntimeError, "Unknown Error in %s.", function);
+        return NULL;
+    }
+}
+
+static PyObject *join_tensors(PyObject *args, PyObject *kwds, StatusCode (*join)(TensorBase **, long, long, TensorBase *), const char *function)
+{
+    static char *kwlist[] = {"tensors", "dim", NULL};
+    PyObject *sequence;
+    long dim = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|l", kwlist, &sequence, &dim))
+    {
+        return NULL;
+    }
+    Py_ssize_t count = PySequence_Size(sequence);
+    if (count < 0)
+    {
+        return NULL;
+    }
+    PyObject *items;
+    TensorBase **tensors = tensorbase_array_from_sequence(sequence, count, "tensors", &items);
+    if (tensors == NULL)
+    {
+        return NULL;
+    }
+
+    PyObject *result = NULL;
+    PyTensorBase *joined = (PyTensorBase *)PyObject_New(PyTensorBase, &PyTensorBaseType);
+    if (joined == NULL)
+    {
+        PyErr_SetString(PyExc_RuntimeError, "Failed to create new TensorBase object.");
+    }
+    else
+    {
+        result = join_result(join(tensors, count, dim, &joined->tb), joined, function);
+    }
+    PyMem_Free(tensors);
+    Py_DECREF(items);
+    return result;
+}
+
+static PyObject *PyTensorBase_concatenate(PyObject *Py_UNUSED(cls), PyObject *args, PyObject *kwds)
+{
+    return join_tensors(args, kwds, TensorBase_concatenate, "concatenate");
+}
+
+static PyObject *PyTensorBase_stack(PyObject *Py_UNUSED(cls), PyObject *args, PyObject *kwds)
+{
+    return join_tensors(args, kwds, TensorBase_stack, "stack");
+}
+
+static PyObject *PyTensorBase_split(PyObject *self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"split_size_or_sizes", "dim", NULL};
+    PyObject *split_sizes;
+    long dim = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|l", kwlist, &split_sizes, &dim))
+    {
+        return NULL;
+    }
+    TensorBase *in = &(((PyTensorBase *)self)->tb);
+    if (in->ndim == 0)
+    {
+        return join_result(TB_INVALID_NDIM_ERROR, NULL, "split");
+    }
+    long normalized_dim = dim < 0 ? dim + in->ndim : dim;
+    if (normalized_dim < 0 || normalized_dim >= in->ndim)
+    {
+        return join_result(TB_DIMENSION_OUT_OF_BOUNDS_ERROR, NULL, "split");
+    }
+
+    // An int splits dim into pieces of that size (the last one may be smaller), a sequence gives every size.
+    long size = in->shape[normalized_dim];
+    long count;
+    long *sizes;
+    if (PyLong_Check(split_sizes))
+    {
+        long split_size = PyLong_AsLong(split_sizes);
+        if (split_size == -1 && PyErr_Occurred())
+        {
+            return NULL;
+        }
+        if (split_size < 1)
+        {
+            PyErr_SetString(PyExc_ValueError, "split_size must be positive.");
+            return NULL;
+        }
+        count = size == 0 ? 1 : (size + split_size - 1) / split_size;
+        sizes = (long *)PyMem_Malloc(count * sizeof(long));
+        if (sizes == NULL)
+        {
+            return PyErr_NoMemory();
+        }
+        for (long i = 0; i < count; i++)
+        {
+            sizes[i] = Py_MIN(split_size, size - i * split_size);
+        }
+    }
+    else
+    {
+        PyObject *fast = PySequence_Fast(split_sizes, "split_size_or_sizes must be an int or a sequence of ints.");
+        if (fast == NULL)
+        {
+            return NULL;
+        }
+        count = PySequence_Fast_GET_SIZE(fast);
+        sizes = (long *)PyMem_Malloc(Py_MAX(count, 1) * sizeof(long));
+        if (sizes == NULL)
+        {
+            Py_DECREF(fast);
+            return PyErr_NoMemory();
+        }
+        for (long i = 0; i < count; i++)
+        {
+            sizes[i] = PyLong_AsLong(PySequence_Fast_GET_ITEM(fast, i));
+            if (sizes[i] == -1 && PyErr_Occurred())
+            {
+                PyMem_Free(sizes);
+                Py_DECREF(fast);
+                return NULL;
+            }
+        }
+        Py_DECREF(fast);
+    }
+
+    PyObject *result = NULL;
+    TensorBase *pieces = (TensorBase *)PyMem_Malloc(Py_MAX(count, 1) * sizeof(TensorBase));
+    if (pieces == NULL)
+    {
+        PyErr_NoMemory();
+    }
+    else
+    {
+        StatusCode status = TensorBase_split(in, sizes, count, dim, pieces);
+        if (status != TB_OK)
+        {
+            join_result(status, NULL, "split");
+        }
+        else
+        {
+            result = PyList_New(count);
+            for (long i = 0; i < count; i++)
+            {
+                PyTensorBase *piece = result == NULL ? NULL : (PyTensorBase *)PyObject_New(PyTensorBase, &PyTensorBaseType);
+                if (piece == NULL)
+                {
+                    // The list releases the pieces already wrapped, the others are released here.
+                    for (long j = i; j < count; j++)
+                    {
+                        TensorBase_dealloc(&pieces[j]);
+                    }
+                    Py_XDECREF(result);
+                    result = NULL;
+                    break;
+                }
+                piece->tb = pieces[i];
+                PyList_SET_ITEM(result, i, (PyObject *)piece);
+            }
+        }
+    }
+    PyMem_Free(pieces);
+    PyMem_Free(sizes);
+    return result;
+}
+
+static PyObject *softmax_result(StatusCode status, PyTensorBase *result)
+{
+    switch (status)
+    {
+    case TB_OK:
+        return (PyObject *)result;
+    case TB_DIMENSION_OUT_OF_BOUNDS_ERROR:
+        PyErr_SetString(PyExc_IndexError, "Dimension out of range in softmax.");
+        return NULL;
+    case TB_SHAPE_MISMATCH_ERROR:
+        PyErr_SetString(PyExc_ValueError, "The gradient given to the softmax backward must have the shape of the output.");
+        return NULL;
+    case TB_UNSUPPORTED_DTYPE_ERROR:
+        PyErr_SetString(PyExc_TypeError, "softmax is only supported for float32 and float64 tensors, and the gradient must have the output's dtype.");
+        return NULL;
+    case TB_MALLOC_ERROR:
+        PyErr_SetString(PyExc_RuntimeError, "Memory allocation error, unable to allocate enough memory for new tensorbase object.");
+        return NULL;
+    default:
+        PyErr_SetString(PyExc_RuntimeError, "Unknown Error in softmax.");
+        return NULL;
+    }
+}
+
+static PyObject *softmax_forward(PyObject *self, PyObject *args, PyObject *kwds, bool log)
+{
+    static char *kwlist[] = {"dim", NULL};
+    long dim;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "l", kwlist, &dim))
+    {
+        return NULL;
+    }
+    PyTensorBase *result = (PyTensorBase *)PyObject_New(PyTensorBase, &PyTensorBaseType);
+    if (result == NULL)
+    {
+        PyErr_SetString(PyExc_RuntimeError, "Failed to create new TensorBase object.");
+        return NULL;
+    }
+    return softmax_result(TensorBase_softmax(&((PyTensorBase *)self)->tb, dim, log, &result->tb), result);
+}
+
+static PyObject *softmax_backward(PyObject *self, PyObject *args, PyObject *kwds, bool log)
+{
+    static char *kwlist[] = {"grad", "dim", NULL};
+    PyObject *grad;
+    long dim;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "Ol", kwlist, &grad, &dim))
+    {
+        return NULL;
+    }
+    if (!PyTensorBase_Check(grad))
+    {
+        PyErr_SetString(PyExc_TypeError, "grad must be a TensorBase.");
+        return NULL;
+    }
+    PyTensorBase *result = (PyTensorBase *)PyObject_New(PyTensorBase, &PyTensorBaseType);
+    if (result == NULL)
+    {
+        PyErr_SetString(PyExc_RuntimeError, "Failed to create new TensorBase object.");
+        return NULL;
+    }
+    return softmax_result(TensorBase_softmax_backward(&((PyTensorBase *)self)->tb, &((PyTensorBase *)grad)->tb, dim, log, &result->tb), result);
+}
+
+static PyObject *PyTensorBase_softmax(PyObject *self, PyObject *args, PyObject *kwds)
+{
+    return softmax_forward(self, args, kwds, false);
+}
+
+static PyObject *PyTensorBase_log_softmax(PyObject *self, PyObject *args, PyObject *kwds)
+{
+    return softmax_forward(self, args, kwds, true);
+}
+
+static PyObject *PyTensorBase_softmax_backward(PyObject *self, PyObject *args, PyObject *kwds)
+{
+    return softmax_backward(self, args, kwds, false);
+}
+
+static PyObject *PyTensorBase_log_softmax_backward(PyObject *self, PyObject *args, PyObject *kwds)
+{
+    return softmax_backward(self, args, kwds, true);
+}
+
+static int parse_loss_reduction(const char *name, LossReduction *reduction)
+{
+    if (strcmp(name, "mean") == 0)
+    {
+        *reduction = TB_REDUCTION_MEAN;
+    }
+    else if (strcmp(name, "sum") == 0)
+    {
+        *reduction = TB_REDUCTION_SUM;
+    }
+    else if (strcmp(name, "none") == 0)
+    {
+        *reduction = TB_REDUCTION_NONE;
+    }
+    else
+    {
+        PyErr_Format(PyExc_ValueError, "Unknown reduction '%s'. Choose one of mean, sum or none.", name);
+        return -1;
+    }
+    return 0;
+}
+
+static int cross_entropy_error(StatusCode status)
+{
+    // Sets the Python exception for a failed cross entropy, and returns -1 (or 0 if it did not fail).
+    switch (status)
+    {
+    case TB_OK:
+        return 0;
+    case TB_INVALID_NDIM_ERROR:
+        PyErr_SetString(PyExc_ValueError, "cross_entropy expects (N, C) or (C) logits.");
+        return -1;
+    case TB_SHAPE_MISMATCH_ERROR:
+        PyErr_SetString(PyExc_ValueError, "The target of cross_entropy must be (N) class indices or class probabilities of the logits' shape.");
+        return -1;
+    case TB_INDEX_OUT_OF_BOUNDS_ERROR:
+        PyErr_SetString(PyExc_IndexError, "Target class index out of range in cross_entropy.");
+        return -1;
+    case TB_UNSUPPORTED_DTYPE_ERROR:
+        PyErr_SetString(PyExc_TypeError, "cross_entropy expects float32 or float64 logits, and int64 class indices or class probabilities of the logits' dtype.");
+        return -1;
+    case TB_MALLOC_ERROR:
+        PyErr_SetString(PyExc_RuntimeError, "Memory allocation error, unable to allocate enough memory for new tensorbase object.");
+        return -1;
+    default:
+        PyErr_SetString(PyExc_RuntimeError, "Unknown Error in cross_entropy.");
+        return -1;
+    }
+}
+
+static PyObject *PyTensorBase_cross_entropy(PyObject *self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"target", "reduction", "ignore_index", NULL};
+    PyObject *target;
+    const char *reduction_name = "mean";
+    long ignore_index = -100;
+    LossReduction reduction;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|sl", kwlist, &target, &reduction_name, &ignore_index) ||
+        parse_loss_reduction(reduction_name, &reduction) < 0)
+    {
+        return NULL;
+    }
+    if (!PyTensorBase_Check(target))
+    {
+        PyErr_SetString(PyExc_TypeError, "target must be a TensorBase.");
+        return NULL;
+    }
+
+    PyTensorBase *loss = (PyTensorBase *)PyObject_New(PyTensorBase, &PyTensorBaseType);
+    PyTensorBase *lse = loss == NULL ? NULL : (PyTensorBase *)PyObject_New(PyTensorBase, &PyTensorBaseType);
+    if (lse == NULL)
+    {
+        PyErr_SetString(PyExc_RuntimeError, "Failed to create new TensorBase object.");
+        return NULL;
+    }
+    if (cross_entropy_error(TensorBase_cross_entropy(&((PyTensorBase *)self)->tb, &((PyTensorBase *)target)->tb, ignore_index,
+                                                     reduction, &loss->tb, &lse->tb)) < 0)
+    {
+        return NULL;
+    }
+    // The tuple steals the references.
+    return Py_BuildValue("(NN)", loss, lse);
+}
+
+static PyObject *PyTensorBase_cross_entropy_backward(PyObject *self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"target", "lse", "grad", "reduction", "ignore_index", NULL};
+    PyObject *target, *lse, *grad;
+    const char *reduction_name = "mean";
+    long ignore_index = -100;
+    LossReduction reduction;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "OOO|sl", kwlist, &target, &lse, &grad, &reduction_name, &ignore_index) ||
+        parse_loss_reduction(reduction_name, &reduction) < 0)
+    {
+        return NULL;
+    }
+    if (!PyTensorBase_Check(target) || !PyTensorBase_Check(lse) || !PyTensorBase_Check(grad))
+    {
+        PyErr_SetString(PyExc_TypeError, "target, lse and grad must be TensorBase objects.");
+        return NULL;
+    }
+
+    PyTensorBase *result = (PyTensorBase *)PyObject_New(PyTensorBase, &PyTensorBaseType);
+    if (result == NULL)
+    {
+        PyErr_SetString(PyExc_RuntimeError, "Failed to create new TensorBase object.");
+        return NULL;
+    }
+    if (cross_entropy_error(TensorBase_cross_entropy_backward(&((PyTensorBase *)self)->tb, &((PyTensorBase *)target)->tb,
+                                                              &((PyTensorBase *)lse)->tb, &((PyTensorBase *)grad)->tb,
+                                                              ignore_index, reduction, &result->tb)) < 0)
+    {
+        return NULL;
+    }
+    return (PyObject *)result;
+}
+
+static int layer_norm_error(StatusCode status)
+{
+    // Sets the Python exception for a failed layer norm, and returns -1 (or 0 if it did not fail).
+    switch (status)
+    {
+    case TB_OK:
+        return 0;
+    case TB_INVALID_NDIM_ERROR:
+        PyErr_SetString(PyExc_ValueError, "layer_norm normalizes between 1 and ndim trailing dimensions.");
+        return -1;
+    case TB_SHAPE_MISMATCH_ERROR:
+        PyErr_SetString(PyExc_ValueError, "The residual and gradient of layer_norm must have the input's shape, and the weight and bias the shape of its normalized dimensions.");
+        return -1;
+    case TB_UNSUPPORTED_DTYPE_ERROR:
+        PyErr_SetString(PyExc_TypeError, "layer_norm expects float32 or float64 operands of one dtype.");
+        return -1;
+    case TB_MALLOC_ERROR:
+        PyErr_SetString(PyExc_RuntimeError, "Memory allocation error, unable to allocate enough memory for new tensorbase object.");
+        return -1;
+    default:
+        PyErr_SetString(PyExc_RuntimeError, "Unknown Error in layer_norm.");
+        return -1;
+    }
+}
+
+static PyObject *PyTensorBase_layer_norm(PyObject *self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"normalized_ndim", "weight", "bias", "eps", "residual", NULL};
+    long normalized_ndim;
+    PyObject *weight = Py_None, *bias = Py_None, *residual = Py_None;
+    double eps = 1e-5;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "l|OOdO", kwlist, &normalized_ndim, &weight, &bias, &eps, &residual))
+    {
+        return NULL;
+    }
+    if ((weight != Py_None && !PyTensorBase_Check(weight)) || (bias != Py_None && !PyTensorBase_Check(bias)) ||
+        (residual != Py_None && !PyTensorBase_Check(residual)))
+    {
+        PyErr_SetString(PyExc_TypeError, "weight, bias and residual must be TensorBase objects or None.");
+        return NULL;
+    }
+
+    PyTensorBase *results[4] = {NULL};
+    for (int i = 0; i < 4; i++)
+    {
+        // Without a residual, the normalized input is the tensor itself.
+        if (i == 1 && residual == Py_None)
+        {
+            continue;
+        }
+        results[i] = (PyTensorBase *)PyObject_New(PyTensorBase, &PyTensorBaseType);
+        if (results[i] == NULL)
+        {
+            PyErr_SetString(PyExc_RuntimeError, "Failed to create new TensorBase object.");
+            return NULL;
+        }
+    }
+    if (layer_norm_error(TensorBase_layer_norm(&((PyTensorBase *)self)->tb,
+                                               residual == Py_None ? NULL : &((PyTensorBase *)residual)->tb,
+                                               weight == Py_None ? NULL : &((PyTensorBase *)weight)->tb,
+                                               bias == Py_None ? NULL : &((PyTensorBase *)bias)->tb,
+                                               normalized_ndim, eps, &results[0]->tb,
+                                               residual == Py_None ? NULL : &results[1]->tb,
+                                               &results[2]->tb, &results[3]->tb)) < 0)
+    {
+        return NULL;
+    }
+    if (results[1] == NULL)
+    {
+        Py_INCREF(self);
+        results[1] = (PyTensorBase *)self;
+    }
+    // The tuple steals the references.
+    return Py_BuildValue("(NNNN)", results[0], results[1], results[2], results[3]);
+}
+
+static PyObject *PyTensorBase_layer_norm_backward(PyObject *self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"grad", "mean", "rstd", "normalized_ndim", "weight", "bias", NULL};
+    PyObject *grad, *mean, *rstd, *weight = Py_None;
+    long normalized_ndim;
+    int bias = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "OOOl|Op", kwlist, &grad, &mean, &rstd, &normalized_ndim, &weight, &bias))
+    {
+        return NULL;
+    }
+    if (!PyTensorBase_Check(grad) || !PyTensorBase_Check(mean) || !PyTensorBase_Check(rstd) ||
+        (weight != Py_None && !PyTensorBase_Check(weight)))
+    {
+        PyErr_SetString(PyExc_TypeError, "grad, mean, rstd and weight must be TensorBase objects.");
+        return NULL;
+    }
+
+    // The gradient of the weight is only computed if there is a weight, and the bias's if `bias` is true.
+    PyTensorBase *results[3] = {NULL};
+    bool wanted[3] = {true, weight != Py_None, bias};
+    for (int i = 0; i < 3; i++)
+    {
+        if (!wanted[i])
+        {
+            continue;
+        }
+        results[i] = (PyTensorBase *)PyObject_New(PyTensorBase, &PyTensorBaseType);
+        if (results[i] == NULL)
+        {
+            PyErr_SetString(PyExc_RuntimeError, "Failed to create new TensorBase object.");
+            return NULL;
+        }
+    }
+    if (layer_norm_error(TensorBase_layer_norm_backward(&((PyTensorBase *)self)->tb,
+                                                        weight == Py_None ? NULL : &((PyTensorBase *)weight)->tb,
+                                                        &((PyTensorBase *)mean)->tb, &((PyTensorBase *)rstd)->tb,
+                                                        &((PyTensorBase *)grad)->tb, normalized_ndim, &results[0]->tb,
+                                                        wanted[1] ? &results[1]->tb : NULL,
+                                                        wanted[2] ? &results[2]->tb : NULL)) < 0)
+    {
+        return NULL;
+    }
+    PyObject *items[3];
+    for (int i = 0; i < 3; i++)
+    {
+        items[i] = wanted[i] ? (PyObject *)results[i] : Py_NewRef(Py_None);
+    }
+    return Py_BuildValue("(NNN)", items[0], items[1], items[2]);
+}
+
+static int attention_error(StatusCode status)
+{
+    // Sets the Python exception for a failed attention, and returns -1 (or 0 if it did not fail).
+    switch (status)
+    {
+    case TB_OK:
+        return 0;
+    case TB_INVALID_NDIM_ERROR:
+        PyErr_SetString(PyExc_ValueError, "scaled_dot_product_attention expects queries, keys and values with at least 2 dimensions.");
+        return -1;
+    case TB_SHAPE_MISMATCH_ERROR:
+        PyErr_SetString(PyExc_ValueError, "Incompatible shapes in scaled_dot_product_attention: expected (..., Sq, D) queries, (..., Sk, D) keys, (..., Sk, Dv) values and an (Sq, Sk) or (..., Sq, Sk) mask.");
+        return -1;
+    case TB_UNSUPPORTED_DTYPE_ERROR:
+        PyErr_SetString(PyExc_TypeError, "scaled_dot_product_attention expects float32 or float64 operands of one dtype, and int64 query offsets or cache positions.");
+        return -1;
+    case TB_INDEX_OUT_OF_BOUNDS_ERROR:
+        PyErr_SetString(PyExc_IndexError, "The queries or cache rows of a batch entry do not fit in the keys or the cache at its offset.");
+        return -1;
+    case TB_NOT_IMPLEMENTED_ERROR:
+        PyErr_SetString(PyExc_ValueError, "Key/value caches, query offsets and cache positions must be contiguous.");
+        return -1;
+    case TB_MALLOC_ERROR:
+        PyErr_SetString(PyExc_RuntimeError, "Memory allocation error, unable to allocate enough memory for new tensorbase object.");
+        return -1;
+    default:
+        PyErr_SetString(PyExc_RuntimeError, "Unknown Error in scaled_dot_product_attention.");
+        return -1;
+    }
+}
+
+static int parse_attention_scale(PyObject *scale, TensorBase *query, double *value)
+{
+    // The scale defaults to 1 / sqrt(D).
+    if (scale == Py_None)
+    {
+        long head_dim = query->ndim == 0 ? 1 : query->shape[query->ndim - 1];
+        *value = 1.0 / sqrt((double)Py_MAX(head_dim, 1));
+        return 0;
+    }
+    *value = PyFloat_AsDouble(scale);
+    return *value == -1.0 && PyErr_Occurred() ? -1 : 0;
+}
+
+static PyObject *PyTensorBase_scaled_dot_product_attention(PyObject *self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"key", "value", "mask", "causal", "scale", "query_offsets", NULL};
+    PyObject *key, *value, *mask = Py_None, *scale_object = Py_None, *query_offsets = Py_None;
+    int causal = 0;
+    double scale;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "OO|OpOO", kwlist, &key, &value, &mask, &causal, &scale_object, &query_offsets))
+    {
+        return NULL;
+    }
+    if (!PyTensorBase_Check(key) || !PyTensorBase_Check(value) || (mask != Py_None && !PyTensorBase_Check(mask)) ||
+        (query_offsets != Py_None && !PyTensorBase_Check(query_offsets)))
+    {
+        PyErr_SetString(PyExc_TypeError, "key, value, mask and query_offsets must be TensorBase objects.");
+        return NULL;
+    }
+    if (parse_attention_scale(scale_object, &((PyTensorBase *)self)->tb, &scale) < 0)
+    {
+        return NULL;
+    }
+
+    PyTensorBase *out = (PyTensorBase *)PyObject_New(PyTensorBase, &PyTensorBaseType);
+    PyTensorBase *lse = out == NULL ? NULL : (PyTensorBase *)PyObject_New(PyTensorBase, &PyTensorBaseType);
+    if (lse == NULL)
+    {
+        PyErr_SetString(PyExc_RuntimeError, "Failed to create new TensorBase object.");
+        return NULL;
+    }
+    if (attention_error(TensorBase_scaled_dot_product_attention(&((PyTensorBase *)self)->tb, &((PyTensorBase *)key)->tb,
+                                                                &((PyTensorBase *)value)->tb,
+                                                                mask == Py_None ? NULL : &((PyTensorBase *)mask)->tb,
+                                                                query_offsets == Py_None ? NULL : &((PyTensorBase *)query_offsets)->tb,
+                                                                causal, scale, &out->tb, &lse->tb)) < 0)
+    {
+        return NULL;
+    }
+    // The tuple steals the references.
+    return Py_BuildValue("(NN)", out, lse);
+}
+
+static PyObject *PyTensorBase_scaled_dot_product_attention_backward(PyObject *self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"key", "value", "out", "lse", "grad", "mask", "causal", "scale", "query_offsets", NULL};
+    PyObject *key, *value, *out, *lse, *grad, *mask = Py_None, *scale_object = Py_None, *query_offsets = Py_None;
+    int causal = 0;
+    double scale;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "OOOOO|OpOO", kwlist, &key, &value, &out, &lse, &grad, &mask, &causal, &scale_object,
+                                     &query_offsets))
+    {
+        return NULL;
+    }
+    if (!PyTensorBase_Check(key) || !PyTensorBase_Check(value) || !PyTensorBase_Check(out) || !PyTensorBase_Check(lse) ||
+        !PyTensorBase_Check(grad) || (mask != Py_None && !PyTensorBase_Check(mask)) ||
+        (query_offsets != Py_None && !PyTensorBase_Check(query_offsets)))
+    {
+        PyErr_SetString(PyExc_TypeError, "key, value, out, lse, grad, mask and query_offsets must be TensorBase objects.");
+        return NULL;
+    }
+    if (parse_attention_scale(scale_object, &((PyTensorBase *)self)->tb, &scale) < 0)
+    {
+        return NULL;
+    }
+
+    PyTensorBase *results[3];
+    for (int i = 0; i < 3; i++)
+    {
+        results[i] = (PyTensorBase *)PyObject_New(PyTensorBase, &PyTensorBaseType);
+        if (results[i] == NULL)
+        {
+            PyErr_SetString(PyExc_RuntimeError, "Failed to create new TensorBase object.");
+            return NULL;
+        }
+    }
+    if (attention_error(TensorBase_scaled_dot_product_attention_backward(
+            &((PyTensorBase *)self)->tb, &((PyTensorBase *)key)->tb, &((PyTensorBase *)value)->tb,
+            mask == Py_None ? NULL : &((PyTensorBase *)mask)->tb,
+            query_offsets == Py_None ? NULL : &((PyTensorBase *)query_offsets)->tb, causal, scale, &((PyTensorBase *)out)->tb,
+            &((PyTensorBase *)lse)->tb, &((PyTensorBase *)grad)->tb, &results[0]->tb, &results[1]->tb, &results[2]->tb)) < 0)
+    {
+        return NULL;
+    }
+    return Py_BuildValue("(NNN)", results[0], results[1], results[2]);
+}
+
+static PyObject *PyTensorBase_kv_cache_write_(PyObject *self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"rows", "positions", NULL};
+    PyObject *rows, *positions;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "OO", kwlist, &rows, &positions))
+    {
+        return NULL;
+    }
+    if (!PyTensorBase_Check(rows) || !PyTensorBase_Check(positions))
+    {
+        PyErr_SetString(PyExc_TypeError, "rows and positions must be TensorBase objects.");
+        return NULL;
+    }
+
+    StatusCode status = TensorBase_kv_cache_write(&((PyTensorBase *)self)->tb, &((PyTensorBase *)rows)->tb, &((PyTensorBase *)positions)->tb);
+    if (status == TB_SHAPE_MISMATCH_ERROR)
+    {
+        PyErr_SetString(PyExc_ValueError, "kv_cache_write_ expects (N, ..., T, D) rows for an (N, ..., L, D) cache, and (N) positions.");
+        return NULL;
+    }
+    if (attention_error(status) < 0)
+    {
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+static int parse_activation(const char *name, Activation *activation)
+{
+    if (name == NULL)
+    {
+        *activation = TB_ACTIVATION_NONE;
+    }
+    else if (strcmp(name, "relu") == 0)
+    {
+        *activation = TB_ACTIVATION_RELU;
+    }
+    else if (strcmp(name, "sigmoid") == 0)
+    {
+        *activation = TB_ACTIVATION_SIGMOID;
+    }
+    else if (strcmp(name, "tanh") == 0)
+    {
+        *activation = TB_ACTIVATION_TANH;
+    }
+    else
+    {
+        PyErr_Format(PyExc_ValueError, "Unknown activation '%s'. Choose one of relu, sigmoid, tanh or None.", name);
+        return -1;
+    }
+    return 0;
+}
+
+static int linear_error(StatusCode status)
+{
+    // Sets the Python exception for a failed linear layer, and returns -1 (or 0 if it did not fail).
+    switch (status)
+    {
+    case TB_OK:
+        return 0;
+    case TB_INVALID_NDIM_ERROR:
+        PyErr_SetString(PyExc_ValueError, "linear expects an input with at least 1 dimension, a 2D weight and a 1D bias.");
+        return -1;
+    case TB_SHAPE_MISMATCH_ERROR:
+        PyErr_SetString(PyExc_ValueError, "Incompatible shapes in linear: expected a (..., in_features) input, an (out_features, in_features) weight, an (out_features) bias and a (..., out_features) output and gradient.");
+        return -1;
+    case TB_UNSUPPORTED_DTYPE_ERROR:
+        PyErr_SetString(PyExc_TypeError, "linear expects float32 or float64 operands of one dtype.");
+        return -1;
+    case TB_MALLOC_ERROR:
+        PyErr_SetString(PyExc_RuntimeError, "Memory allocation error, unable to allocate enough memory for new tensorbase object.");
+        return -1;
+    default:
+        PyErr_SetString(PyExc_RuntimeError, "Unknown Error in linear.");
+        return -1;
+    }
+}
+
+static PyObject *PyTensorBase_linear(PyObject *self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"weight", "bias", "activation", NULL};
+    PyObject *weight, *bias = Py_None;
+    const char *activation_name = NULL;
+    Activation activation;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|Oz", kwlist, &weight, &bias, &activation_name) ||
+        parse_activation(activation_name, &activation) < 0)
+    {
+        return NULL;
+    }
+    if (!PyTensorBase_Check(weight) || (bias != Py_None && !PyTensorBase_Check(bias)))
+    {
+        PyErr_SetString(PyExc_TypeError, "weight must be a TensorBase object, and bias a TensorBase object or None.");
+        return NULL;
+    }
+
+    PyTensorBase *result = (PyTensorBase *)PyObject_New(PyTensorBase, &PyTensorBaseType);
+    if (result == NULL)
+    {
+        PyErr_SetString(PyExc_RuntimeError, "Failed to create new TensorBase object.");
+        return NULL;
+    }
+    if (linear_error(TensorBase_linear(&((PyTensorBase *)self)->tb, &((PyTensorBase *)weight)->tb,
+                                       bias == Py_None ? NULL : &((PyTensorBase *)bias)->tb, activation, &result->tb)) < 0)
+    {
+        return NULL;
+    }
+    return (PyObject *)result;
+}
+
+static PyObject *PyTensorBase_linear_backward(PyObject *self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"weight", "out", "grad", "activation", "bias", NULL};
+    PyObject *weight, *out, *grad;
+    const char *activation_name = NULL;
+    Activation activation;
+    int bias = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "OOO|zp", kwlist, &weight, &out, &grad, &activation_name, &bias) ||
+        parse_activation(activation_name, &activation) < 0)
+    {
+        return NULL;
+    }
+    if (!PyTensorBase_Check(weight) || !PyTensorBase_Check(out) || !PyTensorBase_Check(grad))
+    {
+        PyErr_SetString(PyExc_TypeError, "weight, out and grad must be TensorBase objects.");
+        return NULL;
+    }
+
+    // The gradient of the bias is only computed if `bias` is true.
+    PyTensorBase *results[3] = {NULL};
+    for (int i = 0; i < (bias ? 3 : 2); i++)
+    {
+        results[i] = (PyTensorBase *)PyObject_New(PyTensorBase, &PyTensorBaseType);
+        if (results[i] == NULL)
+        {
+            PyErr_SetString(PyExc_RuntimeError, "Failed to create new TensorBase object.");
+            return NULL;
+        }
+    }
+    if (linear_error(TensorBase_linear_backward(&((PyTensorBase *)self)->tb, &((PyTensorBase *)weight)->tb,
+                                                &((PyTensorBase *)out)->tb, &((PyTensorBase *)grad)->tb, activation,
+                                                &results[0]->tb, &results[1]->tb, bias ? &results[2]->tb : NULL)) < 0)
+    {
+        return NULL;
+    }
+    return Py_BuildValue("(NNN)", results[0], results[1], bias ? (PyObject *)results[2] : Py_NewRef(Py_None));
+}
+
 static PyObject *PyTensorBase_richcompare(PyObject *self, PyObject *other, int op)
 {
     BinaryScalarOperation binop;
@@ -25,8 +25,7 @@ class TestConv2d(BaseUnitTest):
             (3, 3, (-3, 3), 1, 0, 1),  # Faulty kernel_size (negative dimension)
             (3, 3, (3, 3), 0, 0, 1),  # Faulty stride (0 is invalid)
             (3, 3, (3, 3), -1, 0, 1),  # Faulty stride (negative value)
-            (3, 3, (3, 3), 1, -1, 1),  # Faulty padding (not 0 is invalid)
-            (3, 3, (3, 3), 1, 1, 1),  # Faulty padding (not 0 is invalid)
+            (3, 3, (3, 3), 1, -1, 1),  # Faulty padding (negative value)
             (3, 3, (3, 3), 1, 0, 0),  # Faulty dilation (0 is invalid)
             (3, 3, (3, 3), 1, 0, -1),  # Faulty dilation (negative value)
             (3, 3, (3,), -1, 0, 1),  # Faulty kernel_size (tuple of length 1)
@@ -287,3 +286,99 @@ class TestConv2d(BaseUnitTest):
                 match_output = match_conv2d(mat_x)
 
                 self.assertTrue(self.almost_equal(match_output, pytorch_output))
+
+    def test_conv2d_padding_gradients(self):
+        # Configuration format: (N, in_channels, out_channels, kernel_size, stride, padding, dilation)
+        configurations = [
+            (2, 3, 4, (3, 3), 1, 1, 1),
+            (1, 2, 3, (3, 2), (2, 1), (2, 1), (1, 2)),
+            (2, 1, 2, (5, 5), 2, 3, 1),
+        ]
+
+        for (
+            N,
+            in_channels,
+            out_channels,
+            kernel_size,
+            stride,
+            padding,
+            dilation,
+        ) in configurations:
+            with self.subTest(
+                N=N,
+                kernel_size=kernel_size,
+                stride=stride,
+                padding=padding,
+                dilation=dilation,
+            ):
+                match_conv2d = Conv2d(
+                    in_channels,
+                    out_channels,
+                    kernel_size,
+                    stride=stride,
+                    padding=padding,
+                    dilation=dilation,
+                    bias=True,
+                )
+                pytorch_conv2d = torch.nn.Conv2d(
+                    in_channels,
+                    out_channels,
+                    kernel_size,
+                    stride=stride,
+                    padding=padding,
+                    dilation=dilation,
+                    bias=True,
+                )
+
+                # Initialize with same weights and biases
+                pytorch_conv2d.weight.data = self.to_tensor(
+                    match_conv2d._trainable_kernels.T.reshape(
+                        out_channels, in_channels, *kernel_size
+                    )
+                )
+                pytorch_conv2d.bias.data = self.to_tensor(match_conv2d._trainable_bias)
+
+                mat_x, ten_x = self.generate_tensor_pair((N, in_channels, 9, 10))
+
+                match_output = match_conv2d(mat_x)
+                pytorch_output = pytorch_conv2d(ten_x)
+                self.assertTrue(self.almost_equal(match_output, pytorch_output, debug=False))
+
+                match_output.sum().backward()
+                pytorch_output.sum().backward()
+                self.assertTrue(self.almost_equal(mat_x, ten_x, check_grad=True, debug=False))
+                self.assertTrue(
+                    self.almost_equal(
+                        match_conv2d._trainable_bias,
+                        pytorch_conv2d.bias,
+                        check_grad=True,
+                        debug=False,
+                    )
+                )
+
+    def test_conv2d_algorithms(self):
+        # Every algorithm of the backend computes the same convolution, forwards and backwards.
+        for algorithm in ("im2col", "winograd_2x3", "winograd_4x3", "fft", "auto"):
+            with self.subTest(algorithm=algorithm):
+                match_conv2d = Conv2d(3, 4, (3, 3), padding=1, bias=True, algorithm=algorithm)
+                pytorch_conv2d = torch.nn.Conv2d(3, 4, (3, 3), padding=1, bias=True)
+                pytorch_conv2d.weight.data = self.to_tensor(
+                    match_conv2d._trainable_kernels.T.reshape(4, 3, 3, 3)
+                )
+                pytorch_conv2d.bias.data = self.to_tensor(match_conv2d._trainable_bias)
+
+                mat_x, ten_x = self.generate_tensor_pair((2, 3, 11, 10))
+
+                match_output = match_conv2d(mat_x)
+                pytorch_output = pytorch_conv2d(ten_x)
+                self.assertTrue(self.almost_equal(match_output, pytorch_output, debug=False))
+
+                match_output.sum().backward()
+                pytorch_output.sum().backward()
+                self.assertTrue(self.almost_equal(mat_x, ten_x, check_grad=True, debug=False))
+
+    def test_conv2d_winograd_rejects_strided_window(self):
+        match_conv2d = Conv2d(2, 2, (3, 3), stride=2, algorithm="winograd_4x3")
+        mat_x, _ = self.generate_tensor_pair((1, 2, 8, 8))
+        with self.assertRaises(ValueError):
+            match_conv2d(mat_x)
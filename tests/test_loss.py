@@ -3,6 +3,7 @@ import match.nn
 import torch.nn
 from .base import BaseUnitTest
 from match import tensor
+from match.tensorbase import TensorBase
 
 class TestLossFunctions(BaseUnitTest):
     """
@@ -33,3 +34,24 @@ class TestLossFunctions(BaseUnitTest):
         self.assertTrue(
             self.almost_equal(match_target, torch_target, check_grad=True)
         )
+
+    def test_cross_entropy_loss(self):
+        """
+        Test CrossEntropyLoss against class indices (with an ignored row) and class probabilities.
+        """
+        indices = [random.randrange(5) for _ in range(4)] + [-100]
+        match_indices = tensor.Tensor(TensorBase.from_sequence(indices, dtype="int64"))
+        match_probabilities, torch_probabilities = self.generate_tensor_pair(shape=(5, 5))
+        match_probabilities, torch_probabilities = match_probabilities.softmax(1), torch_probabilities.softmax(1)
+        targets = [(match_indices, torch.tensor(indices)), (match_probabilities, torch_probabilities.detach())]
+
+        for match_target, torch_target in targets:
+            for reduction in ("mean", "sum", "none"):
+                match_logits, torch_logits = self.generate_tensor_pair(shape=(5, 5))
+                match_loss = match.nn.CrossEntropyLoss(reduction=reduction)(match_logits, match_target)
+                torch_loss = torch.nn.CrossEntropyLoss(reduction=reduction)(torch_logits, torch_target)
+                self.assertTrue(self.almost_equal(match_loss, torch_loss, check_grad=False))
+
+                match_loss.sum().backward()
+                torch_loss.sum().backward()
+                self.assertTrue(self.almost_equal(match_logits, torch_logits, check_grad=True))
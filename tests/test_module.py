@@ -100,3 +100,38 @@ class TestModule(BaseUnitTest):
         
         
 
+
+    def test_gpt2_kv_cache_decoding(self):
+        # Decoding one position at a time with a key/value cache matches the causal forward pass of the whole sequence.
+        model = match.nn.GPT2(match.nn.TransformerDecoderLayer(d_model=16, nhead=4, dim_feedforward=32), num_layers=2)
+        x = randn(2, 6, 16)
+        full = self.to_tensor(model(x))
+
+        cache = model.init_cache(batch_size=2, max_length=8)
+        for position, step in enumerate(x.data.split(1, 1)):
+            out = model(tensor.Tensor(step), cache=cache)
+            self.assertTrue(self.almost_equal(out, full[:, position : position + 1]))
+        self.assertEqual(cache.lengths, [6, 6])
+
+    def test_gpt2_kv_cache_ragged_batch(self):
+        # Sequences whose prompts have different lengths are decoded from their own positions, and each matches the
+        # causal forward pass of the whole sequence.
+        model = match.nn.GPT2(match.nn.TransformerDecoderLayer(d_model=16, nhead=4, dim_feedforward=32), num_layers=2)
+        x = randn(2, 6, 16)
+        full = model(x)
+
+        # The prompt of sequence 0 has 2 positions, padded to the 4 positions of the prompt of sequence 1.
+        prompt = match.cat([match.cat([x[0:1, 0:2], randn(1, 2, 16)], 1), x[1:2, 0:4]], 0)
+        cache = model.init_cache(batch_size=2, max_length=8)
+        out = model(prompt, cache=cache, lengths=[2, 4])
+        self.assertTrue(self.almost_equal(out[0:1, 0:2], self.to_tensor(full[0:1, 0:2])))
+        self.assertTrue(self.almost_equal(out[1:2], self.to_tensor(full[1:2, 0:4])))
+
+        positions = [2, 4]
+        while max(positions) < 6:
+            step = match.cat([x[b : b + 1, p : p + 1] for b, p in enumerate(positions)], 0)
+            out = model(step, cache=cache)
+            for b, p in enumerate(positions):
+                self.assertTrue(self.almost_equal(out[b : b + 1], self.to_tensor(full[b : b + 1, p : p + 1])))
+            positions = [p + 1 for p in positions]
+        self.assertEqual(cache.lengths, [4, 6])
@@ -0,0 +1,48 @@
+import match.nn
+import torch.nn
+from .base import BaseUnitTest
+
+
+class TestNormalization(BaseUnitTest):
+
+    def test_layer_norm(self):
+        """
+        Test layer_norm over one and two trailing dimensions, with and without γ, β and a residual.
+        """
+        for shape, normalized_shape in [((2, 4, 3), (3,)), ((3, 4, 5), (4, 5)), ((2, 300), (300,))]:
+            for affine in (False, True):
+                match_x, torch_x = self.generate_tensor_pair(shape=shape)
+                match_residual, torch_residual = self.generate_tensor_pair(shape=shape)
+                match_weight, torch_weight = self.generate_tensor_pair(shape=normalized_shape)
+                match_bias, torch_bias = self.generate_tensor_pair(shape=normalized_shape)
+
+                match_result = match_x.layer_norm(
+                    normalized_shape,
+                    match_weight if affine else None,
+                    match_bias if affine else None,
+                    residual=match_residual,
+                )
+                torch_result = torch.nn.functional.layer_norm(
+                    torch_x + torch_residual,
+                    normalized_shape,
+                    torch_weight if affine else None,
+                    torch_bias if affine else None,
+                )
+                self.assertTrue(self.almost_equal(match_result, torch_result, check_grad=False))
+
+                (match_result * match_result).sum().backward()
+                (torch_result * torch_result).sum().backward()
+                checked = [(match_x, torch_x), (match_residual, torch_residual)]
+                if affine:
+                    checked += [(match_weight, torch_weight), (match_bias, torch_bias)]
+                for match_tensor, torch_tensor in checked:
+                    self.assertTrue(self.almost_equal(match_tensor, torch_tensor, check_grad=True))
+
+    def test_layer_norm_module(self):
+        """
+        Test the LayerNorm module against torch.nn.LayerNorm.
+        """
+        match_x, torch_x = self.generate_tensor_pair(shape=(2, 3, 6))
+        match_result = match.nn.LayerNorm(6)(match_x)
+        torch_result = torch.nn.LayerNorm(6, dtype=torch_x.dtype)(torch_x)
+        self.assertTrue(self.almost_equal(match_result, torch_result, check_grad=False))
@@ -0,0 +1,60 @@
+import torch
+import match.optim
+from .base import BaseUnitTest
+from match import randn
+
+
+class TestOptim(BaseUnitTest):
+    """
+    Unit tests for the fused optimizers, compared against torch.optim.
+    """
+
+    def run_optimizer(self, match_optimizer, torch_optimizer, **kwargs):
+        shapes = [(3, 4), (5,), (40000,)]
+        match_params = [randn(*shape) for shape in shapes]
+        torch_params = [self.to_tensor(param, requires_grad=True) for param in match_params]
+        match_opt = match_optimizer(match_params, **kwargs)
+        torch_opt = torch_optimizer(torch_params, **kwargs)
+
+        for _ in range(3):
+            for match_param, torch_param in zip(match_params, torch_params):
+                grad = randn(*match_param.shape)
+                match_param.grad = grad.data
+                torch_param.grad = self.to_tensor(grad)
+            match_opt.step()
+            torch_opt.step()
+
+        for match_param, torch_param in zip(match_params, torch_params):
+            self.assertTrue(self.almost_equal(match_param, torch_param, debug=False))
+
+    def test_sgd(self):
+        self.run_optimizer(match.optim.SGD, torch.optim.SGD, lr=0.1)
+
+    def test_sgd_momentum(self):
+        self.run_optimizer(match.optim.SGD, torch.optim.SGD, lr=0.1, momentum=0.9, dampening=0.1, weight_decay=0.01)
+
+    def test_sgd_nesterov(self):
+        self.run_optimizer(match.optim.SGD, torch.optim.SGD, lr=0.1, momentum=0.9, nesterov=True)
+
+    def test_adam(self):
+        self.run_optimizer(match.optim.Adam, torch.optim.Adam, lr=0.01, weight_decay=0.1)
+
+    def test_adamw(self):
+        self.run_optimizer(match.optim.AdamW, torch.optim.AdamW, lr=0.01, weight_decay=0.1)
+
+    def test_optimizer_rejects_mismatched_gradients(self):
+        param = randn(2, 3)
+        param.grad = randn(3, 2).data
+        with self.assertRaises(ValueError):
+            match.optim.SGD([param], lr=0.1).step()
+
+    def test_optimizer_step_accepts_generators(self):
+        # The tensors of an iterable that is not a list or tuple (e.g., a generator) must stay alive during the step.
+        from match.tensorbase import sgd_step
+
+        param, grad = randn(2, 3), randn(2, 3)
+        buffers = [randn(2, 3).data]
+        expected = self.to_tensor(param) - 0.1 * self.to_tensor(grad)
+        sgd_step([param.data], [grad.data], (b for b in buffers), lr=0.1, momentum=0.9, first_step=True)
+        self.assertTrue(self.almost_equal(param, expected, debug=False))
+        self.assertTrue(self.almost_equal(match.Tensor(buffers[0]), self.to_tensor(grad), debug=False))
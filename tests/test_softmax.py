@@ -34,3 +34,27 @@ class TestSoftmax(BaseUnitTest):
             self.assertTrue(
                 self.almost_equal(match_tensor, torch_tensor, check_grad=True)
             )
+
+    def test_log_softmax(self):
+        """
+        Test the LogSoftmax function, including chunked rows longer than 256 elements.
+        """
+        for shape, dim in [((2, 4, 3), -1), ((3, 700), 1), ((3, 4, 5), 1)]:
+            match_tensor, torch_tensor = self.generate_tensor_pair(shape=shape)
+
+            match_log_softmax = match.nn.LogSoftmax(dim=dim)(match_tensor)
+            torch_log_softmax = torch.nn.LogSoftmax(dim=dim)(torch_tensor)
+            self.assertTrue(self.almost_equal(match_log_softmax, torch_log_softmax))
+
+            match_log_softmax.sum().backward()
+            torch_log_softmax.sum().backward()
+            self.assertTrue(self.almost_equal(match_tensor, torch_tensor, check_grad=True))
+
+    def test_softmax_large_logits(self):
+        """
+        The max is subtracted before exponentiating, so large logits do not overflow.
+        """
+        match_tensor, torch_tensor = self.generate_tensor_pair(shape=(4, 6))
+        match_softmax = match.nn.Softmax(dim=-1)(match_tensor * 1000)
+        torch_softmax = torch.nn.Softmax(dim=-1)(torch_tensor * 1000)
+        self.assertTrue(self.almost_equal(match_softmax, torch_softmax))
@@ -3,6 +3,7 @@ import torch
 import itertools
 import numpy as np
 import random
+import match
 from .base import BaseUnitTest
 
 
@@ -308,3 +309,67 @@ class TestTensor(BaseUnitTest):
         ten_sum.backward()
 
         self.assertTrue(self.almost_equal(mat, ten, check_grad=True))
+
+    def test_cat(self):
+        mat_a, ten_a = self.generate_tensor_pair((2, 3, 4))
+        mat_b, ten_b = self.generate_tensor_pair((2, 5, 4))
+
+        mat_cat = match.cat([mat_a, mat_b], dim=1)
+        ten_cat = torch.cat([ten_a, ten_b], dim=1)
+        self.assertTrue(self.almost_equal(mat_cat, ten_cat))
+
+        (mat_cat * mat_cat).sum().backward()
+        (ten_cat * ten_cat).sum().backward()
+        self.assertTrue(self.almost_equal(mat_a, ten_a, check_grad=True))
+        self.assertTrue(self.almost_equal(mat_b, ten_b, check_grad=True))
+
+    def test_stack(self):
+        mat_a, ten_a = self.generate_tensor_pair((3, 4))
+        mat_b, ten_b = self.generate_tensor_pair((3, 4))
+
+        mat_stack = match.stack([mat_a, mat_b], dim=-1)
+        ten_stack = torch.stack([ten_a, ten_b], dim=-1)
+        self.assertTrue(self.almost_equal(mat_stack, ten_stack))
+
+        (mat_stack * mat_stack).sum().backward()
+        (ten_stack * ten_stack).sum().backward()
+        self.assertTrue(self.almost_equal(mat_a, ten_a, check_grad=True))
+        self.assertTrue(self.almost_equal(mat_b, ten_b, check_grad=True))
+
+    def test_scaled_dot_product_attention(self):
+        # Sequences longer than one 64-key tile, with and without a causal mask, and with an additive mask.
+        for is_causal, with_mask in [(False, False), (True, False), (False, True)]:
+            mat_q, ten_q = self.generate_tensor_pair((2, 3, 70, 8))
+            mat_k, ten_k = self.generate_tensor_pair((2, 3, 70, 8))
+            mat_v, ten_v = self.generate_tensor_pair((2, 3, 70, 5))
+            mat_mask, ten_mask = self.generate_tensor_pair((70, 70)) if with_mask else (None, None)
+
+            mat_attn = match.scaled_dot_product_attention(mat_q, mat_k, mat_v, attn_mask=mat_mask, is_causal=is_causal)
+            ten_attn = torch.nn.functional.scaled_dot_product_attention(
+                ten_q, ten_k, ten_v, attn_mask=None if ten_mask is None else ten_mask.detach(), is_causal=is_causal
+            )
+            self.assertTrue(self.almost_equal(mat_attn, ten_attn))
+
+            (mat_attn * mat_attn).sum().backward()
+            (ten_attn * ten_attn).sum().backward()
+            for mat, ten in [(mat_q, ten_q), (mat_k, ten_k), (mat_v, ten_v)]:
+                self.assertTrue(self.almost_equal(mat, ten, check_grad=True))
+
+    def test_linear(self):
+        # A batched input, with the activations fused into the GEMM's epilogue, with and without a bias.
+        activations = {None: lambda t: t, "relu": torch.relu, "sigmoid": torch.sigmoid, "tanh": torch.tanh}
+        for activation, torch_activation in activations.items():
+            for with_bias in (True, False):
+                mat_x, ten_x = self.generate_tensor_pair((3, 5, 300))
+                mat_w, ten_w = self.generate_tensor_pair((20, 300))
+                mat_b, ten_b = self.generate_tensor_pair((20,)) if with_bias else (None, None)
+
+                mat_y = mat_x.linear(mat_w, mat_b, activation)
+                ten_y = torch_activation(torch.nn.functional.linear(ten_x, ten_w, ten_b))
+                self.assertTrue(self.almost_equal(mat_y, ten_y))
+
+                (mat_y * mat_y).sum().backward()
+                (ten_y * ten_y).sum().backward()
+                for mat, ten in [(mat_x, ten_x), (mat_w, ten_w), (mat_b, ten_b)]:
+                    if mat is not None:
+                        self.assertTrue(self.almost_equal(mat, ten, check_grad=True))
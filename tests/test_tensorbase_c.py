@@ -1,6 +1,7 @@
 import torch
 from .base import BaseUnitTest
 from match.tensorbase import TensorBase
+import match.tensorbase
 import operator
 from typing import Callable
 from random import gauss
@@ -56,7 +57,8 @@ class TestTensorBase(BaseUnitTest):
         self.assertEqual(match_tensorbase.size, torch_tensor.size())
         self.assertEqual(match_tensorbase.ndim, torch_tensor.ndim)
         self.assertEqual(match_tensorbase.numel, torch_tensor.numel())
-        # Strides differ because PyTorch uses views, while PyMatch doesn't, so we skip this comparison.
+        # Strides may differ because PyTorch preserves the layout of views in the results of operations, while PyMatch
+        # always returns contiguous results, so we skip this comparison.
 
     def test_invalid_non_tuple(self):
         """Test TensorBase initialization with non-integer input."""
@@ -374,6 +376,30 @@ class TestTensorBase(BaseUnitTest):
         with self.subTest(msg="nodim"):
             self.almost_equal(match_tensor.sum((), False), torch_tensor.sum())
 
+    def test_aggregate_random(self):
+        match_tensor, torch_tensor = self.generate_tensor_pair((4, 3, 37))
+        for dims in [(0,), (1,), (2,), (0, 2), (1, 2)]:
+            with self.subTest(msg=f"sum_{dims}"):
+                self.almost_equal(
+                    match_tensor.sum(dims, True), torch_tensor.sum(dims, keepdim=True)
+                )
+        for dim in [0, 1, 2]:
+            with self.subTest(msg=f"max_{dim}"):
+                self.almost_equal(
+                    match_tensor.max((dim,), False), torch_tensor.max(dim).values
+                )
+            with self.subTest(msg=f"argmin_{dim}"):
+                self.almost_equal(
+                    match_tensor.argmin((dim,), False), torch_tensor.argmin(dim)
+                )
+
+    def test_sum_large_keepdim(self):
+        # The output has too many elements to be buffered on the stack.
+        match_tensor, torch_tensor = self.generate_tensor_pair((2, 1_000_000), fill_value=0.5)
+        self.almost_equal(
+            match_tensor.sum((0,), True), torch_tensor.sum((0,), keepdim=True)
+        )
+
     def test_mean(self):
         match_tensor, torch_tensor = self.generate_tensor_pair((3, 1, 3), fill_value=4)
         with self.subTest(msg="dim"):
@@ -415,6 +441,43 @@ class TestTensorBase(BaseUnitTest):
                     match_tensor1 @ match_tensor2, torch_tensor1 @ torch_tensor2
                 )
 
+    def test_matmul_blocked_shapes(self):
+        # Shapes that straddle the GEMM engine's register and cache block boundaries.
+        configurations = {
+            "micro_tile_edges": [(5, 9), (9, 17)],
+            "multiple_blocks": [(130, 300), (300, 33)],
+            "wide_output": [(3, 70), (70, 2050)],
+            "batched": [(2, 1, 65, 40), (3, 40, 66)],
+        }
+        for msg, shapes in configurations.items():
+            with self.subTest(msg=msg):
+                match_tensor1, torch_tensor1 = self.generate_tensor_pair(shapes[0])
+                match_tensor2, torch_tensor2 = self.generate_tensor_pair(shapes[1])
+                self.almost_equal(
+                    match_tensor1 @ match_tensor2, torch_tensor1 @ torch_tensor2
+                )
+
+    def test_matmul_batched_parallel(self):
+        # Batches that are shared out between threads, with a broadcast (shared) rhs and with per-entry operands.
+        configurations = {
+            "shared_rhs": [(3, 2, 70, 80), (80, 90)],
+            "broadcast_lhs": [(80, 90), (4, 90, 70)],
+            "broadcast_batch_dims": [(2, 1, 30, 40), (3, 40, 50)],
+            "many_small": [(4, 6, 9, 8), (4, 6, 8, 9)],
+        }
+        num_threads = match.tensorbase.get_num_threads()
+        match.tensorbase.set_num_threads(4)
+        try:
+            for msg, shapes in configurations.items():
+                with self.subTest(msg=msg):
+                    match_tensor1, torch_tensor1 = self.generate_tensor_pair(shapes[0])
+                    match_tensor2, torch_tensor2 = self.generate_tensor_pair(shapes[1])
+                    self.almost_equal(
+                        match_tensor1 @ match_tensor2, torch_tensor1 @ torch_tensor2
+                    )
+        finally:
+            match.tensorbase.set_num_threads(num_threads)
+
     def test_transpose(self):
         match_tensor, torch_tensor = self.generate_tensor_pair((3, 4, 2))
         self.almost_equal(match_tensor.transpose(), torch_tensor.T)
@@ -441,6 +504,49 @@ class TestTensorBase(BaseUnitTest):
         self.almost_equal(match_tensor.permute(()), torch_tensor.permute(()))
         self.assertRaises(RuntimeError, lambda: match_tensor.permute((0,)))
 
+    def test_permute_tiled(self):
+        # Shapes that straddle the transpose kernel's tile boundaries.
+        configurations = {
+            "transpose_2d": [(70, 33), (1, 0)],
+            "last_two_axes": [(3, 40, 37), (0, 2, 1)],
+            "keep_inner_axis": [(4, 5, 6, 7), (1, 0, 2, 3)],
+            "general": [(5, 34, 3, 35), (3, 2, 0, 1)],
+            "size_one_axes": [(1, 36, 1, 33), (3, 2, 1, 0)],
+        }
+        for msg, (shape, permutation) in configurations.items():
+            with self.subTest(msg=msg):
+                match_tensor, torch_tensor = self.generate_tensor_pair(shape)
+                self.almost_equal(
+                    match_tensor.permute(permutation), torch_tensor.permute(permutation)
+                )
+
+    def test_views(self):
+        match_tensor, torch_tensor = self.generate_tensor_pair((3, 4, 5))
+        match_view = match_tensor.permute((2, 0, 1))
+        torch_view = torch_tensor.permute(2, 0, 1)
+        with self.subTest(msg="layout"):
+            self.assertTrue(match_tensor.is_contiguous())
+            self.assertFalse(match_view.is_contiguous())
+            self.assertEqual(match_view.stride, torch_view.stride())
+            self.assertTrue(match_view.contiguous().is_contiguous())
+            self.almost_equal(match_view.contiguous(), torch_view.contiguous())
+        with self.subTest(msg="operations"):
+            self.almost_equal(match_view.exp(), torch_view.exp())
+            self.almost_equal(match_view * 2, torch_view * 2)
+            self.almost_equal(match_view - match_view.contiguous(), torch_view - torch_view)
+            self.almost_equal(match_view.sum((1,), False), torch_view.sum(1))
+            self.almost_equal(match_view.reshape((20, 3)), torch_view.reshape(20, 3))
+            self.almost_equal(
+                match_tensor[0, 1:].transpose() @ match_tensor[1, :3],
+                torch_tensor[0, 1:].T @ torch_tensor[1, :3],
+            )
+        with self.subTest(msg="shared_storage"):
+            match_tensor[1:, ::2].fill_(3)
+            torch_tensor[1:, ::2].fill_(3)
+            self.almost_equal(match_tensor, torch_tensor)
+            match_tensor.transpose().relu_()
+            self.almost_equal(match_tensor, torch_tensor.relu())
+
     def test_reshape(self):
         with self.subTest(msg="nd_to_nd"):
             match_tensor, torch_tensor = self.generate_tensor_pair(
@@ -627,6 +733,293 @@ class TestTensorBase(BaseUnitTest):
         )
         self.almost_equal(match_tensorbase.relu(), torch_tensor.relu())
 
+    def test_instruction_set(self):
+        self.assertIn(
+            match.tensorbase.instruction_set(), ("baseline", "avx2", "avx512")
+        )
+
+    def test_transcendental_random(self):
+        match_tensorbase, torch_tensor = self.generate_tensor_pair((7, 33))
+        with self.subTest(msg="exp"):
+            self.almost_equal(match_tensorbase.exp(), torch_tensor.exp())
+        with self.subTest(msg="log"):
+            self.almost_equal(match_tensorbase.abs().log(), torch_tensor.abs().log())
+        with self.subTest(msg="tanh"):
+            self.almost_equal(match_tensorbase.tanh(), torch_tensor.tanh())
+        with self.subTest(msg="sigmoid"):
+            self.almost_equal(match_tensorbase.sigmoid(), torch_tensor.sigmoid())
+        with self.subTest(msg="pow"):
+            self.almost_equal(match_tensorbase.abs() ** 1.7, torch_tensor.abs() ** 1.7)
+
+    def test_transcendental_special_values(self):
+        values = [0.0, 800.0, -800.0, float("inf"), float("-inf")]
+        match_tensorbase = TensorBase((len(values),))
+        for i, value in enumerate(values):
+            match_tensorbase[i] = value
+        torch_tensor = torch.tensor(values, dtype=torch.float64)
+        with self.subTest(msg="exp"):
+            self.assertEqual(match_tensorbase.exp()._raw_data, torch_tensor.exp().tolist())
+        with self.subTest(msg="log"):
+            self.almost_equal(match_tensorbase.log(), torch_tensor.log(), equal_nan=True)
+        with self.subTest(msg="tanh"):
+            self.assertEqual(match_tensorbase.tanh()._raw_data, torch_tensor.tanh().tolist())
+        with self.subTest(msg="sigmoid"):
+            self.assertEqual(match_tensorbase.sigmoid()._raw_data, torch_tensor.sigmoid().tolist())
+
+    def test_fast_math(self):
+        self.assertFalse(match.tensorbase.get_fast_math())
+        match_tensorbase, torch_tensor = self.generate_tensor_pair((7, 33))
+        match.tensorbase.set_fast_math(True)
+        try:
+            self.assertTrue(match.tensorbase.get_fast_math())
+            with self.subTest(msg="exp"):
+                self.almost_equal(match_tensorbase.exp(), torch_tensor.exp())
+            with self.subTest(msg="log"):
+                self.almost_equal(match_tensorbase.abs().log(), torch_tensor.abs().log())
+            with self.subTest(msg="tanh"):
+                self.almost_equal(match_tensorbase.tanh(), torch_tensor.tanh())
+            with self.subTest(msg="sigmoid"):
+                self.almost_equal(match_tensorbase.sigmoid(), torch_tensor.sigmoid())
+            with self.subTest(msg="pow"):
+                self.almost_equal(match_tensorbase ** 1.7, torch_tensor ** 1.7, equal_nan=True)
+        finally:
+            match.tensorbase.set_fast_math(False)
+        self.assertFalse(match.tensorbase.get_fast_math())
+
+    def test_num_threads(self):
+        num_threads = match.tensorbase.get_num_threads()
+        self.assertGreaterEqual(num_threads, 1)
+        with self.assertRaises(ValueError):
+            match.tensorbase.set_num_threads(0)
+        # Large enough for every kernel to be shared out between the threads.
+        match_tensorbase, torch_tensor = self.generate_tensor_pair((300, 257))
+        match.tensorbase.set_num_threads(4)
+        try:
+            self.assertEqual(match.tensorbase.get_num_threads(), 4)
+            with self.subTest(msg="elementwise"):
+                self.almost_equal(match_tensorbase * match_tensorbase, torch_tensor * torch_tensor)
+                self.almost_equal(match_tensorbase.exp(), torch_tensor.exp())
+            with self.subTest(msg="broadcast"):
+                self.almost_equal(
+                    match_tensorbase + match_tensorbase.sum((0,), True),
+                    torch_tensor + torch_tensor.sum(0, keepdim=True),
+                )
+            with self.subTest(msg="matmul"):
+                self.almost_equal(
+                    match_tensorbase @ match_tensorbase.transpose(), torch_tensor @ torch_tensor.T
+                )
+            with self.subTest(msg="aggregate"):
+                self.almost_equal(match_tensorbase.sum((0,), False), torch_tensor.sum(0))
+                self.almost_equal(match_tensorbase.max((1,), True), torch_tensor.max(1, keepdim=True).values)
+                self.almost_equal(match_tensorbase.argmin((), False), torch_tensor.argmin())
+            with self.subTest(msg="permute"):
+                self.almost_equal(match_tensorbase.transpose().contiguous(), torch_tensor.T.contiguous())
+        finally:
+            match.tensorbase.set_num_threads(num_threads)
+        self.assertEqual(match.tensorbase.get_num_threads(), num_threads)
+
+    def test_caching_allocator(self):
+        match_tensorbase, torch_tensor = self.generate_tensor_pair((123, 77))
+        # The first step warms the cache; every step after it reuses those buffers.
+        self.almost_equal(match_tensorbase * match_tensorbase + 1, torch_tensor * torch_tensor + 1)
+        stats = match.tensorbase.memory_stats()
+        for _ in range(10):
+            self.almost_equal(match_tensorbase * match_tensorbase + 1, torch_tensor * torch_tensor + 1)
+        self.assertEqual(match.tensorbase.memory_stats()["system_allocations"], stats["system_allocations"])
+        self.assertGreater(match.tensorbase.memory_stats()["allocations"], stats["allocations"])
+        match.tensorbase.empty_cache()
+        stats = match.tensorbase.memory_stats()
+        self.assertEqual(stats["cached_bytes"], 0)
+        self.assertLessEqual(stats["allocated_bytes"], stats["peak_allocated_bytes"])
+
+    def test_buffer_protocol(self):
+        match_tensorbase, torch_tensor = self.generate_tensor_pair((5, 7, 3))
+        with self.subTest(msg="contiguous"):
+            view = memoryview(match_tensorbase)
+            self.assertEqual((view.format, view.shape, view.strides), ("d", (5, 7, 3), (168, 24, 8)))
+            self.assertEqual(view.cast("B").cast("d").tolist(), match_tensorbase._raw_data)
+            self.assertIsNone(match_tensorbase.__array_interface__["strides"])
+        with self.subTest(msg="strided"):
+            permuted = match_tensorbase.permute((2, 0, 1))
+            view = memoryview(permuted)
+            self.assertEqual(view.strides, (8, 168, 24))
+            self.assertTrue(torch.allclose(torch.tensor(view.tolist()), torch_tensor.permute(2, 0, 1)))
+            self.assertEqual(permuted.__array_interface__["strides"], (8, 168, 24))
+            with self.assertRaises(BufferError):
+                permuted.__buffer__(0)  # A contiguous buffer without strides.
+        with self.subTest(msg="dtypes"):
+            self.assertEqual(memoryview(match_tensorbase > 0).tolist(), (torch_tensor > 0).tolist())
+            self.assertEqual(memoryview(match_tensorbase.argmax((2,), False)).tolist(), torch_tensor.argmax(2).tolist())
+            self.assertEqual(match_tensorbase.to("float32").__array_interface__["typestr"][1:], "f4")
+        with self.subTest(msg="shared memory"):
+            # Writes through the memoryview are seen by the tensor, and the memoryview outlives it.
+            view = memoryview(match_tensorbase.sum((0,), False))
+            view[1, 2] = 42.0
+            self.assertEqual(view[1, 2], 42.0)
+            self.assertTrue(torch.allclose(torch.tensor(view.tolist())[0], torch_tensor.sum(0)[0]))
+
+    def test_bulk_construction(self):
+        torch_tensor = torch.randn(6, 5, 4, dtype=torch.float64)
+        with self.subTest(msg="from_sequence"):
+            self.almost_equal(TensorBase.from_sequence(torch_tensor.tolist()), torch_tensor)
+            match_tensorbase = TensorBase.from_sequence([[1, 2], [3, 4]], dtype="int64")
+            self.assertEqual(match_tensorbase.dtype, "int64")
+            self.assertEqual(match_tensorbase.sum((), False).item(), 10)
+            self.assertEqual(TensorBase.from_sequence(2.5).item(), 2.5)
+            with self.assertRaises(ValueError):
+                TensorBase.from_sequence([[1, 2], [3]])
+        with self.subTest(msg="buffer"):
+            match_tensorbase = TensorBase(torch_tensor.numpy())
+            self.assertEqual(match_tensorbase.dtype, "float64")
+            self.almost_equal(match_tensorbase, torch_tensor)
+            # Strided buffers are copied in row-major order, converting to the requested dtype.
+            match_tensorbase = TensorBase(torch_tensor.permute(2, 0, 1).numpy(), dtype="float32")
+            self.assertEqual(match_tensorbase.dtype, "float32")
+            self.almost_equal(match_tensorbase, torch_tensor.permute(2, 0, 1))
+            pixels = torch.randint(0, 256, (7, 9), dtype=torch.uint8)
+            self.almost_equal(TensorBase(pixels.numpy(), dtype="float64"), pixels.double())
+            self.almost_equal(TensorBase.from_sequence(pixels.numpy()), pixels.long())
+            # Without a dtype, from_sequence keeps the buffer's element type, like the constructor.
+            for source, dtype in [(torch.arange(-3, 9, dtype=torch.int64), "int64"), (torch_tensor.float(), "float32")]:
+                constructed, converted = TensorBase(source.numpy()), TensorBase.from_sequence(source.numpy())
+                self.assertEqual(constructed.dtype, dtype)
+                self.assertEqual(converted.dtype, dtype)
+                self.almost_equal(converted, source)
+        with self.subTest(msg="frombuffer"):
+            match_tensorbase = TensorBase.frombuffer(torch_tensor.numpy().tobytes())
+            self.almost_equal(match_tensorbase, torch_tensor.flatten())
+            with self.assertRaises(ValueError):
+                TensorBase.frombuffer(b"abc")
+
+    def test_inplace_and_out(self):
+        operators_to_test = {
+            "add": (operator.iadd, operator.add),
+            "sub": (operator.isub, operator.sub),
+            "mul": (operator.imul, operator.mul),
+            "truediv": (operator.itruediv, operator.truediv),
+        }
+        for msg, (inplace_op, op) in operators_to_test.items():
+            with self.subTest(msg=msg):
+                for rhs_shape in [(4, 5), (5,), (4, 1)]:
+                    match_tensorbase, torch_tensor = self.generate_tensor_pair((4, 5))
+                    match_rhs, torch_rhs = self.generate_tensor_pair(rhs_shape)
+                    result = inplace_op(match_tensorbase, match_rhs)
+                    # The elements of the left-hand side are updated, rather than a new tensor bound to its name.
+                    self.assertIs(result, match_tensorbase)
+                    self.almost_equal(match_tensorbase, op(torch_tensor, torch_rhs))
+        with self.subTest(msg="view"):
+            match_tensorbase, torch_tensor = self.generate_tensor_pair((6, 8))
+            view = match_tensorbase.transpose()
+            view += match_tensorbase.transpose()
+            self.almost_equal(match_tensorbase, torch_tensor * 2)
+        with self.subTest(msg="fallback"):
+            # The result of an integer tensor, or of a larger right-hand side, does not fit in the left-hand side.
+            match_tensorbase = TensorBase.from_sequence([1, 2, 3], dtype="int64")
+            match_tensorbase += 0.5
+            self.assertEqual(match_tensorbase.dtype, "float64")
+        with self.subTest(msg="out"):
+            match_tensorbase, torch_tensor = self.generate_tensor_pair((4, 5))
+            match_rhs, torch_rhs = self.generate_tensor_pair((5,))
+            out = TensorBase((4, 5))
+            self.assertIs(match_tensorbase.mul(match_rhs, out=out), out)
+            self.almost_equal(out, torch_tensor * torch_rhs)
+            with self.assertRaises(ValueError):
+                match_tensorbase.add(match_rhs, out=TensorBase((5, 4)))
+        with self.subTest(msg="matmul out"):
+            match_lhs, torch_lhs = self.generate_tensor_pair((3, 4, 5))
+            match_rhs, torch_rhs = self.generate_tensor_pair((5, 6))
+            out = TensorBase((3, 4, 6))
+            self.assertIs(match_lhs.matmul(match_rhs, out=out), out)
+            self.almost_equal(out, torch_lhs @ torch_rhs)
+
+    def test_concatenate_stack_split(self):
+        torch_tensors = [torch.randn(2, size, 4, dtype=torch.float64) for size in (3, 1, 5)]
+        match_tensorbases = [TensorBase(t.numpy()) for t in torch_tensors]
+        # Views are joined through contiguous copies.
+        match_tensorbases[0] = TensorBase(torch_tensors[0].permute(2, 1, 0).numpy()).permute((2, 1, 0))
+        with self.subTest(msg="concatenate"):
+            match_result = TensorBase.concatenate(match_tensorbases, -2)
+            self.almost_equal(match_result, torch.cat(torch_tensors, -2))
+            with self.assertRaises(ValueError):
+                TensorBase.concatenate(match_tensorbases, 0)
+        with self.subTest(msg="split"):
+            for match_piece, torch_piece in zip(match_result.split([3, 1, 5], 1), torch_tensors):
+                self.almost_equal(match_piece, torch_piece)
+            self.assertEqual([piece.size[0] for piece in match_result.split(2)], [2])
+        with self.subTest(msg="stack"):
+            for dim in (0, 2, 3, -1):
+                self.almost_equal(
+                    TensorBase.stack([match_tensorbases[0]] * 3, dim),
+                    torch.stack([torch_tensors[0]] * 3, dim),
+                )
+
+    def test_float32(self):
+        match_tensorbase = TensorBase((37, 53), dtype="float32")
+        match_tensorbase.randn_(0, 5)
+        self.assertEqual(match_tensorbase.dtype, "float32")
+        self.assertEqual(TensorBase((2, 3)).dtype, "float64")
+        with self.assertRaises(ValueError):
+            TensorBase((2, 3), dtype="int8")
+        # The float32 elements convert to float64 exactly, so the torch tensor holds the same values.
+        torch_tensor = self.to_tensor(match_tensorbase)
+        match_other = match_tensorbase.to("float64").transpose().to("float32")
+        torch_other = torch_tensor.T
+        with self.subTest(msg="elementwise"):
+            result = match_tensorbase * 2.5 - match_tensorbase.exp().tanh()
+            self.assertEqual(result.dtype, "float32")
+            self.almost_equal(result, torch_tensor * 2.5 - torch_tensor.exp().tanh())
+        with self.subTest(msg="promotion"):
+            result = match_tensorbase + match_tensorbase.to("float64")
+            self.assertEqual(result.dtype, "float64")
+            self.almost_equal(result, torch_tensor + torch_tensor.double())
+        with self.subTest(msg="matmul"):
+            result = match_tensorbase @ match_other
+            self.assertEqual(result.dtype, "float32")
+            self.almost_equal(result, torch_tensor @ torch_other)
+        with self.subTest(msg="aggregate"):
+            self.assertEqual(match_tensorbase.sum((0,), False).dtype, "float32")
+            self.almost_equal(match_tensorbase.sum((0,), False), torch_tensor.sum(0))
+            self.almost_equal(match_tensorbase.mean((1,), True), torch_tensor.mean(1, keepdim=True))
+            self.almost_equal(match_tensorbase.argmax((1,), False), torch_tensor.argmax(1))
+        with self.subTest(msg="views"):
+            self.almost_equal(match_tensorbase.permute((1, 0)).contiguous(), torch_tensor.permute(1, 0))
+            self.almost_equal(match_tensorbase[3:20:2, 7], torch_tensor[3:20:2, 7])
+            match_tensorbase[0] = 1.5
+            torch_tensor[0] = 1.5
+            self.almost_equal(match_tensorbase, torch_tensor)
+
+    def test_int64_and_bool(self):
+        match_tensorbase, torch_tensor = self.generate_tensor_pair((37, 53))
+        match_other, torch_other = self.generate_tensor_pair((37, 53))
+        with self.subTest(msg="comparisons"):
+            mask = match_tensorbase > 0
+            self.assertEqual(mask.dtype, "bool")
+            self.almost_equal(mask, torch_tensor > 0)
+            self.almost_equal(match_tensorbase.transpose() <= match_other.transpose(), torch_tensor.T <= torch_other.T)
+        with self.subTest(msg="mask_multiply"):
+            for result in (mask * match_other, match_other * mask):
+                self.assertEqual(result.dtype, "float64")
+                self.almost_equal(result, (torch_tensor > 0) * torch_other)
+            self.assertEqual((mask * match_other.to("float32")).dtype, "float32")
+            self.almost_equal(match_other * mask[0], torch_other * (torch_tensor[0] > 0))
+            self.almost_equal(mask + 2.5, (torch_tensor > 0) + 2.5)
+        with self.subTest(msg="argmax"):
+            argmax = match_tensorbase.argmax((1,), False)
+            self.assertEqual(argmax.dtype, "int64")
+            self.assertEqual(match_tensorbase.argmin((), False).dtype, "int64")
+            self.almost_equal(argmax, torch_tensor.argmax(1))
+            self.almost_equal(argmax == argmax.to("float64"), torch.ones(37, dtype=torch.bool))
+        with self.subTest(msg="aggregate"):
+            self.assertEqual(mask.sum((), False).dtype, "int64")
+            self.assertEqual(mask.sum((), False).item(), (torch_tensor > 0).sum().item())
+            self.almost_equal(mask.sum((0,), False), (torch_tensor > 0).sum(0))
+            self.almost_equal(mask.mean((1,), False), (torch_tensor > 0).double().mean(1))
+        with self.subTest(msg="conversion"):
+            self.almost_equal(match_tensorbase.to("int64"), torch_tensor.to(torch.int64))
+            self.almost_equal(mask.exp(), (torch_tensor > 0).double().exp())
+            with self.assertRaises(TypeError):
+                mask.exp_()
+
     def test_bin_operators_broadcast_success(self):
         operators_to_test = {
             "add": operator.add,
@@ -714,6 +1107,26 @@ class TestTensorBase(BaseUnitTest):
                         op(-3.47, torch_tensor_singleton),
                     )
 
+    def test_bin_operators_broadcast_random(self):
+        shape_pairs = [
+            ((5, 7), (7,)),
+            ((5, 7), (5, 1)),
+            ((5, 1), (1, 7)),
+            ((4, 1, 1, 3), (2, 1)),
+            ((2, 1, 3, 1, 2), (1, 4, 1, 5, 1)),
+            ((6,), (2, 3, 6)),
+        ]
+        for lhs_shape, rhs_shape in shape_pairs:
+            with self.subTest(msg=f"{lhs_shape}_{rhs_shape}"):
+                match_tensorbase1, torch_tensor1 = self.generate_tensor_pair(lhs_shape)
+                match_tensorbase2, torch_tensor2 = self.generate_tensor_pair(rhs_shape)
+                self.almost_equal(
+                    match_tensorbase1 - match_tensorbase2, torch_tensor1 - torch_tensor2
+                )
+                self.almost_equal(
+                    match_tensorbase2 * match_tensorbase1, torch_tensor2 * torch_tensor1
+                )
+
     def test_operators_broadcast_failure(self):
         operators_to_test = {
             "add": operator.add,